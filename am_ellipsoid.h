@@ -32,6 +32,14 @@ namespace pool_shape {
          	_p_width(p_width), _p_depth(p_depth), _tail_length(tail_length), _cap_height(cap_height), _HAZ_width(HAZ_width), _tail_HAZ(tail_HAZ) {}
 
          virtual ~AmEllipsoid(){}
+
+         // Pool trails along -x (tail) and leads along +x (cap);
+         //    it is centered on y and lies below the layer surface z=0
+         virtual void bounding_box(double *lo, double *hi) const {
+            lo[0]=-_tail_length; hi[0]=_cap_height;
+            lo[1]=-0.5*_p_width; hi[1]=0.5*_p_width;
+            lo[2]=-_p_depth;     hi[2]=0.0;
+         }
          
          
          bool is_inside(const double *XYZ) const {
@@ -28,6 +28,9 @@ namespace pool_shape {
    class PoolShape {
       public:
          virtual double distance(const double *XYZ) const = 0;
+         // Axis aligned box enclosing pool in pool coordinates; 
+         //    every point outside of box has distance > 0
+         virtual void bounding_box(double *lo, double *hi) const = 0;
          PoolShape() {}
          virtual ~PoolShape() {}
    };
@@ -16,7 +16,11 @@
 #include "app.h"
 #include "domain.h"
 #include "finish.h"
+#include "output.h"
+#include "ensemble.h"
 #include "timer.h"
+#include "solve.h"
+#include "site_index.h"
 #include "memory.h"
 #include "error.h"
 
@@ -40,6 +44,10 @@ App::App(SPPARKS *spk, int narg, char **arg) : Pointers(spk)
   iarray = NULL;
   darray = NULL;
 
+  sitestamp = 0;
+  valuestamp = 0;
+  sitelookup = NULL;
+
   sites_exist = 0;
 }
 
@@ -48,6 +56,7 @@ App::App(SPPARKS *spk, int narg, char **arg) : Pointers(spk)
 App::~App()
 {
   delete [] style;
+  delete sitelookup;
 
   memory->destroy(id);
   memory->destroy(xyz);
@@ -139,7 +148,15 @@ void App::run(int narg, char **arg)
 
   if (stoptime > time) iterate();
 
+  // off-lattice sites may have moved, been created or deleted
+
+  if (appclass == OFF_LATTICE) sitestamp++;
+
   Finish finish(spk,postflag);
+
+  // combine stats of all partitions once run is done
+
+  if (output->ensemble) output->ensemble->reduce();
 }
 
 /* ---------------------------------------------------------------------- */
@@ -190,6 +207,46 @@ void *App::extract(char *name)
   return extract_app(name);
 }
 
+/* ----------------------------------------------------------------------
+   return a pointer to a named per-site array of owned sites
+   dtype = INT32, INT64, DOUBLE for type of values
+   n = # of owned sites, ncol = # of values per site, stored contiguously
+   ghost values may follow the owned ones, but are not included in n
+   return NULL if name is not recognized
+ ------------------------------------------------------------------------- */
+
+void *App::extract_array(char *name, int *dtype, int *n, int *ncol)
+{
+  *n = nlocal;
+  *ncol = 1;
+
+  if (strcmp(name,"id") == 0) {
+    *dtype = sizeof(tagint) == 8 ? INT64 : INT32;
+    return (void *) id;
+  }
+  if (strcmp(name,"xyz") == 0) {
+    *dtype = DOUBLE;
+    *ncol = 3;
+    if (xyz == NULL) return NULL;
+    return (void *) xyz[0];
+  }
+
+  if (strstr(name,"iarray") == name) {
+    int m = atoi(&name[6]);
+    if (m < 1 || m > ninteger) return NULL;
+    *dtype = INT32;
+    return (void *) iarray[m-1];
+  }
+  if (strstr(name,"darray") == name) {
+    int m = atoi(&name[6]);
+    if (m < 1 || m > ndouble) return NULL;
+    *dtype = DOUBLE;
+    return (void *) darray[m-1];
+  }
+
+  return NULL;
+}
+
 /* ----------------------------------------------------------------------
    return min ID
    may not be 1 if site IDs are not contiguous
@@ -240,3 +297,13 @@ int App::contiguous_sites()
   return 1;
 }
 
+
+/* ----------------------------------------------------------------------
+   return # of bytes of memory allocated by the solver
+------------------------------------------------------------------------- */
+
+bigint App::memory_usage_solve()
+{
+  if (solve) return solve->memory_usage();
+  return 0;
+}
@@ -21,6 +21,7 @@ namespace SPPARKS_NS {
 class App : protected Pointers {
  public:
   enum APP_CLASSES{GENERAL,LATTICE,OFF_LATTICE};
+  enum ARRAY_TYPES{INT32,INT64,DOUBLE};   // same as SPPARKS_INT32, etc
 
   int appclass;           // one of the enum values
   char *style;            // style name of app
@@ -40,14 +41,21 @@ class App : protected Pointers {
   int **iarray;                // one or more ints per site
   double **darray;             // one or more doubles per site
 
+  bigint sitestamp;            // incremented when sites are added or move
+  bigint valuestamp;           // incremented when commands set site values
+  class SiteIndex *sitelookup; // ID and spatial index of owned sites
+
   App(class SPPARKS *, int, char **);
   virtual ~App();
   void run(int, char **);
   void reset_time(double);
   void *extract(char *);
+  virtual void *extract_array(char *, int *, int *, int *);
   tagint min_site_ID();
   tagint max_site_ID();
   virtual bigint memory_usage() {return 0;}
+  virtual bigint memory_usage_solve();
+  virtual bigint memory_usage_comm() {return 0;}
 
   // pure virtual functions, must be defined in child class
   
@@ -20,13 +20,20 @@
 ------------------------------------------------------------------------- */
 
 #include "math.h"
+#include "stdio.h"
 #include "mpi.h"
 #include "stdlib.h"
 #include "string.h"
+#include <algorithm>
 #include "app_ald.h"
+#include "domain.h"
 #include "solve.h"
 #include "random_park.h"
 #include "memory.h"
+#include "timer.h"
+#include "input.h"
+#include "variable.h"
+#include "diag_kmc_profile.h"
 #include "error.h"
 
 using namespace SPPARKS_NS;
@@ -39,8 +46,21 @@ HfX2,HfHX2,HfH2X2,//29
 HfHX,HfX,Hf,//32
 OH2HfX,OH2HfHX,OH2Hf,OHHfHX,OH2,Si};//38 same as DiagAld
 
+// species names in enum order, used by event library files
+
+static const char *species_names[] = {"VAC","O","OH",
+  "HfX4O","HfX4OH","HfHX4O","HfHX4OH","HfH2X4O","HfH2X4OH",
+  "HfH3X4O","HfH3X4OH","HfH4X4O","HfH4X4OH",
+  "HfX3O","HfX3OH","HfHX3O","HfHX3OH","HfH2X3O","HfH2X3OH",
+  "HfH3X3O","HfH3X3OH",
+  "HfX2O","HfX2OH","HfHX2O","HfHX2OH","HfH2X2O","HfH2X2OH",
+  "HfX2","HfHX2","HfH2X2",
+  "HfHX","HfX","Hf",
+  "OH2HfX","OH2HfHX","OH2Hf","OHHfHX","OH2","Si"};
 
 #define DELTAEVENT 100000
+#define EVENTMAGIC "SPPARKS ALD events"
+#define EVENTFORMAT 1
 
 /* ---------------------------------------------------------------------- */
 
@@ -54,7 +74,11 @@ AppAld::AppAld(SPPARKS *spk, int narg, char **arg) :
   allow_kmc = 1;
   allow_rejection = 0;
   allow_masking = 0;
-  
+  allow_balance = 1;
+  allow_active = 1;
+  allow_threads = 1;
+  allow_keep = 1;
+  allow_app_update = 1;
 
   create_arrays();
 
@@ -64,15 +88,29 @@ AppAld::AppAld(SPPARKS *spk, int narg, char **arg) :
   pressureOn = 1;
   hello = 1;
   firsttime = 1;
+  maxlocal = 0;
   esites = NULL;
   echeck = NULL;
   events = NULL;
   maxevent = 0;
   firstevent = NULL;
+  rfirst = NULL;
+  nreaction = 0;
+
+  schedules = NULL;
+  nschedule = 0;
+  rate_every = 0.0;
+  rscale = NULL;
+
+  nthreads = 0;
+  tcomneigh = NULL;
+  tsite = NULL;
+  tevent = NULL;
 
   // reaction lists
 
   none = ntwo = nthree = 0;
+  maxone = maxtwo = maxthree = 0;
   srate = drate = vrate = NULL;
   spropensity = dpropensity = vpropensity = NULL;
   sinput = soutput = NULL;
@@ -90,10 +128,21 @@ AppAld::AppAld(SPPARKS *spk, int narg, char **arg) :
 
 AppAld::~AppAld()
 {
-  delete [] esites;
+  memory->sfree(esites);
   delete [] echeck;
   memory->sfree(events);
   memory->sfree(firstevent);
+  memory->destroy(rfirst);
+  memory->destroy(rscale);
+  for (int m = 0; m < nschedule; m++) {
+    delete [] schedules[m].id;
+    memory->destroy(schedules[m].ttable);
+    memory->destroy(schedules[m].vtable);
+  }
+  memory->sfree(schedules);
+  memory->destroy(tcomneigh);
+  delete [] tsite;
+  delete [] tevent;
   memory->sfree(srate);
   memory->sfree(drate);
   memory->sfree(vrate);
@@ -130,8 +179,11 @@ void AppAld::input_app(char *command, int narg, char **arg)
 {
   if (strcmp(command,"event") == 0) {
     if (narg < 1) error->all(FLERR,"Illegal event command");
+    setupflag = SETUP_ALL;
     int rstyle = atoi(arg[0]);
-    grow_reactions(rstyle);
+    if (rstyle == 1) grow_reactions(rstyle,none+1);
+    else if (rstyle == 2) grow_reactions(rstyle,ntwo+1);
+    else if (rstyle == 3) grow_reactions(rstyle,nthree+1);
 
     if (rstyle == 1) {
       if (narg != 9) error->all(FLERR,"Illegal event arg command");
@@ -418,7 +470,16 @@ void AppAld::input_app(char *command, int narg, char **arg)
 
     } else error->all(FLERR,"Illegal event command37");
   } 
+  else if (strcmp(command,"event_file") == 0) {
+    setupflag = SETUP_ALL;
+    event_file(narg,arg);
+  }
+  else if (strcmp(command,"write_event_file") == 0) {
+    write_event_file(narg,arg);
+  }
   else if (strcmp(command,"pulse_time") == 0) {
+    // pulse and purge times only affect events after current time,
+    //   so they leave setupflag alone
     if (narg != 2) error->all(FLERR,"Illegal pulse time");
       T1 = atof(arg[0]);
       T3 = atof(arg[1]);
@@ -427,6 +488,11 @@ void AppAld::input_app(char *command, int narg, char **arg)
     if (narg != 2) error->all(FLERR,"Illegal purge time");
       T2 = atof(arg[0]);
       T4 = atof(arg[1]);
+  }
+  else if (strcmp(command,"rate_schedule") == 0) {
+    // setup_app() compares rate tables to the kept ones,
+    //   so a new schedule leaves setupflag alone
+    rate_schedule(narg,arg);
   }else error->all(FLERR,"Unrecognized command38");
 }
 
@@ -450,20 +516,68 @@ void AppAld::init_app()
   if (firsttime) {
     firsttime = 0;
 
-    echeck = new int[nlocal];
-    firstevent = (int *) memory->smalloc(nlocal*sizeof(int),"app:firstevent");
     //comneigh was defined to avoid double counting of common neighbor in site_propensity
     comneigh = memory->grow(comneigh,12*maxneigh,2,"app/ald:comneigh");
     // esites must be large enough for 3 sites and their 1st neighbors
     
     esites = (int *) memory->smalloc(12*maxneigh*sizeof(int),"app:esites");
     //esites = new int[12*maxneigh]; 
+
+    tselect = timer->find_region("ald_select");
+    tcoord = timer->find_region("ald_update_coord");
+    tpropensity = timer->find_region("ald_propensity");
+    tclear = timer->find_region("ald_clear_events");
+  }
+
+  // per-site arrays, reallocated if balance command increased nlocal
+
+  if (nlocal > maxlocal) {
+    maxlocal = nlocal;
+    delete [] echeck;
+    echeck = new int[maxlocal];
+    firstevent = (int *)
+      memory->srealloc(firstevent,maxlocal*sizeof(int),"app:firstevent");
+  }
+
+  // per-reaction arrays, reallocated if event command added reactions
+  // event command forces a full setup, so rfirst is rebuilt before use
+
+  if (none + ntwo + nthree != nreaction) {
+    nreaction = none + ntwo + nthree;
+    memory->destroy(rfirst);
+    memory->destroy(rscale);
+    memory->create(rfirst,nreaction,"app/ald:rfirst");
+    memory->create(rscale,nreaction,"app/ald:rscale");
+    for (int m = 0; m < nreaction; m++) rfirst[m] = -1;
+  }
+
+  // rate schedules
+
+  for (int m = 0; m < nschedule; m++) {
+    Schedule *sched = &schedules[m];
+    if ((sched->style == 1 && sched->which >= none) ||
+	(sched->style == 2 && sched->which >= ntwo) ||
+	(sched->style == 3 && sched->which >= nthree))
+      error->all(FLERR,"Rate_schedule reaction does not exist");
+    if (sched->style) 
+      sched->reaction = reaction_index(sched->style,sched->which);
+    if (sched->id) {
+      sched->ivar = spk->input->variable->find(sched->id);
+      if (sched->ivar < 0)
+	error->all(FLERR,"Variable name for rate_schedule does not exist");
+      if (!spk->input->variable->equalstyle(sched->ivar))
+	error->all(FLERR,"Variable for rate_schedule is invalid style");
+    }
   }
+  if (nschedule && rate_every <= 0.0)
+    error->all(FLERR,"Rate_schedule every must be set");
+
   // site validity
+  // put_mask() lowers coord by 10 per mask, so no lower bound after a run
 
   int flag = 0;
   for (int i = 0; i < nlocal; i++) {
-    if (coord[i] < -1 || coord[i] > 8) flag = 1;
+    if (coord[i] > 8) flag = 1;
     if (element[i] < VACANCY || element[i] > Si) flag = 1;
   }
   int flagall;
@@ -474,32 +588,69 @@ void AppAld::init_app()
 
 void AppAld::setup_app()
 {
-  for (int i = 0; i < nlocal; i++) echeck[i] = 0;
-  
-
-  nevents = 0;
-  for (int i = 0; i < nlocal; i++) firstevent[i] = -1;
-  for (int i = 0; i < maxevent; i++) events[i].next = i+1;
-  freeevent = 0;
+  // scheduled temperature and rate scales at start of run
 
+  evaluate_schedules();
+  nextrate = time + rate_every;
 
   if (temperature == 0.0)
     error->all(FLERR,"Temperature cannot be 0.0 for app_ald");
+
+  // type II events of equal propensity on the same partner are merged,
+  //   so new rates that change which ones are equal need a full setup
+  // kept events only need new propensities if a schedule changed a rate
+
+  std::vector<double> sprevious(spropensity,spropensity+none);
+  std::vector<double> dprevious(dpropensity,dpropensity+ntwo);
+  std::vector<double> vprevious(vpropensity,vpropensity+nthree);
+
+  compute_rates();
+
   for (int m = 0; m < none; m++) {
-    spropensity[m] = sA[m]*pow(temperature,sexpon[m])*exp(-srate[m]/temperature);
-    scount[m] = 0;
+    if (!rebalanceflag) scount[m] = 0;
   if (spropensity[m] == 0.0) error->warning(FLERR," spropensity cannot be 0.0 for app_ald");
   }
   for (int m = 0; m < ntwo; m++) {
-    dpropensity[m] = dA[m]*pow(temperature,dexpon[m])*exp(-drate[m]/temperature);
-    dcount[m] = 0;
+    if (!rebalanceflag) dcount[m] = 0;
   if (dpropensity[m] == 0.0) error->warning(FLERR,"dpropensity cannot be 0.0 for app_ald");
   }
   for (int m = 0; m < nthree; m++) {
-    vpropensity[m] = vA[m]*pow(temperature,vexpon[m])*exp(-vrate[m]/temperature);
-    vcount[m] = 0;
+    if (!rebalanceflag) vcount[m] = 0;
   if (vpropensity[m] == 0.0) error->warning(FLERR,"vpropensity cannot be 0.0 for app_ald");
   }
+
+  if (setupflag == SETUP_NONE &&
+      (sprevious != std::vector<double>(spropensity,spropensity+none) ||
+       dprevious != std::vector<double>(dpropensity,dpropensity+ntwo) ||
+       vprevious != std::vector<double>(vpropensity,vpropensity+nthree)))
+    setupflag = SETUP_RATES;
+
+  if (setupflag == SETUP_RATES)
+    for (int m = 0; m < ntwo; m++)
+      for (int n = m+1; n < ntwo; n++)
+	if ((dprevious[m] == dprevious[n]) != 
+	    (dpropensity[m] == dpropensity[n])) setupflag = SETUP_ALL;
+
+  // event lists are rebuilt from scratch unless kept from previous run
+
+  if (setupflag != SETUP_ALL) return;
+
+  for (int i = 0; i < nlocal; i++) echeck[i] = 0;
+
+  nevents = 0;
+  for (int i = 0; i < nlocal; i++) firstevent[i] = -1;
+  for (int i = 0; i < maxevent; i++) events[i].next = i+1;
+  for (int m = 0; m < nreaction; m++) rfirst[m] = -1;
+  freeevent = 0;
+}
+
+/* ----------------------------------------------------------------------
+   shrink event list to fit once all initial propensities are computed
+------------------------------------------------------------------------- */
+
+void AppAld::setup_end_app()
+{
+  if (setupflag == SETUP_ALL) compact_events();
 }
 
 /* ----------------------------------------------------------------------
@@ -518,10 +669,25 @@ double AppAld::site_energy(int i)
 
 double AppAld::site_propensity(int i)
 {
-  int j,k,m;
-
+  timer->region_start(tpropensity);
 
   clear_events(i);
+  double proball = find_events(i,comneigh,-1);
+
+  timer->region_stop(tpropensity);
+  return proball;
+}
+
+/* ----------------------------------------------------------------------
+   find possible events of owned site I and return their total propensity
+   cn = scratch to avoid double counting type II events
+   ithread < 0: add events to site's list
+   ithread >= 0: buffer events for merge_threads(), events list untouched
+------------------------------------------------------------------------- */
+
+double AppAld::find_events(int i, double **comneigh, int ithread)
+{
+  int j,k,m,comevent;
 
   double proball = 0.0;
 
@@ -534,7 +700,7 @@ double AppAld::site_propensity(int i)
   for (m = 0; m < none; m++) {
     if (element[i] != sinput[m]) continue;
     if ((coord[i] == scoord[m] || scoord[m] == 0) && (spresson[m] == pressureOn || spresson[m] == 0)) {
-	    add_event(i,1,m,spropensity[m],-1,-1);
+	    found_event(i,1,m,spropensity[m],-1,-1,ithread);
 	    proball += spropensity[m];
     }
   }
@@ -556,7 +722,7 @@ double AppAld::site_propensity(int i)
   	      if ( comneigh[ii][0] == k && comneigh[ii][1] == dpropensity[m]) comevent = 0;
   	      }
   	      if (comevent){	
-                add_event(i,2,m,dpropensity[m],-1,k);
+                found_event(i,2,m,dpropensity[m],-1,k,ithread);
                 proball += dpropensity[m];
   	        comneigh[nextneib][0] = k;
                   comneigh[nextneib][1] = dpropensity[m];
@@ -575,16 +741,116 @@ double AppAld::site_propensity(int i)
     j = neighbor[i][jj];
       for (m =0; m < nthree; m++) { 
 	if (element[i] == vinput[m][0] && element[j] == vinput[m][1] && (coord[i] == vcoord[m] || vcoord[m] == 0) && (dpresson[m] == pressureOn || dpresson[m] == 0)) {
-	add_event(i,3,m,vpropensity[m],j,-1);
+	found_event(i,3,m,vpropensity[m],j,-1,ithread);
 	proball += vpropensity[m];
       }
     }
   }
 
+  return proball;
+}
+
+/* ----------------------------------------------------------------------
+   KMC method
+   refresh propensity of each kept event of owned site I from rate tables
+   events are stored newest first, so sum them in the order found
+------------------------------------------------------------------------- */
+
+double AppAld::site_propensity_rates(int i)
+{
+  rscratch.clear();
+  for (int ievent = firstevent[i]; ievent >= 0; ievent = events[ievent].next) {
+    Event &event = events[ievent];
+    if (event.style == 1) event.propensity = spropensity[event.which];
+    else if (event.style == 2) event.propensity = dpropensity[event.which];
+    else event.propensity = vpropensity[event.which];
+    rscratch.push_back(event.propensity);
+  }
 
+  double proball = 0.0;
+  for (int m = rscratch.size()-1; m >= 0; m--) proball += rscratch[m];
   return proball;
 }
 
+/* ----------------------------------------------------------------------
+   store one event found by find_events()
+------------------------------------------------------------------------- */
+
+void AppAld::found_event(int i, int rstyle, int which, double propensity,
+			 int jpartner, int kpartner, int ithread)
+{
+  if (ithread < 0) {
+    add_event(i,rstyle,which,propensity,jpartner,kpartner);
+    return;
+  }
+
+  Event event;
+  event.style = rstyle;
+  event.which = which;
+  event.jpartner = jpartner;
+  event.kpartner = kpartner;
+  event.next = -1;
+  event.propensity = propensity;
+  tsite[ithread].push_back(i);
+  tevent[ithread].push_back(event);
+}
+
+/* ----------------------------------------------------------------------
+   allocate per-thread scratch for initial propensities in setup()
+------------------------------------------------------------------------- */
+
+void AppAld::setup_threads(int n)
+{
+  if (n != nthreads) {
+    nthreads = n;
+    memory->destroy(tcomneigh);
+    memory->create(tcomneigh,nthreads,12*maxneigh,2,"app/ald:tcomneigh");
+    delete [] tsite;
+    delete [] tevent;
+    tsite = new std::vector<int>[nthreads];
+    tevent = new std::vector<Event>[nthreads];
+  }
+
+  for (int t = 0; t < nthreads; t++) {
+    for (int m = 0; m < 12*maxneigh; m++)
+      tcomneigh[t][m][0] = tcomneigh[t][m][1] = 0.0;
+    tsite[t].clear();
+    tevent[t].clear();
+  }
+}
+
+/* ----------------------------------------------------------------------
+   KMC method
+   compute total propensity of owned site in a setup thread
+------------------------------------------------------------------------- */
+
+double AppAld::site_propensity_thread(int i, int ithread)
+{
+  return find_events(i,tcomneigh[ithread],ithread);
+}
+
+/* ----------------------------------------------------------------------
+   move events buffered by threads into events list of each site
+   threads took contiguous chunks of list, so each site's events
+     are added in the same order site_propensity() would add them
+------------------------------------------------------------------------- */
+
+void AppAld::merge_threads(int n, int *list)
+{
+  for (int m = 0; m < n; m++) clear_events(list[m]);
+
+  for (int t = 0; t < nthreads; t++) {
+    int nbuf = tsite[t].size();
+    for (int m = 0; m < nbuf; m++) {
+      Event &event = tevent[t][m];
+      add_event(tsite[t][m],event.style,event.which,event.propensity,
+		event.jpartner,event.kpartner);
+    }
+    std::vector<int>().swap(tsite[t]);
+    std::vector<Event>().swap(tevent[t]);
+  }
+}
+
 /* ----------------------------------------------------------------------
    KMC method
    choose and perform an event for site
@@ -599,6 +865,8 @@ void AppAld::site_event(int i, class RandomPark *random)
   
 
 
+  timer->region_start(tselect);
+
   double threshhold = random->uniform() * propensity[i2site[i]];
   double proball = 0.0;
 
@@ -631,7 +899,11 @@ void AppAld::site_event(int i, class RandomPark *random)
     }
   else { error->all(FLERR,"Illegal execution event"); }
 
+  timer->region_stop(tselect);
+
+  timer->region_start(tcoord);
   update_coord(elcoord,i,j,which);
+  timer->region_stop(tcoord);
 
   // sequence of ALD, 
   // 1 is metal pulse, 3 purge, 2 oxygen pulse.
@@ -656,20 +928,10 @@ void AppAld::site_event(int i, class RandomPark *random)
   // for HfX4O, HfX4OH, and HfX2 go to the third and fourth neighbor to set mask
   for (n = 0; n < numneigh[i]; n++) {
     m = neighbor[i][n];
-    isite = i2site[m];
-    if (isite >= 0 && echeck[isite] == 0) {
-      propensity[isite] = site_propensity(m);
-      esites[nsites++] = isite;
-      echeck[isite] = 1;
-    }
+    update_site(m,nsites);
       for (jj = 0; jj< numneigh[m];jj++) {
         mm = neighbor[m][jj];
-        isite = i2site[mm];
-        if (isite >= 0 && echeck[isite] == 0) {
-          propensity[isite] = site_propensity(mm);
-          esites[nsites++] = isite;
-          echeck[isite] = 1;
-        }
+        update_site(mm,nsites);
 	//update mask up to fourth neighbor for HfX4O and HfX4OH
 	if ((elcoord == O || elcoord == OH) && (element[i]== HfX4O || element[i]== HfX4OH) && rstyle == 1) {
 
@@ -677,12 +939,7 @@ void AppAld::site_event(int i, class RandomPark *random)
 	     int s = neighbor[mm][ss];
 	     for (int ll = 0; ll< numneigh[s]; ll++) {
 	       int l = neighbor[s][ll];
-	       isite = i2site[l];
-	       if (isite >= 0 && echeck[isite] == 0) {
-			 propensity[isite] = site_propensity(l);
-			 esites[nsites++] = isite;
-			 echeck[isite] = 1;
-	       }
+	       update_site(l,nsites);
 	     }
 	   }
 	}
@@ -692,12 +949,7 @@ void AppAld::site_event(int i, class RandomPark *random)
 	     int s = neighbor[mm][ss];
 	     for (int ll = 0; ll< numneigh[s]; ll++) {
 	       int l = neighbor[s][ll];
-	       isite = i2site[l];
-	       if (isite >= 0 && echeck[isite] == 0) {
-			 propensity[isite] = site_propensity(l);
-			 esites[nsites++] = isite;
-			 echeck[isite] = 1;
-	       }
+	       update_site(l,nsites);
 	     }
 	   }
 	}
@@ -708,20 +960,10 @@ void AppAld::site_event(int i, class RandomPark *random)
   if (rstyle == 2) {
     for (n = 0; n < numneigh[k]; n++) {
       m = neighbor[k][n];
-      isite = i2site[m];
-      if (isite >= 0 && echeck[isite] == 0) {
-        propensity[isite] = site_propensity(m);
-        esites[nsites++] = isite; 
-        echeck[isite] = 1;
-      }
+      update_site(m,nsites);
       for (jj = 0; jj< numneigh[m];jj++) {
         mm = neighbor[m][jj];
-        isite = i2site[mm];
-        if (isite >= 0 && echeck[isite] == 0) {
-          propensity[isite] = site_propensity(mm);
-          esites[nsites++] = isite; 
-          echeck[isite] = 1;
-        }
+        update_site(mm,nsites);
       }
     }
   }
@@ -730,40 +972,20 @@ void AppAld::site_event(int i, class RandomPark *random)
   if (rstyle == 3) {
     for (n = 0; n < numneigh[j]; n++) {
       m = neighbor[j][n];
-      isite = i2site[m];
-      if (isite >= 0 && echeck[isite] == 0) {
-        propensity[isite] = site_propensity(m);
-        esites[nsites++] = isite;
-        echeck[isite] = 1;
-      }
+      update_site(m,nsites);
       for (jj = 0; jj< numneigh[m];jj++) {
         mm = neighbor[m][jj];
-        isite = i2site[mm];
-        if (isite >= 0 && echeck[isite] == 0) {
-          propensity[isite] = site_propensity(mm);
-          esites[nsites++] = isite;
-          echeck[isite] = 1;
-        }
+        update_site(mm,nsites);
         if ((elcoord == HfX2O || elcoord == HfHX2O || elcoord == HfH2X2O || elcoord == HfH4X4O) && element[i] == O ) {
 	   for (int ss = 0; ss< numneigh[mm]; ss++) {
 	     int s = neighbor[mm][ss];
-	     isite = i2site[s];
-	     if (isite >= 0 && echeck[isite] == 0) {
-		 propensity[isite] = site_propensity(s);
-		 esites[nsites++] = isite;
-		 echeck[isite] = 1;
-	     }
+	     update_site(s,nsites);
 	   }
 	}
         if ((elcoord == HfX2OH || elcoord == HfHX2OH || elcoord == HfH2X2OH || elcoord == HfH4X4OH) && element[i] == OH ) {
 	   for (int ss = 0; ss< numneigh[mm]; ss++) {
 	     int s = neighbor[mm][ss];
-	       isite = i2site[s];
-	       if (isite >= 0 && echeck[isite] == 0) {
-			 propensity[isite] = site_propensity(s);
-			 esites[nsites++] = isite;
-			 echeck[isite] = 1;
-		    }
+	       update_site(s,nsites);
 	     }
 	   }
         if ((elcoord == HfX2 || elcoord == HfHX2 || elcoord == HfH2X2) && element[i] == VACANCY ) {
@@ -771,12 +993,7 @@ void AppAld::site_event(int i, class RandomPark *random)
 	     int s = neighbor[mm][ss];
 	     for (int ll = 0; ll< numneigh[s]; ll++) {
 	       int l = neighbor[s][ll];
-	       isite = i2site[l];
-	       if (isite >= 0 && echeck[isite] == 0) {
-			 propensity[isite] = site_propensity(l);
-			 esites[nsites++] = isite;
-			 echeck[isite] = 1;
-	       }
+	       update_site(l,nsites);
 	     }
 	   }
 	  }
@@ -784,12 +1001,99 @@ void AppAld::site_event(int i, class RandomPark *random)
     }
   }
 
+  if (profile) {
+    int ireaction = which;
+    if (rstyle == 2) ireaction += none;
+    else if (rstyle == 3) ireaction += none + ntwo;
+    profile->event(i,ireaction,nsites);
+  }
+
   solve->update(nsites,esites,propensity);
 
    // clear echeck array
 
   for (m = 0; m < nsites; m++)  {echeck[esites[m]] = 0; esites[m]=0;}
-  
+
+  // KMC without sectors has no app_update(), so scheduled rates
+  //   change at the first event past each update time
+
+  if (nschedule && nset == 1 && time >= nextrate) {
+    while (nextrate <= time) nextrate += rate_every;
+    update_rates();
+  }
+}
+
+/* ----------------------------------------------------------------------
+   KMC with sectors
+   change scheduled rates between passes over the sectors
+   dt = time the pass being finished has advanced
+------------------------------------------------------------------------- */
+
+void AppAld::app_update(double dt)
+{
+  if (nschedule == 0 || time + dt < nextrate) return;
+  while (nextrate <= time + dt) nextrate += rate_every;
+
+  double tcurrent = time;
+  time += dt;
+  update_rates();
+  time = tcurrent;
+}
+
+/* ----------------------------------------------------------------------
+   recompute propensity of owned site i after an event changed its neighborhood
+   echeck and esites are indexed by set index of the site
+   inactive site rejoins the KMC set, it is dropped again at next compaction
+     if its propensity is still zero
+------------------------------------------------------------------------- */
+
+void AppAld::update_site(int i, int &nsites)
+{
+  int isite = i2site[i];
+  if (isite < 0) {
+    if (!can_activate(i)) return;
+    isite = activate(i);
+  } else if (echeck[isite]) return;
+
+  propensity[isite] = site_propensity(i);
+  esites[nsites++] = isite;
+  echeck[isite] = 1;
+}
+
+/* ----------------------------------------------------------------------
+   flag site i as visited by a mask or coordination walk
+   return 1 if i is an owned site in the current set, active or not,
+     which was not visited before
+   echeck and esites are indexed by lattice index of the site,
+     caller must clear them before site_event() uses them
+------------------------------------------------------------------------- */
+
+int AppAld::visit_site(int i, int &nsites)
+{
+  if (i >= nlocal || echeck[i]) return 0;
+  if (i2site[i] < 0 && !can_activate(i)) return 0;
+  esites[nsites++] = i;
+  echeck[i] = 1;
+  return 1;
+}
+
+/* ----------------------------------------------------------------------
+   reactions reported to diag_style kmc_profile
+   single, double, triple reactions in that order, labeled as in diag ald
+------------------------------------------------------------------------- */
+
+int AppAld::profile_reactions()
+{
+  return none + ntwo + nthree;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void AppAld::profile_label(int m, char *str)
+{
+  if (m < none) sprintf(str,"s%d",m+1);
+  else if (m < none + ntwo) sprintf(str,"d%d",m-none+1);
+  else sprintf(str,"v%d",m-none-ntwo+1);
 }
 
 /* ----------------------------------------------------------------------
@@ -799,9 +1103,16 @@ void AppAld::site_event(int i, class RandomPark *random)
 
 void AppAld::clear_events(int i)
 {
+  timer->region_start(tclear);
+
   int next;
   int index = firstevent[i];
   while (index >= 0) {
+    Event &event = events[index];
+    if (event.rprev >= 0) events[event.rprev].rnext = event.rnext;
+    else rfirst[reaction_index(event.style,event.which)] = event.rnext;
+    if (event.rnext >= 0) events[event.rnext].rprev = event.rprev;
+
     next = events[index].next;
     events[index].next = freeevent;
     freeevent = index;
@@ -809,6 +1120,53 @@ void AppAld::clear_events(int i)
     index = next;
   }
   firstevent[i] = -1;
+
+  timer->region_stop(tclear);
+}
+
+/* ----------------------------------------------------------------------
+   copy events of each site contiguously into a list of exactly nevents
+   preserves event order within each site so event selection is unchanged
+   add_event() grows the list again by at most DELTAEVENT when needed
+------------------------------------------------------------------------- */
+
+void AppAld::compact_events()
+{
+  if (nevents == maxevent) return;
+
+  Event *newevents = (Event *) 
+    memory->smalloc(nevents*sizeof(Event),"app:events");
+
+  int m = 0;
+  int ievent;
+  for (int i = 0; i < nlocal; i++) {
+    ievent = firstevent[i];
+    if (ievent < 0) continue;
+    firstevent[i] = m;
+    while (ievent >= 0) {
+      newevents[m] = events[ievent];
+      ievent = events[ievent].next;
+      if (ievent >= 0) newevents[m].next = m+1;
+      else newevents[m].next = -1;
+      m++;
+    }
+  }
+
+  memory->sfree(events);
+  events = newevents;
+  maxevent = nevents;
+  freeevent = nevents;
+
+  // relink events of each reaction at their new indices
+
+  for (m = 0; m < nreaction; m++) rfirst[m] = -1;
+  for (m = nevents-1; m >= 0; m--) {
+    int r = reaction_index(events[m].style,events[m].which);
+    events[m].rprev = -1;
+    events[m].rnext = rfirst[r];
+    if (rfirst[r] >= 0) events[rfirst[r]].rprev = m;
+    rfirst[r] = m;
+  }
 }
 
 /* ----------------------------------------------------------------------
@@ -820,7 +1178,7 @@ void AppAld::add_event(int i, int rstyle, int which, double propensity,
 			  int jpartner, int kpartner)
 {
   if (nevents == maxevent) {
-    maxevent += DELTAEVENT;
+    maxevent += MIN(DELTAEVENT,maxevent/2+1);
     events = 
       (Event *) memory->srealloc(events,maxevent*sizeof(Event),"app:events");
     for (int m = nevents; m < maxevent; m++) events[m].next = m+1;
@@ -834,22 +1192,259 @@ void AppAld::add_event(int i, int rstyle, int which, double propensity,
   events[freeevent].jpartner = jpartner;
   events[freeevent].kpartner = kpartner;
   events[freeevent].propensity = propensity;
+  events[freeevent].site = i;
 
   if ( propensity == 0 ) error->all(FLERR,"propensity in add_event wrong app ald");
   events[freeevent].next = firstevent[i];
   firstevent[i] = freeevent;
+
+  int r = reaction_index(rstyle,which);
+  events[freeevent].rprev = -1;
+  events[freeevent].rnext = rfirst[r];
+  if (rfirst[r] >= 0) events[rfirst[r]].rprev = freeevent;
+  rfirst[r] = freeevent;
   freeevent = next;
   nevents++;
 }
 
 /* ----------------------------------------------------------------------
-   grow list of stored reactions for single and double
+   index of a reaction in per-reaction arrays
+   single, double, triple reactions in that order, same as profile
+------------------------------------------------------------------------- */
+
+int AppAld::reaction_index(int rstyle, int which)
+{
+  if (rstyle == 1) return which;
+  if (rstyle == 2) return none + which;
+  return none + ntwo + which;
+}
+
+/* ----------------------------------------------------------------------
+   rate_schedule command
+   temperature or one rate scale follows an equal-style variable
+     or a piecewise linear table of time/value pairs
+   a new schedule of the same quantity replaces the old one
+------------------------------------------------------------------------- */
+
+void AppAld::rate_schedule(int narg, char **arg)
+{
+  if (narg < 1) error->all(FLERR,"Illegal rate_schedule command");
+
+  if (strcmp(arg[0],"every") == 0) {
+    if (narg != 2) error->all(FLERR,"Illegal rate_schedule command");
+    rate_every = atof(arg[1]);
+    if (rate_every <= 0.0) error->all(FLERR,"Illegal rate_schedule command");
+    return;
+  }
+
+  if (strcmp(arg[0],"none") == 0) {
+    if (narg != 1) error->all(FLERR,"Illegal rate_schedule command");
+    for (int m = 0; m < nschedule; m++) {
+      delete [] schedules[m].id;
+      memory->destroy(schedules[m].ttable);
+      memory->destroy(schedules[m].vtable);
+    }
+    nschedule = 0;
+    return;
+  }
+
+  int rstyle = 0;
+  int which = 0;
+  int iarg = 1;
+  if (strcmp(arg[0],"temperature") == 0) {
+    rstyle = which = 0;
+    iarg = 1;
+  } else if (strcmp(arg[0],"scale") == 0) {
+    if (narg < 4) error->all(FLERR,"Illegal rate_schedule command");
+    rstyle = atoi(arg[1]);
+    which = atoi(arg[2]) - 1;
+    if (rstyle < 1 || rstyle > 3 || which < 0)
+      error->all(FLERR,"Illegal rate_schedule command");
+    iarg = 3;
+  } else error->all(FLERR,"Illegal rate_schedule command");
+
+  if (iarg >= narg) error->all(FLERR,"Illegal rate_schedule command");
+
+  int m;
+  for (m = 0; m < nschedule; m++)
+    if (schedules[m].style == rstyle && schedules[m].which == which) break;
+  if (m == nschedule) {
+    schedules = (Schedule *) 
+      memory->srealloc(schedules,(nschedule+1)*sizeof(Schedule),
+		       "app/ald:schedules");
+    nschedule++;
+  } else {
+    delete [] schedules[m].id;
+    memory->destroy(schedules[m].ttable);
+    memory->destroy(schedules[m].vtable);
+  }
+
+  Schedule *sched = &schedules[m];
+  sched->style = rstyle;
+  sched->which = which;
+  sched->reaction = -1;
+  sched->id = NULL;
+  sched->ivar = -1;
+  sched->ntable = 0;
+  sched->ttable = sched->vtable = NULL;
+
+  if (strstr(arg[iarg],"v_") == arg[iarg]) {
+    if (iarg+1 != narg) error->all(FLERR,"Illegal rate_schedule command");
+    int n = strlen(&arg[iarg][2]) + 1;
+    sched->id = new char[n];
+    strcpy(sched->id,&arg[iarg][2]);
+
+  } else if (strcmp(arg[iarg],"table") == 0) {
+    int nvalues = narg - iarg - 1;
+    if (nvalues < 2 || nvalues % 2) 
+      error->all(FLERR,"Illegal rate_schedule command");
+    sched->ntable = nvalues/2;
+    memory->create(sched->ttable,sched->ntable,"app/ald:ttable");
+    memory->create(sched->vtable,sched->ntable,"app/ald:vtable");
+    for (int n = 0; n < sched->ntable; n++) {
+      sched->ttable[n] = atof(arg[iarg+1+2*n]);
+      sched->vtable[n] = atof(arg[iarg+2+2*n]);
+      if (n && sched->ttable[n] <= sched->ttable[n-1])
+	error->all(FLERR,"Rate_schedule table times must increase");
+    }
+
+  } else error->all(FLERR,"Illegal rate_schedule command");
+}
+
+/* ----------------------------------------------------------------------
+   value of a schedule at current time
+   table is held constant before its first and after its last time
+------------------------------------------------------------------------- */
+
+double AppAld::schedule_value(Schedule *sched)
+{
+  if (sched->id) return spk->input->variable->compute_equal(sched->ivar);
+
+  double *tt = sched->ttable;
+  double *vt = sched->vtable;
+  int n = sched->ntable;
+
+  if (time <= tt[0]) return vt[0];
+  if (time >= tt[n-1]) return vt[n-1];
+
+  int m = 1;
+  while (tt[m] < time) m++;
+  double fraction = (time - tt[m-1]) / (tt[m] - tt[m-1]);
+  return vt[m-1] + fraction*(vt[m] - vt[m-1]);
+}
+
+/* ----------------------------------------------------------------------
+   set temperature and rate scales from schedules at current time
+   unscheduled rates have scale 1
+------------------------------------------------------------------------- */
+
+void AppAld::evaluate_schedules()
+{
+  for (int m = 0; m < nreaction; m++) rscale[m] = 1.0;
+
+  for (int m = 0; m < nschedule; m++) {
+    double value = schedule_value(&schedules[m]);
+    if (schedules[m].style == 0) {
+      if (value <= 0.0) 
+	error->all(FLERR,"Rate_schedule temperature must be > 0.0");
+      temperature = value;
+      t_inverse = 1.0/temperature;
+    } else {
+      if (value <= 0.0) error->all(FLERR,"Rate_schedule scale must be > 0.0");
+      rscale[schedules[m].reaction] = value;
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   rate tables from Arrhenius parameters, temperature and rate scales
+------------------------------------------------------------------------- */
+
+void AppAld::compute_rates()
+{
+  for (int m = 0; m < none; m++)
+    spropensity[m] = rscale[m]*sA[m]*
+      pow(temperature,sexpon[m])*exp(-srate[m]/temperature);
+  for (int m = 0; m < ntwo; m++)
+    dpropensity[m] = rscale[none+m]*dA[m]*
+      pow(temperature,dexpon[m])*exp(-drate[m]/temperature);
+  for (int m = 0; m < nthree; m++)
+    vpropensity[m] = rscale[none+ntwo+m]*vA[m]*
+      pow(temperature,vexpon[m])*exp(-vrate[m]/temperature);
+}
+
+/* ----------------------------------------------------------------------
+   change rates to scheduled values during a run
+   only sites with an event of a changed reaction get new propensities,
+     found by walking the event list of each changed reaction
+   if the change alters which type II rates are equal, merged type II
+     events are no longer valid, so all sites with events find them again
 ------------------------------------------------------------------------- */
 
-void AppAld::grow_reactions(int rstyle)
+void AppAld::update_rates()
+{
+  std::vector<double> previous;
+  previous.insert(previous.end(),spropensity,spropensity+none);
+  previous.insert(previous.end(),dpropensity,dpropensity+ntwo);
+  previous.insert(previous.end(),vpropensity,vpropensity+nthree);
+
+  evaluate_schedules();
+  compute_rates();
+
+  int full = 0;
+  for (int m = 0; m < ntwo; m++)
+    for (int n = m+1; n < ntwo; n++)
+      if ((previous[none+m] == previous[none+n]) != 
+	  (dpropensity[m] == dpropensity[n])) full = 1;
+
+  rsites.clear();
+  if (full) {
+    for (int i = 0; i < nlocal; i++)
+      if (firstevent[i] >= 0) rsites.push_back(i);
+  } else {
+    for (int r = 0; r < nreaction; r++) {
+      double p;
+      if (r < none) p = spropensity[r];
+      else if (r < none+ntwo) p = dpropensity[r-none];
+      else p = vpropensity[r-none-ntwo];
+      if (p == previous[r]) continue;
+      for (int ievent = rfirst[r]; ievent >= 0; ievent = events[ievent].rnext)
+	rsites.push_back(events[ievent].site);
+    }
+    std::sort(rsites.begin(),rsites.end());
+    rsites.erase(std::unique(rsites.begin(),rsites.end()),rsites.end());
+  }
+
+  // sites with events are active, so each is in the set that owns it
+
+  int nsites = rsites.size();
+  for (int iset = 0; iset < nset; iset++) {
+    int *setmap = set[iset].i2site;
+    double *setpropensity = set[iset].propensity;
+    rlist.clear();
+    for (int m = 0; m < nsites; m++) {
+      int i = rsites[m];
+      int isite = setmap[i];
+      if (isite < 0) continue;
+      if (full) setpropensity[isite] = site_propensity(i);
+      else setpropensity[isite] = site_propensity_rates(i);
+      rlist.push_back(isite);
+    }
+    if (rlist.size())
+      set[iset].solve->update(rlist.size(),&rlist[0],setpropensity);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   grow lists of stored reactions of one type to hold at least N reactions
+   capacity doubles, so adding reactions one at a time stays linear
+------------------------------------------------------------------------- */
+
+void AppAld::grow_reactions(int rstyle, int n)
 {
   if (rstyle == 1) {
-    int n = none + 1;
+    if (n <= maxone) return;
+    maxone = n = MAX(n,2*maxone);
     srate = (double *) 
       memory->srealloc(srate,n*sizeof(double),"app/ald:srate");
     spropensity = (double *) 
@@ -870,7 +1465,8 @@ void AppAld::grow_reactions(int rstyle)
       memory->srealloc(spresson,n*sizeof(int),"app/ald:spresson");
 
   } else if (rstyle == 2) {
-    int n = ntwo + 1;
+    if (n <= maxtwo) return;
+    maxtwo = n = MAX(n,2*maxtwo);
     drate = (double *) 
       memory->srealloc(drate,n*sizeof(double),"app/ald:drate");
     dpropensity = (double *) 
@@ -889,7 +1485,8 @@ void AppAld::grow_reactions(int rstyle)
       memory->srealloc(dpresson,n*sizeof(int),"app/ald:dpresson");
 
   } else if (rstyle == 3) {
-    int n = nthree + 1;
+    if (n <= maxthree) return;
+    maxthree = n = MAX(n,2*maxthree);
     vrate = (double *)
       memory->srealloc(vrate,n*sizeof(double),"app/ald:vrate");
     vpropensity = (double *)
@@ -909,6 +1506,242 @@ void AppAld::grow_reactions(int rstyle)
   }
 }
 
+/* ----------------------------------------------------------------------
+   write all events defined so far to a binary event library
+   file holds species names, then for each event type the # of events
+     followed by one contiguous block per event parameter
+   species are stored as indices into the file's own name list,
+     so a library stays valid if species are added to the app
+------------------------------------------------------------------------- */
+
+void AppAld::write_event_file(int narg, char **arg)
+{
+  if (narg != 1) error->all(FLERR,"Illegal write_event_file command");
+  if (domain->me) return;
+
+  FILE *fp = fopen(arg[0],"wb");
+  if (fp == NULL) {
+    char str[128];
+    sprintf(str,"Cannot open event file %s",arg[0]);
+    error->one(FLERR,str);
+  }
+
+  int format = EVENTFORMAT;
+  int nname = sizeof(species_names)/sizeof(species_names[0]);
+  fwrite(EVENTMAGIC,sizeof(char),strlen(EVENTMAGIC)+1,fp);
+  fwrite(&format,sizeof(int),1,fp);
+  fwrite(&nname,sizeof(int),1,fp);
+  for (int m = 0; m < nname; m++) {
+    int n = strlen(species_names[m]) + 1;
+    fwrite(&n,sizeof(int),1,fp);
+    fwrite(species_names[m],sizeof(char),n,fp);
+  }
+
+  fwrite(&none,sizeof(int),1,fp);
+  if (none) {
+    fwrite(sinput,sizeof(int),none,fp);
+    fwrite(soutput,sizeof(int),none,fp);
+    fwrite(sA,sizeof(double),none,fp);
+    fwrite(sexpon,sizeof(int),none,fp);
+    fwrite(srate,sizeof(double),none,fp);
+    fwrite(scoord,sizeof(int),none,fp);
+    fwrite(spresson,sizeof(int),none,fp);
+  }
+
+  fwrite(&ntwo,sizeof(int),1,fp);
+  if (ntwo) {
+    fwrite(&dinput[0][0],sizeof(int),2*ntwo,fp);
+    fwrite(&doutput[0][0],sizeof(int),2*ntwo,fp);
+    fwrite(dA,sizeof(double),ntwo,fp);
+    fwrite(dexpon,sizeof(int),ntwo,fp);
+    fwrite(drate,sizeof(double),ntwo,fp);
+    fwrite(dcoord,sizeof(int),ntwo,fp);
+    fwrite(dpresson,sizeof(int),ntwo,fp);
+  }
+
+  fwrite(&nthree,sizeof(int),1,fp);
+  if (nthree) {
+    fwrite(&vinput[0][0],sizeof(int),2*nthree,fp);
+    fwrite(&voutput[0][0],sizeof(int),2*nthree,fp);
+    fwrite(vA,sizeof(double),nthree,fp);
+    fwrite(vexpon,sizeof(int),nthree,fp);
+    fwrite(vrate,sizeof(double),nthree,fp);
+    fwrite(vcoord,sizeof(int),nthree,fp);
+    fwrite(vpresson,sizeof(int),nthree,fp);
+  }
+
+  fclose(fp);
+}
+
+/* ----------------------------------------------------------------------
+   add all events of a binary event library written by write_event_file
+   proc 0 reads the whole file, all procs unpack it
+   optional barrier keywords then override activation energies
+------------------------------------------------------------------------- */
+
+void AppAld::event_file(int narg, char **arg)
+{
+  if (narg < 1 || (narg-1) % 4) error->all(FLERR,"Illegal event_file command");
+
+  // read file into one buffer and broadcast it
+
+  int me = domain->me;
+  int nbytes = 0;
+  char *buf = NULL;
+
+  if (me == 0) {
+    FILE *fp = fopen(arg[0],"rb");
+    if (fp == NULL) {
+      char str[128];
+      sprintf(str,"Cannot open event file %s",arg[0]);
+      error->one(FLERR,str);
+    }
+    fseek(fp,0,SEEK_END);
+    nbytes = ftell(fp);
+    fseek(fp,0,SEEK_SET);
+    buf = new char[nbytes];
+    if (fread(buf,sizeof(char),nbytes,fp) != (size_t) nbytes)
+      error->one(FLERR,"Invalid event file");
+    fclose(fp);
+  }
+
+  MPI_Bcast(&nbytes,1,MPI_INT,0,world);
+  if (me) buf = new char[nbytes];
+  MPI_Bcast(buf,nbytes,MPI_CHAR,0,world);
+
+  // header and map of file species to app species
+
+  char *ptr = buf;
+  char *end = buf + nbytes;
+  int nmagic = strlen(EVENTMAGIC) + 1;
+  int format,nname,n;
+
+  if (end-ptr < nmagic || memcmp(ptr,EVENTMAGIC,nmagic) != 0)
+    error->all(FLERR,"Invalid event file");
+  ptr += nmagic;
+  unpack_events(ptr,end,&format,1);
+  if (format != EVENTFORMAT) error->all(FLERR,"Invalid event file");
+  unpack_events(ptr,end,&nname,1);
+
+  int nspecies = sizeof(species_names)/sizeof(species_names[0]);
+  int *map = new int[nname];
+  for (int m = 0; m < nname; m++) {
+    unpack_events(ptr,end,&n,1);
+    if (n < 1 || end-ptr < n || ptr[n-1] != '\0')
+      error->all(FLERR,"Invalid event file");
+    for (map[m] = 0; map[m] < nspecies; map[m]++)
+      if (strcmp(ptr,species_names[map[m]]) == 0) break;
+    if (map[m] == nspecies) {
+      char str[128];
+      sprintf(str,"Unknown species %s in event file",ptr);
+      error->all(FLERR,str);
+    }
+    ptr += n;
+  }
+
+  // events of each type are appended to ones already defined
+
+  unpack_events(ptr,end,&n,1);
+  if (n < 0) error->all(FLERR,"Invalid event file");
+  grow_reactions(1,none+n);
+  unpack_events(ptr,end,&sinput[none],n);
+  unpack_events(ptr,end,&soutput[none],n);
+  unpack_events(ptr,end,&sA[none],n);
+  unpack_events(ptr,end,&sexpon[none],n);
+  unpack_events(ptr,end,&srate[none],n);
+  unpack_events(ptr,end,&scoord[none],n);
+  unpack_events(ptr,end,&spresson[none],n);
+  map_species(&sinput[none],n,map,nname);
+  map_species(&soutput[none],n,map,nname);
+  none += n;
+
+  unpack_events(ptr,end,&n,1);
+  if (n < 0) error->all(FLERR,"Invalid event file");
+  grow_reactions(2,ntwo+n);
+  if (n) {
+    unpack_events(ptr,end,&dinput[ntwo][0],2*n);
+    unpack_events(ptr,end,&doutput[ntwo][0],2*n);
+    map_species(&dinput[ntwo][0],2*n,map,nname);
+    map_species(&doutput[ntwo][0],2*n,map,nname);
+  }
+  unpack_events(ptr,end,&dA[ntwo],n);
+  unpack_events(ptr,end,&dexpon[ntwo],n);
+  unpack_events(ptr,end,&drate[ntwo],n);
+  unpack_events(ptr,end,&dcoord[ntwo],n);
+  unpack_events(ptr,end,&dpresson[ntwo],n);
+  ntwo += n;
+
+  unpack_events(ptr,end,&n,1);
+  if (n < 0) error->all(FLERR,"Invalid event file");
+  grow_reactions(3,nthree+n);
+  if (n) {
+    unpack_events(ptr,end,&vinput[nthree][0],2*n);
+    unpack_events(ptr,end,&voutput[nthree][0],2*n);
+    map_species(&vinput[nthree][0],2*n,map,nname);
+    map_species(&voutput[nthree][0],2*n,map,nname);
+  }
+  unpack_events(ptr,end,&vA[nthree],n);
+  unpack_events(ptr,end,&vexpon[nthree],n);
+  unpack_events(ptr,end,&vrate[nthree],n);
+  unpack_events(ptr,end,&vcoord[nthree],n);
+  unpack_events(ptr,end,&vpresson[nthree],n);
+  nthree += n;
+
+  if (ptr != end) error->all(FLERR,"Invalid event file");
+
+  delete [] map;
+  delete [] buf;
+
+  // barrier overrides, N counts events of a type from 1
+
+  for (int iarg = 1; iarg < narg; iarg += 4) {
+    if (strcmp(arg[iarg],"barrier") != 0)
+      error->all(FLERR,"Illegal event_file command");
+    int rstyle = atoi(arg[iarg+1]);
+    int which = atoi(arg[iarg+2]) - 1;
+    double barrier = atof(arg[iarg+3]);
+    if (rstyle == 1 && which >= 0 && which < none) srate[which] = barrier;
+    else if (rstyle == 2 && which >= 0 && which < ntwo) drate[which] = barrier;
+    else if (rstyle == 3 && which >= 0 && which < nthree)
+      vrate[which] = barrier;
+    else error->all(FLERR,"Event_file barrier event does not exist");
+  }
+
+  if (me == 0) {
+    if (screen) 
+      fprintf(screen,"  %d %d %d events of type I II III\n",none,ntwo,nthree);
+    if (logfile) 
+      fprintf(logfile,"  %d %d %d events of type I II III\n",
+	      none,ntwo,nthree);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   copy N values from event file buffer at ptr and advance ptr
+------------------------------------------------------------------------- */
+
+template <class T>
+void AppAld::unpack_events(char *&ptr, char *end, T *values, int n)
+{
+  size_t nbytes = n*sizeof(T);
+  if ((size_t) (end-ptr) < nbytes) error->all(FLERR,"Invalid event file");
+  if (n) memcpy(values,ptr,nbytes);
+  ptr += nbytes;
+}
+
+/* ----------------------------------------------------------------------
+   convert N species indices of an event file to app species
+------------------------------------------------------------------------- */
+
+void AppAld::map_species(int *species, int n, int *map, int nname)
+{
+  for (int m = 0; m < n; m++) {
+    if (species[m] < 0 || species[m] >= nname)
+      error->all(FLERR,"Invalid event file");
+    species[m] = map[species[m]];
+  }
+}
+
 /* ----------------------------------------------------------------------
    update c.n. for Hf and O, put and remove mask for relative sites
 ------------------------------------------------------------------------- */
@@ -1010,31 +1843,19 @@ void AppAld::update_coord(int elcoord, int i, int j, int which)
 ------------------------------------------------------------------------- */
 void AppAld::put_mask(int i)
 { 
-        int isite = i2site[i];
 	int nsites = 0;
-	esites[nsites++] = isite;
-        echeck[isite] = 1;
+	visit_site(i,nsites);
 	if (element[i] == HfX4O || element[i] == HfX4OH ){
 	  	for (int n = 0; n < numneigh[i]; n++) {
 			int nn = neighbor[i][n];
 			for (int k = 0; k < numneigh[nn]; k++){
 				int kk = neighbor[nn][k];
-				isite = i2site[kk];
-				if (isite >= 0 && echeck[isite] == 0) {
-					coord[isite]=coord[isite]-10;
-					esites[nsites++] = isite;
-					echeck[isite] = 1;
-				}
+				if (visit_site(kk,nsites)) coord[kk] -= 10;
 				for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
 					for (int s = 0; s < numneigh[mm]; s++) {
 						int ss = neighbor[mm][s];
-						isite = i2site[ss];
-						if (isite >= 0 && echeck[isite] == 0) {
-							coord[isite] = coord[isite]-10;
-							esites[nsites++] = isite;
-							echeck[isite] = 1;
-						}
+						if (visit_site(ss,nsites)) coord[ss] -= 10;
 					}
 				}
 			}
@@ -1043,27 +1864,13 @@ void AppAld::put_mask(int i)
 	else if (element[i] == HfX2 || element[i] == HfHX2 || element[i] == HfH2X2){
 	  	for (int n = 0; n < numneigh[i]; n++) {
 			int nn = neighbor[i][n];
-			isite = i2site[nn];
-			if (isite >= 0 && echeck[isite] == 0) {
-				coord[isite]=coord[isite]-10;
-				esites[nsites++] = isite;
-				echeck[isite] = 1;
-			}
+			if (visit_site(nn,nsites)) coord[nn] -= 10;
 			for (int k = 0; k < numneigh[nn]; k++){
 				int kk = neighbor[nn][k];
-				isite = i2site[kk];
-				if (isite >= 0 && echeck[isite] == 0) {
-					esites[nsites++] = isite;
-					echeck[isite] = 1;
-				}
+				visit_site(kk,nsites);
 				for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
-					isite = i2site[mm];
-					if (isite >= 0 && echeck[isite] == 0) {
-						coord[isite] = coord[isite]-10;
-						esites[nsites++] = isite;
-						echeck[isite] = 1;
-					}
+					if (visit_site(mm,nsites)) coord[mm] -= 10;
 				}
 			}
 		}
@@ -1073,22 +1880,12 @@ void AppAld::put_mask(int i)
 			int nn = neighbor[i][n];
 			for (int k = 0; k < numneigh[nn]; k++){
 				int kk = neighbor[nn][k];
-				isite = i2site[kk];
-				if (isite >= 0 && echeck[isite] == 0) {
-					coord[isite]=coord[isite]-10;
-					esites[nsites++] = isite;
-					echeck[isite] = 1;
-				}
+				if (visit_site(kk,nsites)) coord[kk] -= 10;
 				for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
 					for (int s = 0; s < numneigh[mm]; s++) {
 						int ss = neighbor[mm][s];
-						isite = i2site[ss];
-						if (isite >= 0 && echeck[isite] == 0) {
-							coord[isite] = coord[isite]-10;
-							esites[nsites++] = isite;
-							echeck[isite] = 1;
-						}
+						if (visit_site(ss,nsites)) coord[ss] -= 10;
 					}
 				}
 			}
@@ -1101,31 +1898,19 @@ void AppAld::put_mask(int i)
 ------------------------------------------------------------------------- */
 void AppAld::remove_mask(int i)
 {
-        int isite = i2site[i];
 	int nsites = 0;
-	esites[nsites++] = isite;
-        echeck[isite] = 1;
+	visit_site(i,nsites);
 	if (element[i] == O || element[i] == OH ){
 	  	for (int n = 0; n < numneigh[i]; n++) {
 			int nn = neighbor[i][n];
 			for (int k = 0; k < numneigh[nn]; k++){
 				int kk = neighbor[nn][k];
-				isite = i2site[kk];
-				if (isite >= 0 && echeck[isite] == 0) {
-					coord[isite]=coord[isite]+10;
-					esites[nsites++] = isite;
-					echeck[isite] = 1;
-				}
+				if (visit_site(kk,nsites)) coord[kk] += 10;
 				for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
 					for (int s = 0; s < numneigh[mm]; s++) {
 						int ss = neighbor[mm][s];
-						isite = i2site[ss];
-						if (isite >= 0 && echeck[isite] == 0) {
-							coord[isite] = coord[isite]+10;
-							esites[nsites++] = isite;
-							echeck[isite] = 1;
-						}
+						if (visit_site(ss,nsites)) coord[ss] += 10;
 					}
 				}
 			}
@@ -1134,27 +1919,13 @@ void AppAld::remove_mask(int i)
 	else if (element[i] == VACANCY || element[i] == HfX || element[i] == HfHX || element[i] == Hf){
 	  	for (int n = 0; n < numneigh[i]; n++) {
 			int nn = neighbor[i][n];
-			isite = i2site[nn];
-			if (isite >= 0 && echeck[isite] == 0) {
-				coord[isite]=coord[isite]+10;
-				esites[nsites++] = isite;
-				echeck[isite] = 1;
-			}
+			if (visit_site(nn,nsites)) coord[nn] += 10;
 			for (int k = 0; k < numneigh[nn]; k++){
 				int kk = neighbor[nn][k];
-				isite = i2site[kk];
-				if (isite >= 0 && echeck[isite] == 0) {
-					esites[nsites++] = isite;
-					echeck[isite] = 1;
-				}
+				visit_site(kk,nsites);
 				for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
-					isite = i2site[mm];
-					if (isite >= 0 && echeck[isite] == 0) {
-						coord[isite] = coord[isite]+10;
-						esites[nsites++] = isite;
-						echeck[isite] = 1;
-					}
+					if (visit_site(mm,nsites)) coord[mm] += 10;
 				}
 			}
 		}
@@ -1214,21 +1985,17 @@ void AppAld::count_coordO(int i)
     int emptyO = 0;
     int totalS = 0;
 
-    int isite = i2site[i];
     int nsites = 0;
 
 	for (int m = 0; m < numneigh[i]; m++) {
 		int mm = neighbor[i][m];
 		for (int s = 0; s < numneigh[mm]; s++) {
 			int ss = neighbor[mm][s];
-			isite = i2site[ss];
 			if (i==ss)  continue;
-			if (isite >= 0 && echeck[isite] == 0) {
+			if (visit_site(ss,nsites)) {
 			  if (element[ss] == O || element[ss] == OH || element[ss] == OH2) {fullO++;}
 			  else if (element[ss] == VACANCY) {emptyO++;}
                           else {}
-		          esites[nsites++] = isite;
-		          echeck[isite] = 1;
 		        }
     
 		}
@@ -1237,3 +2004,23 @@ void AppAld::count_coordO(int i)
    if ( float(fullO) > 4*totalS/5 ) {coord[i]=2; }
    for (int m = 0; m < nsites; m++)  {echeck[esites[m]] = 0; esites[m]=0;}
 }
+
+/* ----------------------------------------------------------------------
+   memory usage of event list and per-site scratch arrays
+------------------------------------------------------------------------- */
+
+bigint AppAld::memory_usage_app()
+{
+  bigint bytes = 0;
+  bytes += (bigint) maxevent * sizeof(Event);     // events
+  if (firstevent) {
+    bytes += (bigint) maxlocal * sizeof(int);     // firstevent
+    bytes += (bigint) maxlocal * sizeof(int);     // echeck
+    bytes += nreaction * sizeof(int);             // rfirst
+    bytes += nreaction * sizeof(double);          // rscale
+    bytes += 12*maxneigh * sizeof(int);           // esites
+    bytes += 12*maxneigh*2 * sizeof(double);      // comneigh
+  }
+  bytes += (bigint) nthreads*12*maxneigh*2 * sizeof(double);  // tcomneigh
+  return bytes;
+}
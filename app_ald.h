@@ -27,6 +27,7 @@ AppStyle(ald,AppAld)
 #define SPK_APP_ALD_H
 
 #include "app_lattice.h"
+#include <vector>
 
 
 
@@ -42,31 +43,41 @@ class AppAld : public AppLattice {
   void grow_app();
   void init_app();
   void setup_app();
+  void setup_end_app();
+  bigint memory_usage_app();
 
   double site_energy(int);
   void site_event_rejection(int, class RandomPark *) {}
   double site_propensity(int);
   void site_event(int, class RandomPark *);
+  void setup_threads(int);
+  double site_propensity_thread(int, int);
+  void merge_threads(int, int *);
+  double site_propensity_rates(int);
+  void app_update(double);
+  int profile_reactions();
+  void profile_label(int, char *);
 
  private:
   int engstyle;
   int *coord,*element;      // variables on each lattice site 
   int firsttime;
+  int maxlocal;               // allocated size of per-site arrays
   int hello;
   double T1,T2,T3,T4;          // time period during ALD
   double cycle;
   int pressureOn;
 
-  int *esites;
-  int *echeck;
+  int *esites;             // scratch list of sites visited by an update
+  int *echeck;             // 1 if site is on esites, 0 otherwise
 
   int none,ntwo,nthree;
+  int maxone,maxtwo,maxthree;   // allocated size of reaction lists
   double *srate,*drate,*vrate;/* two type of reaction, therefore we need only two pointers here, I deleted trate,tcount,toutput */
   double *spropensity,*dpropensity,*vpropensity;
   /* int *stype,**dtype,**ttype; we do not need any type, we have only one type of crystal that was red by read_sites*/
   int *sinput,**dinput,**vinput;
   int *soutput,**doutput,**voutput;
-  int comevent;
   double **comneigh;
   int *scount,*dcount,*vcount;
   double *sA,*dA,*vA;
@@ -79,6 +90,8 @@ class AppAld : public AppLattice {
     int which;             // which reaction of this type
     int jpartner,kpartner; // neighbors of site I, it can be first or second 
     int next;              // index of next event for this site
+    int site;              // owned site the event belongs to
+    int rprev,rnext;       // neighbor events of same reaction, any site
     double propensity;     // propensity of this event
   };
 
@@ -87,14 +100,59 @@ class AppAld : public AppLattice {
   int maxevent;            // max # of events list can hold
   int *firstevent;         // index of 1st event for each owned site
   int freeevent;           // index of 1st unused event in list
+  int *rfirst;             // index of 1st event of each reaction
+  int nreaction;           // # of reactions rfirst and rscale span
+
+  struct Schedule {        // time dependence of temperature or a rate
+    int style;             // 0 for temperature, else event type of rate
+    int which;             // which rate of this event type
+    int reaction;          // reaction index of scaled rate
+    char *id;              // name of equal-style variable, NULL for table
+    int ivar;              // index of variable
+    int ntable;            // # of time/value pairs in table
+    double *ttable;        // table times, increasing
+    double *vtable;        // table values, linear in between
+  };
+
+  Schedule *schedules;     // list of rate schedules
+  int nschedule;           // # of rate schedules
+  double rate_every;       // time between rate updates during a run
+  double nextrate;         // time of next rate update
+  double *rscale;          // scale factor of each reaction rate
+  std::vector<int> rsites; // owned sites with a changed reaction
+  std::vector<int> rlist;  // set indices of those sites in one set
+
+  int nthreads;            // # of threads with setup scratch allocated
+  double ***tcomneigh;     // per-thread comneigh for site_propensity_thread()
+  std::vector<int> *tsite;      // per-thread owned site of each found event
+  std::vector<Event> *tevent;   // per-thread events found during setup
+  std::vector<double> rscratch; // event propensities of one site
+
+  int tselect,tcoord;      // timer region indices
+  int tpropensity,tclear;
 
+  void compact_events();
   void clear_events(int);
   void add_event(int, int, int, double, int, int);
-  void grow_reactions(int);
+  double find_events(int, double **, int);
+  void found_event(int, int, int, double, int, int, int);
+  void grow_reactions(int, int);
+  void event_file(int, char **);
+  void write_event_file(int, char **);
+  template <class T> void unpack_events(char *&, char *, T *, int);
+  void map_species(int *, int, int *, int);
+  int reaction_index(int, int);
+  void rate_schedule(int, char **);
+  double schedule_value(Schedule *);
+  void evaluate_schedules();
+  void compute_rates();
+  void update_rates();
   void count_coord(int,int);
   void count_coordO(int);
   void remove_mask(int);
   void put_mask(int);
+  void update_site(int, int &);
+  int visit_site(int, int &);
   void update_coord(int,int,int,int);
 };
 
@@ -102,3 +160,64 @@ class AppAld : public AppLattice {
 
 #endif
 #endif
+
+/* ERROR/WARNING messages:
+
+E: Cannot open event file %s
+
+The specified file cannot be opened.  Check that the path and name are
+correct.
+
+E: Invalid event file
+
+The file is not an event library written by the write_event_file
+command, or it is truncated.
+
+E: Unknown species %s in event file
+
+The event library uses a species this version of app ald does not
+know.
+
+E: Event_file barrier event does not exist
+
+The event type and index of a barrier keyword must refer to an event
+defined by the file or by a previous event command.
+
+E: Illegal rate_schedule command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.
+
+E: Rate_schedule reaction does not exist
+
+The event type and index must refer to an event defined by a previous
+event command.
+
+E: Rate_schedule table times must increase
+
+Each time in a table must be larger than the time before it.
+
+E: Rate_schedule every must be set
+
+A time interval between rate updates is required once temperature or
+any reaction rate follows a schedule.
+
+E: Variable name for rate_schedule does not exist
+
+Self-explanatory.
+
+E: Variable for rate_schedule is invalid style
+
+Only equal-style variables can be used.
+
+E: Rate_schedule temperature must be > 0.0
+
+The scheduled temperature became zero or negative at the current time.
+
+E: Rate_schedule scale must be > 0.0
+
+A scheduled rate scale factor became zero or negative at the current
+time.  An event with zero rate cannot be stored, use the pressure
+option of the event command to switch events off instead.
+
+*/
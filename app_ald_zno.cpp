@@ -12,6 +12,7 @@
 ------------------------------------------------------------------------- */
 
 #include "math.h"
+#include "stdio.h"
 #include "mpi.h"
 #include "stdlib.h"
 #include "string.h"
@@ -19,6 +20,7 @@
 #include "solve.h"
 #include "random_park.h"
 #include "memory.h"
+#include "diag_kmc_profile.h"
 #include "error.h"
 
 using namespace SPPARKS_NS;
@@ -44,6 +46,8 @@ AppAldZno::AppAldZno(SPPARKS *spk, int narg, char **arg) :
   allow_kmc = 1;
   allow_rejection = 0;
   allow_masking = 0;
+  allow_balance = 1;
+  allow_active = 1;
   
 
   create_arrays();
@@ -54,6 +58,7 @@ AppAldZno::AppAldZno(SPPARKS *spk, int narg, char **arg) :
   pressureOn = 1;
   hello = 1;
   firsttime = 1;
+  maxlocal = 0;
   esites = NULL;
   echeck = NULL;
   events = NULL;
@@ -80,7 +85,7 @@ AppAldZno::AppAldZno(SPPARKS *spk, int narg, char **arg) :
 
 AppAldZno::~AppAldZno()
 {
-  delete [] esites;
+  memory->sfree(esites);
   delete [] echeck;
   memory->sfree(events);
   memory->sfree(firstevent);
@@ -404,21 +409,32 @@ void AppAldZno::init_app()
   if (firsttime) {
     firsttime = 0;
 
-    echeck = new int[nlocal];
-    firstevent = (int *) memory->smalloc(nlocal*sizeof(int),"app:firstevent");
     //comneigh was defined to avoid double counting of common neighbor in site_propensity
     comneigh = memory->grow(comneigh,12*maxneigh,2,"app/ald:comneigh");
     //comneigh = memory->grow_2d_double_array(comneigh,12*maxneigh,2,"app/ald:comneigh");
-    // esites must be large enough for 3 sites and their 1st neighbors
-    
-    esites = (int *) memory->smalloc(12*maxneigh*sizeof(int),"app:esites");
-    //esites = new int[12*maxneigh]; 
   }
+
+  // per-site arrays, reallocated if balance command increased nlocal
+  // esites must be large enough for 3 sites and their 1st neighbors
+  // plus the masked sites up to 4th neighbors in put_mask(),
+  // echeck keeps each site to one entry so nlocal always suffices
+
+  if (nlocal > maxlocal) {
+    maxlocal = nlocal;
+    delete [] echeck;
+    echeck = new int[maxlocal];
+    firstevent = (int *)
+      memory->srealloc(firstevent,maxlocal*sizeof(int),"app:firstevent");
+    esites = (int *)
+      memory->srealloc(esites,maxlocal*sizeof(int),"app:esites");
+  }
+
   // site validity
+  // put_mask() lowers coord by 10 per mask, so no lower bound after a run
 
   int flag = 0;
   for (int i = 0; i < nlocal; i++) {
-    if (coord[i] < -1 || coord[i] > 8) flag = 1;
+    if (coord[i] > 8) flag = 1;
     if (element[i] < VACANCY) flag = 1;
   }
   int flagall;
@@ -442,21 +458,30 @@ void AppAldZno::setup_app()
     error->all(FLERR,"Temperature cannot be 0.0 for app_ald");
   for (int m = 0; m < none; m++) {
     spropensity[m] = sA[m]*pow(temperature,sexpon[m])*exp(-srate[m]/temperature);
-    scount[m] = 0;
+    if (!rebalanceflag) scount[m] = 0;
   if (spropensity[m] == 0.0) error->warning(FLERR," spropensity cannot be 0.0 for app_ald");
   }
   for (int m = 0; m < ntwo; m++) {
     dpropensity[m] = dA[m]*pow(temperature,dexpon[m])*exp(-drate[m]/temperature);
-    dcount[m] = 0;
+    if (!rebalanceflag) dcount[m] = 0;
   if (dpropensity[m] == 0.0) error->warning(FLERR,"dpropensity cannot be 0.0 for app_ald");
   }
   for (int m = 0; m < nthree; m++) {
     vpropensity[m] = vA[m]*pow(temperature,vexpon[m])*exp(-vrate[m]/temperature);
-    vcount[m] = 0;
+    if (!rebalanceflag) vcount[m] = 0;
   if (vpropensity[m] == 0.0) error->warning(FLERR,"vpropensity cannot be 0.0 for app_ald");
   }
 }
 
+/* ----------------------------------------------------------------------
+   shrink event list to fit once all initial propensities are computed
+------------------------------------------------------------------------- */
+
+void AppAldZno::setup_end_app()
+{
+  compact_events();
+}
+
 /* ----------------------------------------------------------------------
    compute energy of site
 ------------------------------------------------------------------------- */
@@ -610,20 +635,10 @@ void AppAldZno::site_event(int i, class RandomPark *random)
   // go from site i to first and second neighbor in all type
   for (n = 0; n < numneigh[i]; n++) {
     m = neighbor[i][n];
-    isite = i2site[m];
-    if (isite >= 0 && echeck[isite] == 0) {
-      propensity[isite] = site_propensity(m);
-      esites[nsites++] = isite;
-      echeck[isite] = 1;
-    }
+    update_site(m,nsites);
       for (jj = 0; jj< numneigh[m];jj++) {
         mm = neighbor[m][jj];
-        isite = i2site[mm];
-        if (isite >= 0 && echeck[isite] == 0) {
-          propensity[isite] = site_propensity(mm);
-          esites[nsites++] = isite;
-          echeck[isite] = 1;
-        }
+        update_site(mm,nsites);
      }
   }
 
@@ -631,20 +646,10 @@ void AppAldZno::site_event(int i, class RandomPark *random)
   if (rstyle == 2) {
     for (n = 0; n < numneigh[k]; n++) {
       m = neighbor[k][n];
-      isite = i2site[m];
-      if (isite >= 0 && echeck[isite] == 0) {
-        propensity[isite] = site_propensity(m);
-        esites[nsites++] = isite; 
-        echeck[isite] = 1;
-      }
+      update_site(m,nsites);
       for (jj = 0; jj< numneigh[m];jj++) {
         mm = neighbor[m][jj];
-        isite = i2site[mm];
-        if (isite >= 0 && echeck[isite] == 0) {
-          propensity[isite] = site_propensity(mm);
-          esites[nsites++] = isite; 
-          echeck[isite] = 1;
-        }
+        update_site(mm,nsites);
       }
     }
   }
@@ -653,24 +658,21 @@ void AppAldZno::site_event(int i, class RandomPark *random)
   if (rstyle == 3) {
     for (n = 0; n < numneigh[j]; n++) {
       m = neighbor[j][n];
-      isite = i2site[m];
-      if (isite >= 0 && echeck[isite] == 0) {
-        propensity[isite] = site_propensity(m);
-        esites[nsites++] = isite;
-        echeck[isite] = 1;
-      }
+      update_site(m,nsites);
       for (jj = 0; jj< numneigh[m];jj++) {
         mm = neighbor[m][jj];
-        isite = i2site[mm];
-        if (isite >= 0 && echeck[isite] == 0) {
-          propensity[isite] = site_propensity(mm);
-          esites[nsites++] = isite;
-          echeck[isite] = 1;
-        }
+        update_site(mm,nsites);
        }
     }
   }
 
+  if (profile) {
+    int ireaction = which;
+    if (rstyle == 2) ireaction += none;
+    else if (rstyle == 3) ireaction += none + ntwo;
+    profile->event(i,ireaction,nsites);
+  }
+
   solve->update(nsites,esites,propensity);
    // clear echeck array
 
@@ -678,6 +680,62 @@ void AppAldZno::site_event(int i, class RandomPark *random)
   
 }
 
+/* ----------------------------------------------------------------------
+   recompute propensity of owned site i after an event changed its neighborhood
+   echeck and esites are indexed by set index of the site
+   inactive site rejoins the KMC set, it is dropped again at next compaction
+     if its propensity is still zero
+------------------------------------------------------------------------- */
+
+void AppAldZno::update_site(int i, int &nsites)
+{
+  int isite = i2site[i];
+  if (isite < 0) {
+    if (!can_activate(i)) return;
+    isite = activate(i);
+  } else if (echeck[isite]) return;
+
+  propensity[isite] = site_propensity(i);
+  esites[nsites++] = isite;
+  echeck[isite] = 1;
+}
+
+/* ----------------------------------------------------------------------
+   flag site i as visited by a mask or coordination walk
+   return 1 if i is an owned site in the current set, active or not,
+     which was not visited before
+   echeck and esites are indexed by lattice index of the site,
+     caller must clear them before site_event() uses them
+------------------------------------------------------------------------- */
+
+int AppAldZno::visit_site(int i, int &nsites)
+{
+  if (i >= nlocal || echeck[i]) return 0;
+  if (i2site[i] < 0 && !can_activate(i)) return 0;
+  esites[nsites++] = i;
+  echeck[i] = 1;
+  return 1;
+}
+
+/* ----------------------------------------------------------------------
+   reactions reported to diag_style kmc_profile
+   single, double, triple reactions in that order, labeled as in diag ald
+------------------------------------------------------------------------- */
+
+int AppAldZno::profile_reactions()
+{
+  return none + ntwo + nthree;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void AppAldZno::profile_label(int m, char *str)
+{
+  if (m < none) sprintf(str,"s%d",m+1);
+  else if (m < none + ntwo) sprintf(str,"d%d",m-none+1);
+  else sprintf(str,"v%d",m-none-ntwo+1);
+}
+
 /* ----------------------------------------------------------------------
    clear all events out of list for site I
    add cleared events to free list
@@ -697,6 +755,40 @@ void AppAldZno::clear_events(int i)
   firstevent[i] = -1;
 }
 
+/* ----------------------------------------------------------------------
+   copy events of each site contiguously into a list of exactly nevents
+   preserves event order within each site so event selection is unchanged
+   add_event() grows the list again by at most DELTAEVENT when needed
+------------------------------------------------------------------------- */
+
+void AppAldZno::compact_events()
+{
+  if (nevents == maxevent) return;
+
+  Event *newevents = (Event *) 
+    memory->smalloc(nevents*sizeof(Event),"app:events");
+
+  int m = 0;
+  int ievent;
+  for (int i = 0; i < nlocal; i++) {
+    ievent = firstevent[i];
+    if (ievent < 0) continue;
+    firstevent[i] = m;
+    while (ievent >= 0) {
+      newevents[m] = events[ievent];
+      ievent = events[ievent].next;
+      if (ievent >= 0) newevents[m].next = m+1;
+      else newevents[m].next = -1;
+      m++;
+    }
+  }
+
+  memory->sfree(events);
+  events = newevents;
+  maxevent = nevents;
+  freeevent = nevents;
+}
+
 /* ----------------------------------------------------------------------
    add an event to list for site I
    event = exchange with site J with probability = propensity
@@ -706,7 +798,7 @@ void AppAldZno::add_event(int i, int rstyle, int which, double propensity,
 			  int jpartner, int kpartner)
 {
   if (nevents == maxevent) {
-    maxevent += DELTAEVENT;
+    maxevent += MIN(DELTAEVENT,maxevent/2+1);
     events = 
       (Event *) memory->srealloc(events,maxevent*sizeof(Event),"app:events");
     for (int m = nevents; m < maxevent; m++) events[m].next = m+1;
@@ -809,11 +901,11 @@ void AppAldZno::update_coord(int elcoord, int i, int j, int k, int which)
 		remove_mask(i);
 		count_coordO(i);
 	}
-    else if ((elcoord == ZnX2O || elcoord == ZnX2OH || elcoord == ZnX2OH2) && (element[i] == ZnXO || element[i] == ZnXOH ) && (element[k] == OH2 || element[k] == OH || element[k] == O ) && ( j == -1 )){ // DEZ with H2O, event II
+    else if ((elcoord == ZnX2O || elcoord == ZnX2OH || elcoord == ZnX2OH2) && (element[i] == ZnXO || element[i] == ZnXOH ) && k >= 0 && (element[k] == OH2 || element[k] == OH || element[k] == O ) && ( j == -1 )){ // DEZ with H2O, event II
         remove_mask(i);
         put_mask(i);
     }
-	else if ((elcoord == ZnX2O || elcoord == ZnX2OH || elcoord == ZnX2OH2) && (element[i] == ZnXO || element[i] == ZnXOH ) && ( element[j] == ZnX )){ // DEZ dissociation, event III
+	else if ((elcoord == ZnX2O || elcoord == ZnX2OH || elcoord == ZnX2OH2) && (element[i] == ZnXO || element[i] == ZnXOH ) && j >= 0 && ( element[j] == ZnX )){ // DEZ dissociation, event III
         remove_mask(i);
         put_mask(i);
 		coord[j]=coord[j]+1;
@@ -823,11 +915,11 @@ void AppAldZno::update_coord(int elcoord, int i, int j, int k, int which)
         remove_mask(i);
         coord[i]=coord[i]-1;
     }
-	else if ((elcoord == OH || elcoord == OH2) && (element[i] == OH || element[i] == O ) && ( element[j] == Zn ) ) { // MEZ with OH
+	else if ((elcoord == OH || elcoord == OH2) && (element[i] == OH || element[i] == O ) && j >= 0 && ( element[j] == Zn ) ) { // MEZ with OH
         remove_mask(j);
         coord[j]=coord[j]-1;
     }
-	else if ((elcoord == VACANCY) && (element[i] == ZnX || element[i] == Zn) && ( element[j] == O || element[j] == OH || element[j] == OH2 )  ) { // Zn densification
+	else if ((elcoord == VACANCY) && (element[i] == ZnX || element[i] == Zn) && j >= 0 && ( element[j] == O || element[j] == OH || element[j] == OH2 )  ) { // Zn densification
         if (element[i] == ZnX){
         	remove_mask(i, j); // Remove mask from previous O site
         }
@@ -836,19 +928,19 @@ void AppAldZno::update_coord(int elcoord, int i, int j, int k, int which)
             put_mask(i); // Put mask on new Zn site
         }
 	}
-	else if ((elcoord == ZnX ) && (element[i] == VACANCY ) && ( element[j] == ZnXOH || element[j] == ZnXO) ) { // ZnX reverse densification
+	else if ((elcoord == ZnX ) && (element[i] == VACANCY ) && j >= 0 && ( element[j] == ZnXOH || element[j] == ZnXO) ) { // ZnX reverse densification
 		remove_mask(i, j);
 		count_coord(i, j);
 		put_mask(j);
 	}
-	else if ((elcoord == Zn ) && (element[i] == VACANCY ) && ( element[j] == ZnOH || element[j] == ZnO) ) { // Zn reverse densification 
+	else if ((elcoord == Zn ) && (element[i] == VACANCY ) && j >= 0 && ( element[j] == ZnOH || element[j] == ZnO) ) { // Zn reverse densification 
         count_coord(j, i);
         }
-    else if ((elcoord == OH2Zn || elcoord == OHZn || elcoord == OZn) && ( element[i] == Zn ) && (element[j] == O || element[j] == OH || element[j] == OH2 )) { // Oxygen densification
+    else if ((elcoord == OH2Zn || elcoord == OHZn || elcoord == OZn) && ( element[i] == Zn ) && j >= 0 && ( element[j] == O || element[j] == OH || element[j] == OH2 )) { // Oxygen densification
         count_coord(i, j); // Reversed from normal ordering to avoid mixup in count_coord-function that expects i-> O site, j-> Zn site
         count_coordO(j);
     }
-    else if ((elcoord == OH2ZnX || elcoord == OHZnX ) && ( element[i] == ZnX ) && (element[j] == OH || element[j] == OH2 ) && ( k == -1 )) { // Oxygen densification
+    else if ((elcoord == OH2ZnX || elcoord == OHZnX ) && ( element[i] == ZnX ) && j >= 0 && ( element[j] == OH || element[j] == OH2 ) && ( k == -1 )) { // Oxygen densification
         count_coord(i, j); // Reversed from normal ordering to avoid mixup in count_coord-function that expects i-> O site, j-> Zn site
     }
     else if ((elcoord == Zn || elcoord == ZnX ) && (element[i] == OH2Zn || element[i] == OH2ZnX ) && ( j == -1 )) { // Adsorption of H2O
@@ -857,13 +949,13 @@ void AppAldZno::update_coord(int elcoord, int i, int j, int k, int which)
     else if ((elcoord == OH2Zn || elcoord == OH2ZnX ) && (element[i] == Zn || element[i] == ZnX ) && ( j == -1 )) { // Desorption of H2O
         coord[i]=coord[i]-1;
     }
-    else if ((elcoord == ZnX ) && ( element[i] == ZnX && element[j] == VACANCY ) ) { // Desorption of H2O
+    else if ((elcoord == ZnX ) && ( element[i] == ZnX && j >= 0 && element[j] == VACANCY ) ) { // Desorption of H2O
         count_coord(j, i);
     }
     else if ((elcoord == OH2 ) && (element[i] == VACANCY ) && ( j == -1 )){ // Desorption of H2O
         count_coord(i, j);
     }
-	else if ((elcoord == O || elcoord == OH || elcoord == OH2) && (element[i] == VACANCY) && (element[j] == OH2ZnX || element[j] == OHZnX || element[j] == OH2Zn || element[j] == OHZn || element[j] == OZn ) ) {// Oxygen reverse densification
+	else if ((elcoord == O || elcoord == OH || elcoord == OH2) && (element[i] == VACANCY) && j >= 0 && ( element[j] == OH2ZnX || element[j] == OHZnX || element[j] == OH2Zn || element[j] == OHZn || element[j] == OZn ) ) {// Oxygen reverse densification
 		count_coord(i,j);
 		coord[j]++;
 	}
@@ -874,44 +966,22 @@ void AppAldZno::update_coord(int elcoord, int i, int j, int k, int which)
 
 void AppAldZno::put_mask(int i)
 {
-    int isite = i2site[i];
 	int nsites = 0;
-	esites[nsites++] = isite;
-    echeck[isite] = 1;
+	visit_site(i,nsites);
 // Add mask on the second neighbor (oxygen) of the DEZ to block adsorption
 	if (element[i] == ZnX2OH2 || element[i] == ZnX2OH || element[i] == ZnX2O ){
 	  	for (int n = 0; n < numneigh[i]; n++) {
 			int nn = neighbor[i][n];
-			isite = i2site[nn];
-			if (isite >= 0 && echeck[isite] == 0) { // Cover first neighbour Zn site
-			    coord[isite]=coord[isite]-20;
-			    esites[nsites++] = isite;
-			    echeck[isite] = 1;
-                        }
+			if (visit_site(nn,nsites)) coord[nn] -= 20; // Cover first neighbour Zn site
 			for (int k = 0; k < numneigh[nn]; k++){
 				int kk = neighbor[nn][k];
-				isite = i2site[kk];
-				if (isite >= 0 && echeck[isite] == 0) { // Cover second neighbour O site
-					coord[isite]=coord[isite]-10;
-					esites[nsites++] = isite;
-					echeck[isite] = 1;
-				}
+				if (visit_site(kk,nsites)) coord[kk] -= 10; // Cover second neighbour O site
 				for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
-					isite = i2site[mm];
-					if (isite >= 0 && echeck[isite] == 0) { // Cover third neighbour Zn site
-					    coord[isite] = coord[isite]-10;
-					    esites[nsites++] = isite;
-					    echeck[isite] = 1;
-                                        }
+					if (visit_site(mm,nsites)) coord[mm] -= 10; // Cover third neighbour Zn site
 					for (int s = 0; s < numneigh[mm]; s++) {
 						int ss = neighbor[mm][s];
-						isite = i2site[ss];
-						if (isite >= 0 && echeck[isite] == 0) { // Cover fourth neighbour O site
-							coord[isite] = coord[isite]-10;
-							esites[nsites++] = isite;
-							echeck[isite] = 1;
-						}
+						if (visit_site(ss,nsites)) coord[ss] -= 10; // Cover fourth neighbour O site
 					}
 				}
 			}
@@ -922,36 +992,16 @@ void AppAldZno::put_mask(int i)
     else if ( element[i] == ZnXOH || element[i] == ZnXO ){
         for (int n = 0; n < numneigh[i]; n++) {
             int nn = neighbor[i][n];
-            isite = i2site[nn];
-            if (isite >= 0 && echeck[isite] == 0) { // Cover first neighbour Zn site
-                coord[isite]=coord[isite]-10;
-                esites[nsites++] = isite;
-                echeck[isite] = 1;
-            }
+            if (visit_site(nn,nsites)) coord[nn] -= 10; // Cover first neighbour Zn site
             for (int k = 0; k < numneigh[nn]; k++){
                 int kk = neighbor[nn][k];
-                isite = i2site[kk];
-                if (isite >= 0 && echeck[isite] == 0) { // Cover second neighbour O site
-                    coord[isite]=coord[isite]-10;
-                    esites[nsites++] = isite;
-                    echeck[isite] = 1;
-                }
+                if (visit_site(kk,nsites)) coord[kk] -= 10; // Cover second neighbour O site
                 for (int m = 0; m < numneigh[kk]; m++) {
                     int mm = neighbor[kk][m];
-                    isite = i2site[mm];
-                    if (isite >= 0 && echeck[isite] == 0) { // Cover third neighbour Zn site
-                        coord[isite] = coord[isite]-10;
-                        esites[nsites++] = isite;
-                        echeck[isite] = 1;
-                    }
+                    if (visit_site(mm,nsites)) coord[mm] -= 10; // Cover third neighbour Zn site
                     for (int s = 0; s < numneigh[mm]; s++) {
                         int ss = neighbor[mm][s];
-                        isite = i2site[ss];
-                        if (isite >= 0 && echeck[isite] == 0) { // Cover fourth neighbour O site
-                            coord[isite] = coord[isite]-10;
-                            esites[nsites++] = isite;
-                            echeck[isite] = 1;
-                        }
+                        if (visit_site(ss,nsites)) coord[ss] -= 10; // Cover fourth neighbour O site
                     }
                 }
             }
@@ -963,36 +1013,16 @@ void AppAldZno::put_mask(int i)
 	else if ( element[i] == ZnX ){
 	  	for (int n = 0; n < numneigh[i]; n++) {
 			int nn = neighbor[i][n];
-			isite = i2site[nn];
-			if (isite >= 0 && echeck[isite] == 0) { // Cover first neighbour O site
-				coord[isite]=coord[isite]-10;
-				esites[nsites++] = isite;
-				echeck[isite] = 1;
-			}
+			if (visit_site(nn,nsites)) coord[nn] -= 10; // Cover first neighbour O site
             for (int k = 0; k < numneigh[nn]; k++){
                 int kk = neighbor[nn][k];
-                isite = i2site[kk];
-                if (isite >= 0 && echeck[isite] == 0) { // Cover second neighbour Zn site
-                    coord[isite] = coord[isite]-10;
-                    esites[nsites++] = isite;
-                    echeck[isite] = 1;
-                }
+                if (visit_site(kk,nsites)) coord[kk] -= 10; // Cover second neighbour Zn site
                 for (int m = 0; m < numneigh[kk]; m++) {
                     int mm = neighbor[kk][m];
-                    isite = i2site[mm];
-                    if (isite >= 0 && echeck[isite] == 0) { // Cover third neighbour Zn site
-                        coord[isite] = coord[isite]-10;
-                        esites[nsites++] = isite;
-                        echeck[isite] = 1;
-                    }
+                    if (visit_site(mm,nsites)) coord[mm] -= 10; // Cover third neighbour Zn site
                     for (int s = 0; s < numneigh[mm]; s++) {
                         int ss = neighbor[mm][s];
-                        isite = i2site[ss];
-                        if (isite >= 0 && echeck[isite] == 0) { // Cover fourth neighbour O site
-                            coord[isite] = coord[isite]-10;
-                            esites[nsites++] = isite;
-                            echeck[isite] = 1;
-                        }
+                        if (visit_site(ss,nsites)) coord[ss] -= 10; // Cover fourth neighbour O site
                     }
                 }
             }
@@ -1007,44 +1037,22 @@ void AppAldZno::put_mask(int i)
 
 void AppAldZno::remove_mask(int i, int j) // j flag for when Zn densification
 {
-    int isite = i2site[i];
 	int nsites = 0;
-	esites[nsites++] = isite;
-    echeck[isite] = 1;
+	visit_site(i,nsites);
 // Remove mask from oxygen sites after desorption
 	if ( element[i] == O || element[i] == OH || element[i] == OH2 || element[i] == ZnXO || element[i] == ZnXOH ){
 	  	for (int n = 0; n < numneigh[i]; n++) {
 			int nn = neighbor[i][n];
-			isite = i2site[nn];
-			if (isite >= 0 && echeck[isite] == 0) { // Remove first neighbour Zn site
-                coord[isite]=coord[isite]+20;
-                esites[nsites++] = isite;
-                echeck[isite] = 1;
-            }
+			if (visit_site(nn,nsites)) coord[nn] += 20; // Remove first neighbour Zn site
 			for (int k = 0; k < numneigh[nn]; k++){
 				int kk = neighbor[nn][k];
-				isite = i2site[kk];
-				if (isite >= 0 && echeck[isite] == 0) { // Remove second neighbour O site
-					coord[isite]=coord[isite]+10;
-					esites[nsites++] = isite;
-					echeck[isite] = 1;
-				}
+				if (visit_site(kk,nsites)) coord[kk] += 10; // Remove second neighbour O site
 				for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
-					isite = i2site[mm];
-					if (isite >= 0 && echeck[isite] == 0) {// Remove third neighbour Zn site
-					    coord[isite] = coord[isite]+10;
-					    esites[nsites++] = isite;
-					    echeck[isite] = 1;
-                    }
+					if (visit_site(mm,nsites)) coord[mm] += 10; // Remove third neighbour Zn site
 					for (int s = 0; s < numneigh[mm]; s++) {
 						int ss = neighbor[mm][s];
-						isite = i2site[ss];
-						if (isite >= 0 && echeck[isite] == 0) {// Remove fourth neighbour O site
-							coord[isite] = coord[isite]+10;
-							esites[nsites++] = isite;
-							echeck[isite] = 1;
-						}
+						if (visit_site(ss,nsites)) coord[ss] += 10; // Remove fourth neighbour O site
 					}
 				}
 			}
@@ -1053,41 +1061,21 @@ void AppAldZno::remove_mask(int i, int j) // j flag for when Zn densification
 	
 // Remove mask from the oxygen site after densification
 	else if ( ( element[i] == ZnX && ( element[j] == O || element[j] == OH || element[j] == OH2 )) ){ 
-	    echeck[i2site[i]] = 0;
+	    if (i < nlocal) echeck[i] = 0;
 	    for (int n = 0; n < numneigh[j]; n++) {
 	        int nn = neighbor[j][n];
-	        isite = i2site[nn];
-	        if (isite >= 0 && echeck[isite] == 0 ) { // Remove first neighbour Zn site
-	            coord[isite]=coord[isite]+10;
-                esites[nsites++] = isite;
-                echeck[isite] = 1;
-            }
+	        if (visit_site(nn,nsites)) coord[nn] += 10; // Remove first neighbour Zn site
             for (int k = 0; k < numneigh[nn]; k++){
                 int kk = neighbor[nn][k];
                 if(kk != j){
-                    isite = i2site[kk];
-                    if (isite >= 0 && echeck[isite] == 0) { // Remove second neighbour O site
-                        if(isite!=j){coord[isite] = coord[isite]+10;}
-                        esites[nsites++] = isite;
-                        echeck[isite] = 1;
-                    }
+                    if (visit_site(kk,nsites)) coord[kk] += 10; // Remove second neighbour O site
                 }
                 for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
-					isite = i2site[mm];
-					if (isite >= 0 && echeck[isite] == 0) { // Cover third neighbour Zn site
-						coord[isite] = coord[isite]+10;
-						esites[nsites++] = isite;
-						echeck[isite] = 1;
-					}
+					if (visit_site(mm,nsites)) coord[mm] += 10; // Cover third neighbour Zn site
 					for (int s = 0; s < numneigh[mm]; s++) {
 						int ss = neighbor[mm][s];
-						isite = i2site[ss];
-						if (isite >= 0 && echeck[isite] == 0) { // Cover fourth neighbour O site
-							coord[isite] = coord[isite]+10;
-							esites[nsites++] = isite;
-							echeck[isite] = 1;
-						}
+						if (visit_site(ss,nsites)) coord[ss] += 10; // Cover fourth neighbour O site
 					}
 				}
             }
@@ -1099,36 +1087,16 @@ void AppAldZno::remove_mask(int i, int j) // j flag for when Zn densification
 	else if ( element[i] == OZn || element[i] == OHZn || element[i] == OH2Zn ||  element[i] == ZnOH || element[i] == ZnO || element[i] == Zn ){
 	  	for (int n = 0; n < numneigh[i]; n++) {
       	  	int nn = neighbor[i][n];
-            isite = i2site[nn];
-            if (isite >= 0 && echeck[isite] == 0 ) {
-                    coord[isite]=coord[isite]+10;
-                    esites[nsites++] = isite;
-                    echeck[isite] = 1;
-            }
+            if (visit_site(nn,nsites)) coord[nn] += 10;
             for (int k = 0; k < numneigh[nn]; k++){
                 int kk = neighbor[nn][k];
-                isite = i2site[kk];
-                if (isite >= 0 && echeck[isite] == 0) {
-                    coord[isite] = coord[isite]+10;
-                    esites[nsites++] = isite;
-                    echeck[isite] = 1;
-                }
+                if (visit_site(kk,nsites)) coord[kk] += 10;
 				for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
-					isite = i2site[mm];
-					if (isite >= 0 && echeck[isite] == 0) { // Cover third neighbour Zn site
-						coord[isite] = coord[isite]+10;
-						esites[nsites++] = isite;
-                        echeck[isite] = 1;
-                    }
+					if (visit_site(mm,nsites)) coord[mm] += 10; // Cover third neighbour Zn site
                     for (int s = 0; s < numneigh[mm]; s++) {
                         int ss = neighbor[mm][s];
-                        isite = i2site[ss];
-                        if (isite >= 0 && echeck[isite] == 0) { // Cover fourth neighbour O site
-                            coord[isite] = coord[isite]+10;
-                            esites[nsites++] = isite;
-                            echeck[isite] = 1;
-                        }
+                        if (visit_site(ss,nsites)) coord[ss] += 10; // Cover fourth neighbour O site
                     }
                 }
             }
@@ -1138,36 +1106,16 @@ void AppAldZno::remove_mask(int i, int j) // j flag for when Zn densification
     else if ( element[i] == VACANCY && ( element[j] == ZnXOH || element[j] == ZnXO )){
         for (int n = 0; n < numneigh[i]; n++) {
             int nn = neighbor[i][n];
-            isite = i2site[nn];
-            if (isite >= 0 && echeck[isite] == 0 ) {
-                coord[isite]=coord[isite]+10;
-                esites[nsites++] = isite;
-                echeck[isite] = 1;
-            }
+            if (visit_site(nn,nsites)) coord[nn] += 10;
             for (int k = 0; k < numneigh[nn]; k++){
                 int kk = neighbor[nn][k];
-                isite = i2site[kk];
-                if (isite >= 0 && echeck[isite] == 0) {
-                    coord[isite] = coord[isite]+10;
-                    esites[nsites++] = isite;
-                    echeck[isite] = 1;
-                }
+                if (visit_site(kk,nsites)) coord[kk] += 10;
 				for (int m = 0; m < numneigh[kk]; m++) {
 					int mm = neighbor[kk][m];
-					isite = i2site[mm];
-					if (isite >= 0 && echeck[isite] == 0) { // Cover third neighbour Zn site
-                        coord[isite] = coord[isite]+10;
-                        esites[nsites++] = isite;
-                        echeck[isite] = 1;
-                    }
+					if (visit_site(mm,nsites)) coord[mm] += 10; // Cover third neighbour Zn site
                     for (int s = 0; s < numneigh[mm]; s++) {
 						int ss = neighbor[mm][s];
-						isite = i2site[ss];
-						if (isite >= 0 && echeck[isite] == 0) { // Cover fourth neighbour O site
-                            coord[isite] = coord[isite]+10;
-                            esites[nsites++] = isite;
-                            echeck[isite] = 1;
-                        }
+						if (visit_site(ss,nsites)) coord[ss] += 10; // Cover fourth neighbour O site
                     }
                 }
             }
@@ -1185,7 +1133,7 @@ void AppAldZno::remove_mask(int i, int j) // j flag for when Zn densification
 void AppAldZno::count_coord(int i, int j) // i: Oxygen species, j: Zinc species (does not necessarily hold)
 {
 // Densification of ZnXOH, ZnXO -> ZnX
-    if (( element[i] == O || element[i] == OH || element[i] == OH2 ) &&  ( element[j] == ZnX )  ){
+    if (( element[i] == O || element[i] == OH || element[i] == OH2 ) &&  j >= 0 && ( element[j] == ZnX )  ){
 			coord[j]=coord[j]+1; // Add one because of X ligand
 			for (int s = 0; s < numneigh[j]; s++){
 				int nn = neighbor[j][s];
@@ -1196,7 +1144,7 @@ void AppAldZno::count_coord(int i, int j) // i: Oxygen species, j: Zinc species
 			}
     }
 // Densification of ZnOH, ZnO -> Zn
-    else if (( element[i] == O || element[i] == OH || element[i] == OH2 ) &&  ( element[j] == Zn )  ){
+    else if (( element[i] == O || element[i] == OH || element[i] == OH2 ) &&  j >= 0 && ( element[j] == Zn )  ){
         for (int s = 0; s < numneigh[j]; s++){
                 int nn = neighbor[j][s];
                 if (element[nn] >= O && element[nn] <= ZnOH ) { // Check if neighbouring site is an oxygen site
@@ -1206,7 +1154,7 @@ void AppAldZno::count_coord(int i, int j) // i: Oxygen species, j: Zinc species
         }
     }
 // Densification of oxygen-species
-    else if (( element[i] == ZnX || element[i] == Zn ) &&  ( element[j] == O || element[j] == OH || element[j] == OH2 )  ){
+    else if (( element[i] == ZnX || element[i] == Zn ) &&  j >= 0 && ( element[j] == O || element[j] == OH || element[j] == OH2 )  ){
         for (int s = 0; s < numneigh[j]; s++){
                 int nn = neighbor[j][s];
                 if ( Zn <= element[nn] && element[nn] <= OZn) { // Check if neighbouring site is an zinc site
@@ -1218,7 +1166,7 @@ void AppAldZno::count_coord(int i, int j) // i: Oxygen species, j: Zinc species
         }
     }
 // Reverse densification on ZnX
-    else if ( element[i] == VACANCY  && (element[j] >= ZnXO && element[j] <= ZnOH ) ){
+    else if ( element[i] == VACANCY  && j >= 0 && (element[j] >= ZnXO && element[j] <= ZnOH ) ){
         if ( element[j] == ZnXO || element[j] == ZnXOH ){ coord[i]=coord[i] - 1; } // Remove the extra cn from ligand
         for (int s = 0; s < numneigh[i]; s++){
             int nn = neighbor[i][s];
@@ -1240,7 +1188,7 @@ void AppAldZno::count_coord(int i, int j) // i: Oxygen species, j: Zinc species
         }
     }
 // Reverse densification of OH2 / OH / O
-    else if ( element[i] == VACANCY  && ( element[j] == OH2ZnX || element[j] == OH2Zn || element[j] == OHZnX || element[j] == OHZn || element[j] == OZn) ){
+    else if ( element[i] == VACANCY  && j >= 0 && ( element[j] == OH2ZnX || element[j] == OH2Zn || element[j] == OHZnX || element[j] == OHZn || element[j] == OZn) ){
         for (int s = 0; s < numneigh[i]; s++){
             int nn = neighbor[i][s];
             if ( element[nn] >= Zn && element[nn] <= OZn ) { // Check if neighbouring site is a zinc site
@@ -1261,20 +1209,16 @@ void AppAldZno::count_coordO(int i)
     int emptyO = 0;
     int totalS = 0;
 
-    int isite = i2site[i];
     int nsites = 0;
 
 	for (int m = 0; m < numneigh[i]; m++) {
 		int mm = neighbor[i][m];
 		for (int s = 0; s < numneigh[mm]; s++) {
 			int ss = neighbor[mm][s];
-			isite = i2site[ss];
 			if (i==ss)  continue;
-			if (isite >= 0 && echeck[isite] == 0) {
+			if (visit_site(ss,nsites)) {
 			  if ( element[ss] >= O && element[ss] <= ZnOH ) {fullO++;}
 			  else if (element[ss] == VACANCY) {emptyO++;}
-		          esites[nsites++] = isite;
-		          echeck[isite] = 1;
 		        }
     
 		}
@@ -1284,3 +1228,19 @@ void AppAldZno::count_coordO(int i)
    for (int m = 0; m < nsites; m++)  {echeck[esites[m]] = 0; esites[m]=0;}
 }
 
+/* ----------------------------------------------------------------------
+   memory usage of event list and per-site scratch arrays
+------------------------------------------------------------------------- */
+
+bigint AppAldZno::memory_usage_app()
+{
+  bigint bytes = 0;
+  bytes += (bigint) maxevent * sizeof(Event);     // events
+  if (firstevent) {
+    bytes += (bigint) maxlocal * sizeof(int);     // firstevent
+    bytes += (bigint) maxlocal * sizeof(int);     // echeck
+    bytes += (bigint) maxlocal * sizeof(int);     // esites
+    bytes += 12*maxneigh*2 * sizeof(double);      // comneigh
+  }
+  return bytes;
+}
@@ -33,23 +33,28 @@ class AppAldZno : public AppLattice {
   void grow_app();
   void init_app();
   void setup_app();
+  void setup_end_app();
+  bigint memory_usage_app();
 
   double site_energy(int);
   void site_event_rejection(int, class RandomPark *) {}
   double site_propensity(int);
   void site_event(int, class RandomPark *);
+  int profile_reactions();
+  void profile_label(int, char *);
 
  private:
   int engstyle;
   int *coord,*element;      // variables on each lattice site 
   int firsttime;
+  int maxlocal;               // allocated size of per-site arrays
   int hello;
   double T1,T2,T3,T4;          // time period during ALD
   double cycle;
   int pressureOn;
 
-  int *esites;
-  int *echeck;
+  int *esites;             // scratch list of sites visited by an update
+  int *echeck;             // 1 if site is on esites, 0 otherwise
 
   int none,ntwo,nthree;
   double *srate,*drate,*vrate;/* two type of reaction, therefore we need only two pointers here, I deleted trate,tcount,toutput */
@@ -79,6 +84,7 @@ class AppAldZno : public AppLattice {
   int *firstevent;         // index of 1st event for each owned site
   int freeevent;           // index of 1st unused event in list
 
+  void compact_events();
   void clear_events(int);
   void add_event(int, int, int, double, int, int);
   void grow_reactions(int);
@@ -87,6 +93,8 @@ class AppAldZno : public AppLattice {
   void count_coordZn(int);
   void remove_mask(int, int j = 0);
   void put_mask(int);
+  void update_site(int, int &);
+  int visit_site(int, int &);
   void update_coord(int,int,int,int,int);
 };
 
@@ -11,11 +11,18 @@
    See the README file in the top-level SPPARKS directory.
 ------------------------------------------------------------------------- */
 
+#include "mpi.h"
+#include "math.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
 #include "app_chemistry.h"
 #include "solve.h"
+#include "solve_linear.h"
+#include "solve_tree.h"
+#include "domain.h"
+#include "random_park.h"
+#include "random_mars.h"
 #include "finish.h"
 #include "timer.h"
 #include "memory.h"
@@ -26,6 +33,13 @@ using namespace SPPARKS_NS;
 
 #define MAX_PRODUCT 5
 #define AVOGADRO 6.023e23
+#define MAXLINEAR 32        // largest network solved by solve_style linear
+#define MAXLINE 256
+#define CHUNK 1024
+#define MAXWORD 16
+#define NSSA 100            // # of SSA events when a leap is not worthwhile
+#define SSAFACTOR 10.0      // leap only if tau > SSAFACTOR mean SSA steps
+#define BIG 1.0e300
 
 /* ---------------------------------------------------------------------- */
 
@@ -38,10 +52,10 @@ AppChemistry::AppChemistry(SPPARKS *spk, int narg, char **arg) :
 
   volume = 0.0;
 
-  nspecies = 0;
+  nspecies = maxspecies = 0;
   sname = NULL;
 
-  nreactions = 0;
+  nreactions = maxreactions = 0;
   rname = NULL;
   nreactant = NULL;
   reactants = NULL;
@@ -50,11 +64,23 @@ AppChemistry::AppChemistry(SPPARKS *spk, int narg, char **arg) :
   rate = NULL;
 
   pcount = NULL;
-  ndepends = NULL;
-  depends = NULL;
+  rstart = rlist = NULL;
+  dstart = dlist = NULL;
+  uflag = ulist = NULL;
+  autospecies = 0;
   propensity = NULL;
   rcount = NULL;
 
+  nstats = -1;
+  slist = NULL;
+
+  leapflag = 0;
+  nssa = 0;
+  horder = NULL;
+  mu = sigma = NULL;
+  critical = fired = kfire = NULL;
+  random = NULL;
+
   nevents = 0;
 }
 
@@ -74,11 +100,24 @@ AppChemistry::~AppChemistry()
   memory->destroy(products);
   memory->destroy(rate);
 
-  memory->destroy(pcount);
-  memory->destroy(ndepends);
-  memory->destroy(depends);
+  memory->sfree(pcount);
+  memory->destroy(rstart);
+  memory->destroy(rlist);
+  memory->destroy(dstart);
+  memory->destroy(dlist);
+  memory->destroy(uflag);
+  memory->destroy(ulist);
   memory->destroy(propensity);
   memory->destroy(rcount);
+  memory->destroy(slist);
+
+  memory->destroy(horder);
+  memory->destroy(mu);
+  memory->destroy(sigma);
+  memory->destroy(critical);
+  memory->destroy(fired);
+  memory->destroy(kfire);
+  delete random;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -88,6 +127,9 @@ void AppChemistry::input(char *command, int narg, char **arg)
   if (strcmp(command,"add_reaction") == 0) add_reaction(narg,arg);
   else if (strcmp(command,"add_species") == 0) add_species(narg,arg);
   else if (strcmp(command,"count") == 0) set_count(narg,arg);
+  else if (strcmp(command,"read_reactions") == 0) read_reactions(narg,arg);
+  else if (strcmp(command,"stats_species") == 0) set_stats(narg,arg);
+  else if (strcmp(command,"tau_leap") == 0) set_leap(narg,arg);
   else if (strcmp(command,"volume") == 0) set_volume(narg,arg);
   else error->all(FLERR,"Unrecognized command");
 }
@@ -98,27 +140,79 @@ void AppChemistry::init()
 {
   // error check
 
-  if (solve == NULL) error->all(FLERR,"No solver class defined");
   if (volume <= 0.0) error->all(FLERR,"Invalid volume setting");
   if (nreactions == 0)
     error->all(FLERR,"No reactions defined for chemistry app");
 
+  // if no solve_style was given, pick one by size of reaction network
+  // linear search is fastest for small networks, tree for large ones
+
+  if (solve == NULL) {
+    char *args[1];
+    if (nreactions <= MAXLINEAR) {
+      args[0] = (char *) "linear";
+      solve = new SolveLinear(spk,1,args);
+    } else {
+      args[0] = (char *) "tree";
+      solve = new SolveTree(spk,1,args);
+    }
+    if (domain->me == 0) {
+      if (screen)
+	fprintf(screen,"Using solve_style %s for %d reactions\n",
+		args[0],nreactions);
+      if (logfile)
+	fprintf(logfile,"Using solve_style %s for %d reactions\n",
+		args[0],nreactions);
+    }
+  }
+
   factor_zero = AVOGADRO * volume;
   factor_dual = 1.0 / (AVOGADRO * volume);
 
   // determine reaction dependencies
 
-  delete [] ndepends;
-  memory->destroy(depends);
-  memory->create(ndepends,nreactions,"chemistry:ndepends");
   build_dependency_graph();
 
   // zero reaction counts
 
-  delete [] rcount;
+  memory->destroy(rcount);
   memory->create(rcount,nreactions,"chemistry:rcount");
   for (int m = 0; m < nreactions; m++) rcount[m] = 0;
 
+  // per-species and per-reaction work arrays for tau-leaping
+  // horder = highest order of any reaction with species I as reactant
+
+  memory->destroy(horder);
+  memory->destroy(mu);
+  memory->destroy(sigma);
+  memory->destroy(critical);
+  memory->destroy(fired);
+  memory->destroy(kfire);
+
+  if (leapflag) {
+    memory->create(horder,nspecies,"chemistry:horder");
+    memory->create(mu,nspecies,"chemistry:mu");
+    memory->create(sigma,nspecies,"chemistry:sigma");
+    memory->create(critical,nreactions,"chemistry:critical");
+    memory->create(fired,nreactions+1,"chemistry:fired");
+    memory->create(kfire,nreactions+1,"chemistry:kfire");
+
+    for (int i = 0; i < nspecies; i++) horder[i] = 0;
+    for (int m = 0; m < nreactions; m++) {
+      if (nreactant[m] == 1)
+	horder[reactants[m][0]] = MAX(horder[reactants[m][0]],1);
+      else if (nreactant[m] == 2) {
+	if (reactants[m][0] == reactants[m][1])
+	  horder[reactants[m][0]] = 3;
+	else {
+	  horder[reactants[m][0]] = MAX(horder[reactants[m][0]],2);
+	  horder[reactants[m][1]] = MAX(horder[reactants[m][1]],2);
+	}
+      }
+    }
+  }
+  nssa = 0;
+
   // initialize output
 
   output->init(time);
@@ -130,7 +224,7 @@ void AppChemistry::setup()
 {
   // compute initial propensity for each reaction
 
-  delete [] propensity;
+  memory->destroy(propensity);
   memory->create(propensity,nreactions,"chemistry:propensity");
   for (int m = 0; m < nreactions; m++) propensity[m] = compute_propensity(m);
 
@@ -157,9 +251,27 @@ void AppChemistry::iterate()
   timer->barrier_start(TIME_LOOP);
 
   while (!done) {
-    timer->stamp();
+    timer->event_start();
+
+    // tau-leap if enabled and if a leap covers enough SSA events
+    // else perform one SSA event
+
+    if (leapflag && nssa == 0 && leap(dt)) {
+      time += dt;
+      if (time >= stoptime) done = 1;
+      timer->event_stamp(TIME_APP);
+
+      if (done || time >= nextoutput) {
+	timer->event_finish();
+	nextoutput = output->compute(time,done);
+	timer->stamp(TIME_OUTPUT);
+      }
+      continue;
+    }
+    if (nssa > 0) nssa--;
+
     ireaction = solve->event(&dt);
-    timer->stamp(TIME_SOLVE);
+    timer->event_stamp(TIME_SOLVE);
 
     // check if solver failed to pick an event
 
@@ -177,10 +289,10 @@ void AppChemistry::iterate()
       // update propensities of dependent reactions
       // inform Gillespie solver of changes
 
-      for (m = 0; m < ndepends[ireaction]; m++)
-	propensity[depends[ireaction][m]] = 
-	  compute_propensity(depends[ireaction][m]);
-      solve->update(ndepends[ireaction],depends[ireaction],propensity);
+      for (m = dstart[ireaction]; m < dstart[ireaction+1]; m++)
+	propensity[dlist[m]] = compute_propensity(dlist[m]);
+      solve->update(dstart[ireaction+1]-dstart[ireaction],
+		    &dlist[dstart[ireaction]],propensity);
 
       // update time by Gillepsie dt
 
@@ -189,10 +301,13 @@ void AppChemistry::iterate()
       if (time >= stoptime) done = 1;
     }
 
-    timer->stamp(TIME_APP);
+    timer->event_stamp(TIME_APP);
 
-    if (done || time >= nextoutput) nextoutput = output->compute(time,done);
-    timer->stamp(TIME_OUTPUT);
+    if (done || time >= nextoutput) {
+      timer->event_finish();
+      nextoutput = output->compute(time,done);
+      timer->stamp(TIME_OUTPUT);
+    }
   }
 
   timer->barrier_stop(TIME_LOOP);
@@ -208,8 +323,9 @@ void AppChemistry::stats(char *strtmp)
   sprintf(strpnt," %10g %10d",time,nevents);
   strpnt += strlen(strpnt);
 
-  for (int m = 0; m < nspecies; m++) {
-    sprintf(strpnt," %d",pcount[m]);
+  int n = nstats < 0 ? nspecies : nstats;
+  for (int m = 0; m < n; m++) {
+    sprintf(strpnt," %d",pcount[nstats < 0 ? m : slist[m]]);
     strpnt += strlen(strpnt);
   }
 }
@@ -224,8 +340,9 @@ void AppChemistry::stats_header(char *strtmp)
   sprintf(strpnt," %10s %10s","Time","Step");
   strpnt += strlen(strpnt);
 
-  for (int m = 0; m < nspecies; m++) {
-    sprintf(strpnt," %s",sname[m]);
+  int n = nstats < 0 ? nspecies : nstats;
+  for (int m = 0; m < n; m++) {
+    sprintf(strpnt," %s",sname[nstats < 0 ? m : slist[m]]);
     strpnt += strlen(strpnt);
   }
 }
@@ -259,21 +376,24 @@ void AppChemistry::add_reaction(int narg, char **arg)
     error->all(FLERR,str);
   }
 
-  int n = nreactions + 1;
-  rname = (char **) memory->srealloc(rname,n*sizeof(char *),
-					  "chemistry:rname");
+  // grow reaction arrays, doubling to keep bulk loading linear
+
+  if (nreactions == maxreactions) {
+    maxreactions = MAX(2*maxreactions,16);
+    int n = maxreactions;
+    rname = (char **) memory->srealloc(rname,n*sizeof(char *),
+				       "chemistry:rname");
+    memory->grow(nreactant,n,"chemistry:nreactnant");
+    memory->grow(reactants,n,2,"chemistry:reactants");
+    memory->grow(nproduct,n,"chemistry:nproduct");
+    memory->grow(products,n,MAX_PRODUCT,"chemistry:products");
+    memory->grow(rate,n,"chemistry:rate");
+  }
+
   int nlen = strlen(arg[0]) + 1;
   rname[nreactions] = new char[nlen];
   strcpy(rname[nreactions],arg[0]);
 
-  // grow reaction arrays
-
-  memory->grow(nreactant,n,"chemistry:nreactnant");
-  memory->grow(reactants,n,2,"chemistry:reactants");
-  memory->grow(nproduct,n,"chemistry:nproduct");
-  memory->grow(products,n,MAX_PRODUCT,"chemistry:products");
-  memory->grow(rate,n,"chemistry:rate");
-
   // find which arg is numeric reaction rate
 
   char c;
@@ -293,7 +413,11 @@ void AppChemistry::add_reaction(int narg, char **arg)
     error->all(FLERR,"Reaction cannot have more than MAX_PRODUCT products");
 
   // extract reactant and product species names
-  // if any species does not exist, create it
+  // if any species does not exist, create it if allowed by read_reactions
+
+  for (int i = 1; i < narg; i++)
+    if (i != iarg && autospecies && find_species(arg[i]) < 0)
+      add_species(1,&arg[i]);
 
   nreactant[nreactions] = 0;
   for (int i = 1; i < iarg; i++) {
@@ -313,6 +437,7 @@ void AppChemistry::add_reaction(int narg, char **arg)
     nproduct[nreactions]++;
   }
   
+  rhash[rname[nreactions]] = nreactions;
   nreactions++;
 }
 
@@ -324,11 +449,7 @@ void AppChemistry::add_species(int narg, char **arg)
 
   // grow species arrays
 
-  int n = nspecies + narg;
-  sname = (char **) memory->srealloc(sname,n*sizeof(char *),
-					  "chemistry:sname");
-  pcount = (int *) memory->srealloc(pcount,n*sizeof(int),
-					 "chemistry:pcount");
+  grow_species(nspecies + narg);
 
   for (int iarg = 0; iarg < narg; iarg++) {
     if (find_species(arg[iarg]) >= 0) {
@@ -337,11 +458,27 @@ void AppChemistry::add_species(int narg, char **arg)
       error->all(FLERR,str);
     }
     int nlen = strlen(arg[iarg]) + 1;
-    sname[nspecies+iarg] = new char[nlen];
-    strcpy(sname[nspecies+iarg],arg[iarg]);
-    pcount[nspecies+iarg] = 0;
+    sname[nspecies] = new char[nlen];
+    strcpy(sname[nspecies],arg[iarg]);
+    pcount[nspecies] = 0;
+    shash[sname[nspecies]] = nspecies;
+    nspecies++;
   }
-  nspecies += narg;
+}
+
+/* ----------------------------------------------------------------------
+   grow species arrays to hold at least N species
+   double the size to keep adding one species at a time linear
+------------------------------------------------------------------------- */
+
+void AppChemistry::grow_species(int n)
+{
+  if (n <= maxspecies) return;
+  maxspecies = MAX(2*maxspecies,n);
+  sname = (char **) memory->srealloc(sname,maxspecies*sizeof(char *),
+				     "chemistry:sname");
+  pcount = (int *) memory->srealloc(pcount,maxspecies*sizeof(int),
+				    "chemistry:pcount");
 }
 
 /* ---------------------------------------------------------------------- */
@@ -352,6 +489,138 @@ void AppChemistry::set_volume(int narg, char **arg)
   volume = atof(arg[0]);
 }
 
+/* ----------------------------------------------------------------------
+   select species printed in stats output, all species by default
+------------------------------------------------------------------------- */
+
+void AppChemistry::set_stats(int narg, char **arg)
+{
+  if (narg == 0) error->all(FLERR,"Illegal stats_species command");
+
+  memory->destroy(slist);
+  nstats = -1;
+  if (narg == 1 && strcmp(arg[0],"all") == 0) return;
+
+  memory->create(slist,narg,"chemistry:slist");
+  for (int iarg = 0; iarg < narg; iarg++) {
+    slist[iarg] = find_species(arg[iarg]);
+    if (slist[iarg] < 0) {
+      char *str = new char[128];
+      sprintf(str,"Species ID %s does not exist",arg[iarg]);
+      error->all(FLERR,str);
+    }
+  }
+  nstats = narg;
+}
+
+/* ----------------------------------------------------------------------
+   enable or disable hybrid tau-leaping
+------------------------------------------------------------------------- */
+
+void AppChemistry::set_leap(int narg, char **arg)
+{
+  if (narg == 1 && strcmp(arg[0],"no") == 0) {
+    leapflag = 0;
+    return;
+  }
+
+  if (narg != 2) error->all(FLERR,"Illegal tau_leap command");
+  epsilon = atof(arg[0]);
+  ncritical = atoi(arg[1]);
+  if (epsilon <= 0.0 || epsilon >= 1.0 || ncritical < 0)
+    error->all(FLERR,"Illegal tau_leap command");
+  leapflag = 1;
+
+  if (random == NULL) {
+    random = new RandomPark(ranmaster->uniform());
+    double seed = ranmaster->uniform();
+    random->reset(seed,domain->me,100);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   read reactions from a file, one per line with add_reaction syntax
+   proc 0 reads one CHUNK of lines at a time and broadcasts them
+------------------------------------------------------------------------- */
+
+void AppChemistry::read_reactions(int narg, char **arg)
+{
+  if (narg != 1 && narg != 3) error->all(FLERR,"Illegal read_reactions command");
+
+  autospecies = 0;
+  if (narg == 3) {
+    if (strcmp(arg[1],"species") != 0)
+      error->all(FLERR,"Illegal read_reactions command");
+    if (strcmp(arg[2],"yes") == 0) autospecies = 1;
+    else if (strcmp(arg[2],"no") == 0) autospecies = 0;
+    else error->all(FLERR,"Illegal read_reactions command");
+  }
+
+  int me = domain->me;
+  FILE *fp = NULL;
+  if (me == 0) {
+    fp = fopen(arg[0],"r");
+    if (fp == NULL) {
+      char str[128];
+      sprintf(str,"Cannot open reaction file %s",arg[0]);
+      error->one(FLERR,str);
+    }
+  }
+
+  char *buffer = new char[CHUNK*MAXLINE+1];
+  char *words[MAXWORD];
+  int n,m,nlines;
+  char *buf,*next,*ptr;
+  int nprevious = nreactions;
+
+  while (1) {
+    if (me == 0) {
+      m = 0;
+      for (nlines = 0; nlines < CHUNK; nlines++) {
+	if (fgets(&buffer[m],MAXLINE,fp) == NULL) break;
+	n = strlen(&buffer[m]);
+	if (buffer[m+n-1] != '\n') {
+	  if (n == MAXLINE-1 && !feof(fp))
+	    error->one(FLERR,"Reaction file line is too long");
+	  buffer[m+n++] = '\n';
+	}
+	m += n;
+      }
+      buffer[m++] = '\0';
+    }
+    MPI_Bcast(&nlines,1,MPI_INT,0,world);
+    MPI_Bcast(&m,1,MPI_INT,0,world);
+    MPI_Bcast(buffer,m,MPI_CHAR,0,world);
+
+    // strip comments, skip blank lines, add one reaction per line
+
+    buf = buffer;
+    for (int i = 0; i < nlines; i++) {
+      next = strchr(buf,'\n');
+      *next = '\0';
+      if ((ptr = strchr(buf,'#'))) *ptr = '\0';
+
+      n = 0;
+      words[n] = strtok(buf," \t\r\f");
+      while (words[n] && n < MAXWORD-1) words[++n] = strtok(NULL," \t\r\f");
+      if (n) add_reaction(n,words);
+
+      buf = next + 1;
+    }
+
+    if (nlines < CHUNK) break;
+  }
+
+  if (me == 0) fclose(fp);
+  delete [] buffer;
+  autospecies = 0;
+
+  if (me == 0) {
+    if (screen) fprintf(screen,"  %d reactions\n",nreactions-nprevious);
+    if (logfile) fprintf(logfile,"  %d reactions\n",nreactions-nprevious);
+  }
+}
+
 /* ----------------------------------------------------------------------
    return reaction index (0 to N-1) for a reaction ID
    return -1 if doesn't exist
@@ -359,9 +628,9 @@ void AppChemistry::set_volume(int narg, char **arg)
 
 int AppChemistry::find_reaction(char *str)
 {
-  for (int i = 0; i < nreactions; i++)
-    if (strcmp(str,rname[i]) == 0) return i;
-  return -1;
+  std::map<std::string,int>::iterator loc = rhash.find(str);
+  if (loc == rhash.end()) return -1;
+  return loc->second;
 }
 
 /* ----------------------------------------------------------------------
@@ -371,102 +640,105 @@ int AppChemistry::find_reaction(char *str)
 
 int AppChemistry::find_species(char *str)
 {
-  for (int i = 0; i < nspecies; i++)
-    if (strcmp(str,sname[i]) == 0) return i;
-  return -1;
+  std::map<std::string,int>::iterator loc = shash.find(str);
+  if (loc == shash.end()) return -1;
+  return loc->second;
 }
 
 /* ----------------------------------------------------------------------
    build dependency graph for entire set of reactions
    reaction N depends on M if a reactant of N is a reactant or product of M
+   use sparse species-to-reaction incidence so cost scales with
+     # of dependencies, not with square of # of reactions
 ------------------------------------------------------------------------- */
 
 void AppChemistry::build_dependency_graph()
 {
-  int i,j,k,m,n,mspecies,nspecies;
+  int i,j,k,m,pass,ispecies;
 
-  // count the dependencies in flag array:
-  // loop over reactants & products of each reaction
-  // for each reaction m, mspecies = its reactants and products
-  // for each species, loop over reactants of all reactions n
-  // if a match, then set flag[n] since n is in dependency list of m
+  // rlist = reactions with species I as a reactant, in increasing order
+  // a reaction is stored once even if it has 2 reactants of species I
 
-  int *flag = new int[nreactions];
+  memory->destroy(rstart);
+  memory->destroy(rlist);
+  memory->create(rstart,nspecies+1,"chemistry:rstart");
 
-  for (m = 0; m < nreactions; m++) {
-    for (n = 0; n < nreactions; n++) flag[n] = 0;
-
-    for (i = 0; i < nreactant[m]; i++) {
-      mspecies = reactants[m][i];
-      for (n = 0; n < nreactions; n++) {
-	for (j = 0; j < nreactant[n]; j++) {
-	  nspecies = reactants[n][j];
-	  if (mspecies == nspecies) flag[n] = 1;
-	}
-      }
+  for (i = 0; i <= nspecies; i++) rstart[i] = 0;
+  for (m = 0; m < nreactions; m++)
+    for (j = 0; j < nreactant[m]; j++) {
+      if (j == 1 && reactants[m][1] == reactants[m][0]) continue;
+      rstart[reactants[m][j]+1]++;
+    }
+  for (i = 0; i < nspecies; i++) rstart[i+1] += rstart[i];
+
+  memory->create(rlist,MAX(rstart[nspecies],1),"chemistry:rlist");
+  int *next = new int[nspecies];
+  for (i = 0; i < nspecies; i++) next[i] = rstart[i];
+  for (m = 0; m < nreactions; m++)
+    for (j = 0; j < nreactant[m]; j++) {
+      if (j == 1 && reactants[m][1] == reactants[m][0]) continue;
+      rlist[next[reactants[m][j]]++] = m;
     }
+  delete [] next;
+
+  // dlist = reactions that depend on reaction M
+  // 1st pass counts, 2nd pass stores
+  // flag insures each dependency is stored once
+  // order is reactants then products of M, reactions in increasing order
+
+  memory->destroy(dstart);
+  memory->destroy(dlist);
+  memory->create(dstart,nreactions+1,"chemistry:dstart");
 
-    for (i = 0; i < nproduct[m]; i++) {
-      mspecies = products[m][i];
-      for (n = 0; n < nreactions; n++) {
-	for (j = 0; j < nreactant[n]; j++) {
-	  nspecies = reactants[n][j];
-	  if (mspecies == nspecies) flag[n] = 1;
+  int *flag = new int[nreactions];
+  for (pass = 0; pass < 2; pass++) {
+    for (m = 0; m < nreactions; m++) flag[m] = -1;
+    dstart[0] = 0;
+    int n = 0;
+    for (m = 0; m < nreactions; m++) {
+      for (i = 0; i < nreactant[m] + nproduct[m]; i++) {
+	if (i < nreactant[m]) ispecies = reactants[m][i];
+	else ispecies = products[m][i-nreactant[m]];
+	for (j = rstart[ispecies]; j < rstart[ispecies+1]; j++) {
+	  k = rlist[j];
+	  if (flag[k] == m) continue;
+	  flag[k] = m;
+	  if (pass) dlist[n] = k;
+	  n++;
 	}
       }
+      dstart[m+1] = n;
     }
-
-    ndepends[m] = 0;
-    for (n = 0; n < nreactions; n++) if (flag[n]) ndepends[m]++;
+    if (pass == 0) memory->create(dlist,MAX(n,1),"chemistry:dlist");
   }
-
   delete [] flag;
 
-  // allocate depends array, 2nd dim is max of ndepends[]
-
-  memory->destroy(depends);
-  int nmax = 0;
-  for (m = 0; m < nreactions; m++) nmax = MAX(nmax,ndepends[m]);
-  memory->create(depends,nreactions,nmax,"chemistry:depends");
-
-  // zero the dependencies
-
-  for (m = 0; m < nreactions; m++) ndepends[m] = 0;
-
-  // store the dependencies via same loops as before
-  // k loop insures dependency was not already stored
+  memory->destroy(uflag);
+  memory->destroy(ulist);
+  memory->create(uflag,nreactions,"chemistry:uflag");
+  memory->create(ulist,nreactions,"chemistry:ulist");
+  for (m = 0; m < nreactions; m++) uflag[m] = 0;
+}
 
-  for (m = 0; m < nreactions; m++) ndepends[m] = 0;
+/* ----------------------------------------------------------------------
+   append reactions that depend on reaction M to ulist, starting at N
+   skip reactions already flagged in uflag, flag new ones
+   caller must clear uflag of all reactions in ulist
+   return new length of ulist
+------------------------------------------------------------------------- */
 
-  for (m = 0; m < nreactions; m++) {
-    for (i = 0; i < nreactant[m]; i++) {
-      mspecies = reactants[m][i];
-      for (n = 0; n < nreactions; n++) {
-	for (j = 0; j < nreactant[n]; j++) {
-	  nspecies = reactants[n][j];
-	  if (mspecies == nspecies) {
-	    for (k = 0; k < ndepends[m]; k++)
-	      if (n == depends[m][k]) break;
-	    if (k == ndepends[m]) depends[m][ndepends[m]++] = n;
-	  }
-	}
-      }
-    }
+int AppChemistry::dependents(int m, int n)
+{
+  int k;
 
-    for (i = 0; i < nproduct[m]; i++) {
-      mspecies = products[m][i];
-      for (n = 0; n < nreactions; n++) {
-	for (j = 0; j < nreactant[n]; j++) {
-	  nspecies = reactants[n][j];
-	  if (mspecies == nspecies) {
-	    for (k = 0; k < ndepends[m]; k++)
-	      if (n == depends[m][k]) break;
-	    if (k == ndepends[m]) depends[m][ndepends[m]++] = n;
-	  }
-	}
-      }
-    }
+  for (int j = dstart[m]; j < dstart[m+1]; j++) {
+    k = dlist[j];
+    if (uflag[k]) continue;
+    uflag[k] = 1;
+    ulist[n++] = k;
   }
+
+  return n;
 }
 
 /* ----------------------------------------------------------------------
@@ -491,3 +763,225 @@ double AppChemistry::compute_propensity(int m)
   }
   return p;
 }
+
+/* ----------------------------------------------------------------------
+   net change of species counts when reaction M fires once
+   return # of species that change, stored in species and delta
+------------------------------------------------------------------------- */
+
+int AppChemistry::stoichiometry(int m, int *species, int *delta)
+{
+  int i,j,ispecies,change;
+
+  int n = 0;
+  for (i = 0; i < nreactant[m] + nproduct[m]; i++) {
+    if (i < nreactant[m]) {
+      ispecies = reactants[m][i];
+      change = -1;
+    } else {
+      ispecies = products[m][i-nreactant[m]];
+      change = 1;
+    }
+    for (j = 0; j < n; j++)
+      if (species[j] == ispecies) break;
+    if (j == n) {
+      species[n] = ispecies;
+      delta[n++] = change;
+    } else delta[j] += change;
+  }
+
+  for (i = j = 0; i < n; i++)
+    if (delta[i]) {
+      species[j] = species[i];
+      delta[j++] = delta[i];
+    }
+  return j;
+}
+
+/* ----------------------------------------------------------------------
+   perform one tau-leap with step size selection of Cao, Gillespie and
+     Petzold, J Chem Phys 124, 044109 (2006)
+   reactions within ncritical firings of exhausting a reactant are critical,
+     at most one critical reaction fires per leap, chosen as in SSA
+   if the leap is not much longer than an SSA step, do NSSA SSA events
+     before trying again
+   return 1 and leap size in tau if leap was performed, else 0
+------------------------------------------------------------------------- */
+
+int AppChemistry::leap(double &tau)
+{
+  int i,j,m,n,ns,nfire;
+  int species[2+MAX_PRODUCT],delta[2+MAX_PRODUCT];
+
+  nssa = NSSA;
+
+  // total propensity and propensity of critical reactions
+
+  double a0 = 0.0;
+  double acritical = 0.0;
+
+  for (m = 0; m < nreactions; m++) {
+    a0 += propensity[m];
+    critical[m] = 0;
+    if (propensity[m] <= 0.0) continue;
+    ns = stoichiometry(m,species,delta);
+    for (j = 0; j < ns; j++)
+      if (delta[j] < 0 && pcount[species[j]] < -delta[j]*ncritical) break;
+    if (j < ns) {
+      critical[m] = 1;
+      acritical += propensity[m];
+    }
+  }
+
+  if (a0 <= 0.0) return 0;
+
+  // mean and variance of change of each species from non-critical reactions
+  // largest tau that changes propensities by no more than epsilon
+
+  for (i = 0; i < nspecies; i++) mu[i] = sigma[i] = 0.0;
+
+  for (m = 0; m < nreactions; m++) {
+    if (critical[m] || propensity[m] <= 0.0) continue;
+    ns = stoichiometry(m,species,delta);
+    for (j = 0; j < ns; j++) {
+      mu[species[j]] += delta[j]*propensity[m];
+      sigma[species[j]] += delta[j]*delta[j]*propensity[m];
+    }
+  }
+
+  double g,bound;
+  double taunc = BIG;
+
+  for (i = 0; i < nspecies; i++) {
+    if (horder[i] == 0) continue;
+    if (horder[i] == 3 && pcount[i] > 1) g = 2.0 + 1.0/(pcount[i]-1);
+    else g = MIN(horder[i],2);
+    bound = MAX(epsilon*pcount[i]/g,1.0);
+    if (mu[i] != 0.0) taunc = MIN(taunc,bound/fabs(mu[i]));
+    if (sigma[i] > 0.0) taunc = MIN(taunc,bound*bound/sigma[i]);
+  }
+
+  if (taunc < SSAFACTOR/a0) return 0;
+  nssa = 0;
+
+  // draw firings of each reaction
+  // if any species count goes negative, undo the leap and halve taunc
+
+  double fraction,partial;
+  int fire;
+
+  while (1) {
+    double tauc = BIG;
+    if (acritical > 0.0) tauc = -1.0/acritical * log(random->uniform());
+
+    fire = 0;
+    if (tauc < taunc) {
+      tau = tauc;
+      fire = 1;
+    } else tau = taunc;
+    if (time + tau > stoptime) {
+      tau = stoptime - time;
+      fire = 0;
+    }
+
+    nfire = 0;
+    for (m = 0; m < nreactions; m++) {
+      if (critical[m] || propensity[m] <= 0.0) continue;
+      n = poisson(propensity[m]*tau);
+      if (n == 0) continue;
+      fired[nfire] = m;
+      kfire[nfire++] = n;
+    }
+
+    if (fire) {
+      fraction = acritical * random->uniform();
+      partial = 0.0;
+      for (m = 0; m < nreactions; m++) {
+	if (!critical[m]) continue;
+	partial += propensity[m];
+	if (partial > fraction) break;
+      }
+      if (m == nreactions)
+	for (m = nreactions-1; !critical[m]; m--);
+      fired[nfire] = m;
+      kfire[nfire++] = 1;
+    }
+
+    int negative = 0;
+    for (n = 0; n < nfire; n++) {
+      ns = stoichiometry(fired[n],species,delta);
+      for (j = 0; j < ns; j++) pcount[species[j]] += kfire[n]*delta[j];
+    }
+    for (n = 0; n < nfire; n++) {
+      ns = stoichiometry(fired[n],species,delta);
+      for (j = 0; j < ns; j++) if (pcount[species[j]] < 0) negative = 1;
+    }
+    if (!negative) break;
+
+    for (n = 0; n < nfire; n++) {
+      ns = stoichiometry(fired[n],species,delta);
+      for (j = 0; j < ns; j++) pcount[species[j]] -= kfire[n]*delta[j];
+    }
+    taunc *= 0.5;
+  }
+
+  // accept leap, update propensities of reactions that depend on
+  // any fired reaction and inform Gillespie solver of changes
+
+  int nupdate = 0;
+  for (n = 0; n < nfire; n++) {
+    rcount[fired[n]] += kfire[n];
+    nevents += kfire[n];
+    nupdate = dependents(fired[n],nupdate);
+  }
+
+  for (m = 0; m < nupdate; m++) {
+    uflag[ulist[m]] = 0;
+    propensity[ulist[m]] = compute_propensity(ulist[m]);
+  }
+  solve->update(nupdate,ulist,propensity);
+
+  return 1;
+}
+
+/* ----------------------------------------------------------------------
+   Poisson deviate with mean lambda
+   product of uniforms for small lambda, PTRS transformed rejection
+     of Hormann, Insurance Math Econom 12, 39 (1993) for large lambda
+------------------------------------------------------------------------- */
+
+int AppChemistry::poisson(double lambda)
+{
+  if (lambda <= 0.0) return 0;
+
+  if (lambda < 10.0) {
+    double expmean = exp(-lambda);
+    double prod = random->uniform();
+    int k = 0;
+    while (prod > expmean) {
+      prod *= random->uniform();
+      k++;
+    }
+    return k;
+  }
+
+  double slam = sqrt(lambda);
+  double loglam = log(lambda);
+  double b = 0.931 + 2.53*slam;
+  double a = -0.059 + 0.02483*b;
+  double invalpha = 1.1239 + 1.1328/(b-3.4);
+  double vr = 0.9277 - 3.6224/(b-2.0);
+  double u,v,us,k;
+
+  while (1) {
+    u = random->uniform() - 0.5;
+    v = random->uniform();
+    us = 0.5 - fabs(u);
+    k = floor((2.0*a/us + b)*u + lambda + 0.43);
+    if (us >= 0.07 && v <= vr) return static_cast<int> (k);
+    if (k < 0.0 || (us < 0.013 && v > us)) continue;
+    if (log(v) + log(invalpha) - log(a/(us*us) + b) <=
+	-lambda + k*loglam - lgamma(k+1.0))
+      return static_cast<int> (k);
+  }
+}
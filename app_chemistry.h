@@ -20,6 +20,8 @@ AppStyle(chemistry,AppChemistry)
 #define SPK_APP_CHEMISTRY_H
 
 #include "app.h"
+#include <map>
+#include <string>
 
 namespace SPPARKS_NS {
 
@@ -37,10 +39,14 @@ class AppChemistry : public App {
 
   int nevents;                   // # of reactions performed
   int nspecies;                  // # of unique species
+  int maxspecies;                // allocated size of species arrays
   char **sname;                  // ID of each species
+  std::map<std::string,int> shash;   // species ID -> species index
 
   int nreactions;                // # of user defined reactions
+  int maxreactions;              // allocated size of reaction arrays
   char **rname;                  // ID of each reaction
+  std::map<std::string,int> rhash;   // reaction ID -> reaction index
   int *nreactant;                // nreactant[I] = # of reactants of reaction I
   int **reactants;               // reactants[I][J] = particle species of Jth
 				 //   reactant of reaction I
@@ -50,10 +56,30 @@ class AppChemistry : public App {
   double *rate;                  // rate[I] = input rate for reaction I
 
   int *pcount;               // counts for each species
-  int *ndepends;             // # of reactions that depend on each reaction
-  int **depends;             // i,j = jth reaction that depends on ith reaction
+  int *rstart,*rlist;        // reactions with species I as a reactant are
+                             //   rlist[rstart[I]] to rlist[rstart[I+1]-1]
+  int *dstart,*dlist;        // reactions that depend on reaction I are
+                             //   dlist[dstart[I]] to dlist[dstart[I+1]-1]
+  int *uflag,*ulist;         // reactions to update after a leap
+  int autospecies;           // 1 if read_reactions creates unknown species
   double *propensity;        // propensity of each reaction
 
+  int nstats;                // # of species in stats output, -1 = all
+  int *slist;                // species in stats output
+
+  int leapflag;              // 1 if tau-leaping is enabled
+  double epsilon;            // max relative change of propensities per leap
+  int ncritical;             // reactions this close to exhausting a
+                             //   reactant are only fired by SSA
+  int nssa;                  // # of SSA events left before next leap attempt
+  int *horder;               // highest order of reactions using species I,
+                             //   3 = second order with 2 of species I
+  double *mu,*sigma;         // expected change & variance of species I
+  int *critical;             // 1 if reaction I is critical in this leap
+  int *fired;                // reactions that fire in a leap
+  int *kfire;                // # of times each of them fires
+  class RandomPark *random;  // RNG for leaps
+
   double factor_zero;        // conversion factor for different reactions
   double factor_dual;
 
@@ -67,11 +93,18 @@ class AppChemistry : public App {
   void add_reaction(int, char **);
   void set_volume(int, char **);
   void set_stats(int, char **);
+  void set_leap(int, char **);
+  void read_reactions(int, char **);
 
   int find_reaction(char *);
   int find_species(char *);
+  void grow_species(int);
   void build_dependency_graph();
+  int dependents(int, int);
   double compute_propensity(int);
+  int stoichiometry(int, int *, int *);
+  int leap(double &);
+  int poisson(double);
 };
 
 }
@@ -93,10 +126,6 @@ E: Unrecognized command
 The command is assumed to be application specific, but is not
 known to SPPARKS.  Check the input script.
 
-E: No solver class defined
-
-Self-explanatory.
-
 E: Invalid volume setting
 
 Volume must be set to value > 0.
@@ -129,6 +158,16 @@ E: Unknown species in reaction command
 
 Self-explanatory.
 
+E: Cannot open reaction file %s
+
+The specified file cannot be opened.  Check that the path and name are
+correct.
+
+E: Reaction file line is too long
+
+Each line of a file read by the read_reactions command must be shorter
+than 256 characters.
+
 E: Species ID %s already exists
 
 Self-explanatory.
@@ -24,14 +24,20 @@
 #include "random_mars.h"
 #include "random_park.h"
 #include "cluster.h"
+#include "balance.h"
 #include "output.h"
 #include "timer.h"
 #include "memory.h"
 #include "error.h"
 
+#if defined(_OPENMP)
+#include "omp.h"
+#endif
+
 using namespace SPPARKS_NS;
 
 #define DELTA 32768
+#define MINACTIVE 1024
 
 enum{NOSWEEP,RANDOM,RASTER,COLOR,COLOR_STRICT};
 
@@ -61,6 +67,25 @@ AppLattice::AppLattice(SPPARKS *spk, int narg, char **arg) : App(spk,narg,arg)
   mask = NULL;
 
   allow_app_update = 0;
+  allow_balance = 0;
+  allow_active = 0;
+  allow_threads = 0;
+  allow_keep = 0;
+  setupflag = SETUP_ALL;
+  sitestamp_setup = valuestamp_setup = -1;
+
+  active_user = 1;
+  activeflag = 0;
+  isetcurrent = 0;
+  siteset = NULL;
+  windowflag = 0;
+  windowsite = NULL;
+
+  balance = NULL;
+  nextbalance = 0.0;
+  rebalanceflag = 0;
+  activity = NULL;
+  sitepropensity = NULL;
 
   temperature = 0.0;
 
@@ -68,6 +93,7 @@ AppLattice::AppLattice(SPPARKS *spk, int narg, char **arg) : App(spk,narg,arg)
   i2site = NULL;
 
   comm = NULL;
+  profile = NULL;
   sweep = NULL;
 
   nlocal = nghost = nmax = 0;
@@ -101,8 +127,13 @@ AppLattice::~AppLattice()
   memory->destroy(siteseeds);
   memory->destroy(sitelist);
   memory->destroy(mask);
+  memory->destroy(siteset);
+  memory->destroy(windowsite);
 
   delete comm;
+  delete balance;
+  memory->destroy(activity);
+  memory->destroy(sitepropensity);
 
   memory->destroy(owner);
   memory->destroy(index);
@@ -115,11 +146,51 @@ AppLattice::~AppLattice()
 
 void AppLattice::input(char *command, int narg, char **arg)
 {
-  if (strcmp(command,"sector") == 0) set_sector(narg,arg);
-  else if (strcmp(command,"sweep") == 0) set_sweep(narg,arg);
-  else if (strcmp(command,"temperature") == 0) set_temperature(narg,arg);
-  else if (strcmp(command,"app_update_only") == 0) set_app_update_only(narg,arg);
-  else input_app(command,narg,arg);
+  // a temperature change only requires rates to be recomputed
+  // apps with allow_keep set setupflag for their own commands
+
+  if (strcmp(command,"sector") == 0) {
+    set_sector(narg,arg);
+    setupflag = SETUP_ALL;
+  } else if (strcmp(command,"active") == 0) {
+    set_active(narg,arg);
+    setupflag = SETUP_ALL;
+  } else if (strcmp(command,"sweep") == 0) {
+    set_sweep(narg,arg);
+    setupflag = SETUP_ALL;
+  } else if (strcmp(command,"temperature") == 0) {
+    set_temperature(narg,arg);
+    setupflag = MAX(setupflag,SETUP_RATES);
+  } else if (strcmp(command,"app_update_only") == 0) {
+    set_app_update_only(narg,arg);
+    setupflag = SETUP_ALL;
+  } else input_app(command,narg,arg);
+}
+
+/* ----------------------------------------------------------------------
+   add per-site propensity to arrays extracted by App
+   sets may be sectors or hold only active sites, in their own order,
+     so scatter each set into a buffer in owned site order
+   sites in no set, i.e. inactive sites, have zero propensity
+------------------------------------------------------------------------- */
+
+void *AppLattice::extract_array(char *name, int *dtype, int *n, int *ncol)
+{
+  if (strcmp(name,"propensity") == 0) {
+    if (solve == NULL || set == NULL) return NULL;
+    memory->destroy(sitepropensity);
+    memory->create(sitepropensity,nlocal,"app:sitepropensity");
+    for (int i = 0; i < nlocal; i++) sitepropensity[i] = 0.0;
+    for (int iset = 0; iset < nset; iset++)
+      for (int m = 0; m < set[iset].nlocal; m++)
+        sitepropensity[set[iset].site2i[m]] = set[iset].propensity[m];
+    *dtype = DOUBLE;
+    *n = nlocal;
+    *ncol = 1;
+    return (void *) sitepropensity;
+  }
+
+  return App::extract_array(name,dtype,n,ncol);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -196,69 +267,17 @@ void AppLattice::init()
   if (nsector > 1 && ncolors > 1) bothflag = 1;
   else bothflag = 0;
 
-  // create sets based on sectors and coloring
-  // set are either all sectors or all colors or both
-  // for both, first sets are entire sections, remaining are colors in sectors
-  // if new nset is same as old nset, pass each set's solver to create_set,
-  //   so it can reuse solver and its RNG,
-  //   so consecutive runs are identical to one continuous run
+  // KMC solvers span only active sites if app supports it
+  // sets are compacted to active sites in setup()
 
-  int nsetold = nset;
-  Solve **sold = new Solve*[nsetold];
+  if (solve && allow_active && active_user) activeflag = 1;
+  else activeflag = 0;
 
-  for (int i = 0; i < nset; i++) sold[i] = free_set(i);
-  delete [] set;
+  // create sets and mask for current sectoring and coloring
+  // unless sets from previous run are kept
 
-  if (nsector == 1 && ncolors == 1) {
-    nset = 1;
-    set = new Set[nset];
-    if (nset == nsetold) create_set(0,0,0,sold[0]);
-    else create_set(0,0,0,NULL);
-  } else if (nsector > 1 && ncolors == 1) {
-    nset = nsector;
-    set = new Set[nset];
-    for (int i = 0; i < nset; i++) {
-      if (nset == nsetold) create_set(i,i+1,0,sold[i]);
-      else create_set(i,i+1,0,NULL);
-    }
-  } else if (ncolors > 1 && nsector == 1) {
-    nset = ncolors;
-    set = new Set[nset];
-    for (int i = 0; i < nset; i++) {
-      if (nset == nsetold) create_set(i,0,i+1,sold[i]);
-      else create_set(i,0,i+1,NULL);
-    }
-  } else if (bothflag) {
-    nset = nsector + ncolors*nsector;
-    set = new Set[nset];
-    int m = 0;
-    for (int i = 0; i < nsector; i++) {
-      if (nset == nsetold) create_set(m,i+1,0,sold[m]);
-      else create_set(m,i+1,0,NULL);
-      m++;
-    }
-    for (int i = 0; i < nsector; i++) 
-      for (int j = 0; j < ncolors; j++) {
-	if (nset == nsetold) create_set(m,i+1,j+1,sold[m]);
-        else create_set(m,i+1,j+1,NULL);
-	m++;
-      }
-  }
-
-  if (nset != nsetold)
-    for (int i = 0; i < nsetold; i++) delete sold[i];
-  delete [] sold;
-
-  // initialize mask array
-
-  if (!Lmask && mask) {
-    memory->destroy(mask);
-    mask = NULL;
-  }
-  if (Lmask && mask == NULL) {
-    memory->create(mask,nlocal+nghost,"app:mask");
-    for (int i = 0; i < nlocal+nghost; i++) mask[i] = 0;
-  }
+  check_setup();
+  if (setupflag == SETUP_ALL) create_sets();
 
   // setup RN generators, only on first init
   // ranapp is used for all options except sweep color/strict
@@ -327,19 +346,23 @@ void AppLattice::setup()
 {
   // app-specific setup, before propensities are computed
 
+  check_setup();
+  int keptsets = (setupflag != SETUP_ALL);
   setup_app();
 
+  // setup_app() may escalate to SETUP_ALL after init() kept the sets,
+  //   which can be compacted to active sites, so recreate them
+
+  if (keptsets && setupflag == SETUP_ALL) create_sets();
+
   // initialize propensities for KMC solver within each set
   // comm insures ghost sites are up to date
+  // kept sets need only new rates or nothing at all
 
-  if (solve) {
+  if (solve && setupflag == SETUP_ALL) {
     comm->all();
-    for (int i = 0; i < nset; i++) {
-      for (int m = 0; m < set[i].nlocal; m++)
-	set[i].propensity[m] = site_propensity(set[i].site2i[m]);
-      set[i].solve->init(set[i].nlocal,set[i].propensity);
-    }
-  }
+    setup_sets();
+  } else if (solve && setupflag == SETUP_RATES) setup_rates();
 
   // convert per-sector time increment info to KMC params
 
@@ -428,6 +451,12 @@ void AppLattice::setup()
 
   setup_end_app();
 
+  // state is now current, next run can keep it if nothing changes
+
+  setupflag = SETUP_NONE;
+  sitestamp_setup = sitestamp;
+  valuestamp_setup = valuestamp;
+
   // setup future output
 
   nextoutput = output->setup(time,first_run);
@@ -463,7 +492,7 @@ void AppLattice::iterate()
 
 void AppLattice::iterate_kmc_global(double stoptime)
 {
-  int isite;
+  int i,isite;
   
   // global KMC runs with one set
   // save ptr to system solver
@@ -472,19 +501,30 @@ void AppLattice::iterate_kmc_global(double stoptime)
   solve = set[0].solve;
   propensity = set[0].propensity;
   i2site = set[0].i2site;
+  isetcurrent = 0;
 
   int done = 0;
   while (!done) {
-    timer->stamp();
+
+    // drop inactive sites once set size doubled since last compaction
+
+    if (activeflag && set[0].nlocal >= 2*MAX(set[0].nbase,MINACTIVE)) {
+      compact_set(0);
+      propensity = set[0].propensity;
+    }
+
+    timer->event_start();
     isite = solve->event(&dt_step);
-    timer->stamp(TIME_SOLVE);
+    timer->event_stamp(TIME_SOLVE);
 
     if (isite >= 0) {
       time += dt_step;
       if (time <= stoptime) {
-	site_event(isite,ranapp);
+	i = set[0].site2i[isite];
+	if (activity) activity[i] += 1.0;
+	site_event(i,ranapp);
 	naccept++;
-	timer->stamp(TIME_APP);
+	timer->event_stamp(TIME_APP);
       } else {
 	done = 1;
 	time = stoptime;
@@ -494,8 +534,11 @@ void AppLattice::iterate_kmc_global(double stoptime)
       time = stoptime;
     }
 
-    if (done || time >= nextoutput) nextoutput = output->compute(time,done);
-    timer->stamp(TIME_OUTPUT);
+    if (done || time >= nextoutput) {
+      timer->event_finish();
+      nextoutput = output->compute(time,done);
+      timer->stamp(TIME_OUTPUT);
+    }
   }
 
   // restore system solver
@@ -512,7 +555,14 @@ void AppLattice::iterate_kmc_sector(double stoptime)
 {
   int i,isite,done;
   double dt,timesector;
-  double pmax,pmaxall;
+  double pmax,pmaxsend,pmaxall;
+
+  // pmax reduction of one pass is waited on at end of the next pass
+
+  int pending = 0;
+#if defined(MPI_VERSION) && MPI_VERSION >= 3
+  MPI_Request request;
+#endif
 
   // save ptr to system solver
 
@@ -525,19 +575,32 @@ void AppLattice::iterate_kmc_sector(double stoptime)
     for (int iset = 0; iset < nset; iset++) {
       timer->stamp();
 
+      // acquire ghosts for this sector, then post receives for
+      //   reverse comm of this sector and ghosts of next sector,
+      //   so neighbor procs can send them as soon as they are ready
+
       if (nprocs > 1) {
 	comm->sector(iset);
+	comm->reverse_sector_post(iset);
+	if (iset < nset-1) comm->sector_post(iset+1);
 	timer->stamp(TIME_COMM);
       }
 
+      // drop inactive sites once set size doubled since last compaction
+
+      if (activeflag && 
+          set[iset].nlocal >= 2*MAX(set[iset].nbase,MINACTIVE))
+        compact_set(iset);
+
       solve = set[iset].solve;
       
       propensity = set[iset].propensity;
       i2site = set[iset].i2site;
-      int *site2i = set[iset].site2i;
+      isetcurrent = iset;
 
       // update propensities for sites which neighbor a site outside sector
       // necessary since outside sites may have changed
+      // inactive border sites join the set if their propensity is now non-zero
       // attribute this chunk of time to comm, b/c due to decomposition
 
       int *bsites = set[iset].bsites;
@@ -548,8 +611,13 @@ void AppLattice::iterate_kmc_sector(double stoptime)
       for (int m = 0; m < nborder; m++) {
 	i = border[m];
 	isite = i2site[i];
+	if (isite < 0) {
+	  double p = site_propensity(i);
+	  if (p == 0.0) continue;
+	  isite = activate(i);
+	  propensity[isite] = p;
+	} else propensity[isite] = site_propensity(i);
 	bsites[nsites++] = isite;
-	propensity[isite] = site_propensity(i);
       }
       
       solve->update(nsites,bsites,propensity);
@@ -571,21 +639,24 @@ void AppLattice::iterate_kmc_sector(double stoptime)
       done = 0;
       timesector = 0.0;
       while (!done) {
-	timer->stamp();
+	timer->event_start();
 	isite = solve->event(&dt);
-	timer->stamp(TIME_SOLVE);
+	timer->event_stamp(TIME_SOLVE);
 	
 	if (isite < 0) done = 1;
 	else {
 	  timesector += dt;
 	  if (timesector >= dt_kmc) done = 1;
 	  else {
-	    site_event(site2i[isite],ranapp);
+	    i = set[iset].site2i[isite];
+	    if (activity) activity[i] += 1.0;
+	    site_event(i,ranapp);
 	    naccept++;
 	  }
-	  timer->stamp(TIME_APP);
+	  timer->event_stamp(TIME_APP);
 	}
       }
+      timer->event_finish();
       
       if (nprocs > 1) {
 	comm->reverse_sector(iset);
@@ -604,13 +675,42 @@ void AppLattice::iterate_kmc_sector(double stoptime)
       nextoutput = output->compute(time,alldone);
     timer->stamp(TIME_OUTPUT);
 
+    // repartition sites across procs if requested by balance command
+    // attribute to comm, b/c due to decomposition
+
+    if (balance && !alldone && time >= nextbalance) {
+      rebalance();
+      timer->stamp(TIME_COMM);
+    }
+
     // recompute dt_kmc if adaptive, based on pmax across all sectors
+    // after first pass, reduction of pmax is non-blocking and used
+    //   one pass later, so procs do not wait on each other here
+    // first pass reduces pmax right away, since dt_kmc from setup()
+    //   can be far too large once fast events appear
+    // dt_kmc is still identical on all procs, as sectoring requires
 
     if (Ladapt) {
-      MPI_Allreduce(&pmax,&pmaxall,1,MPI_DOUBLE,MPI_MAX,world);
+      if (pending) {
+#if defined(MPI_VERSION) && MPI_VERSION >= 3
+	MPI_Wait(&request,MPI_STATUS_IGNORE);
+#endif
+	pending = 0;
+      } else MPI_Allreduce(&pmax,&pmaxall,1,MPI_DOUBLE,MPI_MAX,world);
+
       if (pmaxall > 0.0) dt_kmc = nstop/pmaxall;
       else dt_kmc = stoptime-time;
       dt_kmc = MIN(dt_kmc,stoptime-time);
+
+      if (!alldone) {
+	pmaxsend = pmax;
+#if defined(MPI_VERSION) && MPI_VERSION >= 3
+	MPI_Iallreduce(&pmaxsend,&pmaxall,1,MPI_DOUBLE,MPI_MAX,world,&request);
+#else
+	MPI_Allreduce(&pmaxsend,&pmaxall,1,MPI_DOUBLE,MPI_MAX,world);
+#endif
+	pending = 1;
+      }
     }
   }
 
@@ -619,13 +719,40 @@ void AppLattice::iterate_kmc_sector(double stoptime)
   solve = hold_solve;
 }
 
+/* ----------------------------------------------------------------------
+   rebalance sites across procs during a KMC run with sectors
+   if sites moved, redo the parts of init() and setup() that depend on
+     which sites a proc owns, without resetting the output schedule
+ ------------------------------------------------------------------------- */
+
+void AppLattice::rebalance()
+{
+  nextbalance = time + balance->every;
+  if (balance->rebalance(0) == 0) return;
+
+  create_sets();
+  comm->init(nsector,delpropensity,delevent,NULL);
+  init_app();
+  output->rebalance();
+
+  // app must keep event counts accumulated so far in this run
+
+  setupflag = SETUP_ALL;
+  rebalanceflag = 1;
+  setup_app();
+  comm->all();
+  setup_sets();
+  setup_end_app();
+  rebalanceflag = 0;
+}
+
 /* ----------------------------------------------------------------------
    rejection KMC solver
  ------------------------------------------------------------------------- */
 
 void AppLattice::iterate_rejection(double stoptime)
 {
-  int i,icolor,nselect,nrange,jset;
+  int i,n,icolor,nselect,nrange,jset;
   int *site2i;
 
   // set loop is over:
@@ -653,21 +780,44 @@ void AppLattice::iterate_rejection(double stoptime)
       // sectors but no colors (could also be no sectors)
       // random selection of sites in iset
 
+      // with a sweep window, only the fraction of selections that would
+      //   land on window sites is made, rounded stochastically,
+      //   selections of other sites are null events but still attempts
+
       if (sweepflag == RANDOM) {
-	site2i = set[iset].site2i;
-	nrange = set[iset].nlocal;
 	nselect = set[iset].nselect;
-	for (i = 0; i < nselect; i++) 
+	if (windowflag) {
+	  site2i = set[iset].window;
+	  nrange = set[iset].nwindow;
+	  n = 0;
+	  if (nrange) {
+	    double fselect = (double) nselect * nrange / set[iset].nlocal;
+	    n = static_cast<int> (fselect);
+	    if (ranapp->uniform() < fselect-n) n++;
+	  }
+	} else {
+	  site2i = set[iset].site2i;
+	  nrange = set[iset].nlocal;
+	  n = nselect;
+	}
+	for (i = 0; i < n; i++) 
 	  sitelist[i] = site2i[ranapp->irandom(nrange) - 1];
-	(this->*sweep)(nselect,sitelist);
+	(this->*sweep)(n,sitelist);
 	nattempt += nselect;
 
       // sectors but no colors, or colors but no sectors
-      // ordered sweep over all sites in iset
+      // ordered sweep over all sites in iset, or its window sites
 
       } else if (bothflag == 0) {
+	if (windowflag) {
+	  n = set[iset].nwindow;
+	  site2i = set[iset].window;
+	} else {
+	  n = set[iset].nlocal;
+	  site2i = set[iset].site2i;
+	}
 	for (i = 0; i < set[iset].nloop; i++)
-	  (this->*sweep)(set[iset].nlocal,set[iset].site2i);
+	  (this->*sweep)(n,site2i);
 	nattempt += set[iset].nselect;
 
       // sectors and colors
@@ -678,8 +828,15 @@ void AppLattice::iterate_rejection(double stoptime)
       } else {
 	for (icolor = 0; icolor < ncolors; icolor++) {
 	  jset = nsector + iset*ncolors + icolor;
+	  if (windowflag) {
+	    n = set[jset].nwindow;
+	    site2i = set[jset].window;
+	  } else {
+	    n = set[jset].nlocal;
+	    site2i = set[jset].site2i;
+	  }
 	  for (i = 0; i < set[jset].nloop; i++)
-	    (this->*sweep)(set[jset].nlocal,set[jset].site2i);
+	    (this->*sweep)(n,site2i);
 	  nattempt += set[jset].nselect;
 	}
       }
@@ -703,6 +860,53 @@ void AppLattice::iterate_rejection(double stoptime)
   }
 }
 
+/* ----------------------------------------------------------------------
+   restrict rKMC sweeps to n owned sites in list, called by app
+   sites outside the window must have no events until it is rebuilt,
+     so that skipping them leaves the rKMC time increment unchanged
+   each set's window keeps the order of its sites
+   app may rebuild the window as often as every app_update()
+------------------------------------------------------------------------- */
+
+void AppLattice::build_window(int n, int *list)
+{
+  if (windowsite == NULL) 
+    memory->create(windowsite,nlocal,"app:windowsite");
+  for (int i = 0; i < nlocal; i++) windowsite[i] = 0;
+  for (int m = 0; m < n; m++) windowsite[list[m]] = 1;
+
+  for (int iset = 0; iset < nset; iset++) {
+    int *site2i = set[iset].site2i;
+    int nwindow = 0;
+    for (int m = 0; m < set[iset].nlocal; m++)
+      if (windowsite[site2i[m]]) nwindow++;
+    memory->destroy(set[iset].window);
+    memory->create(set[iset].window,nwindow,"app:window");
+    set[iset].nwindow = 0;
+    for (int m = 0; m < set[iset].nlocal; m++)
+      if (windowsite[site2i[m]]) 
+	set[iset].window[set[iset].nwindow++] = site2i[m];
+  }
+
+  windowflag = 1;
+}
+
+/* ----------------------------------------------------------------------
+   let rKMC sweeps visit all sites of each set again
+------------------------------------------------------------------------- */
+
+void AppLattice::clear_window()
+{
+  for (int iset = 0; iset < nset; iset++) {
+    memory->destroy(set[iset].window);
+    set[iset].window = NULL;
+    set[iset].nwindow = 0;
+  }
+  memory->destroy(windowsite);
+  windowsite = NULL;
+  windowflag = 0;
+}
+
 /* ----------------------------------------------------------------------
    iterate the app_update routine only
    app is responsible for doing communciation in app_update()
@@ -814,6 +1018,19 @@ void AppLattice::set_sector(int narg, char **arg)
 
 /* ---------------------------------------------------------------------- */
 
+void AppLattice::set_active(int narg, char **arg)
+{
+  if (narg != 1) error->all(FLERR,"Illegal active command");
+  if (strcmp(arg[0],"yes") == 0) active_user = 1;
+  else if (strcmp(arg[0],"no") == 0) active_user = 0;
+  else error->all(FLERR,"Illegal active command");
+
+  if (active_user && !allow_active)
+    error->all(FLERR,"App does not permit active yes");
+}
+
+/* ---------------------------------------------------------------------- */
+
 void AppLattice::set_sweep(int narg, char **arg)
 {
   if (narg < 1) error->all(FLERR,"Illegal sweep command");
@@ -892,6 +1109,93 @@ void AppLattice::stats_header(char *strtmp)
   sprintf(strtmp,"%10s %10s %10s %10s","Time","Naccept","Nreject","Nsweeps");
 }
 
+/* ----------------------------------------------------------------------
+   create sets based on sectors and coloring, initialize mask array
+   called by init() and after sites are rebalanced during a run
+ ------------------------------------------------------------------------- */
+
+void AppLattice::create_sets()
+{
+  // create sets based on sectors and coloring
+  // set are either all sectors or all colors or both
+  // for both, first sets are entire sections, remaining are colors in sectors
+  // if new nset is same as old nset, pass each set's solver to create_set,
+  //   so it can reuse solver and its RNG,
+  //   so consecutive runs are identical to one continuous run
+
+  int nsetold = nset;
+  Solve **sold = new Solve*[nsetold];
+
+  for (int i = 0; i < nset; i++) sold[i] = free_set(i);
+  delete [] set;
+
+  if (nsector == 1 && ncolors == 1) {
+    nset = 1;
+    set = new Set[nset];
+    if (nset == nsetold) create_set(0,0,0,sold[0]);
+    else create_set(0,0,0,NULL);
+  } else if (nsector > 1 && ncolors == 1) {
+    nset = nsector;
+    set = new Set[nset];
+    for (int i = 0; i < nset; i++) {
+      if (nset == nsetold) create_set(i,i+1,0,sold[i]);
+      else create_set(i,i+1,0,NULL);
+    }
+  } else if (ncolors > 1 && nsector == 1) {
+    nset = ncolors;
+    set = new Set[nset];
+    for (int i = 0; i < nset; i++) {
+      if (nset == nsetold) create_set(i,0,i+1,sold[i]);
+      else create_set(i,0,i+1,NULL);
+    }
+  } else if (bothflag) {
+    nset = nsector + ncolors*nsector;
+    set = new Set[nset];
+    int m = 0;
+    for (int i = 0; i < nsector; i++) {
+      if (nset == nsetold) create_set(m,i+1,0,sold[m]);
+      else create_set(m,i+1,0,NULL);
+      m++;
+    }
+    for (int i = 0; i < nsector; i++) 
+      for (int j = 0; j < ncolors; j++) {
+	if (nset == nsetold) create_set(m,i+1,j+1,sold[m]);
+        else create_set(m,i+1,j+1,NULL);
+	m++;
+      }
+  }
+
+  if (nset != nsetold)
+    for (int i = 0; i < nsetold; i++) delete sold[i];
+  delete [] sold;
+
+  // set index of each owned site, used to add inactive sites back to a set
+  // KMC sets are disjoint, so each site belongs to exactly one
+
+  memory->destroy(siteset);
+  if (activeflag) {
+    memory->create(siteset,nlocal,"app:siteset");
+    for (int i = 0; i < nset; i++)
+      for (int m = 0; m < set[i].nlocal; m++)
+	siteset[set[i].site2i[m]] = i;
+  }
+
+  // sweep window refers to old sets, app must rebuild it
+
+  clear_window();
+
+  // initialize mask array
+
+  if (!Lmask && mask) {
+    memory->destroy(mask);
+    mask = NULL;
+  }
+  if (Lmask && mask == NULL) {
+    memory->create(mask,nlocal+nghost,"app:mask");
+    for (int i = 0; i < nlocal+nghost; i++) mask[i] = 0;
+  }
+}
+
 /* ----------------------------------------------------------------------
    create a subset of owned sites
    insure all ptrs in Set data struct are allocated or NULL
@@ -943,6 +1247,10 @@ void AppLattice::create_set(int iset, int isector, int icolor, Solve *oldsolve)
   }
 
   set[iset].nlocal = n;
+  set[iset].maxsite = n;
+  set[iset].nbase = n;
+  set[iset].nwindow = 0;
+  set[iset].window = NULL;
 
   // setup site2i for sites in set
 
@@ -1031,9 +1339,135 @@ Solve *AppLattice::free_set(int iset)
   memory->destroy(set[iset].propensity);
   memory->destroy(set[iset].site2i);
   memory->destroy(set[iset].i2site);
+  memory->destroy(set[iset].window);
   return set[iset].solve;
 }
 
+/* ----------------------------------------------------------------------
+   compute propensities of all sites in each set and initialize its solver
+   if activeflag, then remove sites with zero propensity from each set
+------------------------------------------------------------------------- */
+
+void AppLattice::setup_sets()
+{
+  for (int i = 0; i < nset; i++) {
+    isetcurrent = i;
+    setup_propensity(set[i].nlocal,set[i].site2i,set[i].propensity);
+    if (activeflag) compact_set(i);
+    else set[i].solve->init(set[i].nlocal,set[i].propensity);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   recompute propensities of kept sets after rate constants changed
+------------------------------------------------------------------------- */
+
+void AppLattice::setup_rates()
+{
+  for (int i = 0; i < nset; i++) {
+    isetcurrent = i;
+    for (int m = 0; m < set[i].nlocal; m++)
+      set[i].propensity[m] = site_propensity_rates(set[i].site2i[m]);
+    if (activeflag) compact_set(i);
+    else set[i].solve->init(set[i].nlocal,set[i].propensity);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   require a full setup unless app allows state to be kept
+     and no command has added sites or set site values since last setup
+------------------------------------------------------------------------- */
+
+void AppLattice::check_setup()
+{
+  if (!allow_keep || sitestamp != sitestamp_setup ||
+      valuestamp != valuestamp_setup) setupflag = SETUP_ALL;
+}
+
+/* ----------------------------------------------------------------------
+   compute initial propensity of N sites in list
+   with OpenMP, apps that allow it compute them in threads,
+     each thread takes a contiguous chunk of the list
+------------------------------------------------------------------------- */
+
+void AppLattice::setup_propensity(int n, int *list, double *propensity)
+{
+#if defined(_OPENMP)
+  int nthreads = omp_get_max_threads();
+  if (allow_threads && nthreads > 1 && n >= nthreads) {
+    setup_threads(nthreads);
+#pragma omp parallel for schedule(static)
+    for (int m = 0; m < n; m++)
+      propensity[m] = site_propensity_thread(list[m],omp_get_thread_num());
+    merge_threads(n,list);
+    return;
+  }
+#endif
+
+  for (int m = 0; m < n; m++) propensity[m] = site_propensity(list[m]);
+}
+
+/* ----------------------------------------------------------------------
+   remove sites with zero propensity from set iset and re-init its solver
+   removed sites keep i2site = -1 until activate() adds them back
+   set arrays keep 2x room for growth, capped by # of owned sites
+------------------------------------------------------------------------- */
+
+void AppLattice::compact_set(int iset)
+{
+  Set *s = &set[iset];
+  int *site2i = s->site2i;
+  int *i2site = s->i2site;
+  double *propensity = s->propensity;
+
+  int n = 0;
+  for (int m = 0; m < s->nlocal; m++) {
+    if (propensity[m] > 0.0) {
+      site2i[n] = site2i[m];
+      propensity[n] = propensity[m];
+      i2site[site2i[n]] = n;
+      n++;
+    } else i2site[site2i[m]] = -1;
+  }
+
+  s->nlocal = s->nbase = n;
+  int nmaxsite = MIN(MAX(2*n,MINACTIVE),nlocal);
+  if (nmaxsite != s->maxsite) {
+    s->maxsite = nmaxsite;
+    memory->grow(s->site2i,s->maxsite,"app:site2i");
+    memory->grow(s->propensity,s->maxsite,"app:propensity");
+  }
+  for (int m = n; m < s->maxsite; m++) s->propensity[m] = 0.0;
+
+  s->solve->init(s->maxsite,s->propensity);
+}
+
+/* ----------------------------------------------------------------------
+   add inactive owned site i to the current set and return its set index
+   caller must assign its propensity and pass it to the solver
+   grow set arrays and solver if needed, which resets propensity ptr
+------------------------------------------------------------------------- */
+
+int AppLattice::activate(int i)
+{
+  Set *s = &set[isetcurrent];
+
+  if (s->nlocal == s->maxsite) {
+    int oldmax = s->maxsite;
+    s->maxsite = MIN(2*s->maxsite+1,nlocal);
+    memory->grow(s->site2i,s->maxsite,"app:site2i");
+    memory->grow(s->propensity,s->maxsite,"app:propensity");
+    for (int m = oldmax; m < s->maxsite; m++) s->propensity[m] = 0.0;
+    propensity = s->propensity;
+    s->solve->resize(s->maxsite,s->propensity);
+  }
+
+  int isite = s->nlocal++;
+  s->site2i[isite] = i;
+  s->i2site[i] = isite;
+  return isite;
+}
+
 /* ----------------------------------------------------------------------
    create list of border sites for a set
    border site = site in set with a 1 to Nlayer neighbor outside the set
@@ -1205,6 +1639,7 @@ void AppLattice::grow(int n)
     memory->grow(iarray[i],nmax,"app:iarray");
   for (int i = 0; i < ndouble; i++)
     memory->grow(darray[i],nmax,"app:darray");
+  if (activity) memory->grow(activity,nmax,"app:activity");
 
   grow_app();
 }
@@ -1229,8 +1664,10 @@ void AppLattice::add_site(tagint n, double x, double y, double z)
 
   for (int i = 0; i < ninteger; i++) iarray[i][nlocal] = 0;
   for (int i = 0; i < ndouble; i++) darray[i][nlocal] = 0.0;
+  if (activity) activity[nlocal] = 0.0;
 
   nlocal++;
+  sitestamp++;
 }
 
 /* ----------------------------------------------------------------------
@@ -1371,21 +1808,68 @@ void AppLattice::print_connectivity()
 }
 
 /* ----------------------------------------------------------------------
-   sum and print memory usage
-   result is only memory on proc 0, not averaged across procs
+   sum memory usage of per-site arrays, sets, and child app storage
+   solver and comm memory are tallied separately
+   result is only memory on this proc
 ------------------------------------------------------------------------- */
 
 bigint AppLattice::memory_usage()
 {
   bigint bytes = 0;
 
-  bytes += nmax * sizeof(tagint);           // id
-  bytes += nmax*3 * sizeof(double);         // xyz
-  bytes += ninteger*nmax * sizeof(int);     // iarray
-  bytes += ndouble*nmax * sizeof(double);   // darray
+  bytes += (bigint) nmax * sizeof(tagint);           // id
+  bytes += (bigint) nmax*3 * sizeof(double);         // xyz
+  bytes += (bigint) ninteger*nmax * sizeof(int);     // iarray
+  bytes += (bigint) ndouble*nmax * sizeof(double);   // darray
+  bytes += (bigint) 2*nmax * sizeof(int);            // owner,index
   
-  bytes += nmax * sizeof(int);              // numneigh
-  bytes += nmax*maxneigh * sizeof(int);     // neighbor
+  bytes += (bigint) nmax * sizeof(int);              // numneigh
+  bytes += (bigint) nmax*maxneigh * sizeof(int);     // neighbor
+
+  if (mask) bytes += (nlocal+nghost) * sizeof(char);         // mask
+  if (activity) bytes += (bigint) nmax * sizeof(double);     // activity
+  if (siteseeds) bytes += nlocal * sizeof(int);              // siteseeds
+  if (siteset) bytes += nlocal * sizeof(int);                // siteset
+  if (windowsite) bytes += nlocal * sizeof(char);            // windowsite
+  if (sitelist) {
+    int n = 0;
+    for (int i = 0; i < nset; i++) n = MAX(n,set[i].nselect);
+    bytes += n * sizeof(int);                                // sitelist
+  }
+
+  for (int i = 0; i < nset; i++) {
+    bytes += (bigint) set[i].maxsite * sizeof(int);          // site2i
+    bytes += (bigint) set[i].maxsite * sizeof(double);       // propensity
+    if (set[i].i2site)
+      bytes += (bigint) (nlocal+nghost) * sizeof(int);       // i2site
+    if (set[i].border) bytes += set[i].nborder * sizeof(int);
+    if (set[i].bsites) bytes += set[i].nborder * sizeof(int);
+    if (set[i].window) bytes += set[i].nwindow * sizeof(int);
+  }
+
+  bytes += memory_usage_app();
 
   return bytes;
 }
+
+/* ----------------------------------------------------------------------
+   sum memory usage of KMC solvers, one per set
+------------------------------------------------------------------------- */
+
+bigint AppLattice::memory_usage_solve()
+{
+  bigint bytes = 0;
+  for (int i = 0; i < nset; i++)
+    if (set[i].solve) bytes += set[i].solve->memory_usage();
+  return bytes;
+}
+
+/* ----------------------------------------------------------------------
+   memory usage of ghost comm buffers and swap patterns
+------------------------------------------------------------------------- */
+
+bigint AppLattice::memory_usage_comm()
+{
+  if (comm) return comm->memory_usage();
+  return 0;
+}
@@ -23,8 +23,11 @@ namespace SPPARKS_NS {
 
 class AppLattice : public App {
   friend class CommLattice;
+  friend class Balance;
 
  public:
+  enum SETUP_LEVELS{SETUP_NONE,SETUP_RATES,SETUP_ALL};
+
   int delpropensity;           // # of sites away needed to compute propensity
   int delevent;                // # of sites away affected by an event
 
@@ -34,6 +37,7 @@ class AppLattice : public App {
   int **neighbor;              // local indices of neighbors of each site
 
   class CommLattice *comm;
+  class DiagKMCProfile *profile;  // set if diag_style kmc_profile is defined
 
   AppLattice(class SPPARKS *, int, char **);
   virtual ~AppLattice();
@@ -42,6 +46,9 @@ class AppLattice : public App {
   void setup();
   void iterate();
   virtual bigint memory_usage();
+  virtual bigint memory_usage_solve();
+  virtual bigint memory_usage_comm();
+  void *extract_array(char *, int *, int *, int *);
 
   void grow(int);
   void add_site(tagint, double, double, double);
@@ -65,6 +72,7 @@ class AppLattice : public App {
   virtual void init_app() {}
   virtual void setup_app() {}
   virtual void setup_end_app() {}
+  virtual bigint memory_usage_app() {return 0;}
   virtual void *extract_app(char *) {return NULL;}
 
   virtual void push_new_site(int, int *, int, std::stack<int>*);
@@ -73,6 +81,27 @@ class AppLattice : public App {
 
   virtual void app_update(double) {}
 
+  // apps that report events to diag_style kmc_profile via profile->event()
+  // return their # of reactions and a label for each
+
+  virtual int profile_reactions() {return 0;}
+  virtual void profile_label(int, char *) {}
+
+  // apps with allow_threads set compute initial propensities in threads
+  // setup_threads() allocates per-thread scratch for N threads
+  // site_propensity_thread() must only write to its thread's scratch
+  // merge_threads() stores per-site results serially, in set order
+
+  virtual void setup_threads(int) {}
+  virtual double site_propensity_thread(int, int) {return 0.0;}
+  virtual void merge_threads(int, int *) {}
+
+  // apps with allow_keep set keep sets, solvers and events across runs
+  // site_propensity_rates() recomputes a site's propensity after only
+  //   rate constants changed, e.g. temperature, default is a full recompute
+
+  virtual double site_propensity_rates(int i) {return site_propensity(i);}
+
  protected:
   int me,nprocs;
 
@@ -88,6 +117,10 @@ class AppLattice : public App {
   int allow_rejection;         // 1 if app supports rejection KMC
   int allow_masking;           // 1 if app supports rKMC masking
   int allow_app_update;        // 1 if app provides app_update()
+  int allow_balance;           // 1 if app can be rebalanced after init_app()
+  int allow_active;            // 1 if app can run KMC over active sites only
+  int allow_threads;           // 1 if app provides site_propensity_thread()
+  int allow_keep;              // 1 if app state can persist between runs
   int numrandom;               // # of RN used by rejection routine
 
   int sweepflag;               // set if rejection KMC solver
@@ -97,6 +130,17 @@ class AppLattice : public App {
   int ncolors;                 // # of colors, depends on lattice
   int bothflag;                // 1 if both sectors and colors
   int app_update_only;         // 1 if skip KMC and rKMC updates
+  int active_user;             // 0 if active sites disabled by user
+  int activeflag;              // 1 if sets store only active sites
+  int isetcurrent;             // set whose events are being performed
+  int *siteset;                // set each owned site belongs to
+  int windowflag;              // 1 if rKMC sweeps only visit window sites
+  char *windowsite;            // 1 if owned site is in sweep window
+  int setupflag;               // what next setup() must redo, SETUP_NONE,
+                               //   SETUP_RATES or SETUP_ALL
+  int rebalanceflag;           // 1 while setup is redone by mid-run rebalance
+  bigint sitestamp_setup;      // app sitestamp at last setup()
+  bigint valuestamp_setup;     // app valuestamp at last setup()
 
   class RandomPark *ranapp;    // RN generator for KMC and rejection KMC
   class RandomPark *ranstrict; // RN generator for per-site strict rKMC
@@ -110,6 +154,11 @@ class AppLattice : public App {
   double tstop;                // requested time increment in sector
   double nstop;                // requested events per site in sector
 
+  class Balance *balance;      // settings for rebalancing during runs
+  double nextbalance;          // time of next rebalance
+  double *activity;            // # of events on each site since last balance
+  double *sitepropensity;      // per-site propensity gathered for extract
+
 
                                // arrays for owned + ghost sites
   int *owner;                  // proc who owns the site
@@ -119,7 +168,10 @@ class AppLattice : public App {
   int *i2site;                 // mapping of owned lattice to site index
 
   struct Set {                 // subset of lattice sites I own
-    int nlocal;                // # of owned sites in set
+    int nlocal;                // # of owned sites in set, only active ones
+                               //   if activeflag is set
+    int maxsite;               // allocated length of site2i and propensity
+    int nbase;                 // # of sites in set after last compaction
     int nselect;               // # of selections from set for rKMC
     int nloop;                 // # of loops over set for rKMC
     int nborder;               // # of sites with non-set site as neighbor
@@ -129,6 +181,8 @@ class AppLattice : public App {
     double *propensity;        // propensities for set sites
     int *site2i;               // map from set sites to lattice index
     int *i2site;               // map from lattice index to set sites
+    int nwindow;               // # of set sites in sweep window
+    int *window;               // lattice index for each window site
   };
   Set *set;                    // list of subsets
   int nset;                    // # of subsets of lattice sites
@@ -153,16 +207,35 @@ class AppLattice : public App {
   void ghosts_from_connectivity();
   void connectivity_within_cutoff();
 
+  void create_sets();
   void create_set(int, int, int, class Solve *);
   class Solve *free_set(int);
   int id2color(int);
   int find_border_sites(int);
+  void setup_sets();
+  void setup_propensity(int, int *, double *);
+  void setup_rates();
+  void check_setup();
+  void compact_set(int);
+  int activate(int);
+  void build_window(int, int *);
+  void clear_window();
+
+  // 1 if owned site i belongs to current set but is inactive
+
+  int can_activate(int i) {
+    return activeflag && i < nlocal && i2site[i] < 0 &&
+      siteset[i] == isetcurrent;
+  }
+
   void boundary_clear_mask(int);
+  void rebalance();
 
   void stats(char *);
   void stats_header(char *);
 
   void set_sector(int, char **);
+  void set_active(int, char **);
   void set_sweep(int, char **);
   void set_temperature(int, char **);
   void set_app_update_only(int, char **);
@@ -252,6 +325,11 @@ E: App does not permit app_update_only yes
 
 This app does not have it's own update method
 
+E: App does not permit active yes
+
+This app does not update propensities of inactive sites when
+their neighborhood changes.
+
 E: Per-processor system is too big
 
 UNDOCUMENTED
@@ -29,7 +29,7 @@
 using namespace SPPARKS_NS;
 
 #define DELTA 10000
-#define MAXNEIGH 1000
+#define DELTANEIGH 1000
 #define EPSILON 1.0e-8
 
 enum{NOSWEEP,RANDOM,RASTER};
@@ -77,7 +77,20 @@ AppOffLattice::AppOffLattice(SPPARKS *spk, int narg, char **arg) :
   nstencil = 0;
   stencil = NULL;
 
-  neighs = new int[MAXNEIGH];
+  numneigh = 0;
+  neighs = NULL;
+  maxscratch = 0;
+  neighscratch = NULL;
+
+  skin = 0.0;
+  cutneigh = 0.0;
+  sortfreq = 0;
+  neighepoch = 0;
+  dmax = 0.0;
+  neighstamp = firstneigh = numneighs = NULL;
+  xhold = NULL;
+  npage = maxpage = nneighlive = 0;
+  neighpage = NULL;
 
   naccept = nattempt = 0;
   nsweeps = 0;
@@ -111,7 +124,13 @@ AppOffLattice::~AppOffLattice()
   memory->destroy(ghostproc);
   
   delete [] stencil;
-  delete [] neighs;
+  memory->destroy(neighscratch);
+
+  memory->destroy(neighstamp);
+  memory->destroy(firstneigh);
+  memory->destroy(numneighs);
+  memory->destroy(xhold);
+  memory->destroy(neighpage);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -119,6 +138,7 @@ AppOffLattice::~AppOffLattice()
 void AppOffLattice::input(char *command, int narg, char **arg)
 {
   if (strcmp(command,"sector") == 0) set_sector(narg,arg);
+  else if (strcmp(command,"neighbor") == 0) set_neighbor(narg,arg);
   else if (strcmp(command,"sweep") == 0) set_sweep(narg,arg);
   else if (strcmp(command,"temperature") == 0) set_temperature(narg,arg);
   else input_app(command,narg,arg);
@@ -240,6 +260,10 @@ void AppOffLattice::init()
     add_to_bin(i,bin[i]);
   }
 
+  // all persistent neighbor lists are stale
+
+  neighbor_reset();
+
   // initialize comm, both for this proc's full domain and sectors
   // redo on every init in case cutoff and bins changed
 
@@ -490,6 +514,15 @@ void AppOffLattice::iterate_rejection(double stoptime)
   
   int done = 0;
   while (!done) {
+
+    // periodically re-sort owned sites by bin for memory locality
+
+    if (sortfreq && nsweeps && nsweeps % sortfreq == 0) {
+      timer->stamp();
+      sort_sites();
+      timer->stamp(TIME_APP);
+    }
+
     for (int iset = 0; iset < nset; iset++) {
       activeset = iset;
 
@@ -745,6 +778,29 @@ void AppOffLattice::set_sector(int narg, char **arg)
   }
 }
 
+/* ----------------------------------------------------------------------
+   neighbor skin keyword value ...
+   skin > 0 enables persistent per-site neighbor lists
+------------------------------------------------------------------------- */
+
+void AppOffLattice::set_neighbor(int narg, char **arg)
+{
+  if (narg < 1) error->all(FLERR,"Illegal neighbor command");
+
+  skin = atof(arg[0]);
+  if (skin < 0.0) error->all(FLERR,"Illegal neighbor command");
+
+  int iarg = 1;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"sort") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal neighbor command");
+      sortfreq = atoi(arg[iarg+1]);
+      if (sortfreq < 0) error->all(FLERR,"Illegal neighbor command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal neighbor command");
+  }
+}
+
 /* ---------------------------------------------------------------------- */
 
 void AppOffLattice::set_sweep(int narg, char **arg)
@@ -860,11 +916,13 @@ void AppOffLattice::init_bins()
   int *myloc = domain->myloc;
 
   // bin size must be >= cutoff set by parameters in init_app()
+  // plus neighbor skin, so stencil covers persistent neighbor lists
   // require 2 bins within sub-domain if sectoring in a dimension
   // else require 1 bin within sub-domain
   // require an even number of bins if sectoring in a dimension
 
-  double cutoff = delpropensity + delevent;
+  cutneigh = delpropensity + delevent;
+  double cutoff = cutneigh + skin;
   nbinx = static_cast<int> (xprd/procgrid[0]/cutoff);
   nbiny = nbinz = 1;
   if (dimension >= 2) nbiny = static_cast<int> (yprd/procgrid[1]/cutoff);
@@ -1055,11 +1113,33 @@ void AppOffLattice::init_stencil()
 
 /* ----------------------------------------------------------------------
    create list of neighbors of site I within distance cutoff
+   return list in numneigh and neighs
+   if skin > 0, neighs points to I's persistent list,
+     which can include sites out to cutneigh + skin,
+     so caller must check distances itself
  ------------------------------------------------------------------------- */
 
 void AppOffLattice::neighbor(int i, double cut)
 {
-  int j;
+  if (skin == 0.0 || cut > cutneigh) {
+    numneigh = neighbor_scan(i,cut);
+    neighs = neighscratch;
+    return;
+  }
+
+  if (neighstamp[i] != neighepoch) neighbor_build(i);
+  numneigh = numneighs[i];
+  neighs = &neighpage[firstneigh[i]];
+}
+
+/* ----------------------------------------------------------------------
+   scan stencil bins of site I for neighbors within distance cutoff
+   store them in neighscratch and return their count
+ ------------------------------------------------------------------------- */
+
+int AppOffLattice::neighbor_scan(int i, double cut)
+{
+  int j,jbin;
   double delx,dely,delz,rsq;
 
   double cutsq = cut*cut;
@@ -1068,35 +1148,228 @@ void AppOffLattice::neighbor(int i, double cut)
   double ytmp = xyz[i][1];
   double ztmp = xyz[i][2];
 
-  numneigh = 0;
-
+  int n = 0;
   int ibin = bin[i];
 
   for (int k = 0; k < nstencil; k++) {
-
-    // DEBUG CHECK - can remove
-    if (ibin+stencil[k] < 0 || ibin+stencil[k] >= nbins) {
-      printf("BAD STENCIL %d %d %d\n",i,ibin,ibin+stencil[k]);
-      error->one(FLERR,"BAD STENCIL");
-    }
-
-    for (j = binhead[ibin+stencil[k]]; j >= 0; j = next[j]) {
+    jbin = ibin + stencil[k];
+    for (j = binhead[jbin]; j >= 0; j = next[j]) {
       delx = xtmp - xyz[j][0];
       dely = ytmp - xyz[j][1];
       delz = ztmp - xyz[j][2];
       rsq = delx*delx + dely*dely + delz*delz;
 
-      // SHOULD DELETE THIS TEST eventually
-      if (numneigh == MAXNEIGH) {
-	printf("NEIGH %d %d %d\n",i,ibin,numneigh);
-	error->one(FLERR,"Too many neighbors per site");
+      if (rsq <= cutsq && i != j) {
+	if (n == maxscratch) {
+	  maxscratch += DELTANEIGH;
+	  memory->grow(neighscratch,maxscratch,"app:neighscratch");
+	}
+	neighscratch[n++] = j;
       }
+    }
+  }
 
-      if (rsq <= cutsq && i != j) neighs[numneigh++] = j;
+  return n;
+}
+
+/* ----------------------------------------------------------------------
+   build persistent neighbor list of site I out to cutneigh + skin
+   append it to neighpage and save current coords of I
+   a list made stale by an image change in this epoch keeps its old coords,
+     since the displacement bound of other lists counts from them
+   if neighpage is full and mostly holds stale lists, start over,
+     which makes all other lists stale, else grow neighpage
+ ------------------------------------------------------------------------- */
+
+void AppOffLattice::neighbor_build(int i)
+{
+  int n = neighbor_scan(i,cutneigh+skin);
+  int keephold = (neighstamp[i] == -neighepoch-2);
+
+  if (npage + n > maxpage) {
+    if (npage > 2*nneighlive) {
+      neighbor_reset();
+      keephold = 0;
     }
+    while (npage + n > maxpage) maxpage += MAX(maxpage,DELTANEIGH);
+    memory->grow(neighpage,maxpage,"app:neighpage");
   }
 
-  if (numneigh > MAXNEIGH) error->one(FLERR,"Too many neighbors per site");
+  if (neighstamp[i] == neighepoch) nneighlive -= numneighs[i];
+  memcpy(&neighpage[npage],neighscratch,n*sizeof(int));
+  firstneigh[i] = npage;
+  numneighs[i] = n;
+  npage += n;
+  nneighlive += n;
+
+  neighstamp[i] = neighepoch;
+  if (keephold) return;
+  xhold[i][0] = xyz[i][0];
+  xhold[i][1] = xyz[i][1];
+  xhold[i][2] = xyz[i][2];
+}
+
+/* ----------------------------------------------------------------------
+   make all persistent neighbor lists stale
+   called when site indices are reassigned or sites moved too far
+ ------------------------------------------------------------------------- */
+
+void AppOffLattice::neighbor_reset()
+{
+  neighepoch++;
+  dmax = 0.0;
+  npage = nneighlive = 0;
+}
+
+/* ----------------------------------------------------------------------
+   make lists stale for owned sites in bin IBIN and its surrounding bins
+   called when a ghost image in IBIN is created or deleted,
+     since only those lists can include the image
+   stamp -epoch-2 marks a list made stale within the current epoch,
+     new sites have stamp -1 which never matches
+   IBIN can be a ghost bin, so clip the stencil to the bin grid
+ ------------------------------------------------------------------------- */
+
+void AppOffLattice::neighbor_stale_bin(int ibin)
+{
+  int i,m,ix,iy,iz,jx,jy,jz;
+
+  ix = ibin % nbinx;
+  iy = (ibin/nbinx) % nbiny;
+  iz = ibin / (nbinx*nbiny);
+
+  for (jz = MAX(iz-1,0); jz <= MIN(iz+1,nbinz-1); jz++)
+    for (jy = MAX(iy-1,0); jy <= MIN(iy+1,nbiny-1); jy++)
+      for (jx = MAX(ix-1,0); jx <= MIN(ix+1,nbinx-1); jx++) {
+	m = jz*nbinx*nbiny + jy*nbinx + jx;
+	for (i = binhead[m]; i >= 0; i = next[i])
+	  if (i < nlocal && neighstamp[i] == neighepoch) {
+	    neighstamp[i] = -neighepoch-2;
+	    nneighlive -= numneighs[i];
+	  }
+      }
+}
+
+/* ----------------------------------------------------------------------
+   track displacement of site I since its list was built
+   a list built at one time in the epoch stays valid at a later time
+     if both sites moved less than skin in between,
+   xhold of each site is kept for the whole epoch, even if its list is
+     rebuilt after an image change, so each site stays within dmax of it
+     and moved at most 2*dmax since any list was built,
+     so require 4*dmax < skin
+   a site moving without a list in this epoch cannot be bounded, so reset
+ ------------------------------------------------------------------------- */
+
+void AppOffLattice::neighbor_displace(int i)
+{
+  if (neighstamp[i] != neighepoch && neighstamp[i] != -neighepoch-2) {
+    neighbor_reset();
+    return;
+  }
+
+  double delx = xyz[i][0] - xhold[i][0];
+  double dely = xyz[i][1] - xhold[i][1];
+  double delz = xyz[i][2] - xhold[i][2];
+  double d = sqrt(delx*delx + dely*dely + delz*delz);
+  if (d > dmax) dmax = d;
+  if (4.0*dmax > skin) neighbor_reset();
+}
+
+/* ----------------------------------------------------------------------
+   re-sort owned sites so sites in the same bin are contiguous in memory
+   permute all per-site arrays and remap bin and image links
+   ghost sites keep their indices
+ ------------------------------------------------------------------------- */
+
+void AppOffLattice::sort_sites()
+{
+  int i,j,k,m;
+
+  // old2new = new index of each owned site, visiting bins in order
+
+  int *old2new,*new2old;
+  memory->create(old2new,nlocal,"app:old2new");
+  memory->create(new2old,nlocal,"app:new2old");
+
+  m = 0;
+  for (int ibin = 0; ibin < nbins; ibin++)
+    for (i = binhead[ibin]; i >= 0; i = next[i])
+      if (i < nlocal) {
+	old2new[i] = m;
+	new2old[m++] = i;
+      }
+  if (m != nlocal) error->one(FLERR,"Owned site is not in a bin");
+
+  // permute per-site values of owned sites via a scratch buffer
+
+  double *dbuf;
+  int *ibuf;
+  memory->create(dbuf,nlocal,"app:sortbuf");
+  memory->create(ibuf,nlocal,"app:sortbuf");
+
+  tagint *tbuf = (tagint *) 
+    memory->smalloc(nlocal*sizeof(tagint),"app:sortbuf");
+  for (i = 0; i < nlocal; i++) tbuf[i] = id[new2old[i]];
+  memcpy(id,tbuf,nlocal*sizeof(tagint));
+  memory->sfree(tbuf);
+
+  for (k = 0; k < 3; k++) {
+    for (i = 0; i < nlocal; i++) dbuf[i] = xyz[new2old[i]][k];
+    for (i = 0; i < nlocal; i++) xyz[i][k] = dbuf[i];
+  }
+  for (k = 0; k < ninteger; k++) {
+    for (i = 0; i < nlocal; i++) ibuf[i] = iarray[k][new2old[i]];
+    memcpy(iarray[k],ibuf,nlocal*sizeof(int));
+  }
+  for (k = 0; k < ndouble; k++) {
+    for (i = 0; i < nlocal; i++) dbuf[i] = darray[k][new2old[i]];
+    memcpy(darray[k],dbuf,nlocal*sizeof(double));
+  }
+
+  for (i = 0; i < nlocal; i++) ibuf[i] = bin[new2old[i]];
+  memcpy(bin,ibuf,nlocal*sizeof(int));
+  for (i = 0; i < nlocal; i++) ibuf[i] = nextimage[new2old[i]];
+  memcpy(nextimage,ibuf,nlocal*sizeof(int));
+
+  // relink every bin in its current order using new indices
+  // first record each bin's sites while old links are intact
+  // free list and image chains only hold ghost indices, so are unchanged
+
+  int *seq,*binstart;
+  memory->create(seq,nmax,"app:sortseq");
+  memory->create(binstart,nbins+1,"app:sortseq");
+
+  m = 0;
+  for (int ibin = 0; ibin < nbins; ibin++) {
+    binstart[ibin] = m;
+    for (j = binhead[ibin]; j >= 0; j = next[j])
+      seq[m++] = (j < nlocal) ? old2new[j] : j;
+  }
+  binstart[nbins] = m;
+
+  for (int ibin = 0; ibin < nbins; ibin++) {
+    if (binstart[ibin] == binstart[ibin+1]) {
+      binhead[ibin] = -1;
+      continue;
+    }
+    binhead[ibin] = seq[binstart[ibin]];
+    prev[seq[binstart[ibin]]] = -1;
+    for (m = binstart[ibin]; m < binstart[ibin+1]-1; m++) {
+      next[seq[m]] = seq[m+1];
+      prev[seq[m+1]] = seq[m];
+    }
+    next[seq[binstart[ibin+1]-1]] = -1;
+  }
+
+  memory->destroy(seq);
+  memory->destroy(binstart);
+  memory->destroy(old2new);
+  memory->destroy(new2old);
+  memory->destroy(dbuf);
+  memory->destroy(ibuf);
+
+  neighbor_reset();
 }
 
 /* ----------------------------------------------------------------------
@@ -1111,6 +1384,10 @@ void AppOffLattice::move(int i)
   int oldbin = bin[i];
   int newbin = site2bin(i);
 
+  // bound validity of persistent neighbor lists
+
+  if (skin > 0.0) neighbor_displace(i);
+
   // if sectoring (1 or more procs), then move is simple
   // if stays in same bin, done
   // else delete it from old bin, add it to new bin
@@ -1205,6 +1482,10 @@ void AppOffLattice::move(int i)
     xyz[i][2] -= pbcoffset[newbin][2]*zprd;
     newbin = site2bin(i);
     if (binflag[newbin] != EDGE) error->one(FLERR,"PBC remap of site failed");
+    if (skin > 0.0) {
+      neighbor_stale_bin(oldbin);
+      neighbor_stale_bin(newbin);
+    }
     delete_from_bin(i,oldbin);
     add_to_bin(i,newbin);
     bin[i] = newbin;
@@ -1310,6 +1591,7 @@ void AppOffLattice::delete_images(int i)
   int j = nextimage[i];
   while (j >= 0) {
     oldbin = bin[j];
+    if (skin > 0.0) neighbor_stale_bin(oldbin);
     delete_from_bin(j,oldbin);
     add_to_free(j);
     j = nextimage[j];
@@ -1327,7 +1609,7 @@ void AppOffLattice::delete_images(int i)
 
 void AppOffLattice::add_images(int i, int ibin)
 {
-  int j,jbin;
+  int j,k,jbin;
 
   nextimage[i] = -1;
   int n = nimages[ibin];
@@ -1338,10 +1620,13 @@ void AppOffLattice::add_images(int i, int ibin)
     xyz[j][1] = xyz[i][1] + pbcoffset[jbin][1]*yprd;
     xyz[j][2] = xyz[i][2] + pbcoffset[jbin][2]*zprd;
     id[j] = id[i];
+    for (k = 0; k < ninteger; k++) iarray[k][j] = iarray[k][i];
+    for (k = 0; k < ndouble; k++) darray[k][j] = darray[k][i];
     bin[j] = jbin;
     add_to_bin(j,jbin);
     nextimage[j] = nextimage[i];
     nextimage[i] = j;
+    if (skin > 0.0) neighbor_stale_bin(jbin);
   }
 }
 
@@ -1373,6 +1658,8 @@ void AppOffLattice::delete_all_ghosts()
 
   for (int i = 0; i < nbins; i++)
     if (binflag[i] == GHOST) binhead[i] = -1;
+
+  neighbor_reset();
 }
 
 /* ----------------------------------------------------------------------
@@ -1412,6 +1699,7 @@ int AppOffLattice::new_owned_site()
   freehead = next[freehead];
   nfree--;
   nlocal++;
+  neighbor_reset();
   return index;
 }
 
@@ -1454,6 +1742,7 @@ int AppOffLattice::delete_owned_site(int i)
   freehead = nlocal-1;
   nfree++;
   nlocal--;
+  neighbor_reset();
 
   return nextptr;
 }
@@ -1585,6 +1874,7 @@ void AppOffLattice::add_image_bins(int m, int i, int j, int k)
 
 void AppOffLattice::grow(int n)
 {
+  int oldmax = nmax;
   if (n == 0) nmax += DELTA;
   else nmax = n;
   if (nmax < 0 || nmax > MAXSMALLINT)
@@ -1601,6 +1891,12 @@ void AppOffLattice::grow(int n)
   memory->grow(site2i,nmax,"app:site2i");
   memory->grow(in_sector,nmax,"app:in_sector");
 
+  memory->grow(neighstamp,nmax,"app:neighstamp");
+  memory->grow(firstneigh,nmax,"app:firstneigh");
+  memory->grow(numneighs,nmax,"app:numneighs");
+  memory->grow(xhold,nmax,3,"app:xhold");
+  for (int i = oldmax; i < nmax; i++) neighstamp[i] = -1;
+
   for (int i = 0; i < ninteger; i++)
     memory->grow(iarray[i],nmax,"app:iarray");
   for (int i = 0; i < ndouble; i++)
@@ -1692,6 +1988,7 @@ void AppOffLattice::add_site(tagint n, double x, double y, double z)
   for (int i = 0; i < ndouble; i++) darray[i][nlocal] = 0;
 
   nlocal++;
+  sitestamp++;
 }
 
 /* ----------------------------------------------------------------------
@@ -1717,3 +2014,28 @@ void AppOffLattice::add_value(int i, int type, int index, char *value)
   if (type == 0) iarray[index-1][i] = atoi(value);
   else if (type == 1) darray[index-1][i] = atof(value);
 }
+
+/* ----------------------------------------------------------------------
+   sum memory usage of per-site arrays, bins, and neighbor lists
+   comm memory is tallied separately
+------------------------------------------------------------------------- */
+
+bigint AppOffLattice::memory_usage()
+{
+  bigint bytes = 0;
+
+  bytes += (bigint) nmax * sizeof(tagint);           // id
+  bytes += (bigint) nmax*3 * sizeof(double);         // xyz
+  bytes += (bigint) ninteger*nmax * sizeof(int);     // iarray
+  bytes += (bigint) ndouble*nmax * sizeof(double);   // darray
+  bytes += (bigint) 6*nmax * sizeof(int);            // bin,next,prev,etc
+
+  bytes += (bigint) nbins * 4 * sizeof(int);         // binhead,binflag,etc
+
+  bytes += (bigint) maxscratch * sizeof(int);        // neighscratch
+  bytes += (bigint) 3*nmax * sizeof(int);            // neighstamp,etc
+  bytes += (bigint) nmax*3 * sizeof(double);         // xhold
+  bytes += (bigint) maxpage * sizeof(int);           // neighpage
+
+  return bytes;
+}
@@ -31,6 +31,7 @@ class AppOffLattice : public App {
   void init();
   void setup();
   void iterate();
+  bigint memory_usage();
 
   void grow(int);
   void add_site(tagint, double, double, double);
@@ -101,11 +102,30 @@ class AppOffLattice : public App {
   double *propensity;          // probabilities for each owned site
 
                                // neighbor list info
-  int numneigh;
-  int *neighs;
+  int numneigh;                // # of neighbors returned by neighbor()
+  int *neighs;                 // neighbors returned by neighbor()
   int nstencil;                // # of surrounding bins
   int *stencil;                // offsets for surrounding bins
 
+  int maxscratch;              // size of neighscratch
+  int *neighscratch;           // neighbors of one site from a bin scan
+
+                               // persistent neighbor lists, if skin > 0
+  double skin;                 // extra distance added to list cutoff
+  double cutneigh;             // largest cutoff requested of neighbor()
+  int sortfreq;                // re-sort owned sites by bin every this
+                               //   many sweeps, 0 = never
+  int neighepoch;              // lists built in earlier epochs are stale
+  double dmax;                 // max displacement since list was built
+                               //   of any site that moved this epoch
+  int *neighstamp;             // epoch each site's list was built in
+  int *firstneigh;             // offset of each site's list in neighpage
+  int *numneighs;              // # of neighbors in each site's list
+  double **xhold;              // site coords when its list was built
+  int npage,maxpage;           // used and allocated length of neighpage
+  int nneighlive;              // # of neighpage entries in current lists
+  int *neighpage;              // contiguous storage for all lists
+
   struct Set {                 // subset of particles I own
     double xlo,xhi;            // sector bounds
     double ylo,yhi;
@@ -153,6 +173,13 @@ class AppOffLattice : public App {
   void neighbor(int, double);
   void move(int);
 
+  int neighbor_scan(int, double);
+  void neighbor_build(int);
+  void neighbor_reset();
+  void neighbor_stale_bin(int);
+  void neighbor_displace(int);
+  void sort_sites();
+
   int site2bin(int);
   void delete_from_bin(int, int);
   void add_to_bin(int, int);
@@ -172,6 +199,7 @@ class AppOffLattice : public App {
   void create_set(int, int);
 
   void set_sector(int, char **);
+  void set_neighbor(int, char **);
   void set_sweep(int, char **);
   void set_temperature(int, char **);
 
@@ -217,6 +245,11 @@ E: App did not set dt_sweep
 
 Internal SPPARKS error.
 
+E: Illegal neighbor command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.
+
 E: Invalid number of sectors
 
 Self-explanatory.
@@ -266,14 +299,6 @@ E: Application cutoff is too big for processor sub-domain
 There must be at least 2 bins per processor in each dimension
 where sectoring occurs.
 
-E: BAD STENCIL
-
-UNDOCUMENTED
-
-E: Too many neighbors per site
-
-Internal SPPARKS error.
-
 E: PBC remap of site failed
 
 Internal SPPARKS error.
@@ -34,7 +34,7 @@ using RASTER::DIR;
 /* ---------------------------------------------------------------------- */
 
 AppPottsAdditive::AppPottsAdditive(SPPARKS *spk, int narg, char **arg) :
-  AppPotts(spk,narg,arg), passes(), active_layer() {
+  AppPotts(spk,narg,arg), passes(), active_layer(), started(0), window(), mobile() {
 
    // only error check for this class, not derived classes
    if (strcmp(arg[0],"additive") == 0 && narg != 11 )
@@ -54,6 +54,7 @@ AppPottsAdditive::AppPottsAdditive(SPPARKS *spk, int narg, char **arg) :
    //Define the layer object, this might work better in init_app
    ndouble = 1;
    allow_app_update = 1;
+   allow_balance = 1;
    recreate_arrays();
 }
 
@@ -131,6 +132,7 @@ void AppPottsAdditive::input_app(char *command, int narg, char **arg)
          double transverse_pass_increment=tp.get_increment();
          rectangular_layers[id]=RectangularLayer(start,dir,speed,pass_distance,overpass,transverse_pass_distance,transverse_pass_increment,serpentine);
       }
+      started=0;
 
    } else if (strcmp(command,"am_pattern") == 0) {
       int num_layers;
@@ -160,6 +162,7 @@ void AppPottsAdditive::input_app(char *command, int narg, char **arg)
          iarg+=1;
       } else {error->all(FLERR,"Illegal pattern command. Expected 'z_increment.'");}
       pattern=Pattern(layer_ids,z_start,z_increment);
+      started=0;
 
    } else error->all(FLERR,"Unrecognized command");
 }
@@ -188,17 +191,25 @@ void AppPottsAdditive::init_app()
 
    dt_sweep = 1.0/maxneigh;
 
+   // melted sites are given spins 0 to nspins-1 by site_event_rejection(),
+   // so 0 is valid when a later run or a rebalance re-initializes the app
    int flag = 0;
    for (int i = 0; i < nlocal; i++)
-    if (spin[i] < 1 || spin[i] > nspins) flag = 1;
+    if (spin[i] < 0 || spin[i] > nspins) flag = 1;
    int flagall;
    MPI_Allreduce(&flag,&flagall,1,MPI_INT,MPI_SUM,world);
    if (flagall) error->all(FLERR,"One or more sites have invalid values");
 
-   int next_layer_id=pattern.begin();
-   active_layer=rectangular_layers[next_layer_id];
+   // Start pattern on first run; later runs, and re-initialization after
+   // a rebalance, continue the build where it left off
+   if(!started){
+      int next_layer_id=pattern.begin();
+      active_layer=rectangular_layers[next_layer_id];
+      started=1;
+   }
 
-   // Compute distance function based upon initial pool position
+   // Compute distance function based upon initial pool position;
+   // sweep window was cleared when sets were created and is rebuilt here
    app_update(0.0);
 }
 
@@ -210,16 +221,21 @@ void AppPottsAdditive::init_app()
 void AppPottsAdditive::app_update(double dt)
 {
    // Move pool
+   bool new_layer=false;
    if(active_layer.move(dt)){
    } else {
       // Need to update layer
       int next_layer_id=pattern.next(); 
       active_layer=rectangular_layers[next_layer_id];
+      new_layer=true;
    }
    // WARNING: this should always be run after checking on a move;
    // z-elevation of active layer
    double layer_z=pattern.get_layer_z_elevation();
 
+   // Only sites of active layer down to depth_HAZ can be mobile
+   if(new_layer || !windowflag) build_layer_window(layer_z);
+
 
 	
 	//Use the new position as input to the mobility calculation
@@ -228,9 +244,11 @@ void AppPottsAdditive::app_update(double dt)
 	//Specify the shape of the melt pool and then calculate the distance at each local site.
 	RASTER::pool_shape::AmEllipsoid ae(spot_width, melt_depth, melt_tail_length, cap_height, HAZ, tail_HAZ);
 	
-	//Go through all the local sites and calculate the distance.
+	//Go through all the window sites and calculate the distance.
    double d;
-	for(int i=0;i<nlocal;i++){
+   int nwindow=window.size();
+	for(int m=0;m<nwindow;m++){
+		int i=window[m];
 			
 		// SPPARKS lattice site
 		double XYZ[]={xyz[i][0],xyz[i][1],xyz[i][2]};
@@ -272,10 +290,38 @@ void AppPottsAdditive::app_update(double dt)
 			MobilityOut[i] = 0;
 		}
 	}
+
+   // Zero mobility sites have no events; rKMC sweeps skip them
+   mobile.clear();
+   for(int m=0;m<nwindow;m++)
+      if(MobilityOut[window[m]] != 0.0) mobile.push_back(window[m]);
+   build_window(mobile.size(),mobile.data());
+
    active_layer.move(dt);
 }
 
 
+/* ----------------------------------------------------------------------
+	Collect sites of the layer at layer_z, down to depth_HAZ below it.
+	All other sites are outside the HAZ bounds for as long as this layer
+	is active, so their mobility is zeroed once and never recomputed.
+ ------------------------------------------------------------------------- */
+
+void AppPottsAdditive::build_layer_window(double layer_z)
+{
+   if(windowflag){
+      for(std::size_t m=0;m<window.size();m++) MobilityOut[window[m]]=0;
+   } else {
+      for(int i=0;i<nlocal;i++) MobilityOut[i]=0;
+   }
+
+   window.clear();
+   for(int i=0;i<nlocal;i++){
+      double z=xyz[i][2]-layer_z;
+      if(z <= 0 && abs(z) <= depth_HAZ) window.push_back(i);
+   }
+}
+
 /* ----------------------------------------------------------------------
  Compute the mobility at the specified lattice site. Returns a double
  between 0 and 1 representing the mobility.
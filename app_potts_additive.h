@@ -68,6 +68,17 @@ class AppPottsAdditive : public AppPotts {
    map<int,RectangularLayer> rectangular_layers;
    Pattern pattern;
    RectangularLayer active_layer;
+
+   // pattern is started on first run and continued by later runs
+   int started;
+
+   // sites between active layer and depth_HAZ below it; only these
+   //    are swept and have their mobility updated
+   vector<int> window;
+   void build_layer_window(double layer_z);
+
+   // window sites with nonzero mobility; rKMC sweeps visit only these
+   vector<int> mobile;
 };
 
 }
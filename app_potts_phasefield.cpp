@@ -56,6 +56,11 @@ AppPottsPhaseField::AppPottsPhaseField(SPPARKS *spk, int narg, char **arg) :
 
   recreate_arrays();
 
+  nstencil = 0;
+  stencil = NULL;
+  interior = boundary = NULL;
+  ninterior = nboundary = 0;
+
   // parse arguments for PottsPhaseField class only, not children
 
   if (strcmp(style,"potts/pfm") != 0) return;
@@ -157,6 +162,9 @@ AppPottsPhaseField::~AppPottsPhaseField()
   }
   if (cmap)
     memory->sfree(cmap);
+  memory->destroy(stencil);
+  memory->destroy(interior);
+  memory->destroy(boundary);
 }
 
 void AppPottsPhaseField::init_app() 
@@ -168,6 +176,10 @@ void AppPottsPhaseField::init_app()
   // setup the connectivity map
 
   if (!cmap_ready) setup_connectivity_map();
+
+  // flatten the finite difference stencil and split sites by ghost access
+
+  setup_stencil();
   
   // initialize values if command is called
 
@@ -211,9 +223,10 @@ void AppPottsPhaseField::grow_app()
   c = darray[0];
   
   // grow cnew locally so it doesn't have to be communicated
+  // sized like darray so the two can be swapped after each step
 
-  if (nlocal_app < nlocal) {
-    nlocal_app = nlocal;
+  if (nlocal_app < nmax) {
+    nlocal_app = nmax;
 
     cnew = (double *) 
     memory->srealloc(cnew,nlocal_app*sizeof(double),"app_potts_pf:cnew");
@@ -221,15 +234,15 @@ void AppPottsPhaseField::grow_app()
 }
 
 /* ----------------------------------------------------------------------
- perform finite difference on a single  site
+ perform finite difference on a single site
+ return 1 if the new concentration is outside [0,1], else 0
  ------------------------------------------------------------------------- */
 
-void AppPottsPhaseField::site_event_finitedifference(int i)
+int AppPottsPhaseField::site_event_finitedifference(int i)
 {
 
-  int j,jj;
+  int j,jj,s;
   
-  int ispin = spin[i];
   double qi_alpha,qi_beta,qs_alpha,qs_beta;
   
   double C_sum[3],qAlpha_sum[3],qBeta_sum[3];
@@ -255,6 +268,7 @@ void AppPottsPhaseField::site_event_finitedifference(int i)
   double C=c[i];
   double CmC3 = C-c_3;
   double CmC4 = C-c_4;
+  int *sten = &stencil[nstencil*i];
   
   // the following code will automatically perform 1-,2-, or 3-D
   // finite difference, central in space and backward in time
@@ -262,41 +276,30 @@ void AppPottsPhaseField::site_event_finitedifference(int i)
   double val=0.0;
   
   // perform finite difference on all the cells in the list
+  // sten holds the 1st and 2nd neighbor in direction j
 
   for (j=0; j<2*dimension; j++) {
     
     // site
 
-    int s=neighbor[i][cmap[j]];
+    s=sten[2*j];
 
     // phase
 
-    if (phase[s]==0) {
-      qs_alpha=1.0;
-      qs_beta=0.0;
-    }
-    else {
-      qs_alpha=0.0;
-      qs_beta=1.0;
-    }
+    qs_beta = phase[s];
+    qs_alpha = 1.0 - qs_beta;
     
     // calculate contribution from D sum
 
     val += factor*c[s];
     val += 2.0*a_1*CmC3*qs_alpha + 2.0*a_2*CmC4*qs_beta;
-    val += -1.0*kappaC * (-4.0*c[s] + c[neighbor[s][cmap[j]]]);
+    val += -1.0*kappaC * (-4.0*c[s] + c[sten[2*j+1]]);
     
     // calculate the sign for the first order derivatives
+    // even j is the - direction, odd j is the + direction
 
-    double sign;
-    if (j%2) {
-      sign=+1.0;
-      jj=(j-1)/2;
-    }
-    else {
-      sign=-1.0;
-      jj=j/2;
-    }
+    double sign = (j%2) ? 1.0 : -1.0;
+    jj = j/2;
     
     // calculate the contribution from C, alpha and beta sum
 
@@ -319,15 +322,34 @@ void AppPottsPhaseField::site_event_finitedifference(int i)
   val += 4.0 * dimension * 
     (a_1*c_3*qi_alpha + a_2*c_4*qi_beta);
     
-  cnew[i] = C + (dt_phasefield * M_c) * val;
+  double cn = C + (dt_phasefield * M_c) * val;
   
   if (enforceConcentrationLimits) {
-    if (cnew[i] > 1.0) cnew[i]=1.0;
-    if (cnew[i] < 0.0) cnew[i]=0.0;
+    if (cn > 1.0) cn=1.0;
+    if (cn < 0.0) cn=0.0;
   }
   
-  if (!warn_concentration_deviation && (cnew[i] > 1.0 || cnew[i] < 0.0))
-    warn_concentration_deviation=1;  
+  cnew[i] = cn;
+  return (cn > 1.0 || cn < 0.0);
+}
+
+/* ----------------------------------------------------------------------
+ perform finite difference on a list of sites
+ sites are independent, each reads c and writes only its own cnew,
+   so the loop is threaded when compiled with OpenMP
+ ------------------------------------------------------------------------- */
+
+void AppPottsPhaseField::finitedifference(int n, int *list)
+{
+  int deviate = 0;
+
+#if defined(_OPENMP)
+#pragma omp parallel for reduction(|:deviate) schedule(static)
+#endif
+  for (int m = 0; m < n; m++)
+    deviate |= site_event_finitedifference(list[m]);
+
+  if (deviate) warn_concentration_deviation = 1;
 }
 
 /* ----------------------------------------------------------------------
@@ -451,6 +473,9 @@ void AppPottsPhaseField::site_event_rejection(int i, RandomPark *random)
 
 /* ----------------------------------------------------------------------
  iterate through the phase field solution 
+ only the concentration changes between steps, so after the initial
+   full comm only its ghost values are exchanged, and the exchange
+   overlaps the update of interior sites which do not read ghosts
  ------------------------------------------------------------------------- */
 
 void AppPottsPhaseField::app_update(double stoptime)
@@ -463,18 +488,36 @@ void AppPottsPhaseField::app_update(double stoptime)
   comm->all();
   timer->stamp(TIME_COMM);
   
+  int pending = 0;
   int done = 0;
   while (!done) {
 
-    // iterate through all the sets
+    // start ghost exchange of concentration from previous step
+
+    if (pending) {
+      comm->all_double_start(0);
+      timer->stamp(TIME_COMM);
+    }
+
+    // update sites that only read owned values
+
+    finitedifference(ninterior,interior);
+    timer->stamp(TIME_SOLVE);
+
+    // complete ghost exchange, then update sites that read ghosts
+
+    if (pending) {
+      comm->all_double_finish(0);
+      timer->stamp(TIME_COMM);
+    }
 
-    for (int i=0; i<nlocal; i++)
-      site_event_finitedifference(i);
+    finitedifference(nboundary,boundary);
     
-    // copy updated phase field into old concentration field
+    // updated phase field becomes the concentration field by swapping ptrs
 
-    for (int i=0; i<nlocal; i++)
-      c[i]=cnew[i];
+    darray[0] = cnew;
+    cnew = c;
+    c = darray[0];
     
     // reset the certain values if appropriate
 
@@ -483,10 +526,7 @@ void AppPottsPhaseField::app_update(double stoptime)
         c[pf_resetlist[i]]=pf_resetlistvals[i];
     }
     timer->stamp(TIME_SOLVE);
-    
-    // re-sync all the data
-
-    comm->all();
+    pending = 1;
     
     // check for concentration devation warnings
 
@@ -519,6 +559,11 @@ void AppPottsPhaseField::app_update(double stoptime)
       error->all(FLERR,errorstr);
     }
   } 
+
+  // leave ghost concentrations current for the rest of the app
+
+  comm->all_double(0);
+  timer->stamp(TIME_COMM);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -637,6 +682,40 @@ void AppPottsPhaseField::setup_connectivity_map()
   if (cmap_ready && print_cmap && me==0) print_connectivity_map();  
 }
 
+/* ----------------------------------------------------------------------
+ flatten the stencil into per-site lists of 1st and 2nd neighbors
+ in each direction and split owned sites into interior and boundary,
+ boundary sites have a ghost site somewhere in their stencil
+ ------------------------------------------------------------------------- */
+
+void AppPottsPhaseField::setup_stencil()
+{
+  int i,j,s1,s2,ghost;
+
+  nstencil = 4*dimension;
+
+  memory->destroy(stencil);
+  memory->destroy(interior);
+  memory->destroy(boundary);
+  memory->create(stencil,nstencil*nlocal,"app_potts_pf:stencil");
+  memory->create(interior,nlocal,"app_potts_pf:interior");
+  memory->create(boundary,nlocal,"app_potts_pf:boundary");
+
+  ninterior = nboundary = 0;
+  for (i=0; i<nlocal; i++) {
+    ghost = 0;
+    for (j=0; j<2*dimension; j++) {
+      s1 = neighbor[i][cmap[j]];
+      s2 = neighbor[s1][cmap[j]];
+      stencil[nstencil*i+2*j] = s1;
+      stencil[nstencil*i+2*j+1] = s2;
+      if (s1 >= nlocal || s2 >= nlocal) ghost = 1;
+    }
+    if (ghost) boundary[nboundary++] = i;
+    else interior[ninterior++] = i;
+  }
+}
+
 /* ---------------------------------------------------------------------- */
 
 void AppPottsPhaseField::print_connectivity_map()
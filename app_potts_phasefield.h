@@ -46,6 +46,12 @@ class AppPottsPhaseField : public AppPottsNeighOnly {
   int dimension;  //simulation dimension
   int *cmap;      //connectivity map for finite difference
   
+  int nstencil;     //# of stencil indices per site
+  int *stencil;     //1st and 2nd neighbor of each site in each direction
+  int *interior;    //owned sites whose stencil contains no ghost sites
+  int *boundary;    //owned sites whose stencil contains a ghost site
+  int ninterior,nboundary;
+  
   int phaseChangeInt; //integer equal to half the # of spins to distinguish phases
   int *phase;         //pointer to phase variable
   
@@ -76,7 +82,8 @@ class AppPottsPhaseField : public AppPottsNeighOnly {
   
   // methods unique to this class
   void init_values();
-  void site_event_finitedifference(int);
+  int site_event_finitedifference(int);
+  void finitedifference(int, int *);
   double site_energy_no_gradient(int i);
   void check_phasefield_stability(int,double);
   
@@ -84,6 +91,7 @@ class AppPottsPhaseField : public AppPottsNeighOnly {
   void set_site_phase(int);
   
   void setup_connectivity_map();
+  void setup_stencil();
   void print_connectivity_map();
   
   void set_phasefield_resetfield();
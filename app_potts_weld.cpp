@@ -89,7 +89,8 @@ AppPottsWeld::AppPottsWeld(SPPARKS *spk, int narg, char **arg) :
    haz(-1.0),  distance(nullptr),
    random_park(std::atof(arg[2])), simulation_time(0.0),
    pulse_amplitude(0.0), pulse_step_frequency(1.0), shape_type(ShapeType::undefined), 
-   width(-1.0), length(-1.0), teardrop_control_points()
+   width(-1.0), length(-1.0), teardrop_control_points(),
+   shape(nullptr), shape_scale(0.0), boxflag(0), window(), mobile()
 
 
 {
@@ -121,6 +122,13 @@ AppPottsWeld::AppPottsWeld(SPPARKS *spk, int narg, char **arg) :
 
 /* ---------------------------------------------------------------------- */
 
+AppPottsWeld::~AppPottsWeld()
+{
+   delete shape;
+}
+
+/* ---------------------------------------------------------------------- */
+
 void AppPottsWeld::print_potts_weld_params() const {
 
    std::cout << "nspins: " << std::setw(7) << nspins << std::endl;
@@ -167,7 +175,10 @@ void AppPottsWeld::init_app()
    MPI_Allreduce(&flag,&flagall,1,MPI_INT,MPI_SUM,world);
    if (flagall) error->all(FLERR,"One or more sites have invalid values");
 
-   // Initialize pool position and distances
+   // Initialize pool shape, position and distances at all sites
+   delete shape;
+   shape=nullptr;
+   boxflag=0;
    this->app_update(0.0);
 }
 
@@ -247,7 +258,77 @@ void AppPottsWeld::app_update(double dt)
    yp+=velocity*dt;
    double zp=thickness;
 
-   weld::pool_shape::PoolShape *shape=nullptr;
+   build_shape(p);
+
+   // Pool bounding box in lattice coordinates, grown by heat affected zone;
+   // sites outside of it have distance > haz and therefore zero mobility.
+   double margin=haz>0.0 ? haz : 0.0;
+   double lo[3],hi[3];
+   shape->bounding_box(lo,hi);
+   double xc[]={xp,yp,zp};
+   for(int k=0;k<3;k++){
+      lo[k]+=xc[k]-margin;
+      hi[k]+=xc[k]+margin;
+   }
+
+   // Sites needing update: all sites on first call; otherwise sites inside
+   //    current or previous box.  Elsewhere cached distance is retained; 
+   //    it is a lower bound once >= haz but mobility there is zero anyway.
+   window.clear();
+   for(int i=0;i<nlocal;i++){
+      const double *x=xyz[i];
+      bool in=true, inold=boxflag;
+      for(int k=0;k<3;k++){
+         if(x[k]<lo[k] || x[k]>hi[k]) in=false;
+         if(boxflag && (x[k]<boxlo[k] || x[k]>boxhi[k])) inold=false;
+      }
+      if(!boxflag || in || inold) window.push_back(i);
+   }
+   for(int k=0;k<3;k++){
+      boxlo[k]=lo[k];
+      boxhi[k]=hi[k];
+   }
+   boxflag=1;
+
+   int n=window.size();
+   const int *list=window.data();
+   compute_distances(n,list,xp,yp,zp);
+
+   /* -------------------------------------------------------------------
+   For sites within pool, assign random spins so that when they exit the
+   pool, they will be singleton spins and generally not part of a grain.
+   Done serially in site order so random sequence does not depend on 
+   number of threads.
+   ---------------------------------------------------------------------- */
+   for(int m=0;m<n;m++){
+      int i=list[m];
+      if(distance[i]<0){
+         // Random number between [1,nspins] inclusive
+         int ran = random_park.irandom(nspins);
+         spin[i]=ran;
+      }
+   }
+
+   // Zero mobility sites cannot flip; sites outside of window have
+   //    distance >= haz, so sweep list is drawn from window alone
+   mobile.clear();
+   for(int m=0;m<n;m++){
+      int i=list[m];
+      if(compute_mobility(i)>0.0) mobile.push_back(i);
+   }
+   build_window(mobile.size(),mobile.data());
+}
+
+/* ----------------------------------------------------------------------
+   (re)build pool shape for pulse scale 'p'
+------------------------------------------------------------------------- */
+
+void AppPottsWeld::build_shape(double p)
+{
+   if(shape && p==shape_scale) return;
+   delete shape;
+   shape=nullptr;
+   double thickness=std::abs(domain->zprd);
    switch(shape_type) {
       case ShapeType::ellipse:
          shape=new weld::pool_shape::EllipticBezier(p*width,p*length,thickness,alpha,beta);
@@ -255,41 +336,38 @@ void AppPottsWeld::app_update(double dt)
       case ShapeType::teardrop:
          shape=new weld::pool_shape::Teardrop(thickness,p*width,alpha,beta,teardrop_control_points);
          break;
+      default:
+         error->all(FLERR,"Potts/weld pool shape has not been defined");
    }
+   shape_scale=p;
+}
 
-   // Lattice point location relative to 'pool' position
-   double xo[]={0,0,0};
+/* ----------------------------------------------------------------------
+   compute distance to pool surface for a list of sites
+   pool is at (xp,yp,zp); sites are independent and distance()
+   only reads the shape, so loop is threaded when compiled with OpenMP
+------------------------------------------------------------------------- */
 
-   // For each site i:
-   //    Compute 'closest' distance from observation point to weld pool surface
-   for(int i=0;i<nlocal;i++){
+void AppPottsWeld::compute_distances(int n, const int *list, 
+                                     double xp, double yp, double zp)
+{
+   const weld::pool_shape::PoolShape *s=shape;
 
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+   for(int m=0;m<n;m++){
+      int i=list[m];
+
+      // Lattice point location relative to 'pool' position
       // site coordinates (spparks coordinate system)
       // xyz -- public member 'app.h'
+      double xo[]={xyz[i][0]-xp,xyz[i][1]-yp,xyz[i][2]-zp};
 
-      xo[0]=xyz[i][0]-xp;
-      xo[1]=xyz[i][1]-yp;
-      xo[2]=xyz[i][2]-zp;
-
-      // Compute distance for this site
       // This function returns d=-1 for points within pool;
       // Otherwise it returns the distance associated with the closest point
-      double d=shape->distance(xo);
-      distance[i]=d;
-
-      /* -------------------------------------------------------------------
-      For sites within pool, assign random spins so that when they exit the
-      pool, they will be singleton spins and generally not part of a grain.
-      ---------------------------------------------------------------------- */
-      if(d<0){
-
-         // Random number between [1,nspins] inclusive
-         int ran = random_park.irandom(nspins);
-         spin[i]=ran;
-      }
+      distance[i]=s->distance(xo);
    }
-
-   delete shape;
 }
 
 /* --------------------------------------------------------
@@ -31,7 +31,7 @@ namespace SPPARKS_NS {
 class AppPottsWeld : public AppPotts {
  public:
    AppPottsWeld(class SPPARKS *, int, char **);
-   virtual ~AppPottsWeld() { }
+   virtual ~AppPottsWeld();
    virtual void init_app();
    virtual void grow_app();
    virtual void site_event_rejection(int, class RandomPark *);
@@ -55,6 +55,23 @@ class AppPottsWeld : public AppPotts {
    double width, length;
    vector<vector<double> > teardrop_control_points;
 
+   // Pool shape is rebuilt only when pulse changes its size
+   weld::pool_shape::PoolShape *shape;
+   double shape_scale;
+
+   // Distances are recomputed only for sites inside the pool bounding
+   //    box grown by 'haz'; box of previous update is kept so sites the
+   //    pool moved away from are refreshed once more.
+   int boxflag;
+   double boxlo[3], boxhi[3];
+   vector<int> window;
+
+   // Sites with nonzero mobility; rKMC sweeps visit only these
+   vector<int> mobile;
+
+   void build_shape(double p);
+   void compute_distances(int n, const int *list, double xp, double yp, double zp);
+
 };
 
 }
@@ -76,4 +93,9 @@ E: One or more sites have invalid values
 The application only allows sites to be initialized with specific
 values.
 
+E: Potts/weld pool shape has not been defined
+
+Use the weld_shape_ellipse or weld_shape_teardrop command before
+the run.
+
 */
@@ -108,16 +108,12 @@ double AppRelax::site_energy_neighbor(int i)
 
 void AppRelax::site_event_rejection(int i, RandomPark *random)
 {
-  double xold[3];
+  double xnew[3];
   double dx,dy,dz;
+  double einitial,efinal;
 
   double rc = pair->cutoff;
   neighbor(i,rc+delta);
-  double einitial = site_energy_neighbor(i);
-
-  xold[0] = xyz[i][0];
-  xold[1] = xyz[i][1];
-  xold[2] = xyz[i][2];
 
   double rsq = 1.0e20;
   while (rsq > deltasq) {
@@ -127,29 +123,27 @@ void AppRelax::site_event_rejection(int i, RandomPark *random)
     else dz = 0.0;
     rsq = dx*dx + dy*dy + dz*dz;
   }
-  xyz[i][0] += dx;
-  xyz[i][1] += dy;
-  xyz[i][2] += dz;
+  xnew[0] = xyz[i][0] + dx;
+  xnew[1] = xyz[i][1] + dy;
+  xnew[2] = xyz[i][2] + dz;
+
+  // energy before and after the move in one pass over neighbors
 
-  double efinal = site_energy_neighbor(i);
+  pair->energy_trial(i,numneigh,neighs,xyz,type,xnew,einitial,efinal);
 
   // accept or reject via Boltzmann criterion
 
   int success = 0;
 
-  if (efinal <= einitial) {
-    success = 1;
-  } else if (temperature == 0.0) {
-    xyz[i][0] = xold[0];
-    xyz[i][1] = xold[1];
-    xyz[i][2] = xold[2];
-  } else if (random->uniform() > exp((einitial-efinal)*t_inverse)) {
-    xyz[i][0] = xold[0];
-    xyz[i][1] = xold[1];
-    xyz[i][2] = xold[2];
-  } else success = 1;
+  if (efinal <= einitial) success = 1;
+  else if (temperature == 0.0) success = 0;
+  else if (random->uniform() > exp((einitial-efinal)*t_inverse)) success = 0;
+  else success = 1;
 
   if (success) {
+    xyz[i][0] = xnew[0];
+    xyz[i][1] = xnew[1];
+    xyz[i][2] = xnew[2];
     move(i);
     naccept++;
   }
@@ -26,8 +26,11 @@
 #include "memory.h"
 #include "error.h"
 #include "output.h"
+#include "irregular.h"
 
 #include <cfloat>
+#include <climits>
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <new>
@@ -88,6 +91,9 @@ AppSinter::AppSinter(SPPARKS *spk, int narg, char **arg) :
   
   size_annihilist = 0;
   size_collapsinglist = 0;
+
+  irregular = NULL;
+  visitstamp = 0;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -106,6 +112,7 @@ AppSinter::~AppSinter()
 		annihilist_dist.clear();
 		displacement.clear();
 	}		
+  delete irregular;
 }
 
 /* ----------------------------------------------------------------------
@@ -1101,7 +1108,7 @@ bool AppSinter::vacancy_adjacent_grain( int i, RandomPark *random, int & adjacen
 double AppSinter::calculate_mass_center_adjacent_grain(int i, int isite, vector<double> & cm )
 {
 	
-	vector<bool> registered ( nlocal, false ); 
+	next_visit_stamp();
 	
 	for ( int j = 0; j < dimension; j++ ) 
 		cm[j] = 0.0;
@@ -1110,7 +1117,7 @@ double AppSinter::calculate_mass_center_adjacent_grain(int i, int isite, vector<
 		
 	std::stack<int> grainstack;	
 	grainstack.push(i);
-	registered[i] = true;
+	visit[i] = visitstamp;
 	double vol = 0.0;
 	
 	int ii, k;
@@ -1125,9 +1132,9 @@ double AppSinter::calculate_mass_center_adjacent_grain(int i, int isite, vector<
 			cm[j] += xyz[k][j];
 		for (int j = 0; j < numneigh[k]; j++) {
 			ii = neighbor[k][j];
-			if (spin[ii] == isite && registered[ii] == false) {
+			if (spin[ii] == isite && visit[ii] != visitstamp) {
 				grainstack.push(ii);
-				registered[ii] = true;
+				visit[ii] = visitstamp;
 			}
 		}		
 	}
@@ -1529,41 +1536,21 @@ void AppSinter::generate_local_vacancy_collapsing_list( const int SIZE_LIST )
 	vector<double> p ( dimension );
 	double mint;
 	
+	// Bring grain sums up to date with site changes since last call and
+	// retrieve mass center of adjacent grains from the processors owning them
+	vector<double> cm_adjacent;
+	grain_mass_centers( size_annihilist, &annihilation_spin[0], cm_adjacent );
+	
 	for ( int i = 0; i < size_annihilist; i++ ) {
 		int j = annihilation_list[i];
-		if ( spin[j] != VACANT ) { // Other vacancy update modified this site -> no longer a vacancy
-			naccept--;
+		if ( spin[j] != VACANT || cm_adjacent[4*i+3] <= 0.0 ) { // Other vacancy update modified this site -> no longer a vacancy
+			naccept--;									// or adjacent grain seen in a stale ghost no longer exists
 			vac_made--;
 			continue;
 		}	
-		
-		// Find the spin of the adjacent grain in the global list of grains
-		// and retrieve the center of mass
-		int grain_ind = -1;
-		for ( int ind = 0; ind < numgrains; ind++ ) {
-			if ( annihilation_spin[i] == grain_spins[ind] ) {
-				grain_ind = ind;
-				break;
-			}
-		}
-		/*		if ( grain_ind == -1 ) {
-		 printf("proc: %d vacancy to be annihilated: %d (spin: %d) spin of adjacent grain: %d\n", me, j, lattice[j], annihilation_spin[i]);
-		 printf("List of neighboring spins:\n");
-		 for ( int count = 0; count < numneigh[j]; count++ ) {
-		 printf("%d ", lattice[neighbor[j][count]] );
-		 }
-		 printf("\nnumber of grains: %d. List of spins:\n", numgrains );  
-		 //			for ( int count = 0; count < numgrains; count++ ) {
-		 //				printf("%d ", grain_spins[count]);
-		 //			}
-		 //			printf("\n");
-		 }
-		 */		
-		assert ( grain_ind > -1 ); // The adjacent grain was found !
-		
-		int offset = grain_ind * dimension;		
+
 		for ( int k = 0; k < dimension; k++ )
-			coord_cm[k] = grain_mass_center[offset+k];
+			coord_cm[k] = cm_adjacent[4*i+k];
 		
 		calculate_vacancy_new_position( j, coord_cm, p, mint, new_pos );
 		register_collapsing_event(j, p, mint, new_pos);
@@ -2038,7 +2025,8 @@ double AppSinter::calculate_gb_average(double & grain_size_average)
 	int localsum_faces = 0;
 	int localnum_grains = 0;
 	
-	vector<bool> site_included( nlocal+nghost, false );
+	// One stamp marks every site already assigned to a grain in this call
+	next_visit_stamp();
 	
 	vector<int> grains_spins;
 	int num_faces=0;
@@ -2046,21 +2034,11 @@ double AppSinter::calculate_gb_average(double & grain_size_average)
 	vector<int> local_buffer( nlocal * 10 );
 	int size_local_buffer = 0;
 	
-	const int GROUPSIZE ( dimension + 1 );
-	vector<double> center_mass( dimension );
-	vector<int> local_grain_spin;
-	vector<double> local_grain_mass_center;
-	int size_local_numgrain = 0;
-	if ( nprocs > 1 ) {
-		local_grain_spin.resize( nlocal );
-		local_grain_mass_center.resize( nlocal * GROUPSIZE );
-	}
-	
 	int num_grains = 0;
 	for ( int i = 0; i < nlocal; i++ ) {
 		if ( spin[i] == VACANT || spin[i] == FRAME )
 			continue;
-		if ( site_included[i] )
+		if ( visit[i] == visitstamp )
 			continue;
 		grains_spins.push_back( spin[i] );	
 		vector<int> faces;
@@ -2068,7 +2046,7 @@ double AppSinter::calculate_gb_average(double & grain_size_average)
 		int grain_vol, face_sites;
 		bool multiproc;
 		
-		cluster_faces( i, site_included, grain_vol, face_sites, faces, multiproc, neigh_procs, center_mass );
+		cluster_faces( i, grain_vol, face_sites, faces, multiproc, neigh_procs );
 		if ( multiproc ) {
 			local_buffer[size_local_buffer++] = spin[i];
 			local_buffer[size_local_buffer++] = faces.size();
@@ -2086,15 +2064,6 @@ double AppSinter::calculate_gb_average(double & grain_size_average)
 		}
 		localsum_face_sites += face_sites;
 		localsum_grain_sites += grain_vol;
-		
-		// Store spin and center of mass of each grain
-		if ( nprocs > 1 ) {
-			local_grain_spin[size_local_numgrain] = spin[i];
-			for ( int k = 0; k < dimension; k++ )
-				local_grain_mass_center[size_local_numgrain*GROUPSIZE+k] = center_mass[k];
-			local_grain_mass_center[size_local_numgrain*GROUPSIZE+dimension] = grain_vol;
-			size_local_numgrain++;
-		}	
 	}
 	local_buffer[size_local_buffer++] = localsum_faces;
 	local_buffer[size_local_buffer++] = localsum_face_sites;
@@ -2112,13 +2081,6 @@ double AppSinter::calculate_gb_average(double & grain_size_average)
 	
 	int total_faces = 0, total_face_sites = 0, total_grain_sites = 0, total_grains = 0;
 	
-	// Consolidate list of grains mass center
-	if ( nprocs > 1 ) {
-		//		if ( me == 0 ) printf("going to calculate center of mass at time: %lf\n", time );
-		consolidate_mass_center_distributed_grains( local_grain_spin, local_grain_mass_center, size_local_numgrain );	
-		//		printf("after calculating center of mass. proc: %d local number of grains: %d total: %d\n", me, size_local_numgrain, numgrains);
-	}
-	
 	// Calculations regarding grain boundary
 	if ( me == 0 ) {
 		vector<int> copy_buffer( size_buffer_all );
@@ -2312,8 +2274,8 @@ void AppSinter::cluster_faces( int start_ilocal, vector<bool> & site_included, i
  counted.
  ------------------------------------------------------------------------- */
 
-void AppSinter::cluster_faces( int start_ilocal, vector<bool> & site_included, int & grain_vol, int & face_sites, vector<int> & faces,
-							  bool & multiproc, vector<int> & neigh_procs, vector<double> & cm )
+void AppSinter::cluster_faces( int start_ilocal, int & grain_vol, int & face_sites, vector<int> & faces,
+							  bool & multiproc, vector<int> & neigh_procs )
 {
 	int ispin = spin[start_ilocal];
 	
@@ -2322,11 +2284,8 @@ void AppSinter::cluster_faces( int start_ilocal, vector<bool> & site_included, i
 	
 	std::stack<int> exploring;
 	
-	for ( int k = 0; k < dimension; k++ )
-		cm[k] = 0.0;
-	
 	exploring.push( start_ilocal );
-	site_included[start_ilocal] = true;
+	visit[start_ilocal] = visitstamp;
 	grain_vol = 1;
 	
 	vector<int> aux_faces;
@@ -2341,14 +2300,10 @@ void AppSinter::cluster_faces( int start_ilocal, vector<bool> & site_included, i
 			int neigh_spin = spin[neigh];
 			if ( neigh_spin == FRAME || neigh_spin == VACANT ) continue; // Outside simulation space or vacancy
 			if ( neigh_spin == ispin ) { // Same spin, part of the cluster 
-				if ( !site_included[neigh] ) { // if not included --> include in exploring stack
+				if ( visit[neigh] != visitstamp ) { // if not included --> include in exploring stack
 					exploring.push( neigh );
-					site_included[neigh] = true;
-					if ( neigh < nlocal )	{
-						grain_vol++;
-						for ( int k = 0; k < dimension; k++ )
-							cm[k] += xyz[neigh][k];
-					}
+					visit[neigh] = visitstamp;
+					if ( neigh < nlocal )	grain_vol++;
 					else {
 						aux_neigh_procs.push_back ( owner[neigh] );
 						multiproc = true; // grain is contained in more than one processor
@@ -2399,104 +2354,155 @@ void AppSinter::cluster_faces( int start_ilocal, vector<bool> & site_included, i
 } 
 
 /* ----------------------------------------------------------------------
- In Parallel execution, consolidate the list of centers of mass for
- each grain in the domain. The same spin comming from different
- processors is collected as one grain. 
- At the end every processor knows the center of mass of every grain.
- Spins are stored in vector 'grain_spins', center of mas in vector
- 'grain_mass_center' and number of grain in 'numgrains'
+ Grain statistics for annihilation: each grain (spin) is owned by one
+ processor, grain_owner(), which holds the sum of the coords of all its
+ sites and their count. Each processor remembers which spin every owned
+ site last contributed (cmspin), so bringing the sums up to date only
+ sends the net change per spin to the owners of the changed grains.
+ This replaces gathering every grain on one processor and broadcasting
+ the full list of mass centers back to all processors.
+
+ Retrieve mass center of N grains with spins GSPINS. On return cm holds
+ x,y,z,count per requested grain, count = 0 if the grain has no sites.
+ Net changes and requests travel in the same message to each owner, so
+ one round trip both updates and queries the grain sums.
+ Must be called by all processors, with N = 0 if nothing is needed.
  ------------------------------------------------------------------------- */
 
-void AppSinter::consolidate_mass_center_distributed_grains( vector<int> & spins, vector<double> & cm_list, const int LOCALNUMGRAINS ) 
+void AppSinter::grain_mass_centers( int n, int *gspins, vector<double> & cm )
 {
-	const int GROUPSIZE ( dimension + 1 ); // coordinates plus one element for volume
-	int local_size = LOCALNUMGRAINS; 
-	int fat_numgrains=0;
-	
-	vector<int> cm_distribution( nprocs );
-	
-	MPI_Gather(&local_size, 1, MPI_INT, &cm_distribution[0], 1, MPI_INT, 0, world);
-	
-	vector<int> cm_displacement;
-	vector<int> gspins;
-	vector<double> gcm; 
-	
-	if ( me == 0 ) {			
-		cm_displacement.resize( nprocs );
-		int sum=0;
-		for ( int i = 0; i < nprocs; i++ ) {
-			cm_displacement[i] = sum;
-			sum += cm_distribution[i];
+	// First call: no site has contributed yet
+	if ( (int) cmspin.size() != nlocal ) cmspin.assign( nlocal, FRAME );
+
+	// Outgoing datums of 6 values
+	// net change: 0, spin, x, y, z, count
+	// request:    1, spin, requesting processor, index in request list, 0, 0
+	std::map<int,int> deltaindex;
+	std::map<int,int>::iterator loc;
+	vector<double> send;
+	int m, oldspin, newspin;
+
+	for ( int i = 0; i < nlocal; i++ ) {
+		oldspin = cmspin[i];
+		newspin = spin[i];
+		if ( oldspin == newspin ) continue;
+		for ( int side = 0; side < 2; side++ ) {
+			int gspin = side ? newspin : oldspin;
+			if ( gspin <= VACANT ) continue;
+			double sign = side ? 1.0 : -1.0;
+			loc = deltaindex.find( gspin );
+			if ( loc == deltaindex.end() ) {
+				m = deltaindex.size();
+				deltaindex.insert( std::pair<int,int> (gspin,m) );
+				send.resize( 6*(m+1), 0.0 );
+				send[6*m+1] = gspin;
+			}
+			else m = loc->second;
+			send[6*m+2] += sign * xyz[i][0];
+			send[6*m+3] += sign * xyz[i][1];
+			send[6*m+4] += sign * xyz[i][2];
+			send[6*m+5] += sign;
 		}
-		
-		gspins.resize( sum );
-		gcm.resize( sum * GROUPSIZE ); 
-		fat_numgrains = sum;
+		cmspin[i] = newspin;
 	}
-	
-	MPI_Gatherv(&spins[0], local_size, MPI_INT, &gspins[0], &cm_distribution[0], &cm_displacement[0], MPI_INT, 0, world);
-	if ( me == 0 ) {
-		for ( int i = 0; i < nprocs; i++ ) {
-			cm_distribution[i] *= GROUPSIZE;
-			cm_displacement[i] *= GROUPSIZE;
-		}
+
+	int ndelta = deltaindex.size();
+	int nsend = ndelta + n;
+	send.resize( 6*(nsend+1), 0.0 );
+	for ( int k = 0; k < n; k++ ) {
+		m = ndelta + k;
+		send[6*m] = 1;
+		send[6*m+1] = gspins[k];
+		send[6*m+2] = me;
+		send[6*m+3] = k;
 	}
-	MPI_Gatherv(&cm_list[0], GROUPSIZE*local_size, MPI_DOUBLE, &gcm[0], &cm_distribution[0], &cm_displacement[0], MPI_DOUBLE, 0, world);
-	
-	numgrains = 0;
-	if ( me == 0 ) {
-		grain_spins.resize( 0 );
-		grain_mass_center.resize( 0 );
-		for ( int i = 0; i < fat_numgrains; i++ ) {
-			if ( gspins[i] != -1 ) { // Grain has not been counted
-				grain_spins.push_back( gspins[i] );
-				for ( int k = 0; k < dimension; k++ ) {
-					grain_mass_center.push_back( gcm[i*GROUPSIZE+k] );
-				}
-				int gvol = gcm[i*GROUPSIZE+3];
-				for ( int j = i+1; j < fat_numgrains; j++ ) {
-					if ( gspins[j] == gspins[i] ) { // Another part of grain found
-						for ( int k = 0; k < dimension; k++ ) {
-							grain_mass_center[numgrains*dimension+k] += gcm[j*GROUPSIZE+k];
-						}
-						gvol += gcm[j*GROUPSIZE+3];
-						gspins[j] = -1; // Burn grain because it has been counted
-					}
-				}
-				// Calculate average
-				for ( int k = 0; k < dimension; k++ ) {
-					grain_mass_center[numgrains*dimension+k] /= gvol;
-				}
-				numgrains++;
-				gspins[i] = -1; // Burn grain because it has been counted
-			}
+
+	vector<int> proclist( nsend+1 );
+	for ( m = 0; m < nsend; m++ )
+		proclist[m] = grain_owner( static_cast<int> (send[6*m+1]) );
+
+	int nrecv;
+	vector<double> recv;
+	if ( nprocs > 1 ) {
+		if ( irregular == NULL ) irregular = new Irregular(spk);
+		nrecv = irregular->create_data( nsend, &proclist[0] );
+		recv.resize( 6*(nrecv+1) );
+		irregular->exchange_data( (char *) &send[0], 6*sizeof(double), (char *) &recv[0] );
+		irregular->destroy_data();
+	}
+	else {
+		nrecv = nsend;
+		recv.swap( send );
+	}
+
+	// Apply all net changes to the grains I own before answering requests
+	for ( int k = 0; k < nrecv; k++ ) {
+		if ( recv[6*k] != 0.0 ) continue;
+		int gspin = static_cast<int> (recv[6*k+1]);
+		loc = grainindex.find( gspin );
+		if ( loc == grainindex.end() ) {
+			m = grainindex.size();
+			grainindex.insert( std::pair<int,int> (gspin,m) );
+			grainsum.resize( 4*(m+1), 0.0 );
 		}
+		else m = loc->second;
+		for ( int j = 0; j < 4; j++ )
+			grainsum[4*m+j] += recv[6*k+2+j];
 	}
-	
-	MPI_Bcast( &numgrains, 1, MPI_INT, 0, world );
-	if ( me > 0 ) {
-		grain_spins.resize( numgrains );
-		grain_mass_center.resize( numgrains * dimension );
+
+	// Replies: index in request list, mass center, count
+	vector<double> reply;
+	vector<int> replyproc;
+	for ( int k = 0; k < nrecv; k++ ) {
+		if ( recv[6*k] == 0.0 ) continue;
+		int gspin = static_cast<int> (recv[6*k+1]);
+		replyproc.push_back( static_cast<int> (recv[6*k+2]) );
+		reply.push_back( recv[6*k+3] );
+		double *sum = NULL;
+		loc = grainindex.find( gspin );
+		if ( loc != grainindex.end() && grainsum[4*loc->second+3] > 0.5 )
+			sum = &grainsum[4*loc->second];
+		for ( int j = 0; j < 3; j++ )
+			reply.push_back( sum ? sum[j] / sum[3] : 0.0 );
+		reply.push_back( sum ? sum[3] : 0.0 );
+	}
+	int nreply = replyproc.size();
+	reply.resize( 5*(nreply+1) );
+	replyproc.resize( nreply+1 );
+
+	vector<double> answer;
+	if ( nprocs > 1 ) {
+		nrecv = irregular->create_data( nreply, &replyproc[0] );
+		answer.resize( 5*(nrecv+1) );
+		irregular->exchange_data( (char *) &reply[0], 5*sizeof(double), (char *) &answer[0] );
+		irregular->destroy_data();
+	}
+	else {
+		nrecv = nreply;
+		answer.swap( reply );
+	}
+
+	cm.assign( 4*(n+1), 0.0 );
+	for ( int k = 0; k < nrecv; k++ ) {
+		int ind = static_cast<int> (answer[5*k]);
+		for ( int j = 0; j < 4; j++ )
+			cm[4*ind+j] = answer[5*k+1+j];
+	}
+}
+
+/* ----------------------------------------------------------------------
+ Start a new grain traversal: sites with visit[i] == visitstamp are
+ the ones visited, so the marks never need to be cleared
+ ------------------------------------------------------------------------- */
+
+void AppSinter::next_visit_stamp()
+{
+	if ( (int) visit.size() < nlocal+nghost ) visit.resize( nlocal+nghost, 0 );
+	if ( visitstamp == INT_MAX ) {
+		std::fill( visit.begin(), visit.end(), 0 );
+		visitstamp = 0;
 	}
-	MPI_Bcast( &grain_spins[0], numgrains, MPI_INT, 0, world );
-	MPI_Bcast( &grain_mass_center[0], numgrains*dimension, MPI_DOUBLE, 0, world );	
-	/*	
-	 int i, j,count=0;
-	 for ( i = 0; i < nlocal; i++ ) {
-	 if ( lattice[i] > VACANT ) { 
-	 for ( j = 0; j < numgrains; j++ ) {
-	 if ( lattice[i] == grain_spins[j] )
-	 break;
-	 }
-	 if ( lattice[i] != grain_spins[j] ) {
-	 //	printf("proc: %d spin: %d not found in list of grains (j: %d)\n", me, lattice[i], j );
-	 count++;
-	 }
-	 }	
-	 }
-	 printf("proc: %d number of grains not found in the list: %d\n", me, count );
-	 printf("proc: %d size of vector grain_spins: %d\n", me, grain_spins.size() ); 
-	 */	
+	visitstamp++;
 }
 
 /////////////////////////////////////////// STATISTICS /////////////////////////////////////////////////
@@ -2532,7 +2538,7 @@ void AppSinter::stats(char *strtmp)
 	naccept_double_all = naccept_double;
 	vm_all = vacm;
   }
-  if (solve) sprintf(strtmp,"%10g %12.0Lf %14d %<10d %12.0Lf",time,naccept_double_all,0,0,vm_all);
+  if (solve) sprintf(strtmp,"%10g %12.0f %14d %10d %12.0f",time,naccept_double_all,0,0,vm_all);
   else {
     double nattempt_double = (double)nattempt;
     double nattempt_double_all;
@@ -2542,7 +2548,7 @@ void AppSinter::stats(char *strtmp)
 	else {
 		nattempt_double_all = nattempt_double;
 	}	
-    sprintf(strtmp,"%10g %12.0Lf %14.0Lf %10d %12.0Lf",
+    sprintf(strtmp,"%10g %12.0f %14.0f %10d %12.0f",
 	    time,naccept_double_all,nattempt_double_all-naccept_double_all,nsweeps,vm_all);
   }
 //  check_state();
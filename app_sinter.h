@@ -94,12 +94,16 @@ class AppSinter : public AppLattice {
   // Functions for grain boundary calculations
   double calculate_gb_update(double current_time);			  
   double calculate_gb_average(double & grain_size_average);
-  void cluster_faces( int start_ilocal, vector<bool> & site_included, int & grain_vol, int & face_sites, vector<int> & faces,
-							 bool & multiproc, vector<int> & neigh_procs, vector<double> & cm );
+  void cluster_faces( int start_ilocal, int & grain_vol, int & face_sites, vector<int> & faces,
+							 bool & multiproc, vector<int> & neigh_procs );
 //  void cluster_faces( int start_ilocal, vector<bool> & site_included, int & grain_vol, int & face_sites, vector<int> & faces,
 //							 bool & multiproc, vector<int> & neigh_procs );
 							 
-  void consolidate_mass_center_distributed_grains( vector<int> & spins, vector<double> & cm_list, const int LOCALNUMGRAINS );							 
+
+  // Grain statistics owned by one processor per grain, updated incrementally
+  int grain_owner( int gspin ) { return gspin % nprocs; }
+  void grain_mass_centers( int n, int *gspins, vector<double> & cm );
+  void next_visit_stamp();
  
   // Calculating and/or reporting statistics		
   void stats_header(char *strtmp);
@@ -132,9 +136,17 @@ class AppSinter : public AppLattice {
   int size_collapsinglist;
   vector<double> collapsing_directions;
 	
-  vector<int> grain_spins;
-  vector<double> grain_mass_center;
-  int numgrains;
+  // Per grain sums of site coords and site counts
+  // cmspin = spin each owned site last contributed to the sums
+  // grainsum = x,y,z,count for each grain this processor owns, by grainindex
+  vector<int> cmspin;
+  std::map<int,int> grainindex;
+  vector<double> grainsum;
+  class Irregular *irregular;
+
+  // Stamps of visited sites for grain traversals
+  vector<int> visit;
+  int visitstamp;
 	
   double Dx, Dy, Dz;
   double xgrid_proc;
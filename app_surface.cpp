@@ -0,0 +1,886 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#include "math.h"
+#include "stdio.h"
+#include "mpi.h"
+#include "stdlib.h"
+#include "string.h"
+#include "app_surface.h"
+#include "solve.h"
+#include "random_park.h"
+#include "memory.h"
+#include "diag_kmc_profile.h"
+#include "error.h"
+
+using namespace SPPARKS_NS;
+
+#define DELTAEVENT 100000
+#define MASKCOORD 10
+
+/* ---------------------------------------------------------------------- */
+
+AppSurface::AppSurface(SPPARKS *spk, int narg, char **arg) :
+  AppLattice(spk,narg,arg)
+{
+  ninteger = 2;
+  ndouble = 0;
+  delpropensity = 2;
+  delevent = 2;
+  allow_kmc = 1;
+  allow_rejection = 0;
+  allow_masking = 0;
+  allow_balance = 1;
+  allow_app_update = 1;
+
+  // optional arg = max # of hops a mask reaches
+  // ghost sites must cover masks as well as pair partners 2 hops away
+
+  if (narg > 2) error->all(FLERR,"Illegal app_style command");
+  maxmaskhop = 0;
+  if (narg == 2) maxmaskhop = atoi(arg[1]);
+  if (maxmaskhop < 0) error->all(FLERR,"Illegal app_style command");
+  delpropensity = MAX(delpropensity,maxmaskhop);
+
+  create_arrays();
+
+  nspecies = 0;
+  sname = NULL;
+
+  none = ntwo = nthree = 0;
+  sA = dA = vA = NULL;
+  sexpon = dexpon = vexpon = NULL;
+  srate = drate = vrate = NULL;
+  scoord = dcoord = vcoord = NULL;
+  spresson = dpresson = vpresson = NULL;
+  sinput = soutput = NULL;
+  dinput = doutput = NULL;
+  vinput = voutput = NULL;
+  spropensity = dpropensity = vpropensity = NULL;
+  scount = dcount = vcount = NULL;
+
+  ncoordrule = 0;
+  cfrom = cto = cdelta = NULL;
+  maskhop = NULL;
+
+  sstart = slist = NULL;
+  dstart = dlist = NULL;
+  vstart = vlist = NULL;
+  coordchange = maskcheck = pressurecheck = NULL;
+  maxmask = reach = 0;
+
+  T1 = T2 = T3 = T4 = 0.0;
+  pressure = 0;
+
+  events = NULL;
+  nevents = maxevent = 0;
+  firstevent = NULL;
+  maxlocal = 0;
+
+  stamp = NULL;
+  curstamp = maxstamp = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+AppSurface::~AppSurface()
+{
+  for (int m = 0; m < nspecies; m++) delete [] sname[m];
+  memory->sfree(sname);
+
+  memory->destroy(sA);
+  memory->destroy(dA);
+  memory->destroy(vA);
+  memory->destroy(sexpon);
+  memory->destroy(dexpon);
+  memory->destroy(vexpon);
+  memory->destroy(srate);
+  memory->destroy(drate);
+  memory->destroy(vrate);
+  memory->destroy(scoord);
+  memory->destroy(dcoord);
+  memory->destroy(vcoord);
+  memory->destroy(spresson);
+  memory->destroy(dpresson);
+  memory->destroy(vpresson);
+  memory->destroy(sinput);
+  memory->destroy(soutput);
+  memory->destroy(dinput);
+  memory->destroy(doutput);
+  memory->destroy(vinput);
+  memory->destroy(voutput);
+  memory->destroy(spropensity);
+  memory->destroy(dpropensity);
+  memory->destroy(vpropensity);
+  memory->destroy(scount);
+  memory->destroy(dcount);
+  memory->destroy(vcount);
+
+  memory->destroy(cfrom);
+  memory->destroy(cto);
+  memory->destroy(cdelta);
+  memory->destroy(maskhop);
+
+  memory->destroy(sstart);
+  memory->destroy(slist);
+  memory->destroy(dstart);
+  memory->destroy(dlist);
+  memory->destroy(vstart);
+  memory->destroy(vlist);
+  memory->destroy(coordchange);
+  memory->destroy(maskcheck);
+  memory->destroy(pressurecheck);
+
+  memory->sfree(events);
+  memory->destroy(firstevent);
+  memory->destroy(stamp);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void AppSurface::input_app(char *command, int narg, char **arg)
+{
+  if (strcmp(command,"species") == 0) {
+    if (narg < 1) error->all(FLERR,"Illegal species command");
+    sname = (char **)
+      memory->srealloc(sname,(nspecies+narg)*sizeof(char *),
+		       "app/surface:sname");
+    memory->grow(maskhop,nspecies+narg,"app/surface:maskhop");
+    for (int iarg = 0; iarg < narg; iarg++) {
+      if (find_species(arg[iarg]) >= 0)
+	error->all(FLERR,"Species already defined");
+      int n = strlen(arg[iarg]) + 1;
+      sname[nspecies] = new char[n];
+      strcpy(sname[nspecies],arg[iarg]);
+      maskhop[nspecies] = 0;
+      nspecies++;
+    }
+
+  } else if (strcmp(command,"event") == 0) {
+    if (narg < 1) error->all(FLERR,"Illegal event command");
+    int rstyle = atoi(arg[0]);
+
+    // optional last arg is a label for the reaction, it is ignored
+
+    if (rstyle == 1) {
+      if (narg != 8 && narg != 9) error->all(FLERR,"Illegal event command");
+      grow_reactions(rstyle);
+      sinput[none] = species_arg(arg[1],0);
+      soutput[none] = species_arg(arg[2],0);
+      sA[none] = atof(arg[3]);
+      sexpon[none] = atoi(arg[4]);
+      srate[none] = atof(arg[5]);
+      scoord[none] = atoi(arg[6]);
+      spresson[none] = atoi(arg[7]);
+      if (spresson[none] < 0 || spresson[none] > 3)
+	error->all(FLERR,"Illegal event command");
+      none++;
+
+    } else if (rstyle == 2 || rstyle == 3) {
+      if (narg != 10 && narg != 11) error->all(FLERR,"Illegal event command");
+      grow_reactions(rstyle);
+      int **input = dinput;
+      int **output = doutput;
+      int n = ntwo;
+      double *A = dA;
+      int *expon = dexpon;
+      double *rate = drate;
+      int *rcoord = dcoord;
+      int *presson = dpresson;
+      if (rstyle == 3) {
+	input = vinput;
+	output = voutput;
+	n = nthree;
+	A = vA;
+	expon = vexpon;
+	rate = vrate;
+	rcoord = vcoord;
+	presson = vpresson;
+      }
+      input[n][0] = species_arg(arg[1],0);
+      input[n][1] = species_arg(arg[2],0);
+      output[n][0] = species_arg(arg[3],0);
+      output[n][1] = species_arg(arg[4],0);
+      A[n] = atof(arg[5]);
+      expon[n] = atoi(arg[6]);
+      rate[n] = atof(arg[7]);
+      rcoord[n] = atoi(arg[8]);
+      presson[n] = atoi(arg[9]);
+      if (presson[n] < 0 || presson[n] > 3)
+	error->all(FLERR,"Illegal event command");
+      if (rstyle == 2) ntwo++;
+      else nthree++;
+
+    } else error->all(FLERR,"Illegal event command");
+
+  } else if (strcmp(command,"coord") == 0) {
+    if (narg != 3) error->all(FLERR,"Illegal coord command");
+    int n = ncoordrule + 1;
+    memory->grow(cfrom,n,"app/surface:cfrom");
+    memory->grow(cto,n,"app/surface:cto");
+    memory->grow(cdelta,n,"app/surface:cdelta");
+    cfrom[ncoordrule] = species_arg(arg[0],1);
+    cto[ncoordrule] = species_arg(arg[1],1);
+    cdelta[ncoordrule] = atoi(arg[2]);
+    ncoordrule++;
+
+  } else if (strcmp(command,"mask") == 0) {
+    if (narg != 2) error->all(FLERR,"Illegal mask command");
+    int s = species_arg(arg[0],0);
+    maskhop[s] = atoi(arg[1]);
+    if (maskhop[s] < 0) error->all(FLERR,"Illegal mask command");
+    if (maskhop[s] > delpropensity)
+      error->all(FLERR,"Mask of app surface exceeds app_style mask range");
+
+  } else if (strcmp(command,"pulse_time") == 0) {
+    if (narg != 2) error->all(FLERR,"Illegal pulse_time command");
+    T1 = atof(arg[0]);
+    T3 = atof(arg[1]);
+    if (T1 < 0.0 || T3 < 0.0) error->all(FLERR,"Illegal pulse_time command");
+
+  } else if (strcmp(command,"purge_time") == 0) {
+    if (narg != 2) error->all(FLERR,"Illegal purge_time command");
+    T2 = atof(arg[0]);
+    T4 = atof(arg[1]);
+    if (T2 < 0.0 || T4 < 0.0) error->all(FLERR,"Illegal purge_time command");
+
+  } else error->all(FLERR,"Unrecognized command");
+}
+
+/* ----------------------------------------------------------------------
+   set site value ptrs each time iarray/darray are reallocated
+------------------------------------------------------------------------- */
+
+void AppSurface::grow_app()
+{
+  species = iarray[0];
+  coord = iarray[1];
+}
+
+/* ----------------------------------------------------------------------
+   initialize before each run
+   check validity of site values
+------------------------------------------------------------------------- */
+
+void AppSurface::init_app()
+{
+  // per-site arrays, reallocated if balance command changed site counts
+
+  if (nlocal > maxlocal) {
+    maxlocal = nlocal;
+    memory->destroy(firstevent);
+    memory->create(firstevent,maxlocal,"app/surface:firstevent");
+  }
+  if (nlocal+nghost > maxstamp) {
+    maxstamp = nlocal + nghost;
+    memory->destroy(stamp);
+    memory->create(stamp,maxstamp,"app/surface:stamp");
+  }
+  for (int i = 0; i < maxstamp; i++) stamp[i] = 0;
+  curstamp = 0;
+
+  compile_rules();
+
+  // site validity
+
+  int flag = 0;
+  for (int i = 0; i < nlocal; i++)
+    if (species[i] < 0 || species[i] >= nspecies) flag = 1;
+  int flagall;
+  MPI_Allreduce(&flag,&flagall,1,MPI_INT,MPI_SUM,world);
+  if (flagall) error->all(FLERR,"One or more sites have invalid values");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void AppSurface::setup_app()
+{
+  // clear event list
+
+  nevents = 0;
+  for (int i = 0; i < nlocal; i++) firstevent[i] = -1;
+  for (int i = 0; i < maxevent; i++) events[i].next = i+1;
+  freeevent = 0;
+
+  // set propensities from rates
+
+  if (temperature == 0.0)
+    error->all(FLERR,"Temperature cannot be 0.0 for app surface");
+
+  for (int m = 0; m < none; m++) {
+    spropensity[m] =
+      sA[m]*pow(temperature,sexpon[m])*exp(-srate[m]/temperature);
+    if (!rebalanceflag) scount[m] = 0;
+  }
+  for (int m = 0; m < ntwo; m++) {
+    dpropensity[m] =
+      dA[m]*pow(temperature,dexpon[m])*exp(-drate[m]/temperature);
+    if (!rebalanceflag) dcount[m] = 0;
+  }
+  for (int m = 0; m < nthree; m++) {
+    vpropensity[m] =
+      vA[m]*pow(temperature,vexpon[m])*exp(-vrate[m]/temperature);
+    if (!rebalanceflag) vcount[m] = 0;
+  }
+
+  pressure = pressure_state(time);
+}
+
+/* ----------------------------------------------------------------------
+   compile reactions and rules into tables indexed by species
+   site_propensity() then only visits reactions whose reactants match
+------------------------------------------------------------------------- */
+
+void AppSurface::compile_rules()
+{
+  int ns = nspecies;
+  int npair = ns*ns;
+
+  memory->destroy(sstart);
+  memory->destroy(slist);
+  memory->destroy(dstart);
+  memory->destroy(dlist);
+  memory->destroy(vstart);
+  memory->destroy(vlist);
+  memory->destroy(coordchange);
+  memory->destroy(maskcheck);
+  memory->destroy(pressurecheck);
+
+  memory->create(sstart,ns+1,"app/surface:sstart");
+  memory->create(slist,MAX(none,1),"app/surface:slist");
+  memory->create(dstart,npair+1,"app/surface:dstart");
+  memory->create(dlist,MAX(ntwo,1),"app/surface:dlist");
+  memory->create(vstart,npair+1,"app/surface:vstart");
+  memory->create(vlist,MAX(nthree,1),"app/surface:vlist");
+  memory->create(coordchange,MAX(npair,1),"app/surface:coordchange");
+  memory->create(maskcheck,MAX(ns,1),"app/surface:maskcheck");
+  memory->create(pressurecheck,MAX(ns,1),"app/surface:pressurecheck");
+
+  // reactions sorted by reactant species, order of definition kept
+
+  int n = 0;
+  for (int s = 0; s < ns; s++) {
+    sstart[s] = n;
+    for (int m = 0; m < none; m++)
+      if (sinput[m] == s) slist[n++] = m;
+  }
+  sstart[ns] = n;
+
+  n = 0;
+  for (int st = 0; st < npair; st++) {
+    dstart[st] = n;
+    for (int m = 0; m < ntwo; m++)
+      if (dinput[m][0]*ns + dinput[m][1] == st) dlist[n++] = m;
+  }
+  dstart[npair] = n;
+
+  n = 0;
+  for (int st = 0; st < npair; st++) {
+    vstart[st] = n;
+    for (int m = 0; m < nthree; m++)
+      if (vinput[m][0]*ns + vinput[m][1] == st) vlist[n++] = m;
+  }
+  vstart[npair] = n;
+
+  // species with a reaction that depends on coordination or pressure
+
+  for (int s = 0; s < ns; s++) maskcheck[s] = pressurecheck[s] = 0;
+  for (int m = 0; m < none; m++) {
+    if (scoord[m]) maskcheck[sinput[m]] = 1;
+    if (spresson[m]) pressurecheck[sinput[m]] = 1;
+  }
+  for (int m = 0; m < ntwo; m++) {
+    if (dcoord[m]) maskcheck[dinput[m][0]] = 1;
+    if (dpresson[m]) pressurecheck[dinput[m][0]] = 1;
+  }
+  for (int m = 0; m < nthree; m++) {
+    if (vcoord[m]) maskcheck[vinput[m][0]] = 1;
+    if (vpresson[m]) pressurecheck[vinput[m][0]] = 1;
+  }
+
+  // coordination change for each change of species, summed over rules
+
+  for (int st = 0; st < npair; st++) coordchange[st] = 0;
+  for (int m = 0; m < ncoordrule; m++)
+    for (int s = 0; s < ns; s++) {
+      if (cfrom[m] >= 0 && cfrom[m] != s) continue;
+      for (int t = 0; t < ns; t++) {
+	if (s == t) continue;
+	if (cto[m] >= 0 && cto[m] != t) continue;
+	coordchange[s*ns+t] += cdelta[m];
+      }
+    }
+
+  // a species change alters propensities of sites up to reach hops away
+
+  maxmask = 0;
+  for (int s = 0; s < ns; s++) maxmask = MAX(maxmask,maskhop[s]);
+  reach = maxmask;
+  if (nthree) reach = MAX(reach,1);
+  if (ntwo) reach = MAX(reach,2);
+}
+
+/* ----------------------------------------------------------------------
+   compute energy of site
+------------------------------------------------------------------------- */
+
+double AppSurface::site_energy(int i)
+{
+  return 0.0;
+}
+
+/* ----------------------------------------------------------------------
+   KMC method
+   compute total propensity of owned site summed over possible events
+   single events change site I, pair events change I and a site 2 hops
+     away, neighbor events change I and one of its neighbors
+------------------------------------------------------------------------- */
+
+double AppSurface::site_propensity(int i)
+{
+  int j,k,m,n,st;
+
+  clear_events(i);
+
+  int ns = nspecies;
+  int s = species[i];
+  int nsingle = sstart[s+1] - sstart[s];
+  int npair = dstart[(s+1)*ns] - dstart[s*ns];
+  int nneigh = vstart[(s+1)*ns] - vstart[s*ns];
+  if (nsingle + npair + nneigh == 0) return 0.0;
+
+  // each mask lowers coordination seen by events, same as app ald
+
+  int c = coord[i];
+  if (maskcheck[s] && maxmask) c -= MASKCOORD*masked(i);
+
+  double proball = 0.0;
+
+  for (n = sstart[s]; n < sstart[s+1]; n++) {
+    m = slist[n];
+    if (scoord[m] && scoord[m] != c) continue;
+    if (spresson[m] && pressure && spresson[m] != pressure) continue;
+    if (spropensity[m] == 0.0) continue;
+    add_event(i,1,m,spropensity[m],-1);
+    proball += spropensity[m];
+  }
+
+  // each site 2 hops away is a partner once, however many paths lead to it
+
+  if (npair) {
+    new_walk();
+    stamp[i] = curstamp;
+    for (int jj = 0; jj < numneigh[i]; jj++) {
+      j = neighbor[i][jj];
+      for (int kk = 0; kk < numneigh[j]; kk++) {
+	k = neighbor[j][kk];
+	if (stamp[k] == curstamp) continue;
+	stamp[k] = curstamp;
+	st = s*ns + species[k];
+	for (n = dstart[st]; n < dstart[st+1]; n++) {
+	  m = dlist[n];
+	  if (dcoord[m] && dcoord[m] != c) continue;
+	  if (dpresson[m] && pressure && dpresson[m] != pressure) continue;
+	  if (dpropensity[m] == 0.0) continue;
+	  add_event(i,2,m,dpropensity[m],k);
+	  proball += dpropensity[m];
+	}
+      }
+    }
+  }
+
+  if (nneigh) {
+    for (int jj = 0; jj < numneigh[i]; jj++) {
+      j = neighbor[i][jj];
+      st = s*ns + species[j];
+      for (n = vstart[st]; n < vstart[st+1]; n++) {
+	m = vlist[n];
+	if (vcoord[m] && vcoord[m] != c) continue;
+	if (vpresson[m] && pressure && vpresson[m] != pressure) continue;
+	if (vpropensity[m] == 0.0) continue;
+	add_event(i,3,m,vpropensity[m],j);
+	proball += vpropensity[m];
+      }
+    }
+  }
+
+  return proball;
+}
+
+/* ----------------------------------------------------------------------
+   KMC method
+   choose and perform an event for site
+------------------------------------------------------------------------- */
+
+void AppSurface::site_event(int i, class RandomPark *random)
+{
+  // pick one event from total propensity by accumulating its probability
+  // compare prob to threshhold, break when reach it to select event
+
+  double threshhold = random->uniform() * propensity[i2site[i]];
+  double proball = 0.0;
+
+  int ievent = firstevent[i];
+  while (1) {
+    proball += events[ievent].propensity;
+    if (proball >= threshhold) break;
+    ievent = events[ievent].next;
+  }
+
+  // perform single, pair, or neighbor event
+
+  int rstyle = events[ievent].style;
+  int which = events[ievent].which;
+  int partner = events[ievent].partner;
+
+  int changed[2];
+  int nchanged = 0;
+  changed[nchanged++] = i;
+  if (partner >= 0) changed[nchanged++] = partner;
+
+  if (rstyle == 1) {
+    change_species(i,soutput[which]);
+    scount[which]++;
+  } else if (rstyle == 2) {
+    change_species(i,doutput[which][0]);
+    change_species(partner,doutput[which][1]);
+    dcount[which]++;
+  } else {
+    change_species(i,voutput[which][0]);
+    change_species(partner,voutput[which][1]);
+    vcount[which]++;
+  }
+
+  // KMC without sectors has no app_update(), so pressure state
+  //   changes at the first event of each pulse or purge
+
+  if (nset == 1) {
+    int pnew = pressure_state(time);
+    if (pnew != pressure) {
+      pressure = pnew;
+      refresh_pressure();
+    }
+  }
+
+  // compute propensity changes for sites within reach of changed sites
+  // ignore sites not in the current set
+
+  neighborhood(nchanged,changed,reach);
+
+  usites.clear();
+  int nwalk = walk.size();
+  for (int m = 0; m < nwalk; m++) {
+    int isite = walk[m];
+    if (isite >= nlocal || i2site[isite] < 0) continue;
+    usites.push_back(isite);
+  }
+
+  int nsites = usites.size();
+  for (int m = 0; m < nsites; m++) {
+    int isite = i2site[usites[m]];
+    propensity[isite] = site_propensity(usites[m]);
+    usites[m] = isite;
+  }
+
+  if (profile) {
+    int ireaction = which;
+    if (rstyle == 2) ireaction += none;
+    else if (rstyle == 3) ireaction += none + ntwo;
+    profile->event(i,ireaction,nsites);
+  }
+
+  solve->update(nsites,&usites[0],propensity);
+}
+
+/* ----------------------------------------------------------------------
+   KMC with sectors
+   change pressure state between passes over the sectors
+------------------------------------------------------------------------- */
+
+void AppSurface::app_update(double dt)
+{
+  int pnew = pressure_state(time+dt);
+  if (pnew == pressure) return;
+  pressure = pnew;
+  refresh_pressure();
+}
+
+/* ----------------------------------------------------------------------
+   change species of site I to S and apply coordination rules
+------------------------------------------------------------------------- */
+
+void AppSurface::change_species(int i, int s)
+{
+  if (species[i] == s) return;
+  coord[i] += coordchange[species[i]*nspecies + s];
+  species[i] = s;
+}
+
+/* ----------------------------------------------------------------------
+   pressure state at time t from pulse and purge times
+   1 = first pulse, 2 = second pulse, 3 = purge, 0 = no cycle defined
+------------------------------------------------------------------------- */
+
+int AppSurface::pressure_state(double t)
+{
+  double cycle = T1 + T2 + T3 + T4;
+  if (cycle <= 0.0) return 0;
+
+  double tcycle = fmod(t,cycle);
+  if (tcycle < T1) return 1;
+  if (tcycle < T1+T2) return 3;
+  if (tcycle < T1+T2+T3) return 2;
+  return 3;
+}
+
+/* ----------------------------------------------------------------------
+   recompute propensity of all sites with a pressure dependent reaction
+   done for every set, since pressure changes everywhere at once
+------------------------------------------------------------------------- */
+
+void AppSurface::refresh_pressure()
+{
+  for (int iset = 0; iset < nset; iset++) {
+    int *site2i = set[iset].site2i;
+    double *setpropensity = set[iset].propensity;
+    usites.clear();
+    for (int m = 0; m < set[iset].nlocal; m++) {
+      int i = site2i[m];
+      if (!pressurecheck[species[i]]) continue;
+      setpropensity[m] = site_propensity(i);
+      usites.push_back(m);
+    }
+    if (usites.size())
+      set[iset].solve->update(usites.size(),&usites[0],setpropensity);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   return # of sites with a masking species that have site I in range
+------------------------------------------------------------------------- */
+
+int AppSurface::masked(int i)
+{
+  neighborhood(1,&i,maxmask);
+
+  int nmask = 0;
+  for (int hop = 1; hop <= maxmask; hop++)
+    for (int m = layer[hop]; m < layer[hop+1]; m++)
+      if (maskhop[species[walk[m]]] >= hop) nmask++;
+  return nmask;
+}
+
+/* ----------------------------------------------------------------------
+   start a new walk over sites, reset stamps when counter would overflow
+------------------------------------------------------------------------- */
+
+void AppSurface::new_walk()
+{
+  if (curstamp > MAXSMALLINT - 100) {
+    for (int i = 0; i < maxstamp; i++) stamp[i] = 0;
+    curstamp = 0;
+  }
+  curstamp++;
+}
+
+/* ----------------------------------------------------------------------
+   find all owned and ghost sites within nhop hops of n source sites
+   walk = sources followed by sites 1 hop away, 2 hops away, etc
+   sites H hops away are walk[layer[H]] to walk[layer[H+1]-1]
+------------------------------------------------------------------------- */
+
+void AppSurface::neighborhood(int n, int *source, int nhop)
+{
+  new_walk();
+  walk.clear();
+  layer.clear();
+  layer.push_back(0);
+  for (int m = 0; m < n; m++) {
+    if (stamp[source[m]] == curstamp) continue;
+    stamp[source[m]] = curstamp;
+    walk.push_back(source[m]);
+  }
+
+  int first = 0;
+  for (int hop = 0; hop < nhop; hop++) {
+    int last = walk.size();
+    layer.push_back(last);
+    for (int m = first; m < last; m++) {
+      int i = walk[m];
+      for (int jj = 0; jj < numneigh[i]; jj++) {
+	int j = neighbor[i][jj];
+	if (stamp[j] == curstamp) continue;
+	stamp[j] = curstamp;
+	walk.push_back(j);
+      }
+    }
+    first = last;
+  }
+  layer.push_back(walk.size());
+}
+
+/* ----------------------------------------------------------------------
+   clear all events out of list for site I
+   add cleared events to free list
+------------------------------------------------------------------------- */
+
+void AppSurface::clear_events(int i)
+{
+  int next;
+  int index = firstevent[i];
+  while (index >= 0) {
+    next = events[index].next;
+    events[index].next = freeevent;
+    freeevent = index;
+    nevents--;
+    index = next;
+  }
+  firstevent[i] = -1;
+}
+
+/* ----------------------------------------------------------------------
+   add an event to list for site I
+   event = change of site I and partner with probability = propensity
+------------------------------------------------------------------------- */
+
+void AppSurface::add_event(int i, int rstyle, int which, double propensity,
+			   int partner)
+{
+  // grow event list and setup free list
+
+  if (nevents == maxevent) {
+    maxevent += DELTAEVENT;
+    events =
+      (Event *) memory->srealloc(events,maxevent*sizeof(Event),"app:events");
+    for (int m = nevents; m < maxevent; m++) events[m].next = m+1;
+    freeevent = nevents;
+  }
+
+  int next = events[freeevent].next;
+
+  events[freeevent].style = rstyle;
+  events[freeevent].which = which;
+  events[freeevent].partner = partner;
+  events[freeevent].propensity = propensity;
+
+  events[freeevent].next = firstevent[i];
+  firstevent[i] = freeevent;
+  freeevent = next;
+  nevents++;
+}
+
+/* ----------------------------------------------------------------------
+   grow list of stored reactions for single, pair, or neighbor
+------------------------------------------------------------------------- */
+
+void AppSurface::grow_reactions(int rstyle)
+{
+  if (rstyle == 1) {
+    int n = none + 1;
+    memory->grow(sA,n,"app/surface:sA");
+    memory->grow(sexpon,n,"app/surface:sexpon");
+    memory->grow(srate,n,"app/surface:srate");
+    memory->grow(scoord,n,"app/surface:scoord");
+    memory->grow(spresson,n,"app/surface:spresson");
+    memory->grow(sinput,n,"app/surface:sinput");
+    memory->grow(soutput,n,"app/surface:soutput");
+    memory->grow(spropensity,n,"app/surface:spropensity");
+    memory->grow(scount,n,"app/surface:scount");
+
+  } else if (rstyle == 2) {
+    int n = ntwo + 1;
+    memory->grow(dA,n,"app/surface:dA");
+    memory->grow(dexpon,n,"app/surface:dexpon");
+    memory->grow(drate,n,"app/surface:drate");
+    memory->grow(dcoord,n,"app/surface:dcoord");
+    memory->grow(dpresson,n,"app/surface:dpresson");
+    memory->grow(dinput,n,2,"app/surface:dinput");
+    memory->grow(doutput,n,2,"app/surface:doutput");
+    memory->grow(dpropensity,n,"app/surface:dpropensity");
+    memory->grow(dcount,n,"app/surface:dcount");
+
+  } else if (rstyle == 3) {
+    int n = nthree + 1;
+    memory->grow(vA,n,"app/surface:vA");
+    memory->grow(vexpon,n,"app/surface:vexpon");
+    memory->grow(vrate,n,"app/surface:vrate");
+    memory->grow(vcoord,n,"app/surface:vcoord");
+    memory->grow(vpresson,n,"app/surface:vpresson");
+    memory->grow(vinput,n,2,"app/surface:vinput");
+    memory->grow(voutput,n,2,"app/surface:voutput");
+    memory->grow(vpropensity,n,"app/surface:vpropensity");
+    memory->grow(vcount,n,"app/surface:vcount");
+  }
+}
+
+/* ----------------------------------------------------------------------
+   return index of species with name, -1 if not defined
+------------------------------------------------------------------------- */
+
+int AppSurface::find_species(const char *name)
+{
+  for (int m = 0; m < nspecies; m++)
+    if (strcmp(name,sname[m]) == 0) return m;
+  return -1;
+}
+
+/* ----------------------------------------------------------------------
+   species index of an input arg
+   wildflag = 1 if "*" is allowed for any species, returned as -1
+------------------------------------------------------------------------- */
+
+int AppSurface::species_arg(char *name, int wildflag)
+{
+  if (wildflag && strcmp(name,"*") == 0) return -1;
+  int s = find_species(name);
+  if (s < 0) error->all(FLERR,"Unknown species");
+  return s;
+}
+
+/* ----------------------------------------------------------------------
+   reactions reported to diag_style kmc_profile
+   single, pair, neighbor reactions in that order, labeled as in diag surface
+------------------------------------------------------------------------- */
+
+int AppSurface::profile_reactions()
+{
+  return none + ntwo + nthree;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void AppSurface::profile_label(int m, char *str)
+{
+  if (m < none) sprintf(str,"s%d",m+1);
+  else if (m < none + ntwo) sprintf(str,"d%d",m-none+1);
+  else sprintf(str,"v%d",m-none-ntwo+1);
+}
+
+/* ----------------------------------------------------------------------
+   memory usage of event list, per-site and per-species arrays
+------------------------------------------------------------------------- */
+
+bigint AppSurface::memory_usage_app()
+{
+  bigint bytes = 0;
+  bytes += (bigint) maxevent * sizeof(Event);           // events
+  bytes += (bigint) maxlocal * sizeof(int);             // firstevent
+  bytes += (bigint) maxstamp * sizeof(int);             // stamp
+  if (sstart) {
+    bytes += (bigint) (2*nspecies*nspecies+2) * sizeof(int);  // dstart,vstart
+    bytes += (bigint) nspecies*nspecies * sizeof(int);  // coordchange
+    bytes += (bigint) (3*nspecies+1) * sizeof(int);     // sstart,checks
+    bytes += (bigint) (none+ntwo+nthree) * sizeof(int); // slist,dlist,vlist
+  }
+  return bytes;
+}
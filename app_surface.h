@@ -0,0 +1,165 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#ifdef APP_CLASS
+AppStyle(surface,AppSurface)
+
+#else
+
+#ifndef SPK_APP_SURFACE_H
+#define SPK_APP_SURFACE_H
+
+#include "app_lattice.h"
+#include <vector>
+
+namespace SPPARKS_NS {
+
+class AppSurface : public AppLattice {
+  friend class DiagSurface;
+
+ public:
+  AppSurface(class SPPARKS *, int, char **);
+  ~AppSurface();
+  void input_app(char *, int, char **);
+  void grow_app();
+  void init_app();
+  void setup_app();
+  void app_update(double);
+  bigint memory_usage_app();
+
+  double site_energy(int);
+  void site_event_rejection(int, class RandomPark *) {}
+  double site_propensity(int);
+  void site_event(int, class RandomPark *);
+  int profile_reactions();
+  void profile_label(int, char *);
+
+  int find_species(const char *);
+
+ private:
+  int *species,*coord;     // variables on each lattice site
+  int maxmaskhop;          // max # of hops a mask reaches, from app_style
+
+  int nspecies;            // # of declared species
+  char **sname;            // name of each species
+
+  int none,ntwo,nthree;    // # of single, pair, neighbor reactions
+  double *sA,*dA,*vA;      // prefactor of each reaction
+  int *sexpon,*dexpon,*vexpon;      // temperature exponent
+  double *srate,*drate,*vrate;      // activation energy
+  int *scoord,*dcoord,*vcoord;      // required coordination, 0 = any
+  int *spresson,*dpresson,*vpresson; // required pressure state, 0 = any
+  int *sinput,**dinput,**vinput;    // reactant species
+  int *soutput,**doutput,**voutput; // product species
+  double *spropensity,*dpropensity,*vpropensity;
+  int *scount,*dcount,*vcount;      // # of times each reaction occurred
+
+  int ncoordrule;          // coordination rules from coord command
+  int *cfrom,*cto;         // species change of a rule, -1 = any
+  int *cdelta;             // coordination change of a rule
+
+  int *maskhop;            // # of hops each species masks, 0 = none
+
+  // reactions compiled into per-species tables by compile_rules()
+
+  int *sstart,*slist;      // single reactions of species S are
+                           //   slist[sstart[S]] to slist[sstart[S+1]-1]
+  int *dstart,*dlist;      // pair reactions of species S and T,
+                           //   indexed by S*nspecies+T
+  int *vstart,*vlist;      // neighbor reactions of species S and T
+  int *coordchange;        // summed coord rules for species S to T
+  int *maskcheck;          // 1 if species S has a reaction needing coord
+  int *pressurecheck;      // 1 if species S has a pressure reaction
+  int maxmask;             // max # of hops of any mask
+  int reach;               // # of hops a species change affects propensity
+
+  double T1,T2,T3,T4;      // pulse and purge times of a cycle
+  int pressure;            // current pressure state, 0 if no cycle
+
+  struct Event {           // one event for an owned site
+    int style;             // reaction style = SINGLE,PAIR,NEIGHBOR
+    int which;             // which reaction of this type
+    int partner;           // site changed with I, -1 if none
+    int next;              // index of next event for this site
+    double propensity;     // propensity of this event
+  };
+
+  Event *events;           // list of events for all owned sites
+  int nevents;             // # of events for all owned sites
+  int maxevent;            // max # of events list can hold
+  int *firstevent;         // index of 1st event for each owned site
+  int freeevent;           // index of 1st unused event in list
+  int maxlocal;            // allocated size of firstevent
+
+  int *stamp;              // last walk that visited each owned/ghost site
+  int curstamp;            // stamp of current walk
+  int maxstamp;            // allocated size of stamp
+  std::vector<int> walk;   // sites found by current walk
+  std::vector<int> layer;  // index in walk of 1st site of each hop
+  std::vector<int> usites; // set indices of sites to update after event
+
+  void clear_events(int);
+  void add_event(int, int, int, double, int);
+  void grow_reactions(int);
+  void compile_rules();
+  int pressure_state(double);
+  int masked(int);
+  void new_walk();
+  void neighborhood(int, int *, int);
+  void change_species(int, int);
+  void refresh_pressure();
+  int species_arg(char *, int);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running SPPARKS to see the offending
+line.
+
+E: Unrecognized command
+
+The command is assumed to be application specific, but is not
+known to SPPARKS.  Check the input script.
+
+E: Species already defined
+
+Each species name can only be used once in the species command.
+
+E: Unknown species
+
+The event, coord, or mask command refers to a species which was not
+defined by a previous species command.
+
+E: One or more sites have invalid values
+
+Site species must be an index from 0 to the # of species - 1.
+
+E: Temperature cannot be 0.0 for app surface
+
+Self-explanatory.
+
+E: Mask of app surface exceeds app_style mask range
+
+The app_style command sets how many hops of ghost sites are kept.
+Use a larger value there.
+
+*/
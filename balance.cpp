@@ -0,0 +1,606 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "math.h"
+#include "stdlib.h"
+#include "string.h"
+#include "balance.h"
+#include "app.h"
+#include "app_lattice.h"
+#include "domain.h"
+#include "create_sites.h"
+#include "irregular.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace SPPARKS_NS;
+
+enum{SLAB,RCB};
+enum{UNIFORM,EVENTS,WINDOW};
+
+#define NBIN 1024
+
+/* ---------------------------------------------------------------------- */
+
+Balance::Balance(SPPARKS *spk) : Pointers(spk)
+{
+  MPI_Comm_rank(world,&me);
+  MPI_Comm_size(world,&nprocs);
+
+  applattice = NULL;
+
+  style = RCB;
+  sdim = 2;
+  wflag = UNIFORM;
+  wsite = 1.0;
+  thresh = 1.1;
+  every = 0.0;
+
+  nbox = 0;
+  memory->create(boxlo,nprocs,3,"balance:boxlo");
+  memory->create(boxhi,nprocs,3,"balance:boxhi");
+  memory->create(boxfirst,nprocs,"balance:boxfirst");
+  memory->create(boxnp,nprocs,"balance:boxnp");
+
+  nmax = 0;
+  weight = NULL;
+  sitebox = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Balance::~Balance()
+{
+  memory->destroy(boxlo);
+  memory->destroy(boxhi);
+  memory->destroy(boxfirst);
+  memory->destroy(boxnp);
+  memory->destroy(weight);
+  memory->destroy(sitebox);
+}
+
+/* ----------------------------------------------------------------------
+   repartition sites now
+   if every is set, store a copy of the settings in the app
+     so it rebalances periodically during runs
+------------------------------------------------------------------------- */
+
+void Balance::command(int narg, char **arg)
+{
+  if (app == NULL) error->all(FLERR,"Balance command before app_style set");
+  if (app->appclass != App::LATTICE)
+    error->all(FLERR,"Balance command requires lattice app");
+  if (app->sites_exist == 0)
+    error->all(FLERR,"Balance command before sites exist");
+
+  settings(narg,arg);
+
+  applattice = (AppLattice *) app;
+  if (applattice->maxneigh == 0)
+    error->all(FLERR,"Cannot balance sites without neighbor connectivity");
+  if (!applattice->allow_balance && (!applattice->first_run || every > 0.0))
+    error->all(FLERR,"App does not allow balance after first run");
+
+  // start counting events per site, if not already doing so
+
+  if (wflag == EVENTS && applattice->activity == NULL) {
+    memory->create(applattice->activity,applattice->nmax,"app:activity");
+    for (int i = 0; i < applattice->nmax; i++) applattice->activity[i] = 0.0;
+  }
+
+  // if app has already run, re-initialize it for the new partition
+  // in case next run is invoked with pre no
+
+  if (rebalance(1) && !applattice->first_run) applattice->init();
+
+  delete applattice->balance;
+  applattice->balance = NULL;
+  if (every > 0.0) {
+    applattice->balance = new Balance(spk);
+    applattice->balance->settings(narg,arg);
+    applattice->nextbalance = app->time + every;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Balance::settings(int narg, char **arg)
+{
+  if (narg < 1) error->all(FLERR,"Illegal balance command");
+
+  int iarg = 1;
+  if (strcmp(arg[0],"slab") == 0) {
+    if (narg < 2) error->all(FLERR,"Illegal balance command");
+    style = SLAB;
+    if (strcmp(arg[1],"x") == 0) sdim = 0;
+    else if (strcmp(arg[1],"y") == 0) sdim = 1;
+    else if (strcmp(arg[1],"z") == 0) sdim = 2;
+    else error->all(FLERR,"Illegal balance command");
+    if (sdim == 2 && domain->dimension == 2)
+      error->all(FLERR,"Cannot balance in dimension z for 2d simulation");
+    iarg = 2;
+  } else if (strcmp(arg[0],"rcb") == 0) {
+    style = RCB;
+    iarg = 1;
+  } else error->all(FLERR,"Illegal balance command");
+
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"weight") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal balance command");
+      if (strcmp(arg[iarg+1],"uniform") == 0) {
+	wflag = UNIFORM;
+	wsite = 1.0;
+	iarg += 2;
+      } else if (strcmp(arg[iarg+1],"events") == 0) {
+	if (iarg+3 > narg) error->all(FLERR,"Illegal balance command");
+	wflag = EVENTS;
+	wsite = atof(arg[iarg+2]);
+	if (wsite <= 0.0) error->all(FLERR,"Illegal balance command");
+	iarg += 3;
+      } else if (strcmp(arg[iarg+1],"window") == 0) {
+	if (iarg+3 > narg) error->all(FLERR,"Illegal balance command");
+	wflag = WINDOW;
+	wsite = atof(arg[iarg+2]);
+	if (wsite <= 0.0) error->all(FLERR,"Illegal balance command");
+	iarg += 3;
+      } else error->all(FLERR,"Illegal balance command");
+    } else if (strcmp(arg[iarg],"every") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal balance command");
+      every = atof(arg[iarg+1]);
+      if (every < 0.0) error->all(FLERR,"Illegal balance command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"thresh") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal balance command");
+      thresh = atof(arg[iarg+1]);
+      if (thresh < 1.0) error->all(FLERR,"Illegal balance command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal balance command");
+  }
+}
+
+/* ----------------------------------------------------------------------
+   partition sites by weight and migrate them to their new owners
+   skip if imbalance is below thresh or partition would not improve it
+   event counts used as weights are reset either way
+   flag = 1 to always print a summary, else only if sites moved
+   return 1 if sites moved, else 0
+   caller must re-initialize sets, comm, and app if sites moved
+------------------------------------------------------------------------- */
+
+int Balance::rebalance(int flag)
+{
+  double time1 = MPI_Wtime();
+
+  applattice = (AppLattice *) app;
+  if (applattice->siteseeds)
+    error->all(FLERR,"Cannot balance with sweep color/strict");
+
+  // ndim = # of dims that can be cut
+  // with 2 or 4 sectors, sub-domains cannot be split in y or z, or in z
+
+  ndim = domain->dimension;
+  if (applattice->sectorflag && applattice->nsector_user == 2) ndim = 1;
+  else if (applattice->sectorflag && applattice->nsector_user == 4) ndim = 2;
+  if (style == SLAB && sdim >= ndim)
+    error->all(FLERR,"Balance dimension is incompatible with sectors");
+
+  double before = site_weights();
+  double after = before;
+
+  int *proclist = NULL;
+  bigint nmove = 0;
+
+  if (nprocs > 1 && before > thresh) {
+    partition(min_width());
+
+    // imbalance of new partition
+
+    double *wbox = new double[nprocs];
+    double *wboxall = new double[nprocs];
+    for (int i = 0; i < nprocs; i++) wbox[i] = 0.0;
+    for (int i = 0; i < app->nlocal; i++)
+      wbox[boxfirst[sitebox[i]]] += weight[i];
+    MPI_Allreduce(wbox,wboxall,nprocs,MPI_DOUBLE,MPI_SUM,world);
+
+    double wmax = 0.0;
+    double wsum = 0.0;
+    for (int i = 0; i < nprocs; i++) {
+      wmax = MAX(wmax,wboxall[i]);
+      wsum += wboxall[i];
+    }
+    after = wsum > 0.0 ? wmax/(wsum/nprocs) : 1.0;
+    delete [] wbox;
+    delete [] wboxall;
+
+    if (after < before) {
+      memory->create(proclist,MAX(app->nlocal,1),"balance:proclist");
+      bigint n = 0;
+      for (int i = 0; i < app->nlocal; i++) {
+	proclist[i] = boxfirst[sitebox[i]];
+	if (proclist[i] != me) n++;
+      }
+      MPI_Allreduce(&n,&nmove,1,MPI_SPK_BIGINT,MPI_SUM,world);
+    } else after = before;
+  }
+
+  if (nmove) {
+    migrate(proclist);
+    subdomain();
+  }
+  memory->destroy(proclist);
+
+  double *activity = applattice->activity;
+  if (activity)
+    for (int i = 0; i < app->nlocal; i++) activity[i] = 0.0;
+
+  double time2 = MPI_Wtime();
+
+  if (me == 0 && (flag || nmove)) {
+    if (screen)
+      fprintf(screen,"Balance: imbalance %g -> %g, " BIGINT_FORMAT
+	      " sites moved, %g secs\n",before,after,nmove,time2-time1);
+    if (logfile)
+      fprintf(logfile,"Balance: imbalance %g -> %g, " BIGINT_FORMAT
+	      " sites moved, %g secs\n",before,after,nmove,time2-time1);
+  }
+
+  if (nmove) return 1;
+  return 0;
+}
+
+/* ----------------------------------------------------------------------
+   set weight of each owned site
+   return imbalance = max/avg of per-proc weight
+------------------------------------------------------------------------- */
+
+double Balance::site_weights()
+{
+  int nlocal = app->nlocal;
+  if (nlocal > nmax) {
+    nmax = nlocal;
+    memory->destroy(weight);
+    memory->destroy(sitebox);
+    memory->create(weight,nmax,"balance:weight");
+    memory->create(sitebox,nmax,"balance:sitebox");
+  }
+
+  // sites in the app's rKMC sweep window add unit weight
+
+  double *activity = applattice->activity;
+  char *windowsite = applattice->windowsite;
+  double wme = 0.0;
+  for (int i = 0; i < nlocal; i++) {
+    weight[i] = wsite;
+    if (wflag == EVENTS && activity) weight[i] += activity[i];
+    if (wflag == WINDOW && windowsite) weight[i] += windowsite[i];
+    wme += weight[i];
+  }
+
+  double wmax,wsum;
+  MPI_Allreduce(&wme,&wmax,1,MPI_DOUBLE,MPI_MAX,world);
+  MPI_Allreduce(&wme,&wsum,1,MPI_DOUBLE,MPI_SUM,world);
+  if (wsum == 0.0) return 1.0;
+  return wmax/(wsum/nprocs);
+}
+
+/* ----------------------------------------------------------------------
+   minimum width of a proc sub-domain in any dim
+   each half of a sub-domain (one sector) must be wider than the
+     delevent + delpropensity hops an event influences,
+     so that sectors on adjacent procs are independent
+   hop length = longest owned site to neighbor distance,
+     using minimum image for neighbors across periodic boundaries
+------------------------------------------------------------------------- */
+
+double Balance::min_width()
+{
+  int i,j,jj,d;
+  double delta,rsq;
+
+  double **xyz = app->xyz;
+  int *numneigh = applattice->numneigh;
+  int **neighbor = applattice->neighbor;
+  double prd[3];
+  prd[0] = domain->xprd;
+  prd[1] = domain->yprd;
+  prd[2] = domain->zprd;
+
+  double rsqmax = 0.0;
+  for (i = 0; i < app->nlocal; i++)
+    for (jj = 0; jj < numneigh[i]; jj++) {
+      j = neighbor[i][jj];
+      rsq = 0.0;
+      for (d = 0; d < 3; d++) {
+	delta = xyz[j][d] - xyz[i][d];
+	if (delta > 0.5*prd[d]) delta -= prd[d];
+	else if (delta < -0.5*prd[d]) delta += prd[d];
+	rsq += delta*delta;
+      }
+      rsqmax = MAX(rsqmax,rsq);
+    }
+
+  double rsqmaxall;
+  MPI_Allreduce(&rsqmax,&rsqmaxall,1,MPI_DOUBLE,MPI_MAX,world);
+
+  return 2.0 * (applattice->delpropensity + applattice->delevent) *
+    sqrt(rsqmaxall);
+}
+
+/* ----------------------------------------------------------------------
+   recursive bisection of global box into one box per proc
+   at each level every box with multiple procs is cut in two,
+     with fraction of its weight = fraction of its procs on each side
+   cut is at a bin edge of a histogram of site weights along cut dim
+   SLAB always cuts in sdim, RCB cuts the longest extent of the box
+   all procs compute the same boxes, sitebox = final box of each site
+   minw = minimum box width in any cut dim
+------------------------------------------------------------------------- */
+
+void Balance::partition(double minw)
+{
+  int i,b,k,d,n1,n2,ibin,nlo,nhi;
+
+  int nlocal = app->nlocal;
+  double **xyz = app->xyz;
+
+  nbox = 1;
+  boxlo[0][0] = domain->boxxlo;
+  boxlo[0][1] = domain->boxylo;
+  boxlo[0][2] = domain->boxzlo;
+  boxhi[0][0] = domain->boxxhi;
+  boxhi[0][1] = domain->boxyhi;
+  boxhi[0][2] = domain->boxzhi;
+  boxfirst[0] = 0;
+  boxnp[0] = nprocs;
+  for (i = 0; i < nlocal; i++) sitebox[i] = 0;
+
+  // per-level data for boxes being cut, indexed by split
+
+  int *split = new int[nprocs];
+  int *cutdim = new int[nprocs];
+  int *child = new int[nprocs];
+  double *cut = new double[nprocs];
+
+  while (1) {
+    int nsplit = 0;
+    for (b = 0; b < nbox; b++) {
+      if (boxnp[b] == 1) split[b] = -1;
+      else {
+	cutdim[nsplit] = cut_dim(b,minw);
+	split[b] = nsplit++;
+      }
+    }
+    if (nsplit == 0) break;
+
+    // weight histogram along cut dim of each split box
+
+    double *histo,*histoall;
+    memory->create(histo,nsplit*NBIN,"balance:histo");
+    memory->create(histoall,nsplit*NBIN,"balance:histoall");
+    for (i = 0; i < nsplit*NBIN; i++) histo[i] = 0.0;
+
+    for (i = 0; i < nlocal; i++) {
+      b = sitebox[i];
+      k = split[b];
+      if (k < 0) continue;
+      d = cutdim[k];
+      ibin = static_cast<int>
+	((xyz[i][d]-boxlo[b][d]) / (boxhi[b][d]-boxlo[b][d]) * NBIN);
+      ibin = MAX(ibin,0);
+      ibin = MIN(ibin,NBIN-1);
+      histo[k*NBIN+ibin] += weight[i];
+    }
+
+    MPI_Allreduce(histo,histoall,nsplit*NBIN,MPI_DOUBLE,MPI_SUM,world);
+
+    // cut each split box at bin edge closest to its target weight
+    // nlo,nhi = fewest bins allowed on lower,upper side of cut
+    // upper part becomes a new box
+
+    int nboxold = nbox;
+    for (b = 0; b < nboxold; b++) {
+      k = split[b];
+      if (k < 0) continue;
+      d = cutdim[k];
+      double *h = &histoall[k*NBIN];
+
+      n1 = boxnp[b]/2;
+      n2 = boxnp[b] - n1;
+      double binsize = (boxhi[b][d]-boxlo[b][d]) / NBIN;
+      if (style == SLAB) {
+	nlo = static_cast<int> (ceil(n1*minw/binsize));
+	nhi = static_cast<int> (ceil(n2*minw/binsize));
+      } else nlo = nhi = static_cast<int> (ceil(minw/binsize));
+      nlo = MAX(nlo,1);
+      nhi = MAX(nhi,1);
+      if (nlo + nhi > NBIN)
+	error->all(FLERR,"Balance cannot satisfy minimum sub-domain width");
+
+      double total = 0.0;
+      for (ibin = 0; ibin < NBIN; ibin++) total += h[ibin];
+      double target = total * n1/boxnp[b];
+
+      double sum = 0.0;
+      for (ibin = 0; ibin < NBIN; ibin++) {
+	if (sum + h[ibin] >= target) break;
+	sum += h[ibin];
+      }
+      if (ibin < NBIN && sum + h[ibin] - target < target - sum) ibin++;
+      ibin = MAX(ibin,nlo);
+      ibin = MIN(ibin,NBIN-nhi);
+
+      cut[k] = boxlo[b][d] + ibin*binsize;
+      child[k] = nbox;
+      for (i = 0; i < 3; i++) {
+	boxlo[nbox][i] = boxlo[b][i];
+	boxhi[nbox][i] = boxhi[b][i];
+      }
+      boxlo[nbox][d] = boxhi[b][d] = cut[k];
+      boxfirst[nbox] = boxfirst[b] + n1;
+      boxnp[nbox] = n2;
+      boxnp[b] = n1;
+      nbox++;
+    }
+
+    for (i = 0; i < nlocal; i++) {
+      k = split[sitebox[i]];
+      if (k >= 0 && xyz[i][cutdim[k]] >= cut[k]) sitebox[i] = child[k];
+    }
+
+    memory->destroy(histo);
+    memory->destroy(histoall);
+  }
+
+  delete [] split;
+  delete [] cutdim;
+  delete [] child;
+  delete [] cut;
+}
+
+/* ----------------------------------------------------------------------
+   dim to cut box B in
+   RCB = longest extent, must leave room for a minw box on each side
+------------------------------------------------------------------------- */
+
+int Balance::cut_dim(int b, double minw)
+{
+  if (style == SLAB) return sdim;
+
+  int dmax = -1;
+  double extent,extentmax = 0.0;
+  for (int d = 0; d < ndim; d++) {
+    extent = boxhi[b][d] - boxlo[b][d];
+    if (extent >= 2.0*minw && extent > extentmax) {
+      extentmax = extent;
+      dmax = d;
+    }
+  }
+  if (dmax < 0)
+    error->all(FLERR,"Balance cannot satisfy minimum sub-domain width");
+  return dmax;
+}
+
+/* ----------------------------------------------------------------------
+   send each owned site to proc in proclist
+   datum = ID, coords, global IDs of neighbors, per-site values
+   received sites replace all owned and ghost sites,
+     ghosts are then rebuilt from connectivity as read_sites does
+------------------------------------------------------------------------- */
+
+void Balance::migrate(int *proclist)
+{
+  int i,j,m;
+
+  int nlocal = app->nlocal;
+  int ninteger = app->ninteger;
+  int ndouble = app->ndouble;
+  int maxneigh = applattice->maxneigh;
+  int nper = 5 + maxneigh + ninteger + ndouble;
+
+  tagint *id = app->id;
+  double **xyz = app->xyz;
+  int **iarray = app->iarray;
+  double **darray = app->darray;
+  int *numneigh = applattice->numneigh;
+  int **neighbor = applattice->neighbor;
+
+  double *sbuf;
+  memory->create(sbuf,MAX(nlocal,1)*nper,"balance:sbuf");
+
+  m = 0;
+  for (i = 0; i < nlocal; i++) {
+    sbuf[m++] = id[i];
+    sbuf[m++] = xyz[i][0];
+    sbuf[m++] = xyz[i][1];
+    sbuf[m++] = xyz[i][2];
+    sbuf[m++] = numneigh[i];
+    for (j = 0; j < numneigh[i]; j++) sbuf[m++] = id[neighbor[i][j]];
+    for (; j < maxneigh; j++) sbuf[m++] = 0.0;
+    for (j = 0; j < ninteger; j++) sbuf[m++] = iarray[j][i];
+    for (j = 0; j < ndouble; j++) sbuf[m++] = darray[j][i];
+  }
+
+  Irregular *irregular = new Irregular(spk);
+  int nrecv = irregular->create_data(nlocal,proclist,1);
+  double *rbuf;
+  memory->create(rbuf,MAX(nrecv,1)*nper,"balance:rbuf");
+  irregular->exchange_data((char *) sbuf,nper*sizeof(double),(char *) rbuf);
+  irregular->destroy_data();
+  delete irregular;
+  memory->destroy(sbuf);
+
+  // replace owned sites with received sites, discard ghosts
+  // neighbor temporarily stores global IDs, as after read_sites
+  // add_site() may realloc per-site arrays
+
+  applattice->nlocal = 0;
+  applattice->nghost = 0;
+
+  m = 0;
+  for (i = 0; i < nrecv; i++) {
+    tagint idsite = static_cast<tagint> (rbuf[m]);
+    applattice->add_site(idsite,rbuf[m+1],rbuf[m+2],rbuf[m+3]);
+    m += 4;
+    numneigh = applattice->numneigh;
+    neighbor = applattice->neighbor;
+    numneigh[i] = static_cast<int> (rbuf[m++]);
+    for (j = 0; j < maxneigh; j++)
+      neighbor[i][j] = static_cast<int> (rbuf[m++]);
+    for (j = 0; j < ninteger; j++)
+      app->iarray[j][i] = static_cast<int> (rbuf[m++]);
+    for (j = 0; j < ndouble; j++) app->darray[j][i] = rbuf[m++];
+  }
+
+  memory->destroy(rbuf);
+
+  CreateSites *cs = new CreateSites(spk);
+  cs->read_sites(applattice);
+  cs->ghosts_from_connectivity(applattice,applattice->delpropensity);
+  delete cs;
+
+  // mask is sized by owned + ghost sites, init() recreates it
+
+  memory->destroy(applattice->mask);
+  applattice->mask = NULL;
+}
+
+/* ----------------------------------------------------------------------
+   reset my sub-domain to my box
+   procgrid = # of distinct box boundaries in each dim,
+     so AppLattice::init() can check sectors against the new partition
+------------------------------------------------------------------------- */
+
+void Balance::subdomain()
+{
+  int b,c,d;
+
+  for (b = 0; b < nbox; b++)
+    if (boxfirst[b] == me) break;
+
+  domain->subxlo = boxlo[b][0];
+  domain->subxhi = boxhi[b][0];
+  domain->subylo = boxlo[b][1];
+  domain->subyhi = boxhi[b][1];
+  domain->subzlo = boxlo[b][2];
+  domain->subzhi = boxhi[b][2];
+
+  for (d = 0; d < 3; d++) {
+    domain->procgrid[d] = 0;
+    for (b = 0; b < nbox; b++) {
+      for (c = 0; c < b; c++)
+	if (boxlo[c][d] == boxlo[b][d]) break;
+      if (c == b) domain->procgrid[d]++;
+    }
+  }
+}
@@ -0,0 +1,122 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#ifdef COMMAND_CLASS
+CommandStyle(balance,Balance)
+
+#else
+
+#ifndef SPK_BALANCE_H
+#define SPK_BALANCE_H
+
+#include "pointers.h"
+
+namespace SPPARKS_NS {
+
+class Balance : protected Pointers {
+ public:
+  double every;               // time between rebalances in a run, 0 = none
+
+  Balance(class SPPARKS *);
+  ~Balance();
+  void command(int, char **);
+  void settings(int, char **);
+  int rebalance(int);
+
+ private:
+  int me,nprocs;
+  class AppLattice *applattice;
+
+  int style;                  // SLAB or RCB
+  int sdim;                   // cut dimension for SLAB
+  int ndim;                   // # of dims that can be cut
+  int wflag;                  // UNIFORM or EVENTS or WINDOW
+  double wsite;               // weight of site with no events or
+                              //   outside the sweep window
+  double thresh;              // rebalance if max/avg weight exceeds this
+
+  int nbox;                   // # of boxes in partition, nprocs when done
+  double **boxlo,**boxhi;     // bounds of each box
+  int *boxfirst,*boxnp;       // 1st proc and # of procs assigned to box
+
+  int nmax;                   // allocated size of per-site arrays
+  double *weight;             // weight of each owned site
+  int *sitebox;               // box each owned site is in
+
+  double site_weights();
+  double min_width();
+  void partition(double);
+  int cut_dim(int, double);
+  void migrate(int *);
+  void subdomain();
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running SPPARKS to see the offending
+line.
+
+E: Balance command before app_style set
+
+Self-explanatory.
+
+E: Balance command requires lattice app
+
+Self-explanatory.
+
+E: Balance command before sites exist
+
+Sites must be created via the create_sites or read_sites command
+before they can be repartitioned.
+
+E: Cannot balance sites without neighbor connectivity
+
+Migrated sites carry their neighbor lists so that ghost sites can be
+rebuilt.  The app must store neighbors for each site.
+
+E: Cannot balance with sweep color/strict
+
+Per-site random number seeds are not migrated with their sites.
+
+E: App does not allow balance after first run
+
+Apps allocate per-site data structures when a run is first set up.
+Only apps that reallocate them when their # of owned sites changes,
+currently ald and ald/zno, can be rebalanced between or during runs.
+
+E: Cannot balance in dimension z for 2d simulation
+
+Self-explanatory.
+
+E: Balance dimension is incompatible with sectors
+
+With 2 sectors processor sub-domains can only be cut in x, with 4
+sectors only in x and y.
+
+E: Balance cannot satisfy minimum sub-domain width
+
+Each processor sub-domain must be at least twice as wide as the range
+of an event plus the propensity updates it causes, so that sectors on
+neighboring processors do not interact.  Use fewer processors or
+choose a different balance style or dimension.
+
+*/
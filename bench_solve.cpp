@@ -0,0 +1,409 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "math.h"
+#include "stdlib.h"
+#include "string.h"
+#include "bench_solve.h"
+#include "solve.h"
+#include "random_mars.h"
+#include "random_park.h"
+#include "memory.h"
+#include "error.h"
+
+#include "style_solve.h"
+
+using namespace SPPARKS_NS;
+
+#define EPSILON 1.0e-10
+#define NBIN 64
+#define MINEXPECT 5.0
+
+/* ---------------------------------------------------------------------- */
+
+BenchSolve::BenchSolve(SPPARKS *spk) : Pointers(spk)
+{
+  fp = NULL;
+  random = NULL;
+  nstyle = 0;
+  styles = NULL;
+  events = range = fanout = ratio = NULL;
+  propensity = NULL;
+  deps = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+BenchSolve::~BenchSolve()
+{
+  if (fp) fclose(fp);
+  delete random;
+  for (int i = 0; i < nstyle; i++) delete [] styles[i];
+  memory->sfree(styles);
+  memory->destroy(events);
+  memory->destroy(range);
+  memory->destroy(fanout);
+  memory->destroy(ratio);
+  memory->destroy(propensity);
+  memory->destroy(deps);
+}
+
+/* ----------------------------------------------------------------------
+   benchmark every requested solve style on synthetic event sets
+   in the spirit of app_style test/group:
+     propensities log-uniform between pmin and pmin*range
+     each selected event and 1 to fanout random dependents get new
+       propensities tweaked by up to +/- tweak percent
+   each combination of events/range/fanout/ratio is one CSV line
+------------------------------------------------------------------------- */
+
+void BenchSolve::command(int narg, char **arg)
+{
+  if (narg < 1) error->all(FLERR,"Illegal bench_solve command");
+
+  int nprocs;
+  MPI_Comm_size(world,&nprocs);
+  if (nprocs > 1)
+    error->all(FLERR,"Bench_solve command requires a single processor");
+
+  // defaults
+
+  nevents = nrange = nfanout = nratio = 1;
+  memory->create(events,1,"bench:events");
+  memory->create(range,1,"bench:range");
+  memory->create(fanout,1,"bench:fanout");
+  memory->create(ratio,1,"bench:ratio");
+  events[0] = 10000;
+  range[0] = 1.0e3;
+  fanout[0] = 8;
+  ratio[0] = 1.0;
+  nstep = 100000;
+  nsample = 100000;
+  tweak = 10.0;
+  int appendflag = 0;
+
+  int iarg = 1;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"styles") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal bench_solve command");
+      int n = atoi(arg[iarg+1]);
+      if (n < 1 || iarg+2+n > narg)
+	error->all(FLERR,"Illegal bench_solve command");
+      for (int i = 0; i < n; i++) add_style(arg[iarg+2+i]);
+      iarg += 2+n;
+    } else if (strcmp(arg[iarg],"events") == 0) {
+      iarg = read_list(iarg,narg,arg,events,nevents);
+    } else if (strcmp(arg[iarg],"range") == 0) {
+      iarg = read_list(iarg,narg,arg,range,nrange);
+    } else if (strcmp(arg[iarg],"fanout") == 0) {
+      iarg = read_list(iarg,narg,arg,fanout,nfanout);
+    } else if (strcmp(arg[iarg],"ratio") == 0) {
+      iarg = read_list(iarg,narg,arg,ratio,nratio);
+    } else if (strcmp(arg[iarg],"nstep") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal bench_solve command");
+      nstep = atoi(arg[iarg+1]);
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"nsample") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal bench_solve command");
+      nsample = atoi(arg[iarg+1]);
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"tweak") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal bench_solve command");
+      tweak = atof(arg[iarg+1]);
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"append") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal bench_solve command");
+      if (strcmp(arg[iarg+1],"yes") == 0) appendflag = 1;
+      else if (strcmp(arg[iarg+1],"no") == 0) appendflag = 0;
+      else error->all(FLERR,"Illegal bench_solve command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal bench_solve command");
+  }
+
+  if (nstep <= 0 || nsample < 0 || tweak < 0.0 || tweak >= 100.0)
+    error->all(FLERR,"Illegal bench_solve command");
+  for (int i = 0; i < nevents; i++)
+    if (events[i] < 1.0) error->all(FLERR,"Illegal bench_solve command");
+  for (int i = 0; i < nrange; i++)
+    if (range[i] <= 1.0) error->all(FLERR,"Illegal bench_solve command");
+  for (int i = 0; i < nfanout; i++)
+    if (fanout[i] < 0.0) error->all(FLERR,"Illegal bench_solve command");
+  for (int i = 0; i < nratio; i++)
+    if (ratio[i] < 0.0) error->all(FLERR,"Illegal bench_solve command");
+  tweak = 2.0*tweak / 100.0;
+
+  // default = all solve styles compiled into SPPARKS
+
+  if (nstyle == 0) {
+#define SOLVE_CLASS
+#define SolveStyle(key,Class) add_style(#key);
+#include "style_solve.h"
+#undef SOLVE_CLASS
+#undef SolveStyle
+  }
+
+  fp = fopen(arg[0],appendflag ? "a" : "w");
+  if (!fp) error->one(FLERR,"Cannot open bench_solve output file");
+  if (!appendflag)
+    fprintf(fp,"style,events,range,fanout,ratio,nstep,events_per_s,"
+	    "ns_per_select,ns_per_update,memory_bytes,chi2,dof,chi2_z\n");
+
+  random = new RandomPark(ranmaster->uniform());
+
+  for (int istyle = 0; istyle < nstyle; istyle++)
+    for (int ie = 0; ie < nevents; ie++)
+      for (int ir = 0; ir < nrange; ir++)
+	for (int ifan = 0; ifan < nfanout; ifan++)
+	  for (int iq = 0; iq < nratio; iq++)
+	    run(styles[istyle],static_cast<int> (events[ie]),range[ir],
+		static_cast<int> (fanout[ifan]),ratio[iq]);
+
+  fclose(fp);
+  fp = NULL;
+}
+
+/* ----------------------------------------------------------------------
+   one benchmark case
+   1st loop times selections only
+   2nd loop times updates only, a selected event plus its dependents
+   3rd loop times ratio update batches per selection, as a KMC app would
+   then checks selection frequencies against the final propensities
+------------------------------------------------------------------------- */
+
+void BenchSolve::run(char *style, int n, double prange, int nfan, double q)
+{
+  int i,m,nupdate;
+  double dt;
+
+  pmin = 1.0;
+  pmax = prange*(1.0 - EPSILON);
+
+  memory->destroy(propensity);
+  memory->destroy(deps);
+  memory->create(propensity,n,"bench:propensity");
+  memory->create(deps,nfan+1,"bench:deps");
+
+  double interval = log(pmax/pmin) / log(2.0);
+  for (m = 0; m < n; m++) {
+    double p = pmax * pow(2.0,-random->uniform()*interval);
+    p = MIN(p,pmax);
+    p = MAX(p,pmin);
+    propensity[m] = p;
+  }
+
+  Solve *solve = create_solve(style);
+  solve->init(n,propensity);
+  bigint bytes = solve->memory_usage();
+
+  // selection only
+
+  double t0 = MPI_Wtime();
+  for (i = 0; i < nstep; i++) solve->event(&dt);
+  double tselect = MPI_Wtime() - t0;
+
+  // updates only
+
+  bigint nupdated = 0;
+  t0 = MPI_Wtime();
+  for (i = 0; i < nstep; i++) {
+    m = static_cast<int> (n*random->uniform());
+    nupdate = random_deps(m,n,nfan);
+    solve->update(nupdate,deps,propensity);
+    nupdated += nupdate;
+  }
+  double tupdate = MPI_Wtime() - t0;
+
+  // mixed, ratio = update batches per selection
+
+  double credit = 0.0;
+  t0 = MPI_Wtime();
+  for (i = 0; i < nstep; i++) {
+    m = solve->event(&dt);
+    if (m < 0) break;
+    credit += q;
+    while (credit >= 1.0) {
+      nupdate = random_deps(m,n,nfan);
+      solve->update(nupdate,deps,propensity);
+      credit -= 1.0;
+    }
+  }
+  double tmixed = MPI_Wtime() - t0;
+
+  int dof = 0;
+  double chi2 = chi_squared(solve,n,dof);
+  double z = dof ? (chi2-dof)/sqrt(2.0*dof) : 0.0;
+
+  delete solve;
+
+  double rate = tmixed > 0.0 ? nstep/tmixed : 0.0;
+  double nsselect = 1.0e9*tselect/nstep;
+  double nsupdate = nupdated ? 1.0e9*tupdate/nupdated : 0.0;
+
+  fprintf(fp,"%s,%d,%g,%d,%g,%d,%g,%g,%g," BIGINT_FORMAT ",%g,%d,%g\n",
+	  style,n,prange,nfan,q,nstep,rate,nsselect,nsupdate,bytes,chi2,dof,z);
+  fflush(fp);
+
+  if (screen)
+    fprintf(screen,"bench_solve %s events %d range %g fanout %d ratio %g: "
+	    "%g events/s, %g ns/select, %g ns/update, chi2 z %g\n",
+	    style,n,prange,nfan,q,rate,nsselect,nsupdate,z);
+  if (logfile)
+    fprintf(logfile,"bench_solve %s events %d range %g fanout %d ratio %g: "
+	    "%g events/s, %g ns/select, %g ns/update, chi2 z %g\n",
+	    style,n,prange,nfan,q,rate,nsselect,nsupdate,z);
+}
+
+/* ----------------------------------------------------------------------
+   selected event M plus 1 to nfan random dependents get new propensities
+   return # of entries stored in deps
+------------------------------------------------------------------------- */
+
+int BenchSolve::random_deps(int m, int n, int nfan)
+{
+  int ndep = 0;
+  deps[ndep++] = m;
+  propensity[m] = new_propensity(m);
+
+  if (nfan == 0) return ndep;
+  int nextra = static_cast<int> (nfan*random->uniform()) + 1;
+  for (int k = 0; k < nextra; k++) {
+    int j = static_cast<int> (n*random->uniform());
+    if (j == m) continue;
+    propensity[j] = new_propensity(j);
+    deps[ndep++] = j;
+  }
+  return ndep;
+}
+
+/* ---------------------------------------------------------------------- */
+
+double BenchSolve::new_propensity(int m)
+{
+  double p = propensity[m];
+  p += p*tweak*(random->uniform()-0.5);
+  p = MIN(p,pmax);
+  p = MAX(p,pmin);
+  return p;
+}
+
+/* ----------------------------------------------------------------------
+   chi-squared of nsample selections vs current propensities
+   events are binned by index into NBIN contiguous bins,
+   bins with expected count < MINEXPECT are merged with the next bin
+   return chi2 and degrees of freedom
+------------------------------------------------------------------------- */
+
+double BenchSolve::chi_squared(Solve *solve, int n, int &dof)
+{
+  dof = 0;
+  if (nsample == 0) return 0.0;
+
+  int nbin = MIN(n,NBIN);
+  double *expect = new double[nbin];
+  bigint *observe = new bigint[nbin];
+
+  double total = 0.0;
+  for (int m = 0; m < n; m++) total += propensity[m];
+  for (int b = 0; b < nbin; b++) {
+    expect[b] = 0.0;
+    observe[b] = 0;
+  }
+  for (int m = 0; m < n; m++)
+    expect[(bigint) m*nbin/n] += nsample*propensity[m]/total;
+
+  double dt;
+  for (int i = 0; i < nsample; i++) {
+    int m = solve->event(&dt);
+    if (m < 0) break;
+    observe[(bigint) m*nbin/n]++;
+  }
+
+  double chi2 = 0.0;
+  double e = 0.0;
+  double o = 0.0;
+  int ncell = 0;
+  for (int b = 0; b < nbin; b++) {
+    e += expect[b];
+    o += observe[b];
+    if (e < MINEXPECT && b < nbin-1) continue;
+    chi2 += (o-e)*(o-e)/e;
+    ncell++;
+    e = o = 0.0;
+  }
+  dof = ncell - 1;
+
+  delete [] expect;
+  delete [] observe;
+  return chi2;
+}
+
+/* ----------------------------------------------------------------------
+   create instance of a solve style
+   group style needs propensity bounds, others take no args
+------------------------------------------------------------------------- */
+
+Solve *BenchSolve::create_solve(char *style)
+{
+  char shi[32],slo[32];
+  char *arg[3];
+  int narg = 1;
+  arg[0] = style;
+  if (strcmp(style,"group") == 0) {
+    sprintf(shi,"%.17g",pmax);
+    sprintf(slo,"%.17g",pmin);
+    arg[1] = shi;
+    arg[2] = slo;
+    narg = 3;
+  }
+
+  if (0) return NULL;
+
+#define SOLVE_CLASS
+#define SolveStyle(key,Class) \
+  else if (strcmp(style,#key) == 0) return new Class(spk,narg,arg);
+#include "style_solve.h"
+#undef SOLVE_CLASS
+
+  error->all(FLERR,"Invalid solve style in bench_solve command");
+  return NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void BenchSolve::add_style(const char *name)
+{
+  styles = (char **)
+    memory->srealloc(styles,(nstyle+1)*sizeof(char *),"bench:styles");
+  int n = strlen(name) + 1;
+  styles[nstyle] = new char[n];
+  strcpy(styles[nstyle],name);
+  nstyle++;
+}
+
+/* ----------------------------------------------------------------------
+   keyword N v1 ... vN, replace list with the N values
+   return index of next arg
+------------------------------------------------------------------------- */
+
+int BenchSolve::read_list(int iarg, int narg, char **arg,
+			  double *&list, int &n)
+{
+  if (iarg+2 > narg) error->all(FLERR,"Illegal bench_solve command");
+  n = atoi(arg[iarg+1]);
+  if (n < 1 || iarg+2+n > narg) error->all(FLERR,"Illegal bench_solve command");
+  memory->destroy(list);
+  memory->create(list,n,"bench:list");
+  for (int i = 0; i < n; i++) list[i] = atof(arg[iarg+2+i]);
+  return iarg+2+n;
+}
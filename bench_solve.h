@@ -0,0 +1,84 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#ifdef COMMAND_CLASS
+CommandStyle(bench_solve,BenchSolve)
+
+#else
+
+#ifndef SPK_BENCH_SOLVE_H
+#define SPK_BENCH_SOLVE_H
+
+#include "stdio.h"
+#include "pointers.h"
+
+namespace SPPARKS_NS {
+
+class BenchSolve : protected Pointers {
+ public:
+  BenchSolve(class SPPARKS *);
+  ~BenchSolve();
+  void command(int, char **);
+
+ private:
+  FILE *fp;
+  class RandomPark *random;
+
+  int nstyle;                 // solve styles to benchmark
+  char **styles;
+  int nevents,nrange,nfanout,nratio;
+  double *events,*range,*fanout,*ratio;  // sweep values of each parameter
+  int nstep;                  // selections per timed loop
+  int nsample;                // selections for chi-squared check
+
+  double *propensity;         // propensity of each synthetic event
+  int *deps;                  // one list of dependent events
+  double pmax,pmin,tweak;
+
+  void add_style(const char *);
+  int read_list(int, int, char **, double *&, int &);
+  class Solve *create_solve(char *);
+  void run(char *, int, double, int, double);
+  double new_propensity(int);
+  int random_deps(int, int, int);
+  double chi_squared(class Solve *, int, int &);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running SPPARKS to see the offending
+line.
+
+E: Bench_solve command requires a single processor
+
+The benchmark times per-processor solver operations and should not
+compete with other processes.
+
+E: Cannot open bench_solve output file
+
+Self-explanatory.
+
+E: Invalid solve style in bench_solve command
+
+The style must be one of the solve styles compiled into SPPARKS.
+
+*/
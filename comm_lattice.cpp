@@ -110,19 +110,26 @@ void CommLattice::init(int nsector_request, int delpropensity, int delevent,
   allswap = create_swap_all();
   reverseswap = create_swap_all_reverse();
 
+  // each sector swap has its own message tag,
+  //   so receives for one can be posted while another is in progress
+
   nsector = nsector_request;
   if (nsector > 1) {
     sectorswap = new Swap*[nsector];
-    for (int i = 0; i < nsector; i++)
+    for (int i = 0; i < nsector; i++) {
       sectorswap[i] = create_swap_sector(applattice->set[i].nlocal,
 					 applattice->set[i].site2i);
+      sectorswap[i]->tag = 1 + i;
+    }
   }
   if (delreverse && nsector > 1) {
     sectorreverseswap = new Swap*[nsector];
-    for (int i = 0; i < nsector; i++)
+    for (int i = 0; i < nsector; i++) {
       sectorreverseswap[i] = 
 	create_swap_sector_reverse(applattice->set[i].nlocal,
 				   applattice->set[i].site2i);
+      sectorreverseswap[i]->tag = 1 + nsector + i;
+    }
   }
 }
 
@@ -164,6 +171,28 @@ void CommLattice::sector(int isector)
   else perform_swap_general(sectorswap[isector]);
 }
 
+/* ----------------------------------------------------------------------
+   post receives for ghost values of one sector ahead of sector()
+   lets neighbor procs send as soon as their values are final,
+     without waiting for this proc to finish its current sector
+------------------------------------------------------------------------- */
+
+void CommLattice::sector_post(int isector)
+{
+  post_recv(sectorswap[isector]);
+}
+
+/* ----------------------------------------------------------------------
+   post receives for changed border values of one sector
+     ahead of reverse_sector()
+------------------------------------------------------------------------- */
+
+void CommLattice::reverse_sector_post(int isector)
+{
+  if (delreverse == 0) return;
+  post_recv(sectorreverseswap[isector]);
+}
+
 /* ----------------------------------------------------------------------
    reverse communicate changed border values for one sector
 ------------------------------------------------------------------------- */
@@ -216,6 +245,8 @@ CommLattice::Swap *CommLattice::create_swap_all()
   // create swap based on list of recvs
 
   Swap *swap = new Swap;
+  swap->tag = 0;
+  swap->posted = 0;
 
   create_send_from_recv(nsite,maxsite,buf,swap);
   create_recv_from_list(nsite,buf,swap);
@@ -290,6 +321,8 @@ CommLattice::Swap *CommLattice::create_swap_all_reverse()
   // create swap based on list of sends
 
   Swap *swap = new Swap;
+  swap->tag = 0;
+  swap->posted = 0;
 
   create_send_from_list(nsite,buf,swap);
   create_recv_from_send(nsite,maxsite,buf,swap);
@@ -363,6 +396,8 @@ CommLattice::Swap *CommLattice::create_swap_sector(int nsites, int *site2i)
   // create swap based on list of recvs
 
   Swap *swap = new Swap;
+  swap->tag = 0;
+  swap->posted = 0;
 
   create_send_from_recv(nsite,maxsite,buf,swap);
   create_recv_from_list(nsite,buf,swap);
@@ -438,6 +473,8 @@ CommLattice::Swap *CommLattice::create_swap_sector_reverse(int nsites,
   // create swap based on list of sends
 
   Swap *swap = new Swap;
+  swap->tag = 0;
+  swap->posted = 0;
 
   create_send_from_list(nsite,buf,swap);
   create_recv_from_send(nsite,maxsite,buf,swap);
@@ -900,6 +937,93 @@ void CommLattice::free_swap(Swap *swap)
   delete swap;
 }
 
+/* ----------------------------------------------------------------------
+   acquire ghost values of a single double column N for entire sub-domain
+   split into start/finish so caller can compute on owned sites between
+------------------------------------------------------------------------- */
+
+void CommLattice::all_double(int n)
+{
+  all_double_start(n);
+  all_double_finish(n);
+}
+
+/* ----------------------------------------------------------------------
+   post receives and send owned values of darray[N]
+   recv buffers are sized for all per-site values, so 1 value always fits
+------------------------------------------------------------------------- */
+
+void CommLattice::all_double_start(int n)
+{
+  int i,j;
+  int *index;
+  double *buf,*vector;
+
+  Swap *swap = allswap;
+
+  for (i = 0; i < swap->nrecv; i++)
+    MPI_Irecv(swap->rdbuf[i],swap->rcount[i],MPI_DOUBLE,
+	      swap->rproc[i],0,world,&swap->request[i]);
+
+  vector = darray[n];
+  for (i = 0; i < swap->nsend; i++) {
+    index = swap->sindex[i];
+    buf = swap->sdbuf;
+    for (j = 0; j < swap->scount[i]; j++) buf[j] = vector[index[j]];
+    MPI_Send(buf,swap->scount[i],MPI_DOUBLE,swap->sproc[i],0,world);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   wait on receives posted by all_double_start() and unpack into darray[N]
+------------------------------------------------------------------------- */
+
+void CommLattice::all_double_finish(int n)
+{
+  int i,j;
+  int *index;
+  double *buf,*vector;
+
+  Swap *swap = allswap;
+
+  if (swap->nrecv) MPI_Waitall(swap->nrecv,swap->request,swap->status);
+
+  vector = darray[n];
+  for (i = 0; i < swap->nrecv; i++) {
+    index = swap->rindex[i];
+    buf = swap->rdbuf[i];
+    for (j = 0; j < swap->rcount[i]; j++) vector[index[j]] = buf[j];
+  }
+}
+
+/* ----------------------------------------------------------------------
+   post receives of a Swap unless already posted
+   message length and datatype match the perform_swap method for the data
+------------------------------------------------------------------------- */
+
+void CommLattice::post_recv(Swap *swap)
+{
+  if (swap->posted) return;
+
+  int ntotal = ninteger + ndouble;
+  for (int i = 0; i < swap->nrecv; i++) {
+    if (site_only)
+      MPI_Irecv(swap->ribuf[i],swap->rcount[i],MPI_INT,
+		swap->rproc[i],swap->tag,world,&swap->request[i]);
+    else if (ndouble == 0)
+      MPI_Irecv(swap->ribuf[i],ninteger*swap->rcount[i],MPI_INT,
+		swap->rproc[i],swap->tag,world,&swap->request[i]);
+    else if (ninteger == 0)
+      MPI_Irecv(swap->rdbuf[i],ndouble*swap->rcount[i],MPI_DOUBLE,
+		swap->rproc[i],swap->tag,world,&swap->request[i]);
+    else
+      MPI_Irecv(swap->rdbuf[i],ntotal*swap->rcount[i],MPI_DOUBLE,
+		swap->rproc[i],swap->tag,world,&swap->request[i]);
+  }
+
+  swap->posted = 1;
+}
+
 /* ----------------------------------------------------------------------
    communicate site values via Swap instructions
    use site array = iarray[0] as source/destination
@@ -911,11 +1035,9 @@ void CommLattice::perform_swap_site(Swap *swap)
   int *index;
   int *buf;
 
-  // post receives
+  // post receives, if not already done by caller
 
-  for (i = 0; i < swap->nrecv; i++)
-    MPI_Irecv(swap->ribuf[i],swap->rcount[i],MPI_INT,swap->rproc[i],0,world,
-	      &swap->request[i]);
+  post_recv(swap);
 
   // pack data to send to each proc and send it
 
@@ -924,12 +1046,13 @@ void CommLattice::perform_swap_site(Swap *swap)
     buf = swap->sibuf;
     for (j = 0; j < swap->scount[i]; j++)
       buf[j] = site[index[j]];
-    MPI_Send(buf,swap->scount[i],MPI_INT,swap->sproc[i],0,world);
+    MPI_Send(buf,swap->scount[i],MPI_INT,swap->sproc[i],swap->tag,world);
   }
 
   // wait on incoming messages
 
   if (swap->nrecv) MPI_Waitall(swap->nrecv,swap->request,swap->status);
+  swap->posted = 0;
 
   // unpack received buffers of data from each proc
 
@@ -951,11 +1074,9 @@ void CommLattice::perform_swap_int(Swap *swap)
   int i,j,m,n;
   int *index,*buf,*vector;
 
-  // post receives
+  // post receives, if not already done by caller
 
-  for (i = 0; i < swap->nrecv; i++)
-    MPI_Irecv(swap->ribuf[i],ninteger*swap->rcount[i],MPI_INT,
-	      swap->rproc[i],0,world,&swap->request[i]);
+  post_recv(swap);
 
   // pack data to send to each proc and send it
 
@@ -967,12 +1088,14 @@ void CommLattice::perform_swap_int(Swap *swap)
       vector = iarray[n];
       for (j = 0; j < swap->scount[i]; j++) buf[m++] = vector[index[j]];
     }
-    MPI_Send(buf,ninteger*swap->scount[i],MPI_INT,swap->sproc[i],0,world);
+    MPI_Send(buf,ninteger*swap->scount[i],MPI_INT,swap->sproc[i],swap->tag,
+	     world);
   }
 
   // wait on incoming messages
 
   if (swap->nrecv) MPI_Waitall(swap->nrecv,swap->request,swap->status);
+  swap->posted = 0;
 
   // unpack received buffers of data from each proc
 
@@ -998,11 +1121,9 @@ void CommLattice::perform_swap_double(Swap *swap)
   int *index;
   double *buf,*vector;
 
-  // post receives
+  // post receives, if not already done by caller
 
-  for (i = 0; i < swap->nrecv; i++)
-    MPI_Irecv(swap->rdbuf[i],ndouble*swap->rcount[i],MPI_DOUBLE,
-	      swap->rproc[i],0,world,&swap->request[i]);
+  post_recv(swap);
 
   // pack data to send to each proc and send it
 
@@ -1014,12 +1135,14 @@ void CommLattice::perform_swap_double(Swap *swap)
       vector = darray[n];
       for (j = 0; j < swap->scount[i]; j++) buf[m++] = vector[index[j]];
     }
-    MPI_Send(buf,ndouble*swap->scount[i],MPI_DOUBLE,swap->sproc[i],0,world);
+    MPI_Send(buf,ndouble*swap->scount[i],MPI_DOUBLE,swap->sproc[i],swap->tag,
+	     world);
   }
 
   // wait on incoming messages
 
   if (swap->nrecv) MPI_Waitall(swap->nrecv,swap->request,swap->status);
+  swap->posted = 0;
 
   // unpack received buffers of data from each proc
 
@@ -1045,12 +1168,10 @@ void CommLattice::perform_swap_general(Swap *swap)
   int *index,*ivector;
   double *buf,*dvector;
 
-  // post receives
+  // post receives, if not already done by caller
 
   int ntotal = ninteger + ndouble;
-  for (i = 0; i < swap->nrecv; i++)
-    MPI_Irecv(swap->rdbuf[i],ntotal*swap->rcount[i],MPI_DOUBLE,
-	      swap->rproc[i],0,world,&swap->request[i]);
+  post_recv(swap);
 
   // pack data to send to each proc and send it
 
@@ -1066,12 +1187,14 @@ void CommLattice::perform_swap_general(Swap *swap)
       dvector = darray[n];
       for (j = 0; j < swap->scount[i]; j++) buf[m++] = dvector[index[j]];
     }
-    MPI_Send(buf,ntotal*swap->scount[i],MPI_DOUBLE,swap->sproc[i],0,world);
+    MPI_Send(buf,ntotal*swap->scount[i],MPI_DOUBLE,swap->sproc[i],swap->tag,
+	     world);
   }
 
   // wait on incoming messages
 
   if (swap->nrecv) MPI_Waitall(swap->nrecv,swap->request,swap->status);
+  swap->posted = 0;
 
   // unpack received buffers of data from each proc
 
@@ -1090,3 +1213,56 @@ void CommLattice::perform_swap_general(Swap *swap)
     }
   }
 }
+
+/* ----------------------------------------------------------------------
+   return # of bytes of allocated memory in all Swap patterns
+------------------------------------------------------------------------- */
+
+bigint CommLattice::memory_usage()
+{
+  bigint bytes = 0;
+  if (allswap) bytes += memory_usage_swap(allswap);
+  if (reverseswap) bytes += memory_usage_swap(reverseswap);
+  if (sectorswap)
+    for (int i = 0; i < nsector; i++)
+      bytes += memory_usage_swap(sectorswap[i]);
+  if (sectorreverseswap)
+    for (int i = 0; i < nsector; i++)
+      bytes += memory_usage_swap(sectorreverseswap[i]);
+  return bytes;
+}
+
+/* ----------------------------------------------------------------------
+   return # of bytes of allocated memory in one Swap pattern
+   send/recv buffer size per site depends on ints and doubles per site
+------------------------------------------------------------------------- */
+
+bigint CommLattice::memory_usage_swap(Swap *swap)
+{
+  int persite;
+  if (site_only) persite = sizeof(int);
+  else if (ndouble == 0) persite = ninteger*sizeof(int);
+  else if (ninteger == 0) persite = ndouble*sizeof(double);
+  else persite = (ninteger+ndouble)*sizeof(double);
+
+  bigint bytes = sizeof(Swap);
+
+  int max = 0;
+  bytes += 3*nprocs * sizeof(int);                  // sproc,scount,smax
+  bytes += nprocs * sizeof(int *);                  // sindex
+  for (int i = 0; i < swap->nsend; i++) {
+    bytes += (bigint) swap->smax[i] * sizeof(int);
+    max = MAX(max,swap->scount[i]);
+  }
+  bytes += (bigint) max * persite;                  // sibuf or sdbuf
+
+  bytes += 3*nprocs * sizeof(int);                  // rproc,rcount,rmax
+  bytes += 3*nprocs * sizeof(int *);                // rindex,ribuf,rdbuf
+  for (int i = 0; i < swap->nrecv; i++) {
+    bytes += (bigint) swap->rmax[i] * sizeof(int);
+    bytes += (bigint) swap->rcount[i] * persite;    // ribuf or rdbuf
+  }
+  bytes += swap->nrecv * (sizeof(MPI_Request) + sizeof(MPI_Status));
+
+  return bytes;
+}
@@ -26,7 +26,13 @@ class CommLattice : protected Pointers {
   void all();
   void all_reverse();
   void sector(int);
+  void sector_post(int);
   void reverse_sector(int);
+  void reverse_sector_post(int);
+  void all_double(int);
+  void all_double_start(int);
+  void all_double_finish(int);
+  bigint memory_usage();
 
  private:
   int me,nprocs;
@@ -48,6 +54,8 @@ class CommLattice : protected Pointers {
     double **rdbuf;                // each double recv message
     MPI_Request *request;          // MPI datums for each recv message
     MPI_Status *status;
+    int tag;                       // message tag for sends and recvs
+    int posted;                    // 1 if recvs are posted, not yet waited on
   };
 
   struct Site {
@@ -73,12 +81,14 @@ class CommLattice : protected Pointers {
   Swap *create_swap_sector(int, int *);
   Swap *create_swap_sector_reverse(int, int *);
   void free_swap(Swap *);
+  bigint memory_usage_swap(Swap *);
 
   void create_send_from_list(int, Site *, Swap *);
   void create_send_from_recv(int, int, Site *, Swap *);
   void create_recv_from_send(int, int, Site *, Swap *);
   void create_recv_from_list(int, Site *, Swap *);
 
+  void post_recv(Swap *);
   void perform_swap_site(Swap *);
   void perform_swap_int(Swap *);
   void perform_swap_double(Swap *);
@@ -39,6 +39,11 @@ class Diag : protected Pointers {
   virtual void stats(char *strtmp) {strtmp[0] = '\0';};
   virtual void stats_header(char *strtmp) {strtmp[0] = '\0';};
 
+  // called when sites migrate between procs in the middle of a run
+  // only per-site state needs rebuilding, accumulated values must persist
+
+  virtual void rebalance() {};
+
  protected:
   int me,nprocs;
   int iarg_child;
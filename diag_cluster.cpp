@@ -174,6 +174,19 @@ void DiagCluster::init()
   vav = rav = 0.0;
 }
 
+/* ----------------------------------------------------------------------
+   site ownership changed, so reallocate cluster IDs and their comm
+------------------------------------------------------------------------- */
+
+void DiagCluster::rebalance()
+{
+  delete comm;
+  memory->destroy(cluster_ids);
+  cluster_ids = NULL;
+  comm = NULL;
+  init();
+}
+
 /* ---------------------------------------------------------------------- */
 
 void DiagCluster::compute()
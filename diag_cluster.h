@@ -30,6 +30,7 @@ class DiagCluster : public Diag {
   DiagCluster(class SPPARKS *, int, char **);
   virtual ~DiagCluster();
   void init();
+  void rebalance();
   void compute();
   void stats(char *);
   void stats_header(char *);
@@ -0,0 +1,332 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "string.h"
+#include "diag_kmc_profile.h"
+#include "app.h"
+#include "app_lattice.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace SPPARKS_NS;
+
+/* ---------------------------------------------------------------------- */
+
+DiagKMCProfile::DiagKMCProfile(SPPARKS *spk, int narg, char **arg) :
+  Diag(spk,narg,arg)
+{
+  if (app->appclass != App::LATTICE)
+    error->all(FLERR,"Diag_style kmc_profile requires lattice app");
+
+  fp = NULL;
+  ntop = 10;
+  nwindow = 1;
+
+  int iarg = iarg_child;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"top") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal diag_style kmc_profile command");
+      ntop = atoi(arg[iarg+1]);
+      if (ntop < 0) error->all(FLERR,"Illegal diag_style kmc_profile command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"window") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal diag_style kmc_profile command");
+      nwindow = atoi(arg[iarg+1]);
+      if (nwindow < 1) error->all(FLERR,"Illegal diag_style kmc_profile command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"file") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal diag_style kmc_profile command");
+      if (me == 0) {
+	fp = fopen(arg[iarg+1],"w");
+	if (!fp) error->one(FLERR,"Cannot open diag_style kmc_profile output file");
+      }
+      iarg += 2;
+    } else error->all(FLERR,"Illegal diag_style kmc_profile command");
+  }
+
+  nreaction = 0;
+  labels = NULL;
+  nlocal = 0;
+  sitecount = NULL;
+  rcount = rtotal = NULL;
+  wcount = NULL;
+  wtime = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+DiagKMCProfile::~DiagKMCProfile()
+{
+  if (fp) fclose(fp);
+  memory->destroy(labels);
+  memory->destroy(sitecount);
+  memory->destroy(rcount);
+  memory->destroy(rtotal);
+  memory->destroy(wcount);
+  memory->destroy(wtime);
+}
+
+/* ----------------------------------------------------------------------
+   (re)allocate counters for current app and attach to it
+------------------------------------------------------------------------- */
+
+void DiagKMCProfile::init()
+{
+  applattice = (AppLattice *) app;
+
+  nreaction = applattice->profile_reactions();
+  if (nreaction == 0)
+    error->all(FLERR,"Diag_style kmc_profile requires app that reports events");
+
+  nlocal = app->nlocal;
+
+  memory->destroy(labels);
+  memory->destroy(sitecount);
+  memory->destroy(rcount);
+  memory->destroy(rtotal);
+  memory->destroy(wcount);
+  memory->destroy(wtime);
+
+  memory->create(labels,nreaction,16,"diag/kmc_profile:labels");
+  memory->create(sitecount,nlocal,"diag/kmc_profile:sitecount");
+  memory->create(rcount,nreaction,"diag/kmc_profile:rcount");
+  memory->create(rtotal,nreaction,"diag/kmc_profile:rtotal");
+  memory->create(wcount,nwindow,nreaction,"diag/kmc_profile:wcount");
+  memory->create(wtime,nwindow,"diag/kmc_profile:wtime");
+
+  for (int m = 0; m < nreaction; m++) {
+    applattice->profile_label(m,labels[m]);
+    rcount[m] = rtotal[m] = 0;
+  }
+  for (int i = 0; i < nlocal; i++) sitecount[i] = 0;
+  for (int iw = 0; iw < nwindow; iw++) {
+    wtime[iw] = 0.0;
+    for (int m = 0; m < nreaction; m++) wcount[iw][m] = 0;
+  }
+  for (int ibin = 0; ibin < NBIN_PROFILE; ibin++) nhisto[ibin] = 0;
+  nsum = 0;
+  nsitemax = 0;
+
+  iwindow = 0;
+  last_time = app->time;
+  rate = mean_nsites = 0.0;
+  hot = 0;
+
+  applattice->profile = this;
+}
+
+/* ----------------------------------------------------------------------
+   site ownership changed, so resize per-site counts
+   reaction totals and sliding window persist across the rebalance
+------------------------------------------------------------------------- */
+
+void DiagKMCProfile::rebalance()
+{
+  nlocal = app->nlocal;
+  memory->destroy(sitecount);
+  memory->create(sitecount,nlocal,"diag/kmc_profile:sitecount");
+  for (int i = 0; i < nlocal; i++) sitecount[i] = 0;
+}
+
+/* ----------------------------------------------------------------------
+   close out the current interval and print its profile table
+   rates are over the last nwindow intervals
+------------------------------------------------------------------------- */
+
+void DiagKMCProfile::compute()
+{
+  int m,ibin;
+
+  // sum interval counts across procs and push them into window ring
+
+  bigint *wnew = wcount[iwindow];
+  MPI_Allreduce(rcount,wnew,nreaction,MPI_SPK_BIGINT,MPI_SUM,world);
+  wtime[iwindow] = app->time - last_time;
+  iwindow = (iwindow+1) % nwindow;
+  last_time = app->time;
+
+  bigint nevents = 0;
+  for (m = 0; m < nreaction; m++) {
+    rtotal[m] += wnew[m];
+    nevents += wnew[m];
+  }
+
+  double span = 0.0;
+  for (int iw = 0; iw < nwindow; iw++) span += wtime[iw];
+
+  bigint histo[NBIN_PROFILE];
+  bigint nsumall;
+  int nsitemaxall;
+  MPI_Allreduce(nhisto,histo,NBIN_PROFILE,MPI_SPK_BIGINT,MPI_SUM,world);
+  MPI_Allreduce(&nsum,&nsumall,1,MPI_SPK_BIGINT,MPI_SUM,world);
+  MPI_Allreduce(&nsitemax,&nsitemaxall,1,MPI_INT,MPI_MAX,world);
+
+  double *top = NULL;
+  if (me == 0) top = new double[5*ntop*nprocs];
+  hot_sites(top);
+
+  bigint wevents = 0;
+  for (int iw = 0; iw < nwindow; iw++)
+    for (m = 0; m < nreaction; m++) wevents += wcount[iw][m];
+  rate = span > 0.0 ? wevents/span : 0.0;
+  mean_nsites = nevents ? 1.0*nsumall/nevents : 0.0;
+  hot = (me == 0 && ntop && top[0] > 0.0) ? static_cast<int> (top[0]) : 0;
+  MPI_Bcast(&hot,1,MPI_INT,0,world);
+
+  // print table, reactions that fired in window ordered by window count
+
+  if (me == 0) {
+    FILE *out[2];
+    int nout = 0;
+    if (fp) out[nout++] = fp;
+    else {
+      if (screen) out[nout++] = screen;
+      if (logfile) out[nout++] = logfile;
+    }
+
+    bigint *wsum = new bigint[nreaction];
+    int *order = new int[nreaction];
+    int norder = 0;
+    for (m = 0; m < nreaction; m++) {
+      wsum[m] = 0;
+      for (int iw = 0; iw < nwindow; iw++) wsum[m] += wcount[iw][m];
+      if (wsum[m] == 0) continue;
+      int k = norder++;
+      while (k > 0 && wsum[order[k-1]] < wsum[m]) {
+	order[k] = order[k-1];
+	k--;
+      }
+      order[k] = m;
+    }
+
+    for (int iout = 0; iout < nout; iout++) {
+      FILE *f = out[iout];
+      fprintf(f,"KMC profile: time %g events " BIGINT_FORMAT
+	      " window %g rate %g\n",app->time,nevents,span,rate);
+      fprintf(f,"  %-10s %12s %12s %12s\n",
+	      "reaction","window","rate","total");
+      for (int k = 0; k < norder; k++) {
+	m = order[k];
+	fprintf(f,"  %-10s %12.0f %12.5g %12.0f\n",labels[m],(double) wsum[m],
+		span > 0.0 ? wsum[m]/span : 0.0,(double) rtotal[m]);
+      }
+
+      fprintf(f,"  nsites per event: mean %g max %d |",
+	      mean_nsites,nsitemaxall);
+      for (ibin = 0; ibin < NBIN_PROFILE; ibin++) {
+	int lo = ibin ? 1 << ibin : 0;
+	if (ibin == NBIN_PROFILE-1) fprintf(f," %d+:",lo);
+	else fprintf(f," %d-%d:",lo,(2 << ibin) - 1);
+	fprintf(f,BIGINT_FORMAT,histo[ibin]);
+      }
+      fprintf(f,"\n");
+
+      if (ntop) {
+	fprintf(f,"  %-10s %12s %12s %12s %12s\n","site","events","x","y","z");
+	for (int k = 0; k < ntop; k++) {
+	  double *t = &top[5*k];
+	  if (t[0] <= 0.0) break;
+	  fprintf(f,"  %-10.0f %12.0f %12g %12g %12g\n",t[1],t[0],t[2],t[3],t[4]);
+	}
+      }
+      fflush(f);
+    }
+
+    delete [] wsum;
+    delete [] order;
+  }
+
+  delete [] top;
+
+  // reset interval counters
+
+  for (m = 0; m < nreaction; m++) rcount[m] = 0;
+  for (int i = 0; i < nlocal; i++) sitecount[i] = 0;
+  for (ibin = 0; ibin < NBIN_PROFILE; ibin++) nhisto[ibin] = 0;
+  nsum = 0;
+  nsitemax = 0;
+}
+
+/* ----------------------------------------------------------------------
+   find ntop sites with most events in this interval across all procs
+   each proc selects its own ntop, proc 0 merges them into top
+   top = count,ID,x,y,z per site, sorted by count, count = -1 if unused
+------------------------------------------------------------------------- */
+
+void DiagKMCProfile::hot_sites(double *top)
+{
+  if (ntop == 0) return;
+
+  int *mine = new int[ntop];
+  int nmine = 0;
+  for (int i = 0; i < nlocal; i++) {
+    if (sitecount[i] == 0) continue;
+    if (nmine == ntop && sitecount[i] <= sitecount[mine[ntop-1]]) continue;
+    int k = nmine < ntop ? nmine++ : ntop-1;
+    while (k > 0 && sitecount[mine[k-1]] < sitecount[i]) {
+      mine[k] = mine[k-1];
+      k--;
+    }
+    mine[k] = i;
+  }
+
+  double *buf = new double[5*ntop];
+  for (int k = 0; k < ntop; k++) {
+    double *b = &buf[5*k];
+    if (k < nmine) {
+      int i = mine[k];
+      b[0] = sitecount[i];
+      b[1] = app->id[i];
+      b[2] = app->xyz[i][0];
+      b[3] = app->xyz[i][1];
+      b[4] = app->xyz[i][2];
+    } else b[0] = -1.0;
+  }
+
+  MPI_Gather(buf,5*ntop,MPI_DOUBLE,top,5*ntop,MPI_DOUBLE,0,world);
+
+  // selection of largest counts from merged list, only first ntop matter
+
+  if (me == 0) {
+    int n = ntop*nprocs;
+    double tmp[5];
+    for (int k = 0; k < ntop; k++) {
+      int jmax = k;
+      for (int j = k+1; j < n; j++)
+	if (top[5*j] > top[5*jmax]) jmax = j;
+      if (jmax == k) continue;
+      memcpy(tmp,&top[5*k],5*sizeof(double));
+      memcpy(&top[5*k],&top[5*jmax],5*sizeof(double));
+      memcpy(&top[5*jmax],tmp,5*sizeof(double));
+    }
+  }
+
+  delete [] mine;
+  delete [] buf;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DiagKMCProfile::stats(char *strtmp)
+{
+  sprintf(strtmp," %10g %10g %10d",rate,mean_nsites,hot);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DiagKMCProfile::stats_header(char *strtmp)
+{
+  sprintf(strtmp," %10s %10s %10s","EventRate","<Nsites>","HotSite");
+}
@@ -0,0 +1,107 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#ifdef DIAG_CLASS
+DiagStyle(kmc_profile,DiagKMCProfile)
+
+#else
+
+#ifndef SPK_DIAG_KMC_PROFILE_H
+#define SPK_DIAG_KMC_PROFILE_H
+
+#include "stdio.h"
+#include "diag.h"
+
+namespace SPPARKS_NS {
+
+#define NBIN_PROFILE 8     // nsites bins: 1, 2-3, 4-7, ..., 128+
+
+class DiagKMCProfile : public Diag {
+ public:
+  DiagKMCProfile(class SPPARKS *, int, char **);
+  ~DiagKMCProfile();
+  void init();
+  void rebalance();
+  void compute();
+  void stats(char *);
+  void stats_header(char *);
+
+  // called by app for each executed event
+  // i = local site, ireaction = reaction index, nsites = sites passed to solver
+
+  void event(int i, int ireaction, int nsites) {
+    sitecount[i]++;
+    rcount[ireaction]++;
+    int ibin = 0;
+    while (ibin < NBIN_PROFILE-1 && (2 << ibin) <= nsites) ibin++;
+    nhisto[ibin]++;
+    nsum += nsites;
+    if (nsites > nsitemax) nsitemax = nsites;
+  }
+
+ private:
+  class AppLattice *applattice;
+  FILE *fp;
+  int ntop;                   // # of hot sites to report
+  int nwindow;                // # of stats intervals in sliding window
+
+  int nreaction;              // # of reactions reported by app
+  char **labels;              // label of each reaction
+  int nlocal;                 // # of owned sites per-site counts are for
+  int *sitecount;             // events on each owned site in this interval
+  bigint *rcount;             // events of each reaction in this interval
+  bigint *rtotal;             // events of each reaction since init
+  bigint nhisto[NBIN_PROFILE];  // histogram of nsites in this interval
+  bigint nsum;                // sum of nsites in this interval
+  int nsitemax;               // max nsites in this interval
+
+  bigint **wcount;            // per-reaction counts of last nwindow intervals
+  double *wtime;              // duration of last nwindow intervals
+  int iwindow;                // slot in window ring for next interval
+  double last_time;           // time of previous compute()
+
+  double rate,mean_nsites;    // global values for stats output
+  int hot;
+
+  void hot_sites(double *);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running SPPARKS to see the offending
+line.
+
+E: Diag_style kmc_profile requires lattice app
+
+Self-explanatory.
+
+E: Cannot open diag_style kmc_profile output file
+
+Self-explanatory.
+
+E: Diag_style kmc_profile requires app that reports events
+
+The app must implement profile_reactions() and call profile->event()
+from its site_event() method.  Currently only the ald and ald/zno apps
+do this.
+
+*/
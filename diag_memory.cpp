@@ -0,0 +1,67 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under 
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "string.h"
+#include "diag_memory.h"
+#include "app.h"
+#include "output.h"
+#include "error.h"
+
+using namespace SPPARKS_NS;
+
+/* ---------------------------------------------------------------------- */
+
+DiagMemory::DiagMemory(SPPARKS *spk, int narg, char **arg) : 
+  Diag(spk,narg,arg) {}
+
+/* ---------------------------------------------------------------------- */
+
+void DiagMemory::init()
+{
+  for (int i = 0; i < 5; i++) mbytes[i] = 0.0;
+}
+
+/* ----------------------------------------------------------------------
+   memory in Mbytes of each category, max across procs
+   total is max of per-proc totals, not sum of category maxima
+------------------------------------------------------------------------- */
+
+void DiagMemory::compute()
+{
+  double mine[5];
+  mine[0] = app->memory_usage()/1024.0/1024.0;
+  mine[1] = app->memory_usage_solve()/1024.0/1024.0;
+  mine[2] = app->memory_usage_comm()/1024.0/1024.0;
+  mine[3] = output->memory_usage_dump()/1024.0/1024.0;
+  mine[4] = mine[0] + mine[1] + mine[2] + mine[3];
+
+  MPI_Allreduce(mine,mbytes,5,MPI_DOUBLE,MPI_MAX,world);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DiagMemory::stats(char *strtmp)
+{
+  sprintf(strtmp," %10g %10g %10g %10g %10g",
+	  mbytes[0],mbytes[1],mbytes[2],mbytes[3],mbytes[4]);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DiagMemory::stats_header(char *strtmp)
+{
+  sprintf(strtmp," %10s %10s %10s %10s %10s",
+	  "MemApp","MemSolve","MemComm","MemDump","MemTotal");
+}
@@ -0,0 +1,47 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under 
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#ifdef DIAG_CLASS
+DiagStyle(memory,DiagMemory)
+
+#else
+
+#ifndef SPK_DIAG_MEMORY_H
+#define SPK_DIAG_MEMORY_H
+
+#include "stdio.h"
+#include "diag.h"
+
+namespace SPPARKS_NS {
+
+class DiagMemory : public Diag {
+ public:
+  DiagMemory(class SPPARKS *, int, char **);
+  ~DiagMemory() {}
+  void init();
+  void compute();
+  void stats(char *);
+  void stats_header(char *);
+
+ private:
+  double mbytes[5];          // max over procs of app,solve,comm,dump,total
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+*/
@@ -45,6 +45,13 @@ void DiagPropensity::init()
 
 /* ---------------------------------------------------------------------- */
 
+void DiagPropensity::rebalance()
+{
+  nlocal = app->nlocal;
+}
+
+/* ---------------------------------------------------------------------- */
+
 void DiagPropensity::compute()
 {
   applattice->comm->all();
@@ -30,6 +30,7 @@ class DiagPropensity : public Diag {
   DiagPropensity(class SPPARKS *, int, char **);
   ~DiagPropensity() {}
   void init();
+  void rebalance();
   void compute();
   void stats(char *);
   void stats_header(char *);
@@ -0,0 +1,164 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under 
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "stdlib.h"
+#include "string.h"
+#include "diag_surface.h"
+#include "app.h"
+#include "app_surface.h"
+#include "error.h"
+#include "memory.h"
+
+using namespace SPPARKS_NS;
+
+enum{SPECIES,EVENTS,ONE,TWO,THREE};
+
+/* ---------------------------------------------------------------------- */
+
+DiagSurface::DiagSurface(SPPARKS *spk, int narg, char **arg) : 
+  Diag(spk,narg,arg)
+{
+  if (strcmp(app->style,"surface") != 0)
+    error->all(FLERR,"Diag_style surface requires app_style surface");
+
+  nlist = 0;
+
+  int iarg = iarg_child;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"list") == 0) {
+      nlist = narg - iarg - 1;
+      list = new char*[nlist];
+      int j = 0;
+      for (int i = iarg+1; i < narg; i++) {
+	int n = strlen(arg[i]) + 1;
+	list[j] = new char[n];
+	strcpy(list[j],arg[i]);
+	j++;
+      }
+      iarg = narg;
+    } else error->all(FLERR,"Illegal diag_style surface command");
+  }
+
+  if (nlist == 0) error->all(FLERR,"Illegal diag_style surface command");
+  which = new int[nlist];
+  index = new int[nlist];
+  ivector = new int[nlist];
+  sites = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+DiagSurface::~DiagSurface()
+{
+  for (int i = 0; i < nlist; i++) delete [] list[i];
+  delete [] list;
+  delete [] which;
+  delete [] index;
+  delete [] ivector;
+  memory->destroy(sites);
+}
+
+/* ----------------------------------------------------------------------
+   species names are looked up in the app, so they take precedence
+     over reaction counts sN, dN, vN
+------------------------------------------------------------------------- */
+
+void DiagSurface::init()
+{
+  appsurface = (AppSurface *) app;
+
+  int none = appsurface->none;
+  int ntwo = appsurface->ntwo;
+  int nthree = appsurface->nthree;
+
+  for (int i = 0; i < nlist; i++) {
+    int s = appsurface->find_species(list[i]);
+    if (s >= 0) {
+      which[i] = SPECIES;
+      index[i] = s;
+    } else if (strcmp(list[i],"events") == 0) which[i] = EVENTS;
+    else if (list[i][0] == 's') {
+      which[i] = ONE;
+      int n = atoi(&list[i][1]);
+      if (n < 1 || n > none) 
+	error->all(FLERR,"Invalid value setting in diag_style surface");
+      index[i] = n - 1;
+    } else if (list[i][0] == 'd') {
+      which[i] = TWO;
+      int n = atoi(&list[i][1]);
+      if (n < 1 || n > ntwo) 
+	error->all(FLERR,"Invalid value setting in diag_style surface");
+      index[i] = n - 1;
+    } else if (list[i][0] == 'v') {
+      which[i] = THREE;
+      int n = atoi(&list[i][1]);
+      if (n < 1 || n > nthree) 
+	error->all(FLERR,"Invalid value setting in diag_style surface");
+      index[i] = n - 1;
+    } else error->all(FLERR,"Invalid value setting in diag_style surface");
+  }
+
+  siteflag = 0;
+  for (int i = 0; i < nlist; i++)
+    if (which[i] == SPECIES) siteflag = 1;
+
+  memory->destroy(sites);
+  memory->create(sites,appsurface->nspecies+1,"diag/surface:sites");
+
+  for (int i = 0; i < nlist; i++) ivector[i] = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DiagSurface::compute()
+{
+  int ivalue;
+
+  if (siteflag) {
+    for (int s = 0; s < appsurface->nspecies; s++) sites[s] = 0;
+    int *species = appsurface->species;
+    int nlocal = appsurface->nlocal;
+    for (int i = 0; i < nlocal; i++) sites[species[i]]++;
+  }
+
+  for (int i = 0; i < nlist; i++) {
+    if (which[i] == SPECIES) ivalue = sites[index[i]];
+    else if (which[i] == EVENTS) ivalue = appsurface->nevents;
+    else if (which[i] == ONE) ivalue = appsurface->scount[index[i]];
+    else if (which[i] == TWO) ivalue = appsurface->dcount[index[i]];
+    else if (which[i] == THREE) ivalue = appsurface->vcount[index[i]];
+    
+    MPI_Allreduce(&ivalue,&ivector[i],1,MPI_INT,MPI_SUM,world);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DiagSurface::stats(char *str)
+{
+  for (int i = 0; i < nlist; i++) {
+    sprintf(str," %d",ivector[i]);
+    str += strlen(str);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void DiagSurface::stats_header(char *str)
+{
+  for (int i = 0; i < nlist; i++) {
+    sprintf(str," %s",list[i]);
+    str += strlen(str);
+  }
+}
@@ -776,3 +776,21 @@ void Dump::modify_params(int narg, char **arg)
     }
   }
 }
+
+/* ----------------------------------------------------------------------
+   return # of bytes of allocated memory in buf, sort bufs, irregular
+------------------------------------------------------------------------- */
+
+bigint Dump::memory_usage()
+{
+  bigint bytes = 0;
+  bytes += (bigint) maxbuf*size_one * sizeof(double);   // buf
+  bytes += (bigint) maxids * sizeof(tagint);            // ids
+  bytes += (bigint) maxsort*size_one * sizeof(double);  // bufsort
+  bytes += (bigint) maxsort * sizeof(int);              // index
+  if (sort_flag && sortcol == 0)
+    bytes += (bigint) maxsort * sizeof(tagint);         // idsort
+  bytes += (bigint) maxproc * sizeof(int);              // proclist
+  if (irregular) bytes += irregular->memory_usage();
+  return bytes;
+}
@@ -38,6 +38,7 @@ class Dump : protected Pointers {
   void init();
   virtual void write(double);
   void modify_params(int, char **);
+  virtual bigint memory_usage();
 
  protected:
   int me,nprocs;             // proc info
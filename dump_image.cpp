@@ -34,6 +34,10 @@
 #include "jpeglib.h"
 #endif
 
+#if defined(_OPENMP)
+#include "omp.h"
+#endif
+
 using namespace SPPARKS_NS;
 using namespace MathConst;
 
@@ -83,6 +87,7 @@ DumpImage::DumpImage(SPPARKS *spk, int narg, char **arg) :
 
   shape = SPHERE;
   boundflag = NO;
+  cullflag = NO;
   crange = drange = NO;
   thetastr = phistr = NULL;
   cflag = STATIC;
@@ -160,6 +165,13 @@ DumpImage::DumpImage(SPPARKS *spk, int narg, char **arg) :
       if (bounddiam <= 0.0) error->all(FLERR,"Illegal dump image command");
       iarg += 3;
 
+    } else if (strcmp(arg[iarg],"cull") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal dump image command");
+      if (strcmp(arg[iarg+1],"yes") == 0) cullflag = YES;
+      else if (strcmp(arg[iarg+1],"no") == 0) cullflag = NO;
+      else error->all(FLERR,"Illegal dump image command");
+      iarg += 2;
+
     } else if (strcmp(arg[iarg],"crange") == 0) {
       if (iarg+3 > narg) error->all(FLERR,"Illegal dump image command");
       crange = YES;
@@ -337,6 +349,17 @@ DumpImage::DumpImage(SPPARKS *spk, int narg, char **arg) :
     applattice = (AppLattice *) app;
   }
 
+  if (cullflag == YES) {
+    if (app->appclass != App::LATTICE)
+      error->all(FLERR,"Dump image cull requires lattice app");
+    applattice = (AppLattice *) app;
+  }
+
+  maxdraw = 0;
+  drawlist = NULL;
+  drawcolor = NULL;
+  drawdiam = NULL;
+
   // allocate image buffer now that image size is known
 
   image->buffers();
@@ -393,6 +416,22 @@ DumpImage::~DumpImage()
     memory->sfree(colorattribute);
   }
   memory->destroy(color_memflag);
+
+  memory->destroy(drawlist);
+  memory->destroy(drawcolor);
+  memory->destroy(drawdiam);
+}
+
+/* ----------------------------------------------------------------------
+   add image buffers to dump buffers
+------------------------------------------------------------------------- */
+
+bigint DumpImage::memory_usage()
+{
+  bigint bytes = Dump::memory_usage();
+  bytes += image->memory_usage();
+  bytes += (bigint) maxdraw * (sizeof(int) + 4*sizeof(double));
+  return bytes;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -593,16 +632,33 @@ void DumpImage::create_image()
   double diameter;
   double *color;
 
-  // render my sites
+  // set color and diameter of my sites
+  // skip buried sites if culling
+  // colors are copied since value2color() returns a shared buffer
 
   double **xyz = app->xyz;
   if (crange == YES) nc = chi-clo+1;
   if (drange == YES) nd = dhi-dlo+1;
 
+  if (nchoose > maxdraw) {
+    maxdraw = nchoose;
+    memory->destroy(drawlist);
+    memory->destroy(drawcolor);
+    memory->destroy(drawdiam);
+    memory->create(drawlist,maxdraw,"image:drawlist");
+    memory->create(drawcolor,maxdraw,3,"image:drawcolor");
+    memory->create(drawdiam,maxdraw,"image:drawdiam");
+  }
+
+  int ndraw = 0;
   m = 0;
   for (i = 0; i < nchoose; i++) {
     j = clist[i];
-    
+    if (cullflag == YES && buried(j)) {
+      m += size_one;
+      continue;
+    }
+
     if (scolor == IATTRIBUTE) {
       ivalue = static_cast<int> (buf[m]);
       if (cwrap) {
@@ -631,12 +687,39 @@ void DumpImage::create_image()
       diameter = buf[m+1];
     }
 
-    if (shape == SPHERE) image->draw_sphere(xyz[j],color,diameter);
-    else image->draw_cube(xyz[j],color,diameter);
+    drawlist[ndraw] = j;
+    drawcolor[ndraw][0] = color[0];
+    drawcolor[ndraw][1] = color[1];
+    drawcolor[ndraw][2] = color[2];
+    drawdiam[ndraw] = diameter;
+    ndraw++;
 
     m += size_one;
   }
 
+  // render my sites
+  // with OpenMP, each thread rasterizes all sites into its own band of rows
+
+#if defined(_OPENMP)
+#pragma omp parallel private(i)
+#endif
+  {
+    int ylo = 0;
+    int yhi = image->height;
+#if defined(_OPENMP)
+    int nthreads = omp_get_num_threads();
+    int tid = omp_get_thread_num();
+    ylo = static_cast<int> ((bigint) tid * image->height / nthreads);
+    yhi = static_cast<int> ((bigint) (tid+1) * image->height / nthreads);
+#endif
+
+    for (i = 0; i < ndraw; i++) {
+      if (shape == SPHERE) 
+	image->draw_sphere(xyz[drawlist[i]],drawcolor[i],drawdiam[i],ylo,yhi);
+      else image->draw_cube(xyz[drawlist[i]],drawcolor[i],drawdiam[i],ylo,yhi);
+    }
+  }
+
   // render my boundaries bewteen adjacent sites
   // loop over all chosen sites and all their neighbors
   // neighbor does not have to be chosen site
@@ -780,6 +863,37 @@ void DumpImage::create_image()
   }
 }
 
+/* ----------------------------------------------------------------------
+   return 1 if site I is hidden inside the bulk, 0 if it may be visible
+   buried = site has max # of neighbors, all of them owned and also drawn
+   neighbors that are ghosts or across a periodic boundary do not hide it,
+     so sites on processor and box faces are always drawn
+------------------------------------------------------------------------- */
+
+int DumpImage::buried(int i)
+{
+  int *numneigh = applattice->numneigh;
+  int **neighbor = applattice->neighbor;
+  double **xyz = app->xyz;
+  int nlocal = app->nlocal;
+
+  if (numneigh[i] < applattice->maxneigh) return 0;
+
+  double xhalf = 0.5*domain->xprd;
+  double yhalf = 0.5*domain->yprd;
+  double zhalf = 0.5*domain->zprd;
+
+  for (int jj = 0; jj < numneigh[i]; jj++) {
+    int j = neighbor[i][jj];
+    if (j >= nlocal || !choose[j]) return 0;
+    if (fabs(xyz[i][0]-xyz[j][0]) > xhalf) return 0;
+    if (fabs(xyz[i][1]-xyz[j][1]) > yhalf) return 0;
+    if (fabs(xyz[i][2]-xyz[j][2]) > zhalf) return 0;
+  }
+
+  return 1;
+}
+
 /* ---------------------------------------------------------------------- */
 
 int DumpImage::modify_param(int narg, char **arg)
@@ -29,6 +29,7 @@ class DumpImage : public DumpText {
  public:
   DumpImage(class SPPARKS *, int, char**);
   ~DumpImage();
+  bigint memory_usage();
 
  private:
   int filetype;
@@ -53,6 +54,12 @@ class DumpImage : public DumpText {
   int cwrap,dwrap;                 // 0/1 for wrapping color/diam to c/drange
 
   int viewflag;                    // overall view is static or dynamic
+  int cullflag;                    // 1 to skip sites hidden in the bulk
+
+  int maxdraw;                     // size of per-site draw arrays
+  int *drawlist;                   // sites to render
+  double **drawcolor;              // color of each site to render
+  double *drawdiam;                // diameter of each site to render
 
   class AppLattice *applattice;
 
@@ -72,6 +79,7 @@ class DumpImage : public DumpText {
   void box_bounds();
 
   void create_image();
+  int buried(int);
 
   void bounds(char *, int, int, int &, int &);
 };
@@ -118,6 +126,11 @@ E: Dump image boundary requires lattice app
 
 UNDOCUMENTED
 
+E: Dump image cull requires lattice app
+
+Culling uses the neighbor lists of lattice sites to find sites that
+are hidden by their neighbors.
+
 E: Dump image drange must be set
 
 UNDOCUMENTED
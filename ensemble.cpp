@@ -0,0 +1,368 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#include "math.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "ensemble.h"
+#include "universe.h"
+#include "random_mars.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace SPPARKS_NS;
+
+#define DELTA 256
+#define MAXCOLUMN_ENSEMBLE 256
+#define EPSILON 1.0e-10
+
+/* ---------------------------------------------------------------------- */
+
+Ensemble::Ensemble(SPPARKS *spk, int narg, char **arg) : Pointers(spk)
+{
+  stride = 1;
+  conf = 0.95;
+
+  int iarg = 0;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"stride") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal ensemble command");
+      stride = atoi(arg[iarg+1]);
+      if (stride <= 0) error->all(FLERR,"Illegal ensemble command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"conf") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal ensemble command");
+      conf = atof(arg[iarg+1]);
+      if (conf <= 0.0 || conf >= 1.0)
+	error->all(FLERR,"Illegal ensemble command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal ensemble command");
+  }
+
+  if (ranmaster->initflag)
+    error->all(FLERR,"Ensemble command must come before seed command");
+  if (universe->nworlds == 1)
+    error->warning(FLERR,"Ensemble with a single partition");
+
+  // communicator of partition roots, ordered by partition
+  // other procs are split into a communicator that is never used
+
+  int me;
+  MPI_Comm_rank(world,&me);
+  MPI_Comm_split(universe->uworld,me == 0 ? 0 : 1,universe->iworld,&roots);
+  if (me == 0) MPI_Comm_rank(roots,&iroot);
+  else iroot = -1;
+
+  ncolumn = 0;
+  names = NULL;
+  nrow = maxrow = 0;
+  rows = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Ensemble::~Ensemble()
+{
+  MPI_Comm_free(&roots);
+  for (int i = 0; i < ncolumn; i++) delete [] names[i];
+  delete [] names;
+  memory->destroy(rows);
+}
+
+/* ----------------------------------------------------------------------
+   store column names from stats header, called on partition root
+   1st word is Time, which is replaced by the stats slot time
+------------------------------------------------------------------------- */
+
+void Ensemble::header(char *str)
+{
+  for (int i = 0; i < ncolumn; i++) delete [] names[i];
+  delete [] names;
+
+  char *copy = new char[strlen(str)+1];
+  strcpy(copy,str);
+
+  int n = 0;
+  char *word = strtok(copy," \t");
+  while (word) {
+    n++;
+    word = strtok(NULL," \t");
+  }
+
+  ncolumn = MAX(n-1,0);
+  names = new char*[ncolumn];
+  strcpy(copy,str);
+  word = strtok(copy," \t");
+  for (int i = 0; i < ncolumn; i++) {
+    word = strtok(NULL," \t");
+    names[i] = new char[strlen(word)+1];
+    strcpy(names[i],word);
+  }
+
+  delete [] copy;
+  nrow = 0;
+}
+
+/* ----------------------------------------------------------------------
+   store one stats line, called on partition root
+   slot = scheduled stats time that triggered it
+   apps with more values than header words get extra unnamed columns
+------------------------------------------------------------------------- */
+
+void Ensemble::add(double slot, char *str)
+{
+  double values[MAXCOLUMN_ENSEMBLE];
+  int n = 0;
+
+  char *ptr = str;
+  char *next;
+  strtod(ptr,&next);
+  ptr = next;
+  while (n < MAXCOLUMN_ENSEMBLE) {
+    double value = strtod(ptr,&next);
+    if (next == ptr) break;
+    values[n++] = value;
+    ptr = next;
+  }
+
+  if (n > ncolumn) {
+    char **newnames = new char*[n];
+    for (int i = 0; i < ncolumn; i++) newnames[i] = names[i];
+    for (int i = ncolumn; i < n; i++) {
+      newnames[i] = new char[16];
+      sprintf(newnames[i],"c%d",i+1);
+    }
+    delete [] names;
+    names = newnames;
+    ncolumn = n;
+  }
+  for (int i = n; i < ncolumn; i++) values[i] = 0.0;
+
+  if (nrow == maxrow) {
+    maxrow += DELTA;
+    memory->grow(rows,maxrow*(MAXCOLUMN_ENSEMBLE+1),"ensemble:rows");
+  }
+  double *row = &rows[nrow*(MAXCOLUMN_ENSEMBLE+1)];
+  row[0] = slot;
+  for (int i = 0; i < ncolumn; i++) row[i+1] = values[i];
+  nrow++;
+}
+
+/* ----------------------------------------------------------------------
+   gather stats rows of this run from all partitions to universe root
+   called by all procs at end of run, only partition roots participate
+   rows are gathered once per run rather than at each stats time,
+     so partitions never wait on each other during the run
+------------------------------------------------------------------------- */
+
+void Ensemble::reduce()
+{
+  if (iroot < 0) return;
+
+  int nworlds = universe->nworlds;
+
+  int ncolmin,ncolmax;
+  MPI_Allreduce(&ncolumn,&ncolmin,1,MPI_INT,MPI_MIN,roots);
+  MPI_Allreduce(&ncolumn,&ncolmax,1,MPI_INT,MPI_MAX,roots);
+  if (ncolmin != ncolmax)
+    error->one(FLERR,"Ensemble partitions have inconsistent stats columns");
+
+  int nper = MAXCOLUMN_ENSEMBLE + 1;
+  int nmine = nrow*nper;
+  int *counts = NULL;
+  int *displs = NULL;
+  double *all = NULL;
+
+  if (iroot == 0) {
+    counts = new int[nworlds];
+    displs = new int[nworlds];
+  }
+  MPI_Gather(&nmine,1,MPI_INT,counts,1,MPI_INT,0,roots);
+
+  if (iroot == 0) {
+    int ntotal = 0;
+    for (int i = 0; i < nworlds; i++) {
+      displs[i] = ntotal;
+      ntotal += counts[i];
+    }
+    memory->create(all,MAX(ntotal,1),"ensemble:all");
+  }
+  MPI_Gatherv(rows,nmine,MPI_DOUBLE,all,counts,displs,MPI_DOUBLE,0,roots);
+
+  if (iroot == 0) print(all,counts,displs,nper);
+
+  delete [] counts;
+  delete [] displs;
+  memory->destroy(all);
+  nrow = 0;
+}
+
+/* ----------------------------------------------------------------------
+   print mean, variance, confidence interval of each column at each slot
+   slots = union of stats times of all partitions
+   a partition that skipped a slot (one event spanned several stats
+     intervals) contributes its last row before that slot
+------------------------------------------------------------------------- */
+
+void Ensemble::print(double *all, int *counts, int *displs, int nper)
+{
+  int i,j,k,w;
+
+  int nworlds = universe->nworlds;
+
+  // sorted union of slot times
+
+  int ntotal = 0;
+  for (w = 0; w < nworlds; w++) ntotal += counts[w]/nper;
+  double *slots = new double[MAX(ntotal,1)];
+  int nslot = 0;
+  for (w = 0; w < nworlds; w++)
+    for (i = 0; i < counts[w]/nper; i++)
+      slots[nslot++] = all[displs[w] + i*nper];
+
+  for (i = 1; i < nslot; i++) {
+    double s = slots[i];
+    for (j = i; j > 0 && slots[j-1] > s; j--) slots[j] = slots[j-1];
+    slots[j] = s;
+  }
+  int n = 0;
+  for (i = 0; i < nslot; i++)
+    if (n == 0 || slots[i]-slots[n-1] > EPSILON*fabs(slots[i]))
+      slots[n++] = slots[i];
+  nslot = n;
+
+  FILE *out[2];
+  int nout = 0;
+  if (universe->uscreen) out[nout++] = universe->uscreen;
+  if (universe->ulogfile) out[nout++] = universe->ulogfile;
+
+  double t = tcritical(nworlds-1);
+
+  for (k = 0; k < nout; k++) {
+    fprintf(out[k],"Ensemble stats for %d partitions, "
+	    "mean, variance and %g%% confidence interval\n",
+	    nworlds,100.0*conf);
+    fprintf(out[k],"%12s","Time");
+    char str[64];
+    for (j = 0; j < ncolumn; j++) {
+      fprintf(out[k]," %12s",names[j]);
+      sprintf(str,"%s:var",names[j]);
+      fprintf(out[k]," %12s",str);
+      sprintf(str,"%s:ci",names[j]);
+      fprintf(out[k]," %12s",str);
+    }
+    fprintf(out[k],"\n");
+  }
+
+  int *irow = new int[nworlds];
+  for (w = 0; w < nworlds; w++) irow[w] = 0;
+  double *sum = new double[ncolumn];
+  double *sumsq = new double[ncolumn];
+
+  for (int islot = 0; islot < nslot; islot++) {
+    double slot = slots[islot];
+    for (j = 0; j < ncolumn; j++) sum[j] = sumsq[j] = 0.0;
+
+    for (w = 0; w < nworlds; w++) {
+      int nrow_w = counts[w]/nper;
+      while (irow[w]+1 < nrow_w &&
+	     all[displs[w] + (irow[w]+1)*nper] <= slot + EPSILON*fabs(slot))
+	irow[w]++;
+      double *row = &all[displs[w] + irow[w]*nper];
+      for (j = 0; j < ncolumn; j++) {
+	sum[j] += row[j+1];
+	sumsq[j] += row[j+1]*row[j+1];
+      }
+    }
+
+    for (k = 0; k < nout; k++) {
+      fprintf(out[k],"%12.6g",slot);
+      for (j = 0; j < ncolumn; j++) {
+	double mean = sum[j]/nworlds;
+	double var = 0.0;
+	if (nworlds > 1)
+	  var = MAX(0.0,(sumsq[j] - nworlds*mean*mean)/(nworlds-1));
+	double ci = t*sqrt(var/nworlds);
+	fprintf(out[k]," %12.6g %12.6g %12.6g",mean,var,ci);
+      }
+      fprintf(out[k],"\n");
+    }
+  }
+
+  for (k = 0; k < nout; k++) fflush(out[k]);
+
+  delete [] slots;
+  delete [] irow;
+  delete [] sum;
+  delete [] sumsq;
+}
+
+/* ----------------------------------------------------------------------
+   two-sided critical value of Student t distribution with dof degrees
+   exact for 1 and 2 dof, Cornish-Fisher expansion about normal otherwise
+------------------------------------------------------------------------- */
+
+double Ensemble::tcritical(int dof)
+{
+  if (dof <= 0) return 0.0;
+
+  double p = 0.5 + 0.5*conf;
+  if (dof == 1) return tan(M_PI*(p-0.5));
+  if (dof == 2) return (2.0*p-1.0) / sqrt(2.0*p*(1.0-p));
+
+  double z = normal_quantile(p);
+  double z2 = z*z;
+  double v = dof;
+  double g1 = (z2+1.0)*z/4.0;
+  double g2 = ((5.0*z2+16.0)*z2+3.0)*z/96.0;
+  double g3 = (((3.0*z2+19.0)*z2+17.0)*z2-15.0)*z/384.0;
+  double g4 = ((((79.0*z2+776.0)*z2+1482.0)*z2-1920.0)*z2-945.0)*z/92160.0;
+  return z + g1/v + g2/(v*v) + g3/(v*v*v) + g4/(v*v*v*v);
+}
+
+/* ----------------------------------------------------------------------
+   quantile of standard normal distribution at probability p
+   rational approximation with relative error < 1.2e-9 (Acklam)
+------------------------------------------------------------------------- */
+
+double Ensemble::normal_quantile(double p)
+{
+  static const double a[6] = {-3.969683028665376e+01,2.209460984245205e+02,
+			      -2.759285104469687e+02,1.383577518672690e+02,
+			      -3.066479806614716e+01,2.506628277459239e+00};
+  static const double b[5] = {-5.447609879822406e+01,1.615858368580409e+02,
+			      -1.556989798598866e+02,6.680131188771972e+01,
+			      -1.328068155288572e+01};
+  static const double c[6] = {-7.784894002430293e-03,-3.223964580411365e-01,
+			      -2.400758277161838e+00,-2.549732539343734e+00,
+			      4.374664141464968e+00,2.938163982698783e+00};
+  static const double d[4] = {7.784695709041462e-03,3.224671290700398e-01,
+			      2.445134137142996e+00,3.754408661907416e+00};
+
+  double q,r;
+  if (p < 0.02425) {
+    q = sqrt(-2.0*log(p));
+    return (((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) /
+      ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1.0);
+  }
+  if (p > 1.0-0.02425) {
+    q = sqrt(-2.0*log(1.0-p));
+    return -(((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) /
+      ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1.0);
+  }
+  q = p - 0.5;
+  r = q*q;
+  return (((((a[0]*r+a[1])*r+a[2])*r+a[3])*r+a[4])*r+a[5])*q /
+    (((((b[0]*r+b[1])*r+b[2])*r+b[3])*r+b[4])*r+1.0);
+}
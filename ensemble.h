@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#ifndef SPK_ENSEMBLE_H
+#define SPK_ENSEMBLE_H
+
+#include "mpi.h"
+#include "pointers.h"
+
+namespace SPPARKS_NS {
+
+class Ensemble : protected Pointers {
+ public:
+  int stride;                 // seed increment between partitions
+
+  Ensemble(class SPPARKS *, int, char **);
+  ~Ensemble();
+  void header(char *);
+  void add(double, char *);
+  void reduce();
+
+ private:
+  MPI_Comm roots;             // root procs of all partitions
+  int iroot;                  // my rank in roots
+  double conf;                // confidence level of intervals
+
+  int ncolumn;                // # of stats columns after Time
+  char **names;               // name of each column
+
+  int nrow,maxrow;            // stats rows stored by this partition
+  double *rows;               // slot time + column values per row
+
+  void print(double *, int *, int *, int);
+  double tcritical(int);
+  double normal_quantile(double);
+};
+
+}
+
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running SPPARKS to see the offending
+line.
+
+E: Ensemble command must come before seed command
+
+The seed of each partition is offset when the seed command is
+processed.
+
+W: Ensemble with a single partition
+
+Use the -partition command-line switch to run multiple replicas.
+Statistics are printed with zero variance.
+
+E: Ensemble partitions have inconsistent stats columns
+
+All partitions must run the same input script with the same stats
+output.
+
+*/
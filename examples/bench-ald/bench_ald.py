@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+
+# Script:  bench_ald.py
+# Purpose: regression and performance benchmark for the ALD apps
+# Syntax:  bench_ald.py [options], see bench_ald.py -h
+#
+# runs in.bench_ald_hfo2 and in.bench_ald_zno on scaled copies of the
+#   ald-HfO2 and ald-ZnO example lattices (16k, 128k, 1M sites),
+#   with the serial and/or MPI executables
+# data files are built once with replicate.py and kept in the work dir
+# from each log it extracts loop time, the per-category timing
+#   breakdown printed by Finish, and events/sec = Naccept / loop time
+# final species counts of diag_style ald or ald/zno are checked
+#   against ref.bench_ald, a count passes if it is within
+#   nsigma * max(sd,sqrt(mean)) of the reference mean
+# -u N regenerates ref.bench_ald from N serial runs with different seeds
+# one row per run is appended to bench_ald.csv
+# a failed check is reported as xfail for runs a system lists in xfail,
+#   these are known to drift from the serial reference and do not
+#   change the exit status
+# exit status is 1 if any other species check fails
+
+import argparse,math,os,re,subprocess,sys
+
+# mpi runs use sectors, which refresh only propensities of sites near a
+#   sector border, while ALD masks and coordination reach further,
+#   so they drift from the serial reference even on 1 proc:
+#   more DEZ adsorbs for ZnO, fewer events remain for HfO2 at 128k and 1M
+
+SYSTEMS = {
+  "hfo2": {"input": "in.bench_ald_hfo2",
+           "data": "../ald-HfO2/data.ald",
+           "seed": 4323,
+           "columns": ["events","O","OH","HfHX","HfX","Hf"],
+           "xfail": ["mpi"],
+           # size: nx, ny copies of base lattice, simulated time
+           "sizes": {"16k": (1,1,1.0e-6),
+                     "128k": (2,4,2.5e-7),
+                     "1M": (8,8,1.0e-7)}},
+  "zno": {"input": "in.bench_ald_zno",
+          "data": "../ald-ZnO/data.ald",
+          "seed": 36720,
+          "columns": ["events","QCM","OXYGEN","ZINC","HYDROGEN","MEZ",
+                      "LIGANDS"],
+          "xfail": ["mpi"],
+          "sizes": {"16k": (4,3,0.01),
+                    "128k": (10,10,0.002),
+                    "1M": (40,20,0.0002)}},
+}
+
+TIMERS = ["Solve","Update","Comm","Outpt","App","Event","Other"]
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+# ---------------------------------------------------------------------
+
+def data_file(args,system,size):
+  nx,ny,t = SYSTEMS[system]["sizes"][size]
+  name = os.path.join(args.workdir,"data.%s.%s" % (system,size))
+  if not os.path.exists(name):
+    print("Creating %s" % name)
+    subprocess.check_call([sys.executable,os.path.join(here,"replicate.py"),
+                           os.path.join(here,SYSTEMS[system]["data"]),
+                           name,str(nx),str(ny)])
+  return name
+
+def run(args,system,size,machine,seed):
+  sysdef = SYSTEMS[system]
+  t = sysdef["sizes"][size][2]
+  log = os.path.join(args.workdir,"log.%s.%s.%s" % (system,size,machine))
+  if machine == "serial":
+    cmd = [os.path.abspath(args.serial)]
+  else:
+    cmd = args.mpirun.split() + ["-np",str(args.np),os.path.abspath(args.mpi)]
+  cmd += ["-var","data",data_file(args,system,size),
+          "-var","solve",args.solve,
+          "-var","sector",args.sector if machine == "mpi" else "no",
+          "-var","seed",str(seed),
+          "-var","t",str(t),
+          "-in",os.path.join(here,sysdef["input"]),
+          "-log",log,"-screen","none"]
+  subprocess.check_call(cmd)
+  return parse(open(log).read(),len(sysdef["columns"]))
+
+# extract stats of last thermo line and Finish timings from a log
+# diag columns follow Time, Naccept, Nreject, Nsweeps, CPU
+
+def parse(text,ncolumn):
+  result = {"timers": {}}
+  last = None
+  instats = 0
+  for line in text.split("\n"):
+    words = line.split()
+    if words[:2] == ["Time","Naccept"]: instats = 1
+    elif instats and words:
+      try:
+        float(words[0])
+        last = words
+      except ValueError: instats = 0
+    m = re.match(r"Loop time of (\S+) on (\d+) procs",line)
+    if m:
+      result["loop"] = float(m.group(1))
+      result["procs"] = int(m.group(2))
+    m = re.match(r"(\w+)\s+time \(%\) = (\S+) \((\S+)\)",line)
+    if m and m.group(1) in TIMERS:
+      result["timers"][m.group(1)] = float(m.group(2))
+  if "loop" not in result or not last:
+    raise RuntimeError("Could not find stats and Loop time in log")
+  result["naccept"] = int(float(last[1]))
+  result["species"] = [float(v) for v in last[5:5+ncolumn]]
+  loop = result["loop"]
+  result["rate"] = result["naccept"]/loop if loop > 0.0 else 0.0
+  return result
+
+# ---------------------------------------------------------------------
+
+def read_reference(name):
+  ref = {}
+  if not os.path.exists(name): return ref
+  for line in open(name):
+    words = line.split("#")[0].split()
+    if len(words) != 5: continue
+    ref[(words[0],words[1],words[2])] = (float(words[3]),float(words[4]))
+  return ref
+
+def write_reference(args,name):
+  rows = []
+  for system in args.system:
+    sysdef = SYSTEMS[system]
+    for size in args.size:
+      samples = []
+      for k in range(args.update):
+        print("Reference %s %s seed %d" % (system,size,sysdef["seed"]+k))
+        r = run(args,system,size,"serial",sysdef["seed"]+k)
+        samples.append(r["species"])
+      for j,column in enumerate(sysdef["columns"]):
+        values = [s[j] for s in samples]
+        mean = sum(values)/len(values)
+        var = 0.0
+        if len(values) > 1:
+          var = sum((v-mean)**2 for v in values)/(len(values)-1)
+        rows.append("%s %s %s %.10g %.6g" %
+                    (system,size,column,mean,math.sqrt(var)))
+  ref = read_reference(name)
+  keep = [key for key in ref if key[0] not in args.system or
+          key[1] not in args.size]
+  f = open(name,"w")
+  f.write("# ALD benchmark reference, species counts at end of run\n")
+  f.write("# from %d serial runs with solve style %s\n" %
+          (args.update,args.solve))
+  f.write("# system size column mean sd\n")
+  for key in sorted(keep):
+    f.write("%s %s %s %.10g %.6g\n" % (key + ref[key]))
+  for row in rows: f.write(row + "\n")
+  f.close()
+
+def check(args,ref,system,size,species):
+  failed = []
+  missing = 0
+  for column,value in zip(SYSTEMS[system]["columns"],species):
+    key = (system,size,column)
+    if key not in ref:
+      missing = 1
+      continue
+    mean,sd = ref[key]
+    tol = args.nsigma*max(sd,math.sqrt(max(abs(mean),1.0)))
+    if abs(value-mean) > tol:
+      failed.append("%s %g vs %g +/- %g" % (column,value,mean,tol))
+  if missing: return "noref",failed
+  return ("fail" if failed else "pass"),failed
+
+# ---------------------------------------------------------------------
+
+parser = argparse.ArgumentParser(description="ALD benchmark suite")
+parser.add_argument("-s","--system",default="hfo2,zno",
+                    help="comma list of hfo2,zno")
+parser.add_argument("-z","--size",default="16k,128k,1M",
+                    help="comma list of 16k,128k,1M")
+parser.add_argument("-m","--machine",default="serial,mpi",
+                    help="comma list of serial,mpi")
+parser.add_argument("--serial",default=os.path.join(here,"../../spk_serial"))
+parser.add_argument("--mpi",default=os.path.join(here,"../../spk_mpi"))
+parser.add_argument("--mpirun",default="mpirun")
+parser.add_argument("--np",type=int,default=4)
+parser.add_argument("--solve",default="tree",help="solve style")
+parser.add_argument("--sector",default="yes",help="sector setting for mpi")
+parser.add_argument("--nsigma",type=float,default=4.0)
+parser.add_argument("--workdir",default=".")
+parser.add_argument("--reference",default=os.path.join(here,"ref.bench_ald"))
+parser.add_argument("--csv",default="bench_ald.csv")
+parser.add_argument("-u","--update",type=int,default=0,
+                    help="rebuild reference from N serial runs")
+args = parser.parse_args()
+
+args.system = args.system.split(",")
+args.size = args.size.split(",")
+args.machine = args.machine.split(",")
+for system in args.system:
+  if system not in SYSTEMS: sys.exit("Unknown system %s" % system)
+  for size in args.size:
+    if size not in SYSTEMS[system]["sizes"]: sys.exit("Unknown size %s" % size)
+for machine in args.machine:
+  if machine not in ("serial","mpi"): sys.exit("Unknown machine %s" % machine)
+if not os.path.isdir(args.workdir): os.makedirs(args.workdir)
+
+if args.update:
+  write_reference(args,args.reference)
+  sys.exit()
+
+ref = read_reference(args.reference)
+newcsv = not os.path.exists(args.csv)
+csv = open(args.csv,"a")
+if newcsv:
+  csv.write("system,size,machine,procs,solve,loop,naccept,events_per_s," +
+            ",".join(t.lower() for t in TIMERS) + ",check\n")
+
+print("%-5s %-5s %-7s %5s %10s %10s %12s  %s" %
+      ("sys","size","machine","procs","loop","naccept","events/s","check"))
+status = 0
+for system in args.system:
+  for size in args.size:
+    for machine in args.machine:
+      r = run(args,system,size,machine,SYSTEMS[system]["seed"])
+      result,failed = check(args,ref,system,size,r["species"])
+      if result == "fail" and machine in SYSTEMS[system].get("xfail",[]):
+        result = "xfail"
+      if result == "fail": status = 1
+      print("%-5s %-5s %-7s %5d %10.4g %10d %12.5g  %s" %
+            (system,size,machine,r["procs"],r["loop"],r["naccept"],
+             r["rate"],result))
+      times = ["%g" % (100.0*r["timers"].get(t,0.0)/r["loop"]
+                       if r["loop"] > 0.0 else 0.0) for t in TIMERS]
+      print("      % " + " ".join("%s %s" % (t,v) for t,v in zip(TIMERS,times)))
+      for line in failed: print("      " + line)
+      csv.write("%s,%s,%s,%d,%s,%g,%d,%g,%s,%s\n" %
+                (system,size,machine,r["procs"],args.solve,r["loop"],
+                 r["naccept"],r["rate"],
+                 ",".join("%g" % r["timers"].get(t,0.0) for t in TIMERS),
+                 result))
+csv.close()
+sys.exit(status)
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+
+# Script:  replicate.py
+# Purpose: tile a read_sites data file periodically in x and y
+# Syntax:  replicate.py infile outfile nx ny
+#          infile = data file with Sites, Neighbors, Values sections
+#          nx,ny = # of copies in x and y
+#
+# box must be periodic in x and y, a neighbor more than half a box
+#   length away is taken to be across the periodic boundary
+# copy (a,b) of site I gets ID (b*nx + a)*N + I for N sites in infile
+
+import sys
+
+def sections(lines):
+  idx = {}
+  for i,line in enumerate(lines):
+    word = line.split("#")[0].strip()
+    if word in ("Sites","Neighbors","Values"): idx[word] = i
+  return idx
+
+if len(sys.argv) != 5:
+  sys.exit("Syntax: replicate.py infile outfile nx ny")
+
+infile,outfile = sys.argv[1],sys.argv[2]
+nx,ny = int(sys.argv[3]),int(sys.argv[4])
+
+lines = open(infile).read().split("\n")
+idx = sections(lines)
+header = lines[:idx["Sites"]]
+
+nsites = 0
+box = {}
+for line in header:
+  words = line.split("#")[0].split()
+  if len(words) == 2 and words[1] == "sites": nsites = int(words[0])
+  if len(words) == 4 and words[2] in ("xlo","ylo","zlo"):
+    box[words[2][0]] = (float(words[0]),float(words[1]))
+if not nsites or len(box) != 3:
+  sys.exit("Data file header is missing sites or box bounds")
+
+def body(section):
+  rows = []
+  i = idx[section] + 1
+  while len(rows) < nsites:
+    words = lines[i].split()
+    i += 1
+    if words: rows.append(words)
+  return rows
+
+sites = body("Sites")
+neighs = body("Neighbors")
+values = body("Values")
+
+xlo,xhi = box["x"]
+ylo,yhi = box["y"]
+xprd,yprd = xhi-xlo,yhi-ylo
+xyz = {}
+for words in sites: xyz[int(words[0])] = (float(words[1]),float(words[2]))
+
+# image shift of neighbor J relative to site I in x and y
+
+shift = {}
+for words in neighs:
+  i = int(words[0])
+  for j in map(int,words[1:]):
+    if j == 0: continue
+    dx = xyz[j][0] - xyz[i][0]
+    dy = xyz[j][1] - xyz[i][1]
+    sx = -1 if dx > 0.5*xprd else (1 if dx < -0.5*xprd else 0)
+    sy = -1 if dy > 0.5*yprd else (1 if dy < -0.5*yprd else 0)
+    shift[(i,j)] = (sx,sy)
+
+def newid(i,a,b):
+  return ((b % ny)*nx + (a % nx))*nsites + i
+
+out = open(outfile,"w")
+for line in header:
+  words = line.split("#")[0].split()
+  if len(words) == 2 and words[1] == "sites":
+    out.write("%d sites\n" % (nsites*nx*ny))
+  elif len(words) == 4 and words[2] == "xlo":
+    out.write("%g %g xlo xhi\n" % (xlo,xlo + nx*xprd))
+  elif len(words) == 4 and words[2] == "ylo":
+    out.write("%g %g ylo yhi\n" % (ylo,ylo + ny*yprd))
+  else: out.write(line + "\n")
+
+out.write("Sites\n\n")
+for b in range(ny):
+  for a in range(nx):
+    for words in sites:
+      i = int(words[0])
+      out.write("%d %.7g %.7g %s\n" %
+                (newid(i,a,b),xyz[i][0] + a*xprd,xyz[i][1] + b*yprd,words[3]))
+
+out.write("\nNeighbors\n\n")
+for b in range(ny):
+  for a in range(nx):
+    for words in neighs:
+      i = int(words[0])
+      ids = [newid(i,a,b)]
+      for j in map(int,words[1:]):
+        if j == 0: ids.append(0)
+        else:
+          sx,sy = shift[(i,j)]
+          ids.append(newid(j,a+sx,b+sy))
+      out.write(" ".join(map(str,ids)) + "\n")
+
+out.write("\nValues\n\n")
+for b in range(ny):
+  for a in range(nx):
+    for words in values:
+      out.write("%d %s\n" % (newid(int(words[0]),a,b)," ".join(words[1:])))
+out.close()
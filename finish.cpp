@@ -26,16 +26,19 @@ Finish::Finish (SPPARKS *spk, int flag) : Pointers(spk)
 {
   double time,tmp;
 
-  int me,nprocs;
   MPI_Comm_rank(world,&me);
   MPI_Comm_size(world,&nprocs);
 
+  // split unsampled event time among buckets if timer level = off
+
+  timer->apportion();
+
   // deduce time_other
 
   double time_other = timer->array[TIME_LOOP] -
     (timer->array[TIME_SOLVE] + timer->array[TIME_COMM] + 
      timer->array[TIME_UPDATE] + timer->array[TIME_OUTPUT] + 
-     timer->array[TIME_APP]);
+     timer->array[TIME_APP] + timer->array[TIME_EVENT]);
 
   double time_loop = timer->array[TIME_LOOP];
   MPI_Allreduce(&time_loop,&tmp,1,MPI_DOUBLE,MPI_SUM,world);
@@ -113,6 +116,22 @@ Finish::Finish (SPPARKS *spk, int flag) : Pointers(spk)
       fprintf(logfile,"App   time (%%) = %g (%g)\n",time,time/time_loop*100.0);
   }
 
+  // event time that could not be split, since no events were sampled
+
+  if (timer->level == TIMER_OFF) {
+    time = timer->array[TIME_EVENT];
+    MPI_Allreduce(&time,&tmp,1,MPI_DOUBLE,MPI_SUM,world);
+    time = tmp/nprocs;
+    if (me == 0) {
+      if (screen) 
+	fprintf(screen,"Event time (%%) = %g (%g)\n",
+		time,time/time_loop*100.0);
+      if (logfile) 
+	fprintf(logfile,"Event time (%%) = %g (%g)\n",
+		time,time/time_loop*100.0);
+    }
+  }
+
   time = time_other;
   MPI_Allreduce(&time,&tmp,1,MPI_DOUBLE,MPI_SUM,world);
   time = tmp/nprocs;
@@ -122,6 +141,99 @@ Finish::Finish (SPPARKS *spk, int flag) : Pointers(spk)
     if (logfile) 
       fprintf(logfile,"Other time (%%) = %g (%g)\n",time,time/time_loop*100.0);
   }
+
+  if (timer->level == TIMER_DETAILED) {
+    imbalance(time_loop,time_other);
+    regions(time_loop);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   min/ave/max across procs of each timing bucket
+------------------------------------------------------------------------- */
+
+void Finish::imbalance(double time_loop, double time_other)
+{
+  const char *names[] = {"Solve","Update","Comm","Outpt","App","Other"};
+  double time[6];
+  time[0] = timer->array[TIME_SOLVE];
+  time[1] = timer->array[TIME_UPDATE];
+  time[2] = timer->array[TIME_COMM];
+  time[3] = timer->array[TIME_OUTPUT];
+  time[4] = timer->array[TIME_APP];
+  time[5] = time_other;
+
+  double tmin[6],tave[6],tmax[6];
+  MPI_Allreduce(time,tmin,6,MPI_DOUBLE,MPI_MIN,world);
+  MPI_Allreduce(time,tave,6,MPI_DOUBLE,MPI_SUM,world);
+  MPI_Allreduce(time,tmax,6,MPI_DOUBLE,MPI_MAX,world);
+
+  if (me) return;
+
+  char line[256];
+  sprintf(line,"\nPer-proc time: %10s %10s %10s %8s\n",
+	  "min","ave","max","max/ave");
+  if (screen) fputs(line,screen);
+  if (logfile) fputs(line,logfile);
+
+  for (int i = 0; i < 6; i++) {
+    tave[i] /= nprocs;
+    double ratio = tave[i] > 0.0 ? tmax[i]/tave[i] : 1.0;
+    sprintf(line,"%-14s %10.4g %10.4g %10.4g %8.3f\n",
+	    names[i],tmin[i],tave[i],tmax[i],ratio);
+    if (screen) fputs(line,screen);
+    if (logfile) fputs(line,logfile);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   named sub-region timings from timer level = detailed
+   total is averaged over procs, per-call stats are over all procs
+------------------------------------------------------------------------- */
+
+void Finish::regions(double time_loop)
+{
+  int nregion = timer->nregion;
+  if (nregion == 0) return;
+
+  bigint *count = new bigint[nregion];
+  double *total = new double[nregion];
+  double *totalmax = new double[nregion];
+  double *rmin = new double[nregion];
+  double *rmax = new double[nregion];
+
+  MPI_Allreduce(timer->rcount,count,nregion,MPI_SPK_BIGINT,MPI_SUM,world);
+  MPI_Allreduce(timer->rtotal,total,nregion,MPI_DOUBLE,MPI_SUM,world);
+  MPI_Allreduce(timer->rtotal,totalmax,nregion,MPI_DOUBLE,MPI_MAX,world);
+  MPI_Allreduce(timer->rmin,rmin,nregion,MPI_DOUBLE,MPI_MIN,world);
+  MPI_Allreduce(timer->rmax,rmax,nregion,MPI_DOUBLE,MPI_MAX,world);
+
+  if (me == 0) {
+    char line[256];
+    sprintf(line,"\n%-20s %12s %10s %7s %10s %10s %10s %8s\n",
+	    "Region","Count","Total","%Loop",
+	    "Mean/call","Min/call","Max/call","max/ave");
+    if (screen) fputs(line,screen);
+    if (logfile) fputs(line,logfile);
+
+    for (int m = 0; m < nregion; m++) {
+      double ave = total[m]/nprocs;
+      double mean = count[m] ? total[m]/count[m] : 0.0;
+      double ratio = ave > 0.0 ? totalmax[m]/ave : 1.0;
+      if (count[m] == 0) rmin[m] = 0.0;
+      sprintf(line,"%-20s %12.0f %10.4g %7.2f %10.4g %10.4g %10.4g %8.3f\n",
+	      timer->rname[m],(double) count[m],ave,ave/time_loop*100.0,
+	      mean,rmin[m],rmax[m],ratio);
+      if (screen) fputs(line,screen);
+      if (logfile) fputs(line,logfile);
+    }
+  }
+
+  delete [] count;
+  delete [] total;
+  delete [] totalmax;
+  delete [] rmin;
+  delete [] rmax;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -24,6 +24,10 @@ class Finish : protected Pointers {
   ~Finish() {}
 
  private:
+  int me,nprocs;
+
+  void imbalance(double, double);
+  void regions(double);
   void stats(int, double *, double *, double *, double *, int, int *);
 };
 
@@ -194,17 +194,16 @@ void Groups::alter_element(int n, double *p, double p_new)
 
 /* ----------------------------------------------------------------------
    sample distribution
+   rejection must retry within the selected group,
+   reselecting the group would weight it by its acceptance rate
 ------------------------------------------------------------------------- */
 
 int Groups::sample(double *p)
 {
-  int g;
+  int g = linear_select_group();
 
   int r = -1;
-  while (r < 0) {
-    g = linear_select_group();
-    r = sample_with_rejection(g,p);
-  }
+  while (r < 0) r = sample_with_rejection(g,p);
   return r;
 }
 
@@ -352,3 +351,21 @@ void Groups::sanity_check(double *p)
 
   if (flag) printf("Mis-match of propensity with group: %d\n",flag);
 }
+
+/* ----------------------------------------------------------------------
+   return # of bytes of allocated memory
+------------------------------------------------------------------------- */
+
+bigint Groups::memory_usage()
+{
+  bigint bytes = 0;
+  if (g2p == NULL) return bytes;
+
+  for (int g = 0; g <= ngroups; g++)
+    bytes += memory->usage(g2p[g],gmaxsize[g]);    // g2p
+  bytes += (ngroups+1) * sizeof(int *);            // g2p
+  bytes += 2*(ngroups+1) * sizeof(int);            // gcount,gmaxsize
+  bytes += 2*(ngroups+1) * sizeof(double);         // gpsum,ghibound
+  bytes += 2*memory->usage(p2g,size);              // p2g,p2g_index
+  return bytes;
+}
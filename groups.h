@@ -26,6 +26,7 @@ class Groups : protected Pointers {
   void partition(double *,int);
   void alter_element(int, double *, double);
   int sample(double *);
+  bigint memory_usage();
 
  private:
   int size;             // number of propensities
@@ -337,67 +337,166 @@ void Image::clear()
 /* ----------------------------------------------------------------------
    merge image from each processor into one composite image
    done pixel by pixel, respecting depth buffer
-   hi procs send to lo procs, cascading down logarithmically
+   procs beyond largest power of 2 first send to lo procs
+   then binary swap: at each stage partners exchange half of the
+     pixels they own, so each ends up owning 1/P of the composite image
+   pieces are gathered to proc 0 which writes the image,
+     or to all procs if SSAO needs the full depth buffer
 ------------------------------------------------------------------------- */
 
 void Image::merge()
 {
   MPI_Request requests[3];
   MPI_Status statuses[3];
+  MPI_Status status;
 
-  int nhalf = 1;
-  while (nhalf < nprocs) nhalf *= 2;
-  nhalf /= 2;
+  if (nprocs == 1) {
+    if (ssao) compute_SSAO();
+    writeBuffer = imageBuffer;
+    return;
+  }
 
-  while (nhalf) {
-    if (me < nhalf && me+nhalf < nprocs) {
-      MPI_Irecv(rgbcopy,npixels*3,MPI_BYTE,me+nhalf,0,world,&requests[0]);
-      MPI_Irecv(depthcopy,npixels,MPI_DOUBLE,me+nhalf,0,world,&requests[1]);
-      if (ssao)
-	MPI_Irecv(surfacecopy,npixels*2,MPI_DOUBLE,
-		  me+nhalf,0,world,&requests[2]);
-      if (ssao) MPI_Waitall(3,requests,statuses);
-      else MPI_Waitall(2,requests,statuses);
-
-      for (int i = 0; i < npixels; i++) {
-        if (depthBuffer[i] < 0 || (depthcopy[i] >= 0 && 
-				   depthcopy[i] < depthBuffer[i])) {
-          depthBuffer[i] = depthcopy[i];
-          imageBuffer[i*3+0] = rgbcopy[i*3+0];
-          imageBuffer[i*3+1] = rgbcopy[i*3+1];
-          imageBuffer[i*3+2] = rgbcopy[i*3+2];
-          if (ssao) {
-            surfaceBuffer[i*2+0] = surfacecopy[i*2+0];
-            surfaceBuffer[i*2+1] = surfacecopy[i*2+1];
-          }
-        }
+  int pof2 = 1;
+  while (2*pof2 <= nprocs) pof2 *= 2;
+
+  if (me >= pof2) {
+    MPI_Send(imageBuffer,npixels*3,MPI_BYTE,me-pof2,0,world);
+    MPI_Send(depthBuffer,npixels,MPI_DOUBLE,me-pof2,0,world);
+    if (ssao) MPI_Send(surfaceBuffer,npixels*2,MPI_DOUBLE,me-pof2,0,world);
+  } else if (me+pof2 < nprocs) {
+    MPI_Irecv(rgbcopy,npixels*3,MPI_BYTE,me+pof2,0,world,&requests[0]);
+    MPI_Irecv(depthcopy,npixels,MPI_DOUBLE,me+pof2,0,world,&requests[1]);
+    if (ssao)
+      MPI_Irecv(surfacecopy,npixels*2,MPI_DOUBLE,
+		me+pof2,0,world,&requests[2]);
+    if (ssao) MPI_Waitall(3,requests,statuses);
+    else MPI_Waitall(2,requests,statuses);
+    composite(0,npixels,0);
+  }
+
+  // binary swap among 1st pof2 procs
+  // lower half of pixel range goes to proc with 0 in current bit
+  // partners always own the same range at start of a stage
+
+  int lo = 0;
+  int hi = npixels;
+
+  if (me < pof2) {
+    for (int mask = 1; mask < pof2; mask *= 2) {
+      int partner = me ^ mask;
+      int mid = lo + (hi-lo)/2;
+      int keeplo,keephi,sendlo,sendhi;
+      if (me & mask) {
+	keeplo = mid; keephi = hi;
+	sendlo = lo; sendhi = mid;
+      } else {
+	keeplo = lo; keephi = mid;
+	sendlo = mid; sendhi = hi;
       }
+      int nsend = sendhi - sendlo;
+      int nkeep = keephi - keeplo;
 
-    } else if (me >= nhalf && me < 2*nhalf) {
-      MPI_Send(imageBuffer,npixels*3,MPI_BYTE,me-nhalf,0,world);
-      MPI_Send(depthBuffer,npixels,MPI_DOUBLE,me-nhalf,0,world);
-      if (ssao) MPI_Send(surfaceBuffer,npixels*2,MPI_DOUBLE,me-nhalf,0,world);
+      MPI_Sendrecv(&imageBuffer[3*sendlo],3*nsend,MPI_BYTE,partner,0,
+		   &rgbcopy[3*keeplo],3*nkeep,MPI_BYTE,partner,0,world,&status);
+      MPI_Sendrecv(&depthBuffer[sendlo],nsend,MPI_DOUBLE,partner,0,
+		   &depthcopy[keeplo],nkeep,MPI_DOUBLE,partner,0,world,&status);
+      if (ssao)
+	MPI_Sendrecv(&surfaceBuffer[2*sendlo],2*nsend,MPI_DOUBLE,partner,0,
+		     &surfacecopy[2*keeplo],2*nkeep,MPI_DOUBLE,partner,0,
+		     world,&status);
+
+      composite(keeplo,keephi,partner < me);
+      lo = keeplo;
+      hi = keephi;
     }
+  } else lo = hi = 0;
+
+  // range of pixels owned by each proc
 
-    nhalf /= 2;
+  int range[2];
+  range[0] = lo;
+  range[1] = hi - lo;
+  int *ranges = new int[2*nprocs];
+  int *counts = new int[nprocs];
+  int *displs = new int[nprocs];
+  MPI_Allgather(range,2,MPI_INT,ranges,2,MPI_INT,world);
+
+  // gather composite image to proc 0 only
+
+  if (!ssao) {
+    for (int i = 0; i < nprocs; i++) {
+      displs[i] = 3*ranges[2*i];
+      counts[i] = 3*ranges[2*i+1];
+    }
+    MPI_Gatherv(&imageBuffer[3*lo],3*(hi-lo),MPI_BYTE,
+		rgbcopy,counts,displs,MPI_BYTE,0,world);
+    writeBuffer = rgbcopy;
+
+    delete [] ranges;
+    delete [] counts;
+    delete [] displs;
+    return;
   }
 
   // extra SSAO enhancement
-  // bcast full image to all procs
+  // all procs need full depth and surface buffers
   // each works on subset of pixels
   // gather result back to proc 0
 
-  if (ssao) {
-    MPI_Bcast(imageBuffer,npixels*3,MPI_BYTE,0,world);
-    MPI_Bcast(surfaceBuffer,npixels*2,MPI_DOUBLE,0,world);
-    MPI_Bcast(depthBuffer,npixels,MPI_DOUBLE,0,world);
-    compute_SSAO();
-    int pixelPart = height/nprocs * width*3;
-    MPI_Gather(imageBuffer+me*pixelPart,pixelPart,MPI_BYTE,
-               rgbcopy,pixelPart,MPI_BYTE,0,world);
-    writeBuffer = rgbcopy;
-  } else {
-    writeBuffer = imageBuffer;
+  for (int i = 0; i < nprocs; i++) {
+    displs[i] = 3*ranges[2*i];
+    counts[i] = 3*ranges[2*i+1];
+  }
+  MPI_Allgatherv(&imageBuffer[3*lo],3*(hi-lo),MPI_BYTE,
+		 rgbcopy,counts,displs,MPI_BYTE,world);
+  for (int i = 0; i < nprocs; i++) {
+    displs[i] = ranges[2*i];
+    counts[i] = ranges[2*i+1];
+  }
+  MPI_Allgatherv(&depthBuffer[lo],hi-lo,MPI_DOUBLE,
+		 depthcopy,counts,displs,MPI_DOUBLE,world);
+  for (int i = 0; i < nprocs; i++) {
+    displs[i] = 2*ranges[2*i];
+    counts[i] = 2*ranges[2*i+1];
+  }
+  MPI_Allgatherv(&surfaceBuffer[2*lo],2*(hi-lo),MPI_DOUBLE,
+		 surfacecopy,counts,displs,MPI_DOUBLE,world);
+
+  delete [] ranges;
+  delete [] counts;
+  delete [] displs;
+
+  char *ctmp = imageBuffer; imageBuffer = rgbcopy; rgbcopy = ctmp;
+  double *dtmp = depthBuffer; depthBuffer = depthcopy; depthcopy = dtmp;
+  dtmp = surfaceBuffer; surfaceBuffer = surfacecopy; surfacecopy = dtmp;
+
+  compute_SSAO();
+  int pixelPart = height/nprocs * width*3;
+  MPI_Gather(imageBuffer+me*pixelPart,pixelPart,MPI_BYTE,
+	     rgbcopy,pixelPart,MPI_BYTE,0,world);
+  writeBuffer = rgbcopy;
+}
+
+/* ----------------------------------------------------------------------
+   merge received pixels lo to hi-1 in copy buffers into my image
+   lower = 1 if they came from a lower proc, which wins ties in depth
+------------------------------------------------------------------------- */
+
+void Image::composite(int lo, int hi, int lower)
+{
+  for (int i = lo; i < hi; i++) {
+    if (depthcopy[i] < 0) continue;
+    if (depthBuffer[i] < 0 || depthcopy[i] < depthBuffer[i] ||
+	(lower && depthcopy[i] == depthBuffer[i])) {
+      depthBuffer[i] = depthcopy[i];
+      imageBuffer[i*3+0] = rgbcopy[i*3+0];
+      imageBuffer[i*3+1] = rgbcopy[i*3+1];
+      imageBuffer[i*3+2] = rgbcopy[i*3+2];
+      if (ssao) {
+	surfaceBuffer[i*2+0] = surfacecopy[i*2+0];
+	surfaceBuffer[i*2+1] = surfacecopy[i*2+1];
+      }
+    }
   }
 }
 
@@ -436,9 +535,11 @@ void Image::draw_axes(double (*axes)[3], double diameter)
 /* ----------------------------------------------------------------------
    draw sphere at x with surfaceColor and diameter
    render pixel by pixel onto image plane with depth buffering
+   only rows ylo to yhi-1 are drawn, yhi < 0 means all rows
 ------------------------------------------------------------------------- */
 
-void Image::draw_sphere(double *x, double *surfaceColor, double diameter)
+void Image::draw_sphere(double *x, double *surfaceColor, double diameter,
+			int ylo, int yhi)
 {
   int ix,iy;
   double projRad;
@@ -472,9 +573,13 @@ void Image::draw_sphere(double *x, double *surfaceColor, double diameter)
   xc += width / 2;
   yc += height / 2;
 
-  for (iy = yc - pixelRadius; iy <= yc + pixelRadius; iy++) {
+  if (yhi < 0) yhi = height;
+  int iylo = MAX(yc - pixelRadius,MAX(ylo,0));
+  int iyhi = MIN(yc + pixelRadius,MIN(yhi,height)-1);
+
+  for (iy = iylo; iy <= iyhi; iy++) {
     for (ix = xc - pixelRadius; ix <= xc + pixelRadius; ix++) {
-      if (iy < 0 || iy >= height || ix < 0 || ix >= width) continue;
+      if (ix < 0 || ix >= width) continue;
 
       surface[1] = ((iy - yc) - height_error) * pixelWidth;
       surface[0] = ((ix - xc) - width_error) * pixelWidth;
@@ -498,9 +603,11 @@ void Image::draw_sphere(double *x, double *surfaceColor, double diameter)
 /* ----------------------------------------------------------------------
    draw axis oriented cube at x with surfaceColor and diameter in size
    render pixel by pixel onto image plane with depth buffering
+   only rows ylo to yhi-1 are drawn, yhi < 0 means all rows
 ------------------------------------------------------------------------- */
 
-void Image::draw_cube(double *x, double *surfaceColor, double diameter)
+void Image::draw_cube(double *x, double *surfaceColor, double diameter,
+		      int ylo, int yhi)
 {
   double xlocal[3],surface[3],normal[3];
   double t,tdir[3];
@@ -534,9 +641,13 @@ void Image::draw_cube(double *x, double *surfaceColor, double diameter)
   xc += width / 2;
   yc += height / 2;
 
-  for (int iy = yc - pixelHalfWidth; iy <= yc + pixelHalfWidth; iy ++) {
+  if (yhi < 0) yhi = height;
+  int iylo = MAX(yc - pixelHalfWidth,MAX(ylo,0));
+  int iyhi = MIN(yc + pixelHalfWidth,MIN(yhi,height)-1);
+
+  for (int iy = iylo; iy <= iyhi; iy ++) {
     for (int ix = xc - pixelHalfWidth; ix <= xc + pixelHalfWidth; ix ++) {
-      if (iy < 0 || iy >= height || ix < 0 || ix >= width) continue;
+      if (ix < 0 || ix >= width) continue;
       
       double sy = ((iy - yc) - height_error) * pixelWidth;
       double sx = ((ix - xc) - width_error) * pixelWidth;
@@ -1754,3 +1865,16 @@ double Image::element2diam(char *element)
     if (strcmp(element,name[i]) == 0) return diameter[i];
   return 0.0;
 }
+
+/* ----------------------------------------------------------------------
+   return # of bytes of allocated memory in image buffers
+------------------------------------------------------------------------- */
+
+bigint Image::memory_usage()
+{
+  bigint bytes = 0;
+  bytes += (bigint) 2*npixels * sizeof(double);     // depthBuffer,depthcopy
+  bytes += (bigint) 4*npixels * sizeof(double);     // surfaceBuffer,copy
+  bytes += (bigint) 6*npixels * sizeof(char);       // imageBuffer,rgbcopy
+  return bytes;
+}
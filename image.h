@@ -43,10 +43,11 @@ class Image : protected Pointers {
   void write_JPG(FILE *);
   void write_PPM(FILE *);
   void view_params(double, double, double, double, double, double);
+  bigint memory_usage();
 
   void color_minmax(int, double *, int);
-  void draw_sphere(double *, double *, double);
-  void draw_cube(double *, double *, double);
+  void draw_sphere(double *, double *, double, int ylo = 0, int yhi = -1);
+  void draw_cube(double *, double *, double, int ylo = 0, int yhi = -1);
   void draw_cylinder(double *, double *, double *, double, int);
   void draw_triangle(double *, double *, double *, double *);
   void draw_box(double (*)[3], double);
@@ -132,6 +133,7 @@ class Image : protected Pointers {
 
   void draw_pixel(int, int, double, double *, double*);
   void compute_SSAO();
+  void composite(int, int, int);
 
   // inline functions
 
@@ -25,6 +25,8 @@
 #include "potential.h"
 #include "pair.h"
 #include "output.h"
+#include "ensemble.h"
+#include "timer.h"
 #include "random_mars.h"
 #include "error.h"
 #include "memory.h"
@@ -405,6 +407,7 @@ int Input::execute_command()
   else if (!strcmp(command,"dump")) dump();
   else if (!strcmp(command,"dump_modify")) dump_modify();
   else if (!strcmp(command,"dump_one")) dump_one();
+  else if (!strcmp(command,"ensemble")) ensemble();
   else if (!strcmp(command,"lattice")) lattice();
   else if (!strcmp(command,"pair_coeff")) pair_coeff();
   else if (!strcmp(command,"pair_style")) pair_style();
@@ -415,6 +418,7 @@ int Input::execute_command()
   else if (!strcmp(command,"seed")) seed();
   else if (!strcmp(command,"solve_style")) solve_style();
   else if (!strcmp(command,"stats")) stats();
+  else if (!strcmp(command,"timer")) timer_command();
   else if (!strcmp(command,"undump")) undump();
 
   else flag = 0;
@@ -729,6 +733,13 @@ void Input::dump_one()
 
 /* ---------------------------------------------------------------------- */
 
+void Input::ensemble()
+{
+  output->set_ensemble(narg,arg);
+}
+
+/* ---------------------------------------------------------------------- */
+
 void Input::lattice()
 {
   if (app == NULL) error->all(FLERR,"Lattice command before app_style set");
@@ -809,6 +820,10 @@ void Input::seed()
   int seed = atoi(arg[0]);
   if (seed <= 0) error->all(FLERR,"Illegal seed command");
 
+  // each ensemble partition runs a replica with a different seed
+
+  if (output->ensemble) seed += universe->iworld * output->ensemble->stride;
+
   ranmaster->init(seed);
 }
 
@@ -842,6 +857,13 @@ void Input::stats()
 
 /* ---------------------------------------------------------------------- */
 
+void Input::timer_command()
+{
+  timer->set(narg,arg);
+}
+
+/* ---------------------------------------------------------------------- */
+
 void Input::undump()
 {
   if (app == NULL) error->all(FLERR,"Undump command before app_style set");
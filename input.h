@@ -67,6 +67,7 @@ class Input : protected Pointers {
   void dump();
   void dump_modify();
   void dump_one();
+  void ensemble();
   void lattice();
   void pair_coeff();
   void pair_style();
@@ -77,6 +78,7 @@ class Input : protected Pointers {
   void seed();
   void solve_style();
   void stats();
+  void timer_command();
   void undump();
 };
 
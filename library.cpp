@@ -23,6 +23,7 @@
 #include "comm_lattice.h"
 #include "comm_off_lattice.h"
 #include "input.h"
+#include "output.h"
 
 using namespace SPPARKS_NS;
 
@@ -107,6 +108,46 @@ void *spparks_extract(void *ptr, char *name)
   return spk->app->extract(name);
 }
 
+/* ----------------------------------------------------------------------
+   extract a per-site array of owned sites without copying it
+   name = id, xyz, iarrayN, darrayN, or propensity
+   returns pointer to 1st value, or NULL if name is not recognized
+   dtype = SPPARKS_INT32, SPPARKS_INT64, or SPPARKS_DOUBLE
+   n = # of owned sites, ncol = # of values per site
+   stride = # of values between consecutive sites
+   pointer is valid until sites are added, removed, or reallocated,
+     e.g. by a new run, so extract again after each run or callback
+   propensity is a snapshot gathered into a buffer owned by the app,
+     with zero for inactive sites, so it must be extracted again to update
+   from Python, numpy.ctypeslib.as_array() can wrap it as an
+     n x ncol array that shares memory with SPPARKS
+------------------------------------------------------------------------- */
+
+void *spparks_extract_array(void *ptr, char *name, int *dtype,
+			    int *n, int *ncol, int *stride)
+{
+  SPPARKS *spk = (SPPARKS *) ptr;
+  if (spk->app == NULL) return NULL;
+  void *data = spk->app->extract_array(name,dtype,n,ncol);
+  *stride = *ncol;
+  return data;
+}
+
+/* ----------------------------------------------------------------------
+   register a function to call during runs for in-situ analysis
+   func(ptr,time,data) is called on every proc every delta in time,
+     and at the end of each run, or only at the end if delta = 0
+   func can call spparks_extract_array() on ptr, but not run commands
+   func = NULL removes the callback
+------------------------------------------------------------------------- */
+
+void spparks_set_callback(void *ptr, void (*func)(void *, double, void *),
+			  void *data, double delta)
+{
+  SPPARKS *spk = (SPPARKS *) ptr;
+  spk->output->set_callback(func,data,delta);
+}
+
 /* ----------------------------------------------------------------------
    return total energy of system
 ------------------------------------------------------------------------- */
@@ -18,6 +18,12 @@
 
 #include "mpi.h"
 
+/* data types of arrays returned by spparks_extract_array() */
+
+#define SPPARKS_INT32 0
+#define SPPARKS_INT64 1
+#define SPPARKS_DOUBLE 2
+
 /* ifdefs allow this file to be included in a C program */
 
 #ifdef __cplusplus
@@ -31,6 +37,9 @@ void spparks_file(void *, char *);
 char *spparks_command(void *, char *);
 
 void *spparks_extract(void *, char *);
+void *spparks_extract_array(void *, char *, int *, int *, int *, int *);
+void spparks_set_callback(void *, void (*)(void *, double, void *),
+                          void *, double);
 double spparks_energy(void *);
 
 #ifdef __cplusplus
@@ -21,6 +21,7 @@
 #include "app.h"
 #include "dump.h"
 #include "diag.h"
+#include "ensemble.h"
 #include "timer.h"
 #include "memory.h"
 #include "error.h"
@@ -46,6 +47,12 @@ Output::Output(SPPARKS *spk) : Pointers(spk)
 
   ndiag = 0;
   diaglist = NULL;
+
+  ensemble = NULL;
+
+  callback = NULL;
+  callback_data = NULL;
+  callback_delta = 0.0;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -57,6 +64,8 @@ Output::~Output()
 
   for (int i = 0; i < ndiag; i++) delete diaglist[i];
   memory->sfree(diaglist);
+
+  delete ensemble;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -67,6 +76,18 @@ void Output::init(double time)
   for (int i = 0; i < ndiag; i++) diaglist[i]->init();
 }
 
+/* ----------------------------------------------------------------------
+   called when app rebalances sites across procs during a run
+   dumps have no accumulated state and are simply re-initialized
+   diags rebuild only their per-site data
+------------------------------------------------------------------------- */
+
+void Output::rebalance()
+{
+  for (int i = 0; i < ndump; i++) dumplist[i]->init();
+  for (int i = 0; i < ndiag; i++) diaglist[i]->rebalance();
+}
+
 /* ----------------------------------------------------------------------
    called before every run
    perform stats output
@@ -111,18 +132,25 @@ double Output::setup(double time, int memflag)
   // set next time for stats
 
   stats_header();
-  stats(0);
+  stats(0,time);
   stats_time = app->stoptime;
   if (stats_delta > 0.0)
     stats_time = next_time(time,stats_logfreq,stats_delta,
 			   stats_nrepeat,stats_scale,stats_delay);
 
+  // next time for callback
+
+  callback_time = app->stoptime;
+  if (callback && callback_delta > 0.0)
+    callback_time = next_time(time,0,callback_delta,0,0.0,0.0);
+
   // tnext = next output time for anything
 
   double tnext = app->stoptime;
   tnext = MIN(tnext,dump_time);
   tnext = MIN(tnext,diag_time);
   tnext = MIN(tnext,stats_time);
+  tnext = MIN(tnext,callback_time);
   return tnext;
 }
 
@@ -169,20 +197,32 @@ double Output::compute(double time, int done)
   
   // stats output, after diagnostics compute any needed quantities
 
+  // slot = scheduled stats time, or current time if done before it
+
   if (sflag) {
-    stats(1);
+    stats(1,MIN(time,stats_time));
     stats_time = app->stoptime;
     if (stats_delta)
       stats_time = next_time(time,stats_logfreq,stats_delta,
 			     stats_nrepeat,stats_scale,stats_delay);
   }
 
+  // callback, invoked on every proc with the SPPARKS instance
+
+  if (callback && (time >= callback_time || done)) {
+    callback((void *) spk,time,callback_data);
+    callback_time = app->stoptime;
+    if (callback_delta > 0.0)
+      callback_time = next_time(time,0,callback_delta,0,0.0,0.0);
+  }
+
   // tnext = next output time for anything
 
   double tnext = app->stoptime;
   tnext = MIN(tnext,dump_time);
   tnext = MIN(tnext,diag_time);
   tnext = MIN(tnext,stats_time);
+  tnext = MIN(tnext,callback_time);
   return tnext;
 }
 
@@ -225,6 +265,31 @@ void Output::set_stats(int narg, char **arg)
   }
 }
 
+/* ----------------------------------------------------------------------
+   replace ensemble settings, stats rows are stored from next run on
+------------------------------------------------------------------------- */
+
+void Output::set_ensemble(int narg, char **arg)
+{
+  delete ensemble;
+  ensemble = new Ensemble(spk,narg,arg);
+}
+
+/* ----------------------------------------------------------------------
+   set function called during runs with SPPARKS ptr, time, and data
+   delta = time between calls, 0 = only at end of each run
+   func = NULL removes the callback
+------------------------------------------------------------------------- */
+
+void Output::set_callback(void (*func)(void *, double, void *),
+			  void *data, double delta)
+{
+  if (delta < 0.0) error->all(FLERR,"Invalid callback interval");
+  callback = func;
+  callback_data = data;
+  callback_delta = delta;
+}
+
 /* ---------------------------------------------------------------------- */
 
 void Output::add_dump(int narg, char **arg)
@@ -322,9 +387,10 @@ void Output::add_diag(Diag *diag)
 
 /* ----------------------------------------------------------------------
    print stats, including contributions from app and diagnostics
+   slot = stats time the line is stored under for ensemble statistics
 ------------------------------------------------------------------------- */
 
-void Output::stats(int timeflag)
+void Output::stats(int timeflag, double slot)
 {
   char str[MAXSTR] = {'\0'};
   char *strpnt = str;
@@ -346,6 +412,8 @@ void Output::stats(int timeflag)
       strpnt += strlen(strpnt);
     }
 
+  if (me == 0 && ensemble) ensemble->add(slot,str);
+
   if (me == 0) {
     if (screen)
       fprintf(screen,"%s\n",str);
@@ -377,6 +445,8 @@ void Output::stats_header()
       strpnt += strlen(strpnt);
     }
 
+  if (me == 0 && ensemble) ensemble->header(str);
+
   if (me == 0) {
     if (screen) fprintf(screen,"%s\n",str);
     if (logfile) {
@@ -420,22 +490,40 @@ double Output::next_time(double tcurrent, int logfreq, double delta,
 /* ----------------------------------------------------------------------
    sum and print memory usage and precision
    result is only memory on proc 0, not averaged across procs
+   breakdown is app, solver, comm, dump
 ------------------------------------------------------------------------- */
 
 void Output::memory_usage()
 {
-  bigint bytes = 0;
-  bytes += app->memory_usage();
-
-  double mbytes = bytes/1024.0/1024.0;
+  double mbytes[4];
+  mbytes[0] = app->memory_usage()/1024.0/1024.0;
+  mbytes[1] = app->memory_usage_solve()/1024.0/1024.0;
+  mbytes[2] = app->memory_usage_comm()/1024.0/1024.0;
+  mbytes[3] = memory_usage_dump()/1024.0/1024.0;
+  double mtotal = mbytes[0] + mbytes[1] + mbytes[2] + mbytes[3];
 
   if (me == 0) {
     if (screen) {
       fprintf(screen,"Running with %d-bit site IDs\n",8*sizeof(tagint));
-      fprintf(screen,"Memory usage per processor = %g Mbytes\n",mbytes);
+      fprintf(screen,"Memory usage per processor = %g Mbytes\n",mtotal);
+      fprintf(screen,"  app %g, solve %g, comm %g, dump %g Mbytes\n",
+	      mbytes[0],mbytes[1],mbytes[2],mbytes[3]);
     } if (logfile) {
       fprintf(logfile,"Running with %d-bit site IDs\n",8*sizeof(tagint));
-      fprintf(logfile,"Memory usage per processor = %g Mbytes\n",mbytes);
+      fprintf(logfile,"Memory usage per processor = %g Mbytes\n",mtotal);
+      fprintf(logfile,"  app %g, solve %g, comm %g, dump %g Mbytes\n",
+	      mbytes[0],mbytes[1],mbytes[2],mbytes[3]);
     }
   }
 }
+
+/* ----------------------------------------------------------------------
+   sum memory usage of all dumps on this proc
+------------------------------------------------------------------------- */
+
+bigint Output::memory_usage_dump()
+{
+  bigint bytes = 0;
+  for (int i = 0; i < ndump; i++) bytes += dumplist[i]->memory_usage();
+  return bytes;
+}
@@ -17,17 +17,23 @@ namespace SPPARKS_NS {
 
 class Output : protected Pointers {
  public:
+  class Ensemble *ensemble;          // replica statistics, NULL if none
+
   Output(class SPPARKS *);
   ~Output();
   void init(double);
+  void rebalance();
   double setup(double, int memflag=1);
   double compute(double, int);
   void set_stats(int, char **);
+  void set_ensemble(int, char **);
+  void set_callback(void (*)(void *, double, void *), void *, double);
   void add_dump(int, char **);
   void dump_one(int, char **);
   void dump_modify(int, char **);
   void undump(int, char **);
   void add_diag(class Diag *);
+  bigint memory_usage_dump();
 
  private:
   int me,nprocs;
@@ -43,7 +49,12 @@ class Output : protected Pointers {
   int ndiag;                         // list of diagnostics
   class Diag **diaglist;
 
-  void stats(int);
+  void (*callback)(void *, double, void *);  // in-situ analysis function
+  void *callback_data;               // caller data passed to callback
+  double callback_delta;             // time between calls, 0 = end of run
+  double callback_time;              // next time to call it
+
+  void stats(int, double);
   void stats_header();
   double next_time(double, int, double, int, double, double);
   void memory_usage();               // print out memory usage
@@ -84,4 +95,8 @@ E: Could not find dump ID in undump command
 
 Self-explanatory.
 
+E: Invalid callback interval
+
+The time between calls of a library callback cannot be negative.
+
 */
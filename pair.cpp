@@ -16,6 +16,7 @@
 #include "stdlib.h"
 #include "string.h"
 #include "pair.h"
+#include "memory.h"
 #include "error.h"
 
 using namespace SPPARKS_NS;
@@ -29,6 +30,20 @@ Pair::Pair(SPPARKS *spk) : Pointers(spk)
 {
   mix_flag = GEOMETRIC;
   allocated = 0;
+
+  maxgather = 0;
+  xg = yg = zg = NULL;
+  tg = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Pair::~Pair()
+{
+  memory->destroy(xg);
+  memory->destroy(yg);
+  memory->destroy(zg);
+  memory->destroy(tg);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -63,6 +78,61 @@ void Pair::init()
     }
 }
 
+/* ----------------------------------------------------------------------
+   energy of site I at its current coords and at trial coords XTRIAL
+   default is two calls to energy(), styles can do it in one pass
+------------------------------------------------------------------------- */
+
+void Pair::energy_trial(int i, int numneigh, int *neighs, double **x,
+			int *type, double *xtrial, double &eold, double &etrial)
+{
+  double xold[3];
+
+  eold = energy(i,numneigh,neighs,x,type);
+
+  xold[0] = x[i][0];
+  xold[1] = x[i][1];
+  xold[2] = x[i][2];
+  x[i][0] = xtrial[0];
+  x[i][1] = xtrial[1];
+  x[i][2] = xtrial[2];
+
+  etrial = energy(i,numneigh,neighs,x,type);
+
+  x[i][0] = xold[0];
+  x[i][1] = xold[1];
+  x[i][2] = xold[2];
+}
+
+/* ----------------------------------------------------------------------
+   copy coords and types of neighbors into contiguous arrays
+   so energy loops stream through memory with unit stride
+------------------------------------------------------------------------- */
+
+void Pair::gather(int numneigh, int *neighs, double **x, int *type)
+{
+  if (numneigh > maxgather) {
+    maxgather = numneigh;
+    memory->destroy(xg);
+    memory->destroy(yg);
+    memory->destroy(zg);
+    memory->destroy(tg);
+    memory->create(xg,maxgather,"pair:xg");
+    memory->create(yg,maxgather,"pair:yg");
+    memory->create(zg,maxgather,"pair:zg");
+    memory->create(tg,maxgather,"pair:tg");
+  }
+
+  int j;
+  for (int jj = 0; jj < numneigh; jj++) {
+    j = neighs[jj];
+    xg[jj] = x[j][0];
+    yg[jj] = x[j][1];
+    zg[jj] = x[j][2];
+    tg[jj] = type[j];
+  }
+}
+
 /* ----------------------------------------------------------------------
    mixing of pair potential prefactors (epsilon)
 ------------------------------------------------------------------------- */
@@ -24,7 +24,7 @@ class Pair : protected Pointers {
   double cutoff;
 
   Pair(class SPPARKS *);
-  virtual ~Pair() {}
+  virtual ~Pair();
   void init();
 
   virtual void settings(int, char **) = 0;
@@ -32,6 +32,8 @@ class Pair : protected Pointers {
   virtual void init_style() {}
   virtual double init_one(int, int) {return 0.0;}
   virtual double energy(int, int, int *, double **, int *) = 0;
+  virtual void energy_trial(int, int, int *, double **, int *, double *,
+			    double &, double &);
 
  protected:
   int allocated;                       // 0/1 = whether arrays are allocated
@@ -39,6 +41,12 @@ class Pair : protected Pointers {
   double **cutsq;
   int mix_flag;
 
+  int maxgather;                       // size of gather arrays
+  double *xg,*yg,*zg;                  // coords of neighbors, one per array
+  int *tg;                             // types of neighbors
+
+  void gather(int, int *, double **, int *);
+
   double mix_energy(double, double, double, double);
   double mix_distance(double, double);
 };
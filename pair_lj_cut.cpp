@@ -45,42 +45,98 @@ PairLJCut::~PairLJCut()
   }
 }
 
-/* ---------------------------------------------------------------------- */
+/* ----------------------------------------------------------------------
+   energy of site I with its neighbors
+   neighbors are gathered first so the loop has unit stride and no
+     branches, a neighbor outside the cutoff adds 0.0
+------------------------------------------------------------------------- */
 
 double PairLJCut::energy(int i, int numneigh, int *neighs,
 			 double **x, int *type)
 {
-  int j,jj,itype,jtype;
-  double xtmp,ytmp,ztmp,delx,dely,delz;
-  double rsq,r2inv,r6inv;
-  double phi;
+  int jj,jtype;
+  double delx,dely,delz,rsq,r2inv,r6inv,phi;
 
-  itype = type[i];
-  xtmp = x[i][0];
-  ytmp = x[i][1];
-  ztmp = x[i][2];
+  gather(numneigh,neighs,x,type);
+
+  int itype = type[i];
+  double xtmp = x[i][0];
+  double ytmp = x[i][1];
+  double ztmp = x[i][2];
+  double *cutsqi = cutsq[itype];
+  double *lj3i = lj3[itype];
+  double *lj4i = lj4[itype];
+  double *offseti = offset[itype];
 
   double eng = 0.0;
   for (jj = 0; jj < numneigh; jj++) {
-    j = neighs[jj];
-    jtype = type[j];
-    delx = xtmp - x[j][0];
-    dely = ytmp - x[j][1];
-    delz = ztmp - x[j][2];
+    jtype = tg[jj];
+    delx = xtmp - xg[jj];
+    dely = ytmp - yg[jj];
+    delz = ztmp - zg[jj];
     rsq = delx*delx + dely*dely + delz*delz;
-
-    if (rsq < cutsq[itype][jtype]) {
-      r2inv = 1.0/rsq;
-      r6inv = r2inv*r2inv*r2inv;
-      phi = r6inv*(lj3[itype][jtype]*r6inv-lj4[itype][jtype]) -
-	offset[itype][jtype];
-      eng += phi;
-    }
+    r2inv = 1.0/rsq;
+    r6inv = r2inv*r2inv*r2inv;
+    phi = r6inv*(lj3i[jtype]*r6inv-lj4i[jtype]) - offseti[jtype];
+    eng += (rsq < cutsqi[jtype]) ? phi : 0.0;
   }
 
   return eng;
 }
 
+/* ----------------------------------------------------------------------
+   energy of site I at current coords and at trial coords in one pass
+------------------------------------------------------------------------- */
+
+void PairLJCut::energy_trial(int i, int numneigh, int *neighs, double **x,
+			     int *type, double *xtrial,
+			     double &eold, double &etrial)
+{
+  int jj,jtype;
+  double delx,dely,delz,rsq,r2inv,r6inv,phi;
+
+  gather(numneigh,neighs,x,type);
+
+  int itype = type[i];
+  double xtmp = x[i][0];
+  double ytmp = x[i][1];
+  double ztmp = x[i][2];
+  double xnew = xtrial[0];
+  double ynew = xtrial[1];
+  double znew = xtrial[2];
+  double *cutsqi = cutsq[itype];
+  double *lj3i = lj3[itype];
+  double *lj4i = lj4[itype];
+  double *offseti = offset[itype];
+
+  double eng = 0.0;
+  double engnew = 0.0;
+  for (jj = 0; jj < numneigh; jj++) {
+    jtype = tg[jj];
+
+    delx = xtmp - xg[jj];
+    dely = ytmp - yg[jj];
+    delz = ztmp - zg[jj];
+    rsq = delx*delx + dely*dely + delz*delz;
+    r2inv = 1.0/rsq;
+    r6inv = r2inv*r2inv*r2inv;
+    phi = r6inv*(lj3i[jtype]*r6inv-lj4i[jtype]) - offseti[jtype];
+    eng += (rsq < cutsqi[jtype]) ? phi : 0.0;
+
+    delx = xnew - xg[jj];
+    dely = ynew - yg[jj];
+    delz = znew - zg[jj];
+    rsq = delx*delx + dely*dely + delz*delz;
+    r2inv = 1.0/rsq;
+    r6inv = r2inv*r2inv*r2inv;
+    phi = r6inv*(lj3i[jtype]*r6inv-lj4i[jtype]) - offseti[jtype];
+    engnew += (rsq < cutsqi[jtype]) ? phi : 0.0;
+  }
+
+  eold = eng;
+  etrial = engnew;
+}
+
 /* ----------------------------------------------------------------------
    allocate all arrays 
 ------------------------------------------------------------------------- */
@@ -28,6 +28,8 @@ class PairLJCut : public Pair {
   PairLJCut(class SPPARKS *);
   ~PairLJCut();
   double energy(int, int, int *, double **, int *);
+  void energy_trial(int, int, int *, double **, int *, double *,
+		    double &, double &);
   void settings(int, char **);
   void coeff(int, char **);
   double init_one(int, int);
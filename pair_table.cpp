@@ -0,0 +1,486 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under 
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#include "mpi.h"
+#include "math.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "pair_table.h"
+#include "potential.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace SPPARKS_NS;
+
+#define MAXLINE 1024
+
+/* ---------------------------------------------------------------------- */
+
+PairTable::PairTable(SPPARKS *spk) : Pair(spk)
+{
+  MPI_Comm_rank(world,&me);
+
+  tablength = 0;
+  ntables = 0;
+  tables = NULL;
+  tabindex = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+PairTable::~PairTable()
+{
+  for (int m = 0; m < ntables; m++) free_table(&tables[m]);
+  memory->sfree(tables);
+
+  if (allocated) {
+    memory->destroy(setflag);
+    memory->destroy(cutsq);
+    memory->destroy(tabindex);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   energy of site I with its neighbors
+   linear interpolation in rsq, a neighbor inside the first table point
+     extrapolates from the first interval, outside the cutoff adds 0.0
+------------------------------------------------------------------------- */
+
+double PairTable::energy(int i, int numneigh, int *neighs,
+			 double **x, int *type)
+{
+  int jj,jtype,itable;
+  double delx,dely,delz,rsq,t,frac,phi;
+  Table *tb;
+
+  gather(numneigh,neighs,x,type);
+
+  int itype = type[i];
+  double xtmp = x[i][0];
+  double ytmp = x[i][1];
+  double ztmp = x[i][2];
+  double *cutsqi = cutsq[itype];
+  int *tabindexi = tabindex[itype];
+  double tmax = tablength - 2;
+
+  double eng = 0.0;
+  for (jj = 0; jj < numneigh; jj++) {
+    jtype = tg[jj];
+    delx = xtmp - xg[jj];
+    dely = ytmp - yg[jj];
+    delz = ztmp - zg[jj];
+    rsq = delx*delx + dely*dely + delz*delz;
+    tb = &tables[tabindexi[jtype]];
+    t = (rsq - tb->innersq) * tb->invdelta;
+    itable = static_cast<int> (MIN(MAX(t,0.0),tmax));
+    frac = t - itable;
+    phi = tb->e[itable] + frac*tb->de[itable];
+    eng += (rsq < cutsqi[jtype]) ? phi : 0.0;
+  }
+
+  return eng;
+}
+
+/* ----------------------------------------------------------------------
+   energy of site I at current coords and at trial coords in one pass
+------------------------------------------------------------------------- */
+
+void PairTable::energy_trial(int i, int numneigh, int *neighs, double **x,
+			     int *type, double *xtrial,
+			     double &eold, double &etrial)
+{
+  int jj,jtype,itable;
+  double delx,dely,delz,rsq,t,frac,phi;
+  Table *tb;
+
+  gather(numneigh,neighs,x,type);
+
+  int itype = type[i];
+  double xtmp = x[i][0];
+  double ytmp = x[i][1];
+  double ztmp = x[i][2];
+  double xnew = xtrial[0];
+  double ynew = xtrial[1];
+  double znew = xtrial[2];
+  double *cutsqi = cutsq[itype];
+  int *tabindexi = tabindex[itype];
+  double tmax = tablength - 2;
+
+  double eng = 0.0;
+  double engnew = 0.0;
+  for (jj = 0; jj < numneigh; jj++) {
+    jtype = tg[jj];
+    tb = &tables[tabindexi[jtype]];
+
+    delx = xtmp - xg[jj];
+    dely = ytmp - yg[jj];
+    delz = ztmp - zg[jj];
+    rsq = delx*delx + dely*dely + delz*delz;
+    t = (rsq - tb->innersq) * tb->invdelta;
+    itable = static_cast<int> (MIN(MAX(t,0.0),tmax));
+    frac = t - itable;
+    phi = tb->e[itable] + frac*tb->de[itable];
+    eng += (rsq < cutsqi[jtype]) ? phi : 0.0;
+
+    delx = xnew - xg[jj];
+    dely = ynew - yg[jj];
+    delz = znew - zg[jj];
+    rsq = delx*delx + dely*dely + delz*delz;
+    t = (rsq - tb->innersq) * tb->invdelta;
+    itable = static_cast<int> (MIN(MAX(t,0.0),tmax));
+    frac = t - itable;
+    phi = tb->e[itable] + frac*tb->de[itable];
+    engnew += (rsq < cutsqi[jtype]) ? phi : 0.0;
+  }
+
+  eold = eng;
+  etrial = engnew;
+}
+
+/* ----------------------------------------------------------------------
+   allocate all arrays 
+------------------------------------------------------------------------- */
+
+void PairTable::allocate()
+{
+  allocated = 1;
+  int n = ntypes;
+
+  memory->create(setflag,n+1,n+1,"pair:setflag");
+  for (int i = 1; i <= n; i++)
+    for (int j = i; j <= n; j++)
+      setflag[i][j] = 0;
+
+  memory->create(cutsq,n+1,n+1,"pair:cutsq");
+  memory->create(tabindex,n+1,n+1,"pair:tabindex");
+}
+
+/* ----------------------------------------------------------------------
+   global settings 
+------------------------------------------------------------------------- */
+
+void PairTable::settings(int narg, char **arg)
+{
+  if (narg != 2) error->all(FLERR,"Illegal pair_style command");
+
+  ntypes = atoi(arg[0]);
+  tablength = atoi(arg[1]);
+  if (ntypes <= 0) error->all(FLERR,"Illegal pair_style command");
+  if (tablength < 2) error->all(FLERR,"Invalid pair table length");
+
+  // delete old tables, since cannot just change settings
+
+  for (int m = 0; m < ntables; m++) free_table(&tables[m]);
+  memory->sfree(tables);
+  ntables = 0;
+  tables = NULL;
+
+  if (allocated) {
+    memory->destroy(setflag);
+    memory->destroy(cutsq);
+    memory->destroy(tabindex);
+  }
+  allocated = 0;
+}
+
+/* ----------------------------------------------------------------------
+   set coeffs for one or more type pairs
+   each pair_coeff command reads one table from a file
+------------------------------------------------------------------------- */
+
+void PairTable::coeff(int narg, char **arg)
+{
+  if (narg < 4 || narg > 5) 
+    error->all(FLERR,"Incorrect args for pair coefficients");
+  if (!allocated) allocate();
+
+  int ilo,ihi,jlo,jhi;
+  potential->bounds(arg[0],ntypes,ilo,ihi);
+  potential->bounds(arg[1],ntypes,jlo,jhi);
+
+  tables = (Table *) 
+    memory->srealloc(tables,(ntables+1)*sizeof(Table),"pair:tables");
+  Table *tb = &tables[ntables];
+  null_table(tb);
+  read_table(tb,arg[2],arg[3]);
+  bcast_table(tb);
+
+  // cutoff defaults to outermost r in file
+  // must lie beyond innermost r so the table has non-zero width
+
+  tb->cut = tb->rfile[tb->ninput-1];
+  if (narg == 5) tb->cut = atof(arg[4]);
+  if (tb->cut <= tb->rfile[0] || tb->cut > tb->rfile[tb->ninput-1])
+    error->all(FLERR,"Invalid pair table cutoff");
+
+  spline_table(tb);
+
+  int count = 0;
+  for (int i = ilo; i <= ihi; i++) {
+    for (int j = MAX(jlo,i); j <= jhi; j++) {
+      tabindex[i][j] = ntables;
+      setflag[i][j] = 1;
+      count++;
+    }
+  }
+
+  if (count == 0) error->all(FLERR,"Incorrect args for pair coefficients");
+  ntables++;
+}
+
+/* ----------------------------------------------------------------------
+   init for one type pair i,j and corresponding j,i
+   tables are not mixed, so each I,J must be set explicitly
+------------------------------------------------------------------------- */
+
+double PairTable::init_one(int i, int j)
+{
+  if (setflag[i][j] == 0) error->all(FLERR,"All pair coeffs are not set");
+
+  tabindex[j][i] = tabindex[i][j];
+  Table *tb = &tables[tabindex[i][j]];
+  compute_table(tb);
+
+  return tb->cut;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairTable::null_table(Table *tb)
+{
+  tb->rfile = tb->efile = tb->e2file = NULL;
+  tb->e = tb->de = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairTable::free_table(Table *tb)
+{
+  memory->destroy(tb->rfile);
+  memory->destroy(tb->efile);
+  memory->destroy(tb->e2file);
+  memory->destroy(tb->e);
+  memory->destroy(tb->de);
+}
+
+/* ----------------------------------------------------------------------
+   read a table section from a tabulated potential file
+   only called by proc 0
+   format is a keyword line, a parameter line "N n [R rlo rhi]",
+     a blank line, then n lines of "index r energy [force]"
+------------------------------------------------------------------------- */
+
+void PairTable::read_table(Table *tb, char *file, char *keyword)
+{
+  if (me != 0) return;
+
+  char line[MAXLINE];
+
+  FILE *fp = fopen(file,"r");
+  if (fp == NULL) {
+    char str[128];
+    sprintf(str,"Cannot open file %s",file);
+    error->one(FLERR,str);
+  }
+
+  // loop until section found with matching keyword
+
+  while (1) {
+    if (fgets(line,MAXLINE,fp) == NULL)
+      error->one(FLERR,"Did not find keyword in table file");
+    if (strspn(line," \t\n\r") == strlen(line)) continue;  // blank line
+    if (line[0] == '#') continue;                          // comment
+    char *word = strtok(line," \t\n\r");
+    if (strcmp(word,keyword) == 0) break;                  // matching keyword
+
+    // skip a non-matching section: parameter line, blank, N lines
+
+    if (fgets(line,MAXLINE,fp) == NULL)
+      error->one(FLERR,"Premature end of file in pair table");
+    tb->ninput = 0;
+    word = strtok(line," \t\n\r");
+    while (word) {
+      if (strcmp(word,"N") == 0) tb->ninput = atoi(strtok(NULL," \t\n\r"));
+      word = strtok(NULL," \t\n\r");
+    }
+    if (tb->ninput <= 0) error->one(FLERR,"Pair table parameters did not set N");
+    for (int i = 0; i < tb->ninput+1; i++)
+      if (fgets(line,MAXLINE,fp) == NULL)
+	error->one(FLERR,"Premature end of file in pair table");
+  }
+
+  // parse parameter line
+
+  if (fgets(line,MAXLINE,fp) == NULL)
+    error->one(FLERR,"Premature end of file in pair table");
+
+  tb->ninput = 0;
+  tb->rflag = 0;
+  char *word = strtok(line," \t\n\r");
+  while (word) {
+    if (strcmp(word,"N") == 0) {
+      word = strtok(NULL," \t\n\r");
+      if (word == NULL) error->one(FLERR,"Invalid keyword in pair table parameters");
+      tb->ninput = atoi(word);
+    } else if (strcmp(word,"R") == 0) {
+      tb->rflag = 1;
+      char *lo = strtok(NULL," \t\n\r");
+      char *hi = strtok(NULL," \t\n\r");
+      if (lo == NULL || hi == NULL)
+	error->one(FLERR,"Invalid keyword in pair table parameters");
+      tb->rlo = atof(lo);
+      tb->rhi = atof(hi);
+    } else error->one(FLERR,"Invalid keyword in pair table parameters");
+    word = strtok(NULL," \t\n\r");
+  }
+
+  if (tb->ninput < 2) error->one(FLERR,"Pair table parameters did not set N");
+
+  // read r,e table values from file
+  // if rflag set, r values are evenly spaced between rlo and rhi
+
+  memory->create(tb->rfile,tb->ninput,"pair:rfile");
+  memory->create(tb->efile,tb->ninput,"pair:efile");
+
+  if (fgets(line,MAXLINE,fp) == NULL)
+    error->one(FLERR,"Premature end of file in pair table");
+
+  int itmp;
+  double rtmp;
+  for (int i = 0; i < tb->ninput; i++) {
+    if (fgets(line,MAXLINE,fp) == NULL)
+      error->one(FLERR,"Premature end of file in pair table");
+    if (sscanf(line,"%d %lg %lg",&itmp,&rtmp,&tb->efile[i]) != 3)
+      error->one(FLERR,"Premature end of file in pair table");
+    if (tb->rflag)
+      rtmp = tb->rlo + (tb->rhi - tb->rlo)*i/(tb->ninput-1);
+    tb->rfile[i] = rtmp;
+  }
+
+  fclose(fp);
+
+  for (int i = 0; i < tb->ninput; i++) {
+    if (tb->rfile[i] <= 0.0) error->one(FLERR,"Invalid pair table values");
+    if (i && tb->rfile[i] <= tb->rfile[i-1])
+      error->one(FLERR,"Invalid pair table values");
+  }
+}
+
+/* ----------------------------------------------------------------------
+   broadcast read-in table info from proc 0 to other procs
+------------------------------------------------------------------------- */
+
+void PairTable::bcast_table(Table *tb)
+{
+  MPI_Bcast(&tb->ninput,1,MPI_INT,0,world);
+  MPI_Bcast(&tb->rflag,1,MPI_INT,0,world);
+  MPI_Bcast(&tb->rlo,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&tb->rhi,1,MPI_DOUBLE,0,world);
+
+  if (me > 0) {
+    memory->create(tb->rfile,tb->ninput,"pair:rfile");
+    memory->create(tb->efile,tb->ninput,"pair:efile");
+  }
+
+  MPI_Bcast(tb->rfile,tb->ninput,MPI_DOUBLE,0,world);
+  MPI_Bcast(tb->efile,tb->ninput,MPI_DOUBLE,0,world);
+}
+
+/* ----------------------------------------------------------------------
+   spline the read-in energies as a function of r
+------------------------------------------------------------------------- */
+
+void PairTable::spline_table(Table *tb)
+{
+  memory->create(tb->e2file,tb->ninput,"pair:e2file");
+  spline(tb->rfile,tb->efile,tb->ninput,tb->e2file);
+}
+
+/* ----------------------------------------------------------------------
+   build table of tablength points evenly spaced in rsq
+   from innermost r in file to cutoff
+------------------------------------------------------------------------- */
+
+void PairTable::compute_table(Table *tb)
+{
+  memory->destroy(tb->e);
+  memory->destroy(tb->de);
+  memory->create(tb->e,tablength,"pair:e");
+  memory->create(tb->de,tablength,"pair:de");
+
+  double inner = tb->rfile[0];
+  tb->innersq = inner*inner;
+  double delta = (tb->cut*tb->cut - tb->innersq) / (tablength-1);
+  tb->invdelta = 1.0/delta;
+
+  double r;
+  for (int i = 0; i < tablength; i++) {
+    r = sqrt(tb->innersq + i*delta);
+    if (i == tablength-1) r = tb->cut;
+    tb->e[i] = splint(tb->rfile,tb->efile,tb->e2file,tb->ninput,r);
+  }
+
+  for (int i = 0; i < tablength-1; i++) tb->de[i] = tb->e[i+1] - tb->e[i];
+  tb->de[tablength-1] = 0.0;
+}
+
+/* ----------------------------------------------------------------------
+   natural cubic spline: 2nd derivatives Y2 of tabulated Y(X)
+------------------------------------------------------------------------- */
+
+void PairTable::spline(double *x, double *y, int n, double *y2)
+{
+  int i,k;
+  double p,qn,sig,un;
+  double *u = new double[n];
+
+  y2[0] = u[0] = 0.0;
+  for (i = 1; i < n-1; i++) {
+    sig = (x[i]-x[i-1]) / (x[i+1]-x[i-1]);
+    p = sig*y2[i-1] + 2.0;
+    y2[i] = (sig-1.0) / p;
+    u[i] = (y[i+1]-y[i]) / (x[i+1]-x[i]) - (y[i]-y[i-1]) / (x[i]-x[i-1]);
+    u[i] = (6.0*u[i] / (x[i+1]-x[i-1]) - sig*u[i-1]) / p;
+  }
+
+  qn = un = 0.0;
+  y2[n-1] = (un-qn*u[n-2]) / (qn*y2[n-2] + 1.0);
+  for (k = n-2; k >= 0; k--) y2[k] = y2[k]*y2[k+1] + u[k];
+
+  delete [] u;
+}
+
+/* ----------------------------------------------------------------------
+   evaluate spline of Y(X) with 2nd derivatives Y2 at point X0
+------------------------------------------------------------------------- */
+
+double PairTable::splint(double *xa, double *ya, double *y2a, int n, double x)
+{
+  int klo,khi,k;
+  double h,b,a,y;
+
+  klo = 0;
+  khi = n-1;
+  while (khi-klo > 1) {
+    k = (khi+klo) >> 1;
+    if (xa[k] > x) khi = k;
+    else klo = k;
+  }
+  h = xa[khi]-xa[klo];
+  a = (xa[khi]-x) / h;
+  b = (x-xa[klo]) / h;
+  y = a*ya[klo] + b*ya[khi] + 
+    ((a*a*a-a)*y2a[klo] + (b*b*b-b)*y2a[khi]) * (h*h)/6.0;
+  return y;
+}
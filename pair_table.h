@@ -0,0 +1,125 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under 
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#ifdef PAIR_CLASS
+PairStyle(table,PairTable)
+
+#else
+
+#ifndef SPK_PAIR_TABLE_H
+#define SPK_PAIR_TABLE_H
+
+#include "pair.h"
+
+namespace SPPARKS_NS {
+
+class PairTable : public Pair {
+ public:
+  PairTable(class SPPARKS *);
+  ~PairTable();
+  double energy(int, int, int *, double **, int *);
+  void energy_trial(int, int, int *, double **, int *, double *,
+		    double &, double &);
+  void settings(int, char **);
+  void coeff(int, char **);
+  double init_one(int, int);
+
+ protected:
+  int me;
+  int tablength;                    // # of points in interpolation tables
+
+  struct Table {
+    int ninput;                     // # of points read from file
+    int rflag;                      // 1 if R keyword gave evenly spaced r
+    double rlo,rhi;                 // r bounds from R keyword
+    double cut;                     // cutoff of this table
+    double *rfile,*efile;           // r and energy values from file
+    double *e2file;                 // spline 2nd derivatives of efile
+    double innersq;                 // rsq of first point in table
+    double invdelta;                // inverse of rsq spacing of table
+    double *e,*de;                  // energy at each rsq, diff to next
+  };
+
+  int ntables;
+  Table *tables;
+  int **tabindex;                   // table for each I,J type pair
+
+  void allocate();
+  void null_table(Table *);
+  void free_table(Table *);
+  void read_table(Table *, char *, char *);
+  void bcast_table(Table *);
+  void spline_table(Table *);
+  void compute_table(Table *);
+  void spline(double *, double *, int, double *);
+  double splint(double *, double *, double *, int, double);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running SPPARKS to see the offending
+line.
+
+E: Incorrect args for pair coefficients
+
+Self-explanatory.
+
+E: Invalid pair table length
+
+The table length must be at least 2.
+
+E: Invalid pair table cutoff
+
+The cutoff must be larger than the smallest r in the table and no
+larger than the largest r.
+
+E: Cannot open file %s
+
+The specified file cannot be opened.  Check that the path and name are
+correct.
+
+E: Did not find keyword in table file
+
+The keyword used in the pair_coeff command was not found in the file.
+
+E: Invalid keyword in pair table parameters
+
+Keyword used in the N line of the table file is not recognized.
+
+E: Pair table parameters did not set N
+
+The N keyword must be given in the line after the table keyword.
+
+E: Premature end of file in pair table
+
+The file ended before all N lines of the table were read.
+
+E: Invalid pair table values
+
+The r values in a table must be positive and increasing.
+
+E: All pair coeffs are not set
+
+Pair style table does not mix, so every I,J pair needs a
+pair_coeff command.
+
+*/
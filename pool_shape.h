@@ -13,9 +13,31 @@ namespace pool_shape {
 
    enum ShapeType {undefined=-1, ellipse=0, teardrop=1};
 
+   // Largest factor by which the pool cross-section is scaled over the 
+   //    plate thickness T; cross-section at depth z (-T<=z<=0) is scaled by 
+   //    c(z)=(T^2+2Tz(alpha-1)(beta-1)+z^2(alpha-1)(2beta-1))/T^2
+   inline double max_cross_section_scale(double T, double alpha, double beta) {
+      double c1=2*(alpha-1)*(beta-1)/T;
+      double c2=(alpha-1)*(2*beta-1)/(T*T);
+      double cmax=1.0;
+      if(alpha>cmax) cmax=alpha;
+      // interior extremum of quadratic
+      if(c2!=0.0){
+         double z=-c1/(2*c2);
+         if(-T<z && z<0){
+            double c=1+c1*z+c2*z*z;
+            if(c>cmax) cmax=c;
+         }
+      }
+      return cmax;
+   }
+
    class PoolShape {
       public:
          virtual double distance(const double *XYZ) const = 0;
+         // Axis aligned box enclosing pool in pool coordinates; 
+         //    every point outside of box has distance > 0
+         virtual void bounding_box(double *lo, double *hi) const = 0;
          PoolShape() {}
          virtual ~PoolShape() {}
    };
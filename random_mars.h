@@ -24,9 +24,9 @@ class RanMars : protected Pointers {
   ~RanMars();
   void init(int);
   double uniform();
+  int initflag;
 
  private:
-  int initflag;
   int i97,j97;
   double c,cd,cm;
   double *u;
@@ -140,6 +140,7 @@ void ReadSites::command(int narg, char **arg)
       if (app->sites_exist == 0 && sitesflag == 0) 
 	error->all(FLERR,"Cannot read Values before sites exist or are read");
       values();
+      app->valuestamp++;
       valueflag = 1;
 
     } else {
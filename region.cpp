@@ -31,6 +31,8 @@ Region::Region(SPPARKS *spk, int narg, char **arg) : Pointers(spk)
   n = strlen(arg[1]) + 1;
   style = new char[n];
   strcpy(style,arg[1]);
+
+  bboxflag = 0;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -41,6 +43,19 @@ Region::~Region()
   delete [] style;
 }
 
+/* ----------------------------------------------------------------------
+   match n points xyz[list[i]], set flag[i] = 1 if inside, else 0
+   child classes override to avoid a virtual call per point
+------------------------------------------------------------------------- */
+
+void Region::match_many(int n, int *list, double **xyz, int *flag)
+{
+  for (int i = 0; i < n; i++) {
+    double *x = xyz[list[i]];
+    flag[i] = match(x[0],x[1],x[2]);
+  }
+}
+
 /* ----------------------------------------------------------------------
    parse optional parameters at end of region input line
 ------------------------------------------------------------------------- */
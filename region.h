@@ -26,10 +26,12 @@ class Region : protected Pointers {
   double extent_xlo,extent_xhi;     // bounding box on region
   double extent_ylo,extent_yhi;
   double extent_zlo,extent_zhi;
+  int bboxflag;                     // 1 if extent bounds all matched points
   
   Region(class SPPARKS *, int, char **);
   virtual ~Region();
   virtual int match(double, double, double) = 0;
+  virtual void match_many(int, int *, double **, int *);
 
  protected:
   void options(int, char **);
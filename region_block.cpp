@@ -82,6 +82,7 @@ RegBlock::RegBlock(SPPARKS *spk, int narg, char **arg) : Region(spk, narg, arg)
   extent_yhi = yhi;
   extent_zlo = zlo;
   extent_zhi = zhi;
+  bboxflag = interior;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -95,3 +96,17 @@ int RegBlock::match(double x, double y, double z)
 
   return !(inside ^ interior);         // 1 if same, 0 if different
 }
+
+/* ---------------------------------------------------------------------- */
+
+void RegBlock::match_many(int n, int *list, double **xyz, int *flag)
+{
+  int inside;
+  for (int i = 0; i < n; i++) {
+    double *x = xyz[list[i]];
+    if (x[0] >= xlo && x[0] <= xhi && x[1] >= ylo && x[1] <= yhi && 
+	x[2] >= zlo && x[2] <= zhi) inside = 1;
+    else inside = 0;
+    flag[i] = !(inside ^ interior);
+  }
+}
@@ -27,6 +27,7 @@ class RegBlock : public Region {
  public:
   RegBlock(class SPPARKS *, int, char **);
   int match(double, double, double);
+  void match_many(int, int *, double **, int *);
 
  private:
   double xlo,xhi,ylo,yhi,zlo,zhi;
@@ -117,6 +117,7 @@ RegCylinder::RegCylinder(SPPARKS *spk, int narg, char **arg) :
     extent_zlo = lo;
     extent_zhi = hi;
   }
+  bboxflag = interior;
 }
 
 /* ---------------------------------------------------------------------- */
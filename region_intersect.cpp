@@ -15,6 +15,7 @@
 #include "string.h"
 #include "region_intersect.h"
 #include "domain.h"
+#include "memory.h"
 #include "error.h"
 
 using namespace SPPARKS_NS;
@@ -60,6 +61,15 @@ RegIntersect::RegIntersect(SPPARKS *spk, int narg, char **arg) :
     extent_yhi = MIN(extent_yhi,regions[list[ilist]]->extent_yhi);
     extent_zhi = MIN(extent_zhi,regions[list[ilist]]->extent_zhi);
   }
+
+  // extent is valid if every sub-region is bounded by its own extent
+
+  bboxflag = interior;
+  for (int ilist = 0; ilist < nregion; ilist++)
+    if (!regions[list[ilist]]->bboxflag) bboxflag = 0;
+
+  maxflag = 0;
+  subflag = NULL;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -67,6 +77,7 @@ RegIntersect::RegIntersect(SPPARKS *spk, int narg, char **arg) :
 RegIntersect::~RegIntersect()
 {
   delete [] list;
+  memory->destroy(subflag);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -84,3 +95,28 @@ int RegIntersect::match(double x, double y, double z)
 
   return !(inside ^ interior);         // 1 if same, 0 if different
 }
+
+/* ----------------------------------------------------------------------
+   match all points against one sub-region at a time,
+     inside if matched all sub-regions
+------------------------------------------------------------------------- */
+
+void RegIntersect::match_many(int n, int *plist, double **xyz, int *flag)
+{
+  if (n > maxflag) {
+    maxflag = n;
+    memory->destroy(subflag);
+    memory->create(subflag,maxflag,"region:subflag");
+  }
+
+  int i;
+  for (i = 0; i < n; i++) flag[i] = 1;
+
+  Region **regions = domain->regions;
+  for (int ilist = 0; ilist < nregion; ilist++) {
+    regions[list[ilist]]->match_many(n,plist,xyz,subflag);
+    for (i = 0; i < n; i++) flag[i] &= subflag[i];
+  }
+
+  for (i = 0; i < n; i++) flag[i] = !(flag[i] ^ interior);
+}
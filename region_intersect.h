@@ -28,10 +28,13 @@ class RegIntersect : public Region {
   RegIntersect(class SPPARKS *, int, char **);
   ~RegIntersect();
   int match(double, double, double);
+  void match_many(int, int *, double **, int *);
 
  private:
   int nregion;
   int *list;
+  int maxflag;                  // allocated length of subflag
+  int *subflag;                 // flags returned by one sub-region
 };
 
 }
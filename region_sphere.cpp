@@ -43,6 +43,7 @@ RegSphere::RegSphere(SPPARKS *spk, int narg, char **arg) :
   extent_yhi = yc + radius;
   extent_zlo = zc - radius;
   extent_zhi = zc + radius;
+  bboxflag = interior;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -60,3 +61,19 @@ int RegSphere::match(double x, double y, double z)
 
   return !(inside ^ interior);         // 1 if same, 0 if different
 }
+
+/* ---------------------------------------------------------------------- */
+
+void RegSphere::match_many(int n, int *list, double **xyz, int *flag)
+{
+  int inside;
+  for (int i = 0; i < n; i++) {
+    double *x = xyz[list[i]];
+    double delx = x[0] - xc;
+    double dely = x[1] - yc;
+    double delz = x[2] - zc;
+    if (sqrt(delx*delx + dely*dely + delz*delz) <= radius) inside = 1;
+    else inside = 0;
+    flag[i] = !(inside ^ interior);
+  }
+}
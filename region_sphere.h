@@ -27,6 +27,7 @@ class RegSphere : public Region {
  public:
   RegSphere(class SPPARKS *, int, char **);
   int match(double, double, double);
+  void match_many(int, int *, double **, int *);
 
  private:
   double xc,yc,zc;
@@ -15,6 +15,7 @@
 #include "string.h"
 #include "region_union.h"
 #include "domain.h"
+#include "memory.h"
 #include "error.h"
 
 using namespace SPPARKS_NS;
@@ -57,6 +58,15 @@ RegUnion::RegUnion(SPPARKS *spk, int narg, char **arg) : Region(spk, narg, arg)
     extent_yhi = MAX(extent_yhi,regions[list[ilist]]->extent_yhi);
     extent_zhi = MAX(extent_zhi,regions[list[ilist]]->extent_zhi);
   }
+
+  // extent is valid if every sub-region is bounded by its own extent
+
+  bboxflag = interior;
+  for (int ilist = 0; ilist < nregion; ilist++)
+    if (!regions[list[ilist]]->bboxflag) bboxflag = 0;
+
+  maxflag = 0;
+  subflag = NULL;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -64,6 +74,7 @@ RegUnion::RegUnion(SPPARKS *spk, int narg, char **arg) : Region(spk, narg, arg)
 RegUnion::~RegUnion()
 {
   delete [] list;
+  memory->destroy(subflag);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -81,3 +92,28 @@ int RegUnion::match(double x, double y, double z)
 
   return !(inside ^ interior);         // 1 if same, 0 if different
 }
+
+/* ----------------------------------------------------------------------
+   match all points against one sub-region at a time,
+     inside if matched any sub-regions
+------------------------------------------------------------------------- */
+
+void RegUnion::match_many(int n, int *plist, double **xyz, int *flag)
+{
+  if (n > maxflag) {
+    maxflag = n;
+    memory->destroy(subflag);
+    memory->create(subflag,maxflag,"region:subflag");
+  }
+
+  int i;
+  for (i = 0; i < n; i++) flag[i] = 0;
+
+  Region **regions = domain->regions;
+  for (int ilist = 0; ilist < nregion; ilist++) {
+    regions[list[ilist]]->match_many(n,plist,xyz,subflag);
+    for (i = 0; i < n; i++) flag[i] |= subflag[i];
+  }
+
+  for (i = 0; i < n; i++) flag[i] = !(flag[i] ^ interior);
+}
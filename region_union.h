@@ -28,10 +28,13 @@ class RegUnion : public Region {
   RegUnion(class SPPARKS *, int, char **);
   ~RegUnion();
   int match(double, double, double);
+  void match_many(int, int *, double **, int *);
 
  private:
   int nregion;
   int *list;
+  int maxflag;                  // allocated length of subflag
+  int *subflag;                 // flags returned by one sub-region
 };
 
 }
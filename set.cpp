@@ -20,12 +20,12 @@
 #include "app_off_lattice.h"
 #include "domain.h"
 #include "region.h"
+#include "site_index.h"
 #include "random_mars.h"
 #include "random_park.h"
 #include "memory.h"
 #include "error.h"
 
-#include <map>
 
 using namespace SPPARKS_NS;
 
@@ -202,6 +202,7 @@ void Set::command(int narg, char **arg)
   else if (rhs == RANGE) set_range(lhs,rhs);
   else if (rhs == UNIQUE) set_single(lhs,rhs);
   else if (rhs == DISPLACE) set_displace(lhs,rhs);
+  app->valuestamp++;
 
   // statistics
 
@@ -227,7 +228,7 @@ void Set::command(int narg, char **arg)
 
 void Set::set_single(int lhs, int rhs)
 {
-  int i;
+  int i,m;
   tagint iglobal;
 
   int nlocal = app->nlocal;
@@ -235,7 +236,6 @@ void Set::set_single(int lhs, int rhs)
   tagint maxID = app->max_site_ID();
 
   tagint *id = app->id;
-  double **xyz = app->xyz;
   int **iarray = app->iarray;
   double **darray = app->darray;
 
@@ -249,11 +249,10 @@ void Set::set_single(int lhs, int rhs)
   }
 
   count = 0;
+  index_sites();
 
   if (loopflag) {
-    std::map<tagint,int> hash;
-    std::map<tagint,int>::iterator loc;
-    for (i = 0; i < nlocal; i++) hash.insert(std::pair<tagint,int> (id[i],i));
+    lookup->id_first();
 
     if (lhs == IARRAY) {
       if (regionflag == 0 && fraction == 1.0) {
@@ -264,19 +263,18 @@ void Set::set_single(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction == 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (ncondition && condition(i)) continue;
-	    if (rhs == VALUE) iarray[siteindex][i] = ivalue;
-	    else iarray[siteindex][i] = id[i] % MAXSMALLINT;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (ncondition && condition(i)) continue;
+	  if (rhs == VALUE) iarray[siteindex][i] = ivalue;
+	  else iarray[siteindex][i] = id[i] % MAXSMALLINT;
+	  count++;
+	}
       } else if (regionflag == 0 && fraction < 1.0) {
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  if (random->uniform() >= fraction) continue;
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
 	  if (ncondition && condition(i)) continue;
 	  if (rhs == VALUE) iarray[siteindex][i] = ivalue;
 	  else iarray[siteindex][i] = id[i] % MAXSMALLINT;
@@ -285,10 +283,9 @@ void Set::set_single(int lhs, int rhs)
       } else if (regionflag && fraction < 1.0) {
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  if (random->uniform() >= fraction) continue;
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
+	  if (inregion[i]) {
 	    if (ncondition && condition(i)) continue;
 	    if (rhs == VALUE) iarray[siteindex][i] = ivalue;
 	    else iarray[siteindex][i] = id[i] % MAXSMALLINT;
@@ -306,19 +303,18 @@ void Set::set_single(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction == 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (ncondition && condition(i)) continue;
-	    if (rhs == VALUE) darray[siteindex][i] = dvalue;
-	    else darray[siteindex][i] = id[i] % MAXSMALLINT;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (ncondition && condition(i)) continue;
+	  if (rhs == VALUE) darray[siteindex][i] = dvalue;
+	  else darray[siteindex][i] = id[i] % MAXSMALLINT;
+	  count++;
+	}
       } else if (regionflag == 0 && fraction < 1.0) {
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  if (random->uniform() >= fraction) continue;
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
 	  if (ncondition && condition(i)) continue;
 	  if (rhs == VALUE) darray[siteindex][i] = dvalue;
 	  else darray[siteindex][i] = id[i] % MAXSMALLINT;
@@ -327,10 +323,9 @@ void Set::set_single(int lhs, int rhs)
       } else if (regionflag && fraction < 1.0) {
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  if (random->uniform() >= fraction) continue;
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
+	  if (inregion[i]) {
 	    if (ncondition && condition(i)) continue;
 	    if (rhs == VALUE) darray[siteindex][i] = dvalue;
 	    else darray[siteindex][i] = id[i] % MAXSMALLINT;
@@ -350,13 +345,13 @@ void Set::set_single(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction == 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (ncondition && condition(i)) continue;
-	    if (rhs == VALUE) iarray[siteindex][i] = ivalue;
-	    else iarray[siteindex][i] = id[i] % MAXSMALLINT;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (ncondition && condition(i)) continue;
+	  if (rhs == VALUE) iarray[siteindex][i] = ivalue;
+	  else iarray[siteindex][i] = id[i] % MAXSMALLINT;
+	  count++;
+	}
       } else if (regionflag == 0 && fraction < 1.0) {
 	for (i = 0; i < nlocal; i++) {
 	  if (random->uniform() >= fraction) continue;
@@ -366,14 +361,14 @@ void Set::set_single(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction < 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (random->uniform() >= fraction) continue;
-	    if (ncondition && condition(i)) continue;
-	    if (rhs == VALUE) iarray[siteindex][i] = ivalue;
-	    else iarray[siteindex][i] = id[i] % MAXSMALLINT;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (random->uniform() >= fraction) continue;
+	  if (ncondition && condition(i)) continue;
+	  if (rhs == VALUE) iarray[siteindex][i] = ivalue;
+	  else iarray[siteindex][i] = id[i] % MAXSMALLINT;
+	  count++;
+	}
       }
 
     } else if (lhs == DARRAY) {
@@ -385,13 +380,13 @@ void Set::set_single(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction == 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (ncondition && condition(i)) continue;
-	    if (rhs == VALUE) darray[siteindex][i] = ivalue;
-	    else darray[siteindex][i] = id[i] % MAXSMALLINT;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (ncondition && condition(i)) continue;
+	  if (rhs == VALUE) darray[siteindex][i] = ivalue;
+	  else darray[siteindex][i] = id[i] % MAXSMALLINT;
+	  count++;
+	}
       } else if (regionflag == 0 && fraction < 1.0) {
 	for (i = 0; i < nlocal; i++) {
 	  if (random->uniform() < fraction) continue;
@@ -401,18 +396,20 @@ void Set::set_single(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction < 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (random->uniform() < fraction) continue;
-	    if (ncondition && condition(i)) continue;
-	    if (rhs == VALUE) darray[siteindex][i] = ivalue;
-	    else darray[siteindex][i] = id[i] % MAXSMALLINT;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (random->uniform() < fraction) continue;
+	  if (ncondition && condition(i)) continue;
+	  if (rhs == VALUE) darray[siteindex][i] = ivalue;
+	  else darray[siteindex][i] = id[i] % MAXSMALLINT;
+	  count++;
+	}
       }
     }
   }
 
+  memory->destroy(matchlist);
+  memory->destroy(inregion);
   delete random;
 }
 
@@ -423,15 +420,13 @@ void Set::set_single(int lhs, int rhs)
 
 void Set::set_range(int lhs, int rhs)
 {
-  int i;
+  int i,m;
   tagint iglobal;
 
   int nlocal = app->nlocal;
   tagint minID = app->min_site_ID();
   tagint maxID = app->max_site_ID();
 
-  tagint *id = app->id;
-  double **xyz = app->xyz;
   int **iarray = app->iarray;
   double **darray = app->darray;
 
@@ -445,11 +440,10 @@ void Set::set_range(int lhs, int rhs)
   }
 
   count = 0;
+  index_sites();
 
   if (loopflag) {
-    std::map<tagint,int> hash;
-    std::map<tagint,int>::iterator loc;
-    for (i = 0; i < nlocal; i++) hash.insert(std::pair<tagint,int> (id[i],i));
+    lookup->id_first();
 
     if (lhs == IARRAY) {
       int range = ivaluehi - ivaluelo + 1;
@@ -457,9 +451,8 @@ void Set::set_range(int lhs, int rhs)
       if (regionflag == 0 && fraction == 1.0) {
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  ivalue = random->irandom(range);
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
 	  if (ncondition && condition(i)) continue;
 	  iarray[siteindex][i] = ivalue-1 + ivaluelo;
 	  count++;
@@ -467,10 +460,9 @@ void Set::set_range(int lhs, int rhs)
       } else if (regionflag && fraction == 1.0) {
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  ivalue = random->irandom(range);
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
+	  if (inregion[i]) {
 	    if (ncondition && condition(i)) continue;
 	    iarray[siteindex][i] = ivalue-1 + ivaluelo;
 	    count++;
@@ -480,9 +472,8 @@ void Set::set_range(int lhs, int rhs)
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  if (random->uniform() >= fraction) continue;
 	  ivalue = random->irandom(range);
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
 	  if (ncondition && condition(i)) continue;
 	  iarray[siteindex][i] = ivalue-1 + ivaluelo;
 	  count++;
@@ -491,10 +482,9 @@ void Set::set_range(int lhs, int rhs)
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  if (random->uniform() >= fraction) continue;
 	  ivalue = random->irandom(range);
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
+	  if (inregion[i]) {
 	    if (ncondition && condition(i)) continue;
 	    iarray[siteindex][i] = ivalue-1 + ivaluelo;
 	    count++;
@@ -508,9 +498,8 @@ void Set::set_range(int lhs, int rhs)
       if (regionflag == 0 && fraction == 1.0) {
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  dvalue = random->uniform();
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
 	  if (ncondition && condition(i)) continue;
 	  darray[siteindex][i] = range*dvalue + dvaluelo;
 	  count++;
@@ -518,10 +507,9 @@ void Set::set_range(int lhs, int rhs)
       } else if (regionflag && fraction == 1.0) {
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  dvalue = random->uniform();
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
+	  if (inregion[i]) {
 	    if (ncondition && condition(i)) continue;
 	    darray[siteindex][i] = range*dvalue + dvaluelo;
 	    count++;
@@ -531,9 +519,8 @@ void Set::set_range(int lhs, int rhs)
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  if (random->uniform() >= fraction) continue;
 	  dvalue = random->uniform();
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
 	  if (ncondition && condition(i)) continue;
 	  darray[siteindex][i] = range*dvalue + dvaluelo;
 	  count++;
@@ -542,10 +529,9 @@ void Set::set_range(int lhs, int rhs)
 	for (iglobal = minID; iglobal <= maxID; iglobal++) {
 	  if (random->uniform() >= fraction) continue;
 	  dvalue = random->uniform();
-	  loc = hash.find(iglobal);
-	  if (loc == hash.end()) continue;
-	  i = loc->second;
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
+	  i = lookup->id_next(iglobal);
+	  if (i < 0) continue;
+	  if (inregion[i]) {
 	    if (ncondition && condition(i)) continue;
 	    darray[siteindex][i] = range*dvalue + dvaluelo;
 	    count++;
@@ -565,12 +551,12 @@ void Set::set_range(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction == 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (ncondition && condition(i)) continue;
-	    iarray[siteindex][i] = random->irandom(range)-1 + ivaluelo;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (ncondition && condition(i)) continue;
+	  iarray[siteindex][i] = random->irandom(range)-1 + ivaluelo;
+	  count++;
+	}
       } else if (regionflag == 0 && fraction < 1.0) {
 	for (i = 0; i < nlocal; i++) {
 	  if (random->uniform() >= fraction) continue;
@@ -579,13 +565,13 @@ void Set::set_range(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction < 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (random->uniform() >= fraction) continue;
-	    if (ncondition && condition(i)) continue;
-	    iarray[siteindex][i] = random->irandom(range)-1 + ivaluelo;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (random->uniform() >= fraction) continue;
+	  if (ncondition && condition(i)) continue;
+	  iarray[siteindex][i] = random->irandom(range)-1 + ivaluelo;
+	  count++;
+	}
       }
 
     } else if (lhs == DARRAY) {
@@ -598,12 +584,12 @@ void Set::set_range(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction == 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (ncondition && condition(i)) continue;
-	    darray[siteindex][i] = range*random->uniform() + dvaluelo;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (ncondition && condition(i)) continue;
+	  darray[siteindex][i] = range*random->uniform() + dvaluelo;
+	  count++;
+	}
       } else if (regionflag == 0 && fraction < 1.0) {
 	for (i = 0; i < nlocal; i++) {
 	  if (random->uniform() < fraction) continue;
@@ -612,20 +598,49 @@ void Set::set_range(int lhs, int rhs)
 	  count++;
 	}
       } else if (regionflag && fraction < 1.0) {
-	for (i = 0; i < nlocal; i++)
-	  if (domain->regions[iregion]->match(xyz[i][0],xyz[i][1],xyz[i][2])) {
-	    if (random->uniform() < fraction) continue;
-	    if (ncondition && condition(i)) continue;
-	    darray[siteindex][i] = range*random->uniform() + dvaluelo;
-	    count++;
-	  }
+	for (m = 0; m < nmatch; m++) {
+	  i = matchlist[m];
+	  if (random->uniform() < fraction) continue;
+	  if (ncondition && condition(i)) continue;
+	  darray[siteindex][i] = range*random->uniform() + dvaluelo;
+	  count++;
+	}
       }
     }
   }
 
+  memory->destroy(matchlist);
+  memory->destroy(inregion);
   delete random;
 }
 
+/* ----------------------------------------------------------------------
+   prepare app's site index for set_single() and set_range()
+   matchlist = owned sites in region, in ascending local index order
+   inregion = per-site flag for the same sites, used by loops over IDs
+------------------------------------------------------------------------- */
+
+void Set::index_sites()
+{
+  if (app->sitelookup == NULL) app->sitelookup = new SiteIndex(spk);
+  lookup = app->sitelookup;
+
+  int nlocal = app->nlocal;
+  nmatch = 0;
+  matchlist = NULL;
+  inregion = NULL;
+  if (regionflag == 0) return;
+
+  memory->create(matchlist,MAX(nlocal,1),"set:matchlist");
+  nmatch = lookup->region_sites(domain->regions[iregion],matchlist);
+
+  if (loopflag) {
+    memory->create(inregion,MAX(nlocal,1),"set:inregion");
+    for (int i = 0; i < nlocal; i++) inregion[i] = 0;
+    for (int m = 0; m < nmatch; m++) inregion[matchlist[m]] = 1;
+  }
+}
+
 /* ----------------------------------------------------------------------
    displace site coordinates
 ------------------------------------------------------------------------- */
@@ -48,9 +48,15 @@ class Set : protected Pointers {
   int latticeflag;
   class AppLattice *applattice;
   class AppOffLattice *appoff;
+
+  class SiteIndex *lookup;               // app's ID and spatial index
+  int nmatch;                            // # of owned sites in region
+  int *matchlist;                        // indices of those sites
+  char *inregion;                        // 1 if owned site is in region
     
   void set_single(int, int);
   void set_range(int, int);
+  void index_sites();
   void set_displace(int, int);
   int condition(int);
 };
@@ -0,0 +1,269 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under 
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#include "math.h"
+#include "site_index.h"
+#include "app.h"
+#include "region.h"
+#include "memory.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace SPPARKS_NS;
+
+#define SITES_PER_BIN 8
+
+/* ---------------------------------------------------------------------- */
+
+SiteIndex::SiteIndex(SPPARKS *spk) : Pointers(spk)
+{
+  stamp = -1;
+  nlocal = 0;
+  sortid = NULL;
+  sortindex = NULL;
+  icursor = 0;
+  nbin[0] = nbin[1] = nbin[2] = 0;
+  binstart = NULL;
+  binsite = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+SiteIndex::~SiteIndex()
+{
+  memory->destroy(sortid);
+  memory->destroy(sortindex);
+  memory->destroy(binstart);
+  memory->destroy(binsite);
+}
+
+/* ----------------------------------------------------------------------
+   rebuild ID and bin tables if app's sites changed since last build
+------------------------------------------------------------------------- */
+
+void SiteIndex::update()
+{
+  if (stamp == app->sitestamp && nlocal == app->nlocal) return;
+
+  nlocal = app->nlocal;
+  sort_ids();
+  bin_sites();
+  stamp = app->sitestamp;
+}
+
+/* ----------------------------------------------------------------------
+   sort owned site IDs, so a loop over ascending global IDs can
+     find each owned site by advancing a cursor
+------------------------------------------------------------------------- */
+
+void SiteIndex::sort_ids()
+{
+  tagint *id = app->id;
+
+  std::vector<std::pair<tagint,int> > pairs(nlocal);
+  for (int i = 0; i < nlocal; i++) pairs[i] = std::make_pair(id[i],i);
+  std::sort(pairs.begin(),pairs.end());
+
+  memory->destroy(sortid);
+  memory->destroy(sortindex);
+  memory->create(sortid,nlocal,"site_index:sortid");
+  memory->create(sortindex,nlocal,"site_index:sortindex");
+  for (int i = 0; i < nlocal; i++) {
+    sortid[i] = pairs[i].first;
+    sortindex[i] = pairs[i].second;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   bin owned sites on a uniform grid spanning their bounding box
+   sites in each bin are stored in ascending index order
+------------------------------------------------------------------------- */
+
+void SiteIndex::bin_sites()
+{
+  double **xyz = app->xyz;
+  int i,d;
+
+  double lo[3],hi[3];
+  for (d = 0; d < 3; d++) {
+    lo[d] = 0.0;
+    hi[d] = 0.0;
+  }
+  if (nlocal) {
+    for (d = 0; d < 3; d++) lo[d] = hi[d] = xyz[0][d];
+    for (i = 1; i < nlocal; i++)
+      for (d = 0; d < 3; d++) {
+	lo[d] = MIN(lo[d],xyz[i][d]);
+	hi[d] = MAX(hi[d],xyz[i][d]);
+      }
+  }
+
+  // bin size chosen so bins hold ~SITES_PER_BIN sites on average
+  // flat dims, e.g. z in 2d, get a single bin
+
+  int ndim = 0;
+  double volume = 1.0;
+  for (d = 0; d < 3; d++)
+    if (hi[d] > lo[d]) {
+      ndim++;
+      volume *= hi[d]-lo[d];
+    }
+  double binsize = 1.0;
+  if (ndim) binsize = pow(volume*SITES_PER_BIN/MAX(nlocal,1),1.0/ndim);
+
+  bigint ntotal = 1;
+  for (d = 0; d < 3; d++) {
+    binlo[d] = lo[d];
+    if (hi[d] > lo[d]) {
+      nbin[d] = MAX(1,static_cast<int> ((hi[d]-lo[d])/binsize));
+      bininv[d] = nbin[d]/(hi[d]-lo[d]);
+    } else {
+      nbin[d] = 1;
+      bininv[d] = 0.0;
+    }
+    ntotal *= nbin[d];
+  }
+
+  // counting sort of sites by bin, preserves index order within a bin
+
+  int nbins = static_cast<int> (ntotal);
+  memory->destroy(binstart);
+  memory->destroy(binsite);
+  memory->create(binstart,nbins+1,"site_index:binstart");
+  memory->create(binsite,MAX(nlocal,1),"site_index:binsite");
+
+  int *sitebin;
+  memory->create(sitebin,MAX(nlocal,1),"site_index:sitebin");
+  for (i = 0; i <= nbins; i++) binstart[i] = 0;
+  for (i = 0; i < nlocal; i++) {
+    int ix = coord2bin(xyz[i][0],0);
+    int iy = coord2bin(xyz[i][1],1);
+    int iz = coord2bin(xyz[i][2],2);
+    sitebin[i] = (iz*nbin[1] + iy)*nbin[0] + ix;
+    binstart[sitebin[i]+1]++;
+  }
+  for (i = 0; i < nbins; i++) binstart[i+1] += binstart[i];
+
+  int *fill;
+  memory->create(fill,nbins,"site_index:fill");
+  for (i = 0; i < nbins; i++) fill[i] = binstart[i];
+  for (i = 0; i < nlocal; i++) binsite[fill[sitebin[i]]++] = i;
+
+  memory->destroy(fill);
+  memory->destroy(sitebin);
+}
+
+/* ----------------------------------------------------------------------
+   bin index of coord x in dim d, clamped to the grid
+------------------------------------------------------------------------- */
+
+int SiteIndex::coord2bin(double x, int d)
+{
+  if (x <= binlo[d]) return 0;
+  double delta = (x-binlo[d])*bininv[d];
+  if (delta >= nbin[d]) return nbin[d]-1;
+  return static_cast<int> (delta);
+}
+
+/* ----------------------------------------------------------------------
+   store in list the owned sites that match region, in ascending order
+   only sites in bins overlapping a bounded region's extent are tested
+   list must have room for nlocal entries
+   return # of matching sites
+------------------------------------------------------------------------- */
+
+int SiteIndex::region_sites(Region *region, int *list)
+{
+  update();
+
+  int i,n;
+
+  // candidate sites, sorted back into index order if drawn from bins
+
+  n = 0;
+  if (region->bboxflag) {
+    int ilo[3],ihi[3];
+    double extlo[3] = {region->extent_xlo,region->extent_ylo,
+		       region->extent_zlo};
+    double exthi[3] = {region->extent_xhi,region->extent_yhi,
+		       region->extent_zhi};
+    bigint nbins = 1;
+    for (int d = 0; d < 3; d++) {
+      ilo[d] = coord2bin(extlo[d],d);
+      ihi[d] = coord2bin(exthi[d],d);
+      nbins *= ihi[d]-ilo[d]+1;
+    }
+
+    if (2*nbins < (bigint) nbin[0]*nbin[1]*nbin[2]) {
+      for (int iz = ilo[2]; iz <= ihi[2]; iz++)
+	for (int iy = ilo[1]; iy <= ihi[1]; iy++) {
+	  int ibin = (iz*nbin[1] + iy)*nbin[0];
+	  for (int m = binstart[ibin+ilo[0]]; m < binstart[ibin+ihi[0]+1]; m++)
+	    list[n++] = binsite[m];
+	}
+      std::sort(list,list+n);
+    } else {
+      for (i = 0; i < nlocal; i++) list[n++] = i;
+    }
+  } else {
+    for (i = 0; i < nlocal; i++) list[n++] = i;
+  }
+
+  // test candidates together, compact list to matches
+
+  int *flag;
+  memory->create(flag,MAX(n,1),"site_index:flag");
+  region->match_many(n,list,app->xyz,flag);
+  int nmatch = 0;
+  for (i = 0; i < n; i++)
+    if (flag[i]) list[nmatch++] = list[i];
+  memory->destroy(flag);
+
+  return nmatch;
+}
+
+/* ----------------------------------------------------------------------
+   start a lookup pass over ascending global IDs
+------------------------------------------------------------------------- */
+
+void SiteIndex::id_first()
+{
+  update();
+  icursor = 0;
+}
+
+/* ----------------------------------------------------------------------
+   return local index of site with global ID, -1 if not owned
+   successive calls must be for non-decreasing IDs
+------------------------------------------------------------------------- */
+
+int SiteIndex::id_next(tagint iglobal)
+{
+  while (icursor < nlocal && sortid[icursor] < iglobal) icursor++;
+  if (icursor == nlocal || sortid[icursor] != iglobal) return -1;
+  return sortindex[icursor];
+}
+
+/* ---------------------------------------------------------------------- */
+
+bigint SiteIndex::memory_usage()
+{
+  bigint bytes = 0;
+  bytes += (bigint) nlocal * sizeof(tagint);
+  bytes += (bigint) nlocal * sizeof(int);
+  bytes += (bigint) (nbin[0]*nbin[1]*nbin[2]+1) * sizeof(int);
+  bytes += (bigint) nlocal * sizeof(int);
+  return bytes;
+}
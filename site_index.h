@@ -0,0 +1,52 @@
+/* ----------------------------------------------------------------------
+   SPPARKS - Stochastic Parallel PARticle Kinetic Simulator
+   http://www.cs.sandia.gov/~sjplimp/spparks.html
+   Steve Plimpton, sjplimp@sandia.gov, Sandia National Laboratories
+
+   Copyright (2008) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under 
+   the GNU General Public License.
+
+   See the README file in the top-level SPPARKS directory.
+------------------------------------------------------------------------- */
+
+#ifndef SPK_SITE_INDEX_H
+#define SPK_SITE_INDEX_H
+
+#include "pointers.h"
+
+namespace SPPARKS_NS {
+
+class SiteIndex : protected Pointers {
+ public:
+  SiteIndex(class SPPARKS *);
+  ~SiteIndex();
+  void update();
+  int region_sites(class Region *, int *);
+  void id_first();
+  int id_next(tagint);
+  bigint memory_usage();
+
+ private:
+  bigint stamp;               // app sitestamp when tables were built
+  int nlocal;                 // # of owned sites in tables
+
+  tagint *sortid;             // owned site IDs in ascending order
+  int *sortindex;             // local index of each sorted ID
+  int icursor;                // position of last id_next() lookup
+
+  int nbin[3];                // # of bins in each dim
+  double binlo[3];            // lower corner of bin grid
+  double bininv[3];           // inverse bin size in each dim
+  int *binstart;              // 1st entry in binsite for each bin
+  int *binsite;               // owned sites sorted by bin, then index
+
+  void sort_ids();
+  void bin_sites();
+  int coord2bin(double, int);
+};
+
+}
+
+#endif
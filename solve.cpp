@@ -13,6 +13,7 @@
 
 #include "string.h"
 #include "solve.h"
+#include "timer.h"
 
 using namespace SPPARKS_NS;
 
@@ -24,6 +25,10 @@ Solve::Solve(SPPARKS *spk, int narg, char **arg) : Pointers(spk)
   style = new char[n];
   strcpy(style,arg[0]);
   sum = 0.0;
+
+  tinit = timer->find_region("solve_init");
+  tupdate = timer->find_region("solve_update");
+  tevent = timer->find_region("solve_event");
 }
 
 /* ---------------------------------------------------------------------- */
@@ -27,6 +27,7 @@ class Solve : protected Pointers {
 
   double get_total_propensity();
   int get_num_active();
+  virtual bigint memory_usage() {return 0;}
 
   // pure virtual functions, must be defined in child class
 
@@ -41,6 +42,7 @@ class Solve : protected Pointers {
  protected:
   double sum;
   int num_active;
+  int tinit,tupdate,tevent;    // timer region indices
 };
 
 }
@@ -251,3 +251,15 @@ void SolveGroup::round_check()
     error->warning(FLERR,str);
   }
 }
+
+/* ----------------------------------------------------------------------
+   return # of bytes of allocated memory
+------------------------------------------------------------------------- */
+
+bigint SolveGroup::memory_usage()
+{
+  bigint bytes = 0;
+  bytes += memory->usage(p,nevents);
+  bytes += groups->memory_usage();
+  return bytes;
+}
@@ -20,6 +20,7 @@
 #include "random_mars.h"
 #include "random_park.h"
 #include "memory.h"
+#include "timer.h"
 #include "error.h"
 
 using namespace SPPARKS_NS;
@@ -65,7 +66,9 @@ SolveLinear *SolveLinear::clone()
 
 void SolveLinear::init(int n, double *propensity)
 {
-  delete [] prob;
+  timer->region_start(tinit);
+
+  memory->destroy(prob);
   nevents = n;
   memory->create(prob,n,"solve/linear:prob");
 
@@ -77,6 +80,8 @@ void SolveLinear::init(int n, double *propensity)
     prob[i] = propensity[i];
     sum += propensity[i];
   }
+
+  timer->region_stop(tinit);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -84,6 +89,8 @@ void SolveLinear::init(int n, double *propensity)
 void SolveLinear::update(int n, int *indices, double *propensity)
 {
   int m;
+
+  timer->region_start(tupdate);
   for (int i = 0; i < n; i++) {
     m = indices[i];
     if (prob[m] > 0.0) num_active--;
@@ -92,6 +99,7 @@ void SolveLinear::update(int n, int *indices, double *propensity)
     prob[m] = propensity[m];
     sum += propensity[m];
   }
+  timer->region_stop(tupdate);
 }
 /* ---------------------------------------------------------------------- */
 
@@ -121,6 +129,8 @@ int SolveLinear::event(double *pdt)
     return -1;
   }
 
+  timer->region_start(tevent);
+
   double fraction = sum * random->uniform();
   double partial = 0.0;
 
@@ -131,7 +141,19 @@ int SolveLinear::event(double *pdt)
 
   *pdt = -1.0/sum * log(random->uniform());
 
+  timer->region_stop(tevent);
+
   if (m < nevents) return m;
   return nevents-1;
 }
 
+/* ----------------------------------------------------------------------
+   return # of bytes of allocated memory
+------------------------------------------------------------------------- */
+
+bigint SolveLinear::memory_usage()
+{
+  bigint bytes = 0;
+  bytes += memory->usage(prob,nevents);
+  return bytes;
+}
@@ -34,6 +34,7 @@ class SolveLinear : public Solve {
   void update(int, double *);
   void resize(int, double *);
   int event(double *);
+  bigint memory_usage();
 
  private:
   class RandomPark *random;
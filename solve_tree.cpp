@@ -21,8 +21,11 @@
 #include "random_mars.h"
 #include "random_park.h"
 #include "memory.h"
+#include "timer.h"
 #include "error.h"
 
+#define MINTHREAD 4096
+
 using namespace SPPARKS_NS;
 
 /* ---------------------------------------------------------------------- */
@@ -65,46 +68,54 @@ SolveTree *SolveTree::clone()
 
 void SolveTree::init(int n, double *propensity)
 {
+  timer->region_start(tinit);
+
   ntotal = 0;
   offset = 0;
 
   nevents = n;
 
-  // m = tree depth such that 2^m >= nevents
-  // nround = power of 2 >= nevents
-
-  int m = 0;
-  tagint nround = 1;
-  while (nround < nevents) {
-    nround *= 2;
-    m++;
-  }
-
-  // offset = nround - 1 = where propensities start as leaves of tree
-  // ntotal = 2*nround - 1
+  // tree is stored as a heap, children of node I are 2I+1 and 2I+2
+  // with N leaves every internal node has exactly 2 children,
+  //   so leaves need not be padded out to a power of 2
+  // offset = N - 1 = where propensities start as leaves of tree
+  // ntotal = 2*N - 1, N = 1 if there are no events
   // require ntotal <= MAXSMALLINT for indexing the tree
   // means max N = 2^30 = 1 billion
 
-  offset = nround - 1;
-  nround = 2*nround - 1;
-  ntotal = nround;
-  if (ntotal > MAXSMALLINT)
+  bigint nleaf = MAX(nevents,1);
+  if (2*nleaf - 1 > MAXSMALLINT)
     error->one(FLERR,"Per-processor solve tree is too big");
 
+  offset = nleaf - 1;
+  ntotal = 2*nleaf - 1;
+
   memory->destroy(tree);
   memory->create(tree,ntotal,"solve:tree");
 
-  for (int i = 0; i < ntotal; i++) tree[i] = 0.0;
-  for (int i = offset; i < offset + nevents; i++) 
-    tree[i] = propensity[i-offset];
+  // leaves are filled and the tree summed in bulk, threaded for large N
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (ntotal > MINTHREAD)
+#endif
+  for (int i = 0; i < offset; i++) tree[i] = 0.0;
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (ntotal > MINTHREAD)
+#endif
+  for (int i = offset; i < ntotal; i++) 
+    tree[i] = (i-offset < nevents) ? propensity[i-offset] : 0.0;
   sum_tree();
+
+  timer->region_stop(tinit);
 }
 
 /* ---------------------------------------------------------------------- */
 
 void SolveTree::update(int n, int *indices, double *propensity)
 {
+  timer->region_start(tupdate);
   for (int i = 0; i < n; i++) set(indices[i],propensity[indices[i]]);
+  timer->region_stop(tupdate);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -130,11 +141,14 @@ int SolveTree::event(double *pdt)
 
   if (sum == 0.0) return -1;
 
+  timer->region_start(tevent);
+
   r2 = random->uniform();
   m = find(r2*sum);
   
   *pdt = -1.0/sum * log(random->uniform());
 
+  timer->region_stop(tevent);
   return m;
 }
 
@@ -144,11 +158,21 @@ int SolveTree::event(double *pdt)
 
 void SolveTree::sum_tree()
 {
-  int child1,child2;
-  for (int parent = offset-1; parent >= 0; parent--) {
-    child1 = 2*parent + 1;
-    child2 = 2*parent + 2;
-    tree[parent] = tree[child1] + tree[child2];
+  // nodes at one depth of the heap only read nodes one depth below,
+  //   so sum one depth at a time, deepest first, threaded for large N
+  // nodes at depth D are 2^D-1 to 2^(D+1)-2, leaves start at offset
+
+  int depth = 0;
+  while ((1 << (depth+1)) - 1 < offset) depth++;
+
+  for (int d = depth; d >= 0; d--) {
+    int lo = (1 << d) - 1;
+    int hi = MIN((1 << (d+1)) - 2,offset-1);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (hi-lo > MINTHREAD)
+#endif
+    for (int parent = lo; parent <= hi; parent++)
+      tree[parent] = tree[2*parent+1] + tree[2*parent+2];
   }
 
   // update total propensity
@@ -157,9 +181,14 @@ void SolveTree::sum_tree()
 
   // update number of active events
 
-  num_active = 0;
+  int nactive = 0;
+#if defined(_OPENMP)
+#pragma omp parallel for reduction(+:nactive) schedule(static) \
+  if (ntotal > MINTHREAD)
+#endif
   for (int i = offset; i < ntotal; i++) 
-    if (tree[i] > 0.0) num_active++;
+    if (tree[i] > 0.0) nactive++;
+  num_active = nactive;
 }
 
 /* ----------------------------------------------------------------------
@@ -218,3 +247,14 @@ int SolveTree::find(double value)
   }
   return i - offset;
 }
+
+/* ----------------------------------------------------------------------
+   return # of bytes of allocated memory
+------------------------------------------------------------------------- */
+
+bigint SolveTree::memory_usage()
+{
+  bigint bytes = 0;
+  if (tree) bytes += memory->usage(tree,ntotal);
+  return bytes;
+}
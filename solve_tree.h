@@ -34,14 +34,16 @@ class SolveTree : public Solve {
   void update(int, double *);
   void resize(int, double *);
   int event(double *);
+  bigint memory_usage();
+
   void sum_tree();
   void set(int, double);
   int find(double);
 
  private:
   class RandomPark *random;
-  int nevents;            // # of propensities (unrounded)
-  int ntotal;             // # of propensities (rounded up to power-of-2) + tree
+  int nevents;            // # of propensities
+  int ntotal;             // # of propensities + internal tree nodes
   double *tree;           // tree + propensities
   int offset;             // index where propensities start as leaves of tree
 };
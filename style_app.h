@@ -20,4 +20,5 @@
 #include "app_relax.h"
 #include "app_sinter.h"
 #include "app_sos.h"
+#include "app_surface.h"
 #include "app_test_group.h"
@@ -1,3 +1,5 @@
+#include "balance.h"
+#include "bench_solve.h"
 #include "create_box.h"
 #include "create_sites.h"
 #include "read_sites.h"
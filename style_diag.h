@@ -5,7 +5,10 @@
 #include "diag_diffusion.h"
 #include "diag_energy.h"
 #include "diag_erbium.h"
+#include "diag_kmc_profile.h"
+#include "diag_memory.h"
 #include "diag_propensity.h"
 #include "diag_sinter_density.h"
 #include "diag_sinter_free_energy.h"
 #include "diag_sinter_free_energy_pore.h"
+#include "diag_surface.h"
@@ -1 +1,2 @@
 #include "pair_lj_cut.h"
+#include "pair_table.h"
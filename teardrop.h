@@ -8,6 +8,7 @@
 #include <limits>
 #include <stdio.h>
 #include <tuple>
+#include <algorithm>
 #include "pool_shape.h"
 
 namespace weld {
@@ -662,6 +663,23 @@ namespace pool_shape {
 
          virtual ~Teardrop(){}
 
+         virtual void bounding_box(double *lo, double *hi) const {
+            // Teardrop curve lies within convex hull of its control points;
+            //    cross-section at each depth is that curve scaled by c(z) 
+            //    about the origin, mirrored about x=0.
+            vector< vector<double> > cp=this->get_copy_of_control_points();
+            double xmax=0.0, ymin=0.0, ymax=0.0;
+            for(std::size_t i=0;i<cp.size();i++){
+               xmax=std::max(xmax,std::fabs(cp[i][0]));
+               ymin=std::min(ymin,cp[i][1]);
+               ymax=std::max(ymax,cp[i][1]);
+            }
+            double cmax=max_cross_section_scale(_h,_alpha,_beta);
+            lo[0]=-xmax*cmax; hi[0]=xmax*cmax;
+            lo[1]=ymin*cmax;  hi[1]=ymax*cmax;
+            lo[2]=-_h;        hi[2]=0.0;
+         }
+
          virtual double distance(const double *XYZ) const {
             /**
              * For points 'xyz' outside of pool, 
@@ -12,8 +12,11 @@
 ------------------------------------------------------------------------- */
 
 #include "mpi.h"
+#include "string.h"
+#include "stdlib.h"
 #include "timer.h"
 #include "memory.h"
+#include "error.h"
 
 using namespace SPPARKS_NS;
 
@@ -22,6 +25,17 @@ using namespace SPPARKS_NS;
 Timer::Timer(SPPARKS *spk) : Pointers(spk)
 {
   array = (double *) memory->smalloc(TIME_N*sizeof(double),"array");
+  sample = (double *) memory->smalloc(TIME_N*sizeof(double),"sample");
+
+  level = TIMER_NORMAL;
+  every = 1000;
+  ncount = 0;
+  sampled = 0;
+
+  nregion = maxregion = 0;
+  rname = NULL;
+  rcount = NULL;
+  rtotal = rmin = rmax = rstart = NULL;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -29,13 +43,58 @@ Timer::Timer(SPPARKS *spk) : Pointers(spk)
 Timer::~Timer()
 {
   memory->sfree(array);
+  memory->sfree(sample);
+
+  for (int m = 0; m < nregion; m++) delete [] rname[m];
+  memory->sfree(rname);
+  memory->destroy(rcount);
+  memory->destroy(rtotal);
+  memory->destroy(rmin);
+  memory->destroy(rmax);
+  memory->destroy(rstart);
 }
 
 /* ---------------------------------------------------------------------- */
 
 void Timer::init()
 {
-  for (int i = 0; i < TIME_N; i++) array[i] = 0.0;
+  for (int i = 0; i < TIME_N; i++) array[i] = sample[i] = 0.0;
+  ncount = 0;
+  sampled = 0;
+
+  for (int m = 0; m < nregion; m++) {
+    rcount[m] = 0;
+    rtotal[m] = 0.0;
+    rmin[m] = 1.0e20;
+    rmax[m] = 0.0;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   timer command
+   off = no per-event stamps, sample every Nth event for the breakdown
+   normal = stamp every event
+   detailed = normal + named sub-regions inside apps and solvers
+------------------------------------------------------------------------- */
+
+void Timer::set(int narg, char **arg)
+{
+  if (narg < 1) error->all(FLERR,"Illegal timer command");
+
+  if (strcmp(arg[0],"off") == 0) level = TIMER_OFF;
+  else if (strcmp(arg[0],"normal") == 0) level = TIMER_NORMAL;
+  else if (strcmp(arg[0],"detailed") == 0) level = TIMER_DETAILED;
+  else error->all(FLERR,"Illegal timer command");
+
+  int iarg = 1;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"every") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal timer command");
+      every = atoi(arg[iarg+1]);
+      if (every < 0) error->all(FLERR,"Illegal timer command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal timer command");
+  }
 }
 
 /* ---------------------------------------------------------------------- */
@@ -63,7 +122,7 @@ void Timer::stamp(int which)
 void Timer::barrier_start(int which)
 {
   MPI_Barrier(world);
-  array[which] = MPI_Wtime();
+  array[which] = previous_time = MPI_Wtime();
 }
 
 /* ---------------------------------------------------------------------- */
@@ -82,3 +141,56 @@ double Timer::elapsed(int which)
   double current_time = MPI_Wtime();
   return (current_time - array[which]);
 }
+
+/* ----------------------------------------------------------------------
+   split time of unsampled events among buckets
+   in proportion to the time spent in each bucket by sampled events
+   if no events were sampled, unsampled time stays in TIME_EVENT
+------------------------------------------------------------------------- */
+
+void Timer::apportion()
+{
+  double total = 0.0;
+  for (int i = 0; i < TIME_N; i++) total += sample[i];
+
+  if (total > 0.0) {
+    double unsampled = array[TIME_EVENT];
+    for (int i = 0; i < TIME_N; i++)
+      array[i] += sample[i] + unsampled*sample[i]/total;
+    array[TIME_EVENT] = 0.0;
+  }
+
+  for (int i = 0; i < TIME_N; i++) sample[i] = 0.0;
+}
+
+/* ----------------------------------------------------------------------
+   return index of named sub-region, add it if it does not exist
+   all procs must add regions in the same order
+------------------------------------------------------------------------- */
+
+int Timer::find_region(const char *name)
+{
+  for (int m = 0; m < nregion; m++)
+    if (strcmp(name,rname[m]) == 0) return m;
+
+  if (nregion == maxregion) {
+    maxregion += 8;
+    rname = (char **)
+      memory->srealloc(rname,maxregion*sizeof(char *),"timer:rname");
+    memory->grow(rcount,maxregion,"timer:rcount");
+    memory->grow(rtotal,maxregion,"timer:rtotal");
+    memory->grow(rmin,maxregion,"timer:rmin");
+    memory->grow(rmax,maxregion,"timer:rmax");
+    memory->grow(rstart,maxregion,"timer:rstart");
+  }
+
+  int n = strlen(name) + 1;
+  rname[nregion] = new char[n];
+  strcpy(rname[nregion],name);
+  rcount[nregion] = 0;
+  rtotal[nregion] = 0.0;
+  rmin[nregion] = 1.0e20;
+  rmax[nregion] = 0.0;
+  rstart[nregion] = 0.0;
+  return nregion++;
+}
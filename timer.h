@@ -18,25 +18,108 @@
 
 namespace SPPARKS_NS {
 
-enum{TIME_LOOP,TIME_SOLVE,TIME_UPDATE,TIME_COMM,TIME_OUTPUT,TIME_APP,TIME_N};
+enum{TIME_LOOP,TIME_SOLVE,TIME_UPDATE,TIME_COMM,TIME_OUTPUT,TIME_APP,
+     TIME_EVENT,TIME_N};
+enum{TIMER_OFF,TIMER_NORMAL,TIMER_DETAILED};
 
 class Timer : protected Pointers {
  public:
   double *array;
+  int level;                  // TIMER_OFF, TIMER_NORMAL, TIMER_DETAILED
+  int every;                  // sample every Nth event when level = off
+
+  int nregion;                // # of named sub-regions
+  char **rname;               // name of each region
+  bigint *rcount;             // # of times each region was timed
+  double *rtotal;             // total time in each region
+  double *rmin,*rmax;         // min/max time of a single pass thru region
 
   Timer(class SPPARKS *);
   ~Timer();
   void init();
+  void set(int, char **);
   void stamp();
   void stamp(int);
   void barrier_start(int);
   void barrier_stop(int);
   double elapsed(int);
+  void apportion();
+  int find_region(const char *);
+
+  // per-event stamps inside KMC event loops
+  // level = off only stamps every Nth event,
+  //   time of unsampled events is accumulated in TIME_EVENT by event_finish()
+  //   and split among buckets by apportion() using the sampled events
+
+  void event_start() {
+    if (level == TIMER_OFF) {
+      if (every == 0 || ++ncount < every) {
+        sampled = 0;
+        return;
+      }
+      ncount = 0;
+      sampled = 1;
+      double current_time = MPI_Wtime();
+      array[TIME_EVENT] += current_time - previous_time;
+      previous_time = current_time;
+      return;
+    }
+    previous_time = MPI_Wtime();
+  }
+
+  void event_stamp(int which) {
+    if (level == TIMER_OFF) {
+      if (!sampled) return;
+      double current_time = MPI_Wtime();
+      sample[which] += current_time - previous_time;
+      previous_time = current_time;
+      return;
+    }
+    stamp(which);
+  }
+
+  void event_finish() {
+    if (level != TIMER_OFF) return;
+    double current_time = MPI_Wtime();
+    array[TIME_EVENT] += current_time - previous_time;
+    previous_time = current_time;
+    sampled = 0;
+  }
+
+  // named sub-regions, only timed when level = detailed
+
+  void region_start(int m) {
+    if (level == TIMER_DETAILED) rstart[m] = MPI_Wtime();
+  }
+
+  void region_stop(int m) {
+    if (level != TIMER_DETAILED) return;
+    double delta = MPI_Wtime() - rstart[m];
+    rcount[m]++;
+    rtotal[m] += delta;
+    if (delta < rmin[m]) rmin[m] = delta;
+    if (delta > rmax[m]) rmax[m] = delta;
+  }
 
  private:
   double previous_time;
+  double *sample;             // bucket times of sampled events
+  int ncount;                 // events since last sample
+  int sampled;                // 1 if current event is being sampled
+  int maxregion;
+  double *rstart;
 };
 
 }
 
 #endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running SPPARKS to see the offending line.
+
+*/
@@ -102,6 +102,15 @@ namespace pool_shape {
          { } 
 
          virtual ~EllipticBezier() {}
+
+         virtual void bounding_box(double *lo, double *hi) const {
+            // Cross-section at each depth is an ellipse with semi-axes (a,b)
+            //    scaled by c(z); pool extends from top surface down to -T
+            double cmax=max_cross_section_scale(T,alpha,beta);
+            lo[0]=-a*cmax; hi[0]=a*cmax;
+            lo[1]=-b*cmax; hi[1]=b*cmax;
+            lo[2]=-T;      hi[2]=0.0;
+         }
          
          bool is_inside(const double *xyz) const {
             double x=*xyz;